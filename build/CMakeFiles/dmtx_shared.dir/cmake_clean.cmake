@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/dmtx_shared.dir/dmtx.c.o"
+  "CMakeFiles/dmtx_shared.dir/dmtx.c.o.d"
+  "libdmtx.pdb"
+  "libdmtx.so"
+  "libdmtx.so.0"
+  "libdmtx.so.0.7.9"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/dmtx_shared.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/dmtx_static.dir/dmtx.c.o"
+  "CMakeFiles/dmtx_static.dir/dmtx.c.o.d"
+  "libdmtx.a"
+  "libdmtx.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/dmtx_static.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
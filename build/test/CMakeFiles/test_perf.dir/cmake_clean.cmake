@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test_perf.dir/perf_test/perf_test.c.o"
+  "CMakeFiles/test_perf.dir/perf_test/perf_test.c.o.d"
+  "test_perf"
+  "test_perf.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/test_perf.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test_reedsol.dir/reedsol_test/reedsol_test.c.o"
+  "CMakeFiles/test_reedsol.dir/reedsol_test/reedsol_test.c.o.d"
+  "test_reedsol"
+  "test_reedsol.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/test_reedsol.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test_simple.dir/simple_test/simple_test.c.o"
+  "CMakeFiles/test_simple.dir/simple_test/simple_test.c.o.d"
+  "test_simple"
+  "test_simple.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/test_simple.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
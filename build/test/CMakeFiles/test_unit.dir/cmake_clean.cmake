@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test_unit.dir/unit_test/unit_test.c.o"
+  "CMakeFiles/test_unit.dir/unit_test/unit_test.c.o.d"
+  "test_unit"
+  "test_unit.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/test_unit.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,14 @@
+# CMake generated Testfile for 
+# Source directory: /root/repo/test
+# Build directory: /root/repo/build/test
+# 
+# This file includes the relevant testing commands required for 
+# testing this directory and lists subdirectories to be tested as well.
+add_test(test_simple "/root/repo/build/test/test_simple")
+set_tests_properties(test_simple PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;15;add_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(test_unit "/root/repo/build/test/test_unit")
+set_tests_properties(test_unit PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;20;add_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(test_kernel "/root/repo/build/test/test_kernel")
+set_tests_properties(test_kernel PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;26;add_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(test_reedsol "/root/repo/build/test/test_reedsol")
+set_tests_properties(test_reedsol PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;31;add_test;/root/repo/test/CMakeLists.txt;0;")
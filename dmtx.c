@@ -29,6 +29,18 @@
 #include "config.h"
 #endif
 
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#if defined(HAVE_PTHREAD) || defined(HAVE_UNISTD_H)
+#include <unistd.h>
+#endif
+
+#if !defined(HAVE_PTHREAD) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 #include "dmtx.h"
 #include "dmtxstatic.h"
 
@@ -60,6 +72,8 @@
  * "externally" from the other source files in this list.
  */
 
+#include "dmtxalloc.c"
+#include "dmtxthread.c"
 #include "dmtxencode.c"
 #include "dmtxencodestream.c"
 #include "dmtxencodescheme.c"
@@ -71,12 +85,16 @@
 
 #include "dmtxdecode.c"
 #include "dmtxdecodescheme.c"
+#include "dmtxbatch.c"
 
 #include "dmtxmessage.c"
 #include "dmtxregion.c"
+#include "dmtxflowcache.c"
+#include "dmtxscancache.c"
 #include "dmtxsymbol.c"
 #include "dmtxplacemod.c"
 #include "dmtxreedsol.c"
+#include "dmtxsimd.c"
 #include "dmtxscangrid.c"
 
 #include "dmtximage.c"
@@ -178,6 +178,17 @@ typedef enum {
    DmtxPropSquareDevn,
    DmtxPropSymbolSize,
    DmtxPropEdgeThresh,
+   DmtxPropScanPlane,
+   DmtxPropFlowCache,
+   DmtxPropFlowCacheHits,
+   DmtxPropFlowCacheMisses,
+   DmtxPropPyramidLevels,
+   DmtxPropScanCacheLimit,
+   DmtxPropScanCacheBytes,
+   DmtxPropArenaSize,
+   DmtxPropArenaBytes,
+   DmtxPropTileSize,
+   DmtxPropSaliencyCell,
    /* Image properties */
    DmtxPropWidth             = 300,
    DmtxPropHeight,
@@ -229,6 +240,12 @@ typedef enum {
   DmtxFlipY                  = 0x01 << 1
 } DmtxFlip;
 
+typedef enum {
+   DmtxScanPlaneChannels     = 0,  /* Scan every image channel separately */
+   DmtxScanPlaneLuma,              /* Scan one 8-bit luma plane built from the image */
+   DmtxScanPlaneBestChannel        /* Scan a copy of the channel with the widest spread */
+} DmtxScanPlane;
+
 typedef double DmtxMatrix3[3][3];
 
 /**
@@ -291,6 +308,13 @@ struct DmtxEncodeStream_struct
    DmtxByteList *output;
 };
 
+struct DmtxImage_struct;
+
+/* Format-specialized pixel readers bound by dmtxImageCreate(). Callers must
+ * ensure every coordinate touched lies inside the image. */
+typedef int (*DmtxFetchPixel)(const struct DmtxImage_struct *img, int x, int y, int channel);
+typedef void (*DmtxFetchCompass)(const struct DmtxImage_struct *img, int x, int y, int step, int channel, /*@out@*/ int *color);
+
 /**
  * @struct DmtxImage
  * @brief DmtxImage
@@ -308,6 +332,10 @@ typedef struct DmtxImage_struct {
    int             channelStart[4];
    int             bitsPerChannel[4];
    unsigned char  *pxl;
+   int             originOffset;  /* Byte offset of pixel (0,0) within pxl */
+   int             rowStride;     /* Signed byte step from row y to row y+1 */
+   DmtxFetchPixel  fetchPixel;    /* Reads one channel of one pixel */
+   DmtxFetchCompass fetchCompass; /* Reads one channel of the 8 neighbors in dmtxPattern order */
 } DmtxImage;
 
 /**
@@ -401,6 +429,9 @@ typedef struct DmtxMessage_struct {
    size_t          arraySize;     /* mappingRows * mappingCols */
    size_t          codeSize;      /* Size of encoded data (data words + error words) */
    size_t          outputSize;    /* Size of buffer used to hold decoded data */
+   size_t          arrayCapacity; /* Bytes allocated for array, at least arraySize */
+   size_t          codeCapacity;  /* Bytes allocated for code, at least codeSize */
+   size_t          outputCapacity; /* Bytes allocated for output, at least outputSize */
    int             outputIdx;     /* Internal index used to store output progress */
    int             padCount;
    int             fnc1;          /* Character to represent FNC1, or DmtxUndefined */
@@ -435,6 +466,15 @@ typedef struct DmtxScanGrid_struct {
    int             pixelCount;    /* Progress (pixel count) within current cross pattern */
    int             xCenter;       /* X center of current cross pattern */
    int             yCenter;       /* Y center of current cross pattern */
+
+   /* reset for each saliency cell */
+   struct DmtxSaliency_struct *saliency; /* Cell visiting order, or NULL for raster order */
+   int             cellPos;       /* Position of current cell in saliency order */
+   int             cellBegin;     /* First cell position of current pass */
+   int             cellEnd;       /* Cell position ending current pass */
+   int             xStart;        /* X center of first cross pattern in current cell */
+   int             xEnd;          /* Largest X center inside current cell */
+   int             yEnd;          /* Largest Y center inside current cell */
 } DmtxScanGrid;
 
 /**
@@ -461,6 +501,55 @@ typedef struct DmtxScanConstraint_struct {
   DmtxScanStatus   stopCause;     /* Reason that scanning stopped */
 } DmtxScanConstraint;
 
+/**
+ * @struct DmtxAllocator
+ * @brief Memory allocation hooks installed with dmtxSetAllocator()
+ */
+typedef struct DmtxAllocator_struct {
+   void         *(*alloc)(size_t size, void *userData);
+   void          (*release)(void *ptr, void *userData);
+   void           *userData;
+} DmtxAllocator;
+
+/**
+ * @struct DmtxExecutor
+ * @brief Task submission hooks installed with dmtxDecodeSetExecutor()
+ */
+typedef struct DmtxExecutor_struct {
+   void          (*submit)(void (*task)(void *arg), void *arg, void *userData);
+   void          (*wait)(void *userData);
+   void           *userData;
+} DmtxExecutor;
+
+/**
+ * @struct DmtxSymbolDescriptor
+ * @brief Dimensions, block layout and capacity of one symbol size
+ */
+typedef struct DmtxSymbolDescriptor_struct {
+   int             symbolRows;    /* Rows including alignment patterns */
+   int             symbolCols;    /* Columns including alignment patterns */
+   int             dataRegionRows;
+   int             dataRegionCols;
+   int             horizDataRegions;
+   int             vertDataRegions;
+   int             mappingRows;   /* Data rows of all regions */
+   int             mappingCols;   /* Data columns of all regions */
+   int             interleavedBlocks;
+   int             blockDataWords; /* Data words of each block ... */
+   int             longBlocks;    /* ... plus one for this many leading blocks */
+   int             blockErrorWords;
+   int             blockMaxCorrectable;
+   int             symbolDataWords; /* Capacity in data codewords */
+   int             symbolErrorWords;
+   int             symbolMaxCorrectable;
+} DmtxSymbolDescriptor;
+
+typedef struct DmtxFlowCache_struct DmtxFlowCache;
+typedef struct DmtxScanCache_struct DmtxScanCache;
+typedef struct DmtxArena_struct DmtxArena;
+typedef struct DmtxSaliency_struct DmtxSaliency;
+typedef struct DmtxTrail_struct DmtxTrail;
+
 /**
  * @struct DmtxDecode
  * @brief DmtxDecode
@@ -474,6 +563,10 @@ typedef struct DmtxDecode_struct {
    double          squareDevn;
    int             sizeIdxExpected;
    int             edgeThresh;
+   int             scanPlane;
+   int             pyramidLevels;
+   int             tileSize;
+   int             saliencyCell;
 
    /* Image modifiers */
    int             xMin;
@@ -484,11 +577,32 @@ typedef struct DmtxDecode_struct {
 
    /* Internals */
 /* int             cacheComplete; */
-   unsigned char  *cache;
+   DmtxScanCache  *cache;       /* Visited/assigned state of each scaled pixel */
    DmtxImage      *image;
+   DmtxImage      *plane;       /* Owned 8-bit working plane, or NULL to read image directly */
+   DmtxFlowCache  *flowCache;   /* Memoized GetPointFlow() results, or NULL when disabled */
+   struct DmtxDecode_struct *coarse; /* Owned decoder scanning the coarsest pyramid level, or NULL */
+   DmtxArena      *arena;       /* Backs regions, messages and scratch until the next image, or NULL */
+   DmtxMessage    *layer;       /* Reused for each layer by dmtxDecodeMosaicRegionInto(), or NULL */
+   DmtxExecutor    executor;    /* Runs parallel work instead of library threads when submit is set */
+   DmtxSaliency   *saliency;    /* Edge energy ordering of scan grid cells, or NULL */
+   DmtxTrail      *trail;       /* Points of the last trail blazed, or NULL until first needed */
+   struct DmtxSeedBatch_struct *seeds; /* Edges sought ahead of the scan by the executor, or NULL */
    DmtxScanGrid    grid;
 } DmtxDecode;
 
+/**
+ * @struct DmtxDecodeResult
+ * @brief Symbols decoded from one image
+ */
+typedef struct DmtxDecodeResult_struct {
+   DmtxPassFail    status;      /* DmtxFail if a scan limit cut the scan short or it could not run */
+   int             count;       /* Number of decoded symbols */
+   int             capacity;    /* Allocated entries of region and message */
+   DmtxRegion    **region;      /* Region of each decoded symbol */
+   DmtxMessage   **message;     /* Message of each decoded symbol */
+} DmtxDecodeResult;
+
 /**
  * @struct DmtxEncode
  * @brief DmtxEncode
@@ -555,6 +669,9 @@ extern DmtxTime dmtxTimeNow(void);
 extern DmtxTime dmtxTimeAdd(DmtxTime t, long msec);
 extern int dmtxTimeExceeded(DmtxTime timeout);
 
+/* dmtxalloc.c */
+extern DmtxPassFail dmtxSetAllocator(const DmtxAllocator *hooks);
+
 /* dmtxencode.c */
 extern DmtxEncode *dmtxEncodeCreate(void);
 extern DmtxPassFail dmtxEncodeDestroy(DmtxEncode **enc);
@@ -570,6 +687,8 @@ extern DmtxPassFail dmtxEncodeDataMosaic(DmtxEncode *enc, int n, unsigned char *
 /* dmtxdecode.c */
 extern DmtxDecode *dmtxDecodeCreate(DmtxImage *img, int scale);
 extern DmtxPassFail dmtxDecodeDestroy(DmtxDecode **dec);
+extern DmtxPassFail dmtxDecodeSetImage(DmtxDecode *dec, DmtxImage *img);
+extern DmtxPassFail dmtxDecodeSetExecutor(DmtxDecode *dec, const DmtxExecutor *executor);
 extern DmtxPassFail dmtxDecodeSetProp(DmtxDecode *dec, int prop, int value);
 extern int dmtxDecodeGetProp(DmtxDecode *dec, int prop);
 extern /*@exposed@*/ unsigned char *dmtxDecodeGetCache(DmtxDecode *dec, int x, int y);
@@ -577,6 +696,15 @@ extern DmtxPassFail dmtxDecodeGetPixelValue(DmtxDecode *dec, int x, int y, int c
 extern DmtxMessage *dmtxDecodeMatrixRegion(DmtxDecode *dec, DmtxRegion *reg, int fix);
 extern DmtxMessage *dmtxDecodePopulatedArray(int sizeIdx, DmtxMessage *msg, int fix);
 extern DmtxMessage *dmtxDecodeMosaicRegion(DmtxDecode *dec, DmtxRegion *reg, int fix);
+extern DmtxPassFail dmtxDecodeMatrixRegionInto(DmtxDecode *dec, DmtxRegion *reg, int fix, DmtxMessage *msg);
+extern DmtxPassFail dmtxDecodeMosaicRegionInto(DmtxDecode *dec, DmtxRegion *reg, int fix, DmtxMessage *msg);
+extern DmtxDecodeResult *dmtxDecodeFindAll(DmtxDecode *dec, DmtxScanConstraint *budget, int expectedCount);
+extern DmtxPassFail dmtxDecodeResultDestroy(DmtxDecodeResult **result);
+
+/* dmtxbatch.c */
+extern DmtxDecodeResult *dmtxDecodeBatch(DmtxImage **images, int imageCount, int scale, const int *props,
+      DmtxScanConstraint *constraints, int threadCount, const DmtxExecutor *executor);
+extern DmtxPassFail dmtxDecodeBatchDestroy(DmtxDecodeResult **results, int imageCount);
 extern unsigned char *dmtxDecodeCreateDiagnostic(DmtxDecode *dec, /*@out@*/ int *totalBytes, /*@out@*/ int *headerBytes, int style);
 
 /* dmtxregion.c */
@@ -585,12 +713,16 @@ extern DmtxPassFail dmtxRegionDestroy(DmtxRegion **reg);
 extern DmtxRegion *dmtxRegionFindNext(DmtxDecode *dec, DmtxTime *timeout);
 extern DmtxRegion *dmtxRegionFindNextDeterministic(DmtxDecode *dec, DmtxScanConstraint *constraint);
 extern DmtxRegion *dmtxRegionScanPixel(DmtxDecode *dec, int x, int y);
+extern DmtxRegion **dmtxRegionFindAll(DmtxDecode *dec, int threadCount, /*@out@*/ int *regionCount);
+extern DmtxPassFail dmtxRegionListDestroy(DmtxRegion ***regions);
+extern DmtxRegion *dmtxRegionTrack(DmtxDecode *dec, DmtxRegion *prev, DmtxScanConstraint *constraint);
 extern DmtxPassFail dmtxRegionUpdateCorners(DmtxDecode *dec, DmtxRegion *reg, DmtxVector2 p00,
       DmtxVector2 p10, DmtxVector2 p11, DmtxVector2 p01);
 extern DmtxPassFail dmtxRegionUpdateXfrms(DmtxDecode *dec, DmtxRegion *reg);
 
 /* dmtxmessage.c */
 extern DmtxMessage *dmtxMessageCreate(int sizeIdx, int symbolFormat);
+extern DmtxPassFail dmtxMessageResize(DmtxMessage *msg, int sizeIdx, int symbolFormat);
 extern DmtxPassFail dmtxMessageDestroy(DmtxMessage **msg);
 
 /* dmtximage.c */
@@ -640,6 +772,7 @@ extern void dmtxMatrix3Print(DmtxMatrix3 m);
 
 /* dmtxsymbol.c */
 extern int dmtxSymbolModuleStatus(DmtxMessage *mapping, int sizeIdx, int row, int col);
+extern const DmtxSymbolDescriptor *dmtxGetSymbolDescriptor(int sizeIdx);
 extern int dmtxGetSymbolAttribute(int attribute, int sizeIdx);
 extern int dmtxGetBlockDataSize(int sizeIdx, int blockIdx);
 extern int getSizeIdxFromSymbolDimension(int rows, int cols);
@@ -0,0 +1,339 @@
+/**
+ * libdmtx - Data Matrix Encoding/Decoding Library
+ * Copyright 2008, 2009 Mike Laughton. All rights reserved.
+ * Copyright 2012-2016 Vadim A. Misbakh-Soloviov. All rights reserved.
+ *
+ * See LICENSE file in the main project directory for full
+ * terms of use and distribution.
+ *
+ * Contact:
+ * Vadim A. Misbakh-Soloviov <dmtx@mva.name>
+ * Mike Laughton <mike@dragonflylogic.com>
+ *
+ * \file dmtxalloc.c
+ * \brief Memory allocation hooks and decode arenas
+ */
+
+/**
+ * Every block the library allocates for itself goes through MemAlloc() and
+ * MemFree(), which call the hooks installed with dmtxSetAllocator() (malloc
+ * and free by default). A block is preceded by a small header recording
+ * where it came from. Blocks carved from a DmtxArena carry the same header,
+ * so the usual destroy functions can be called on any object: for arena
+ * blocks MemFree() does nothing and the memory is reclaimed all at once by
+ * ArenaReset() or ArenaDestroy().
+ */
+
+#define DmtxMemHeaderBytes    16
+#define DmtxMemFromHeap       0x4845
+#define DmtxMemFromArena      0x4152
+#define DmtxMemRoundUp(n)     (((n) + DmtxMemHeaderBytes - 1) / DmtxMemHeaderBytes * DmtxMemHeaderBytes)
+#define DmtxArenaChunkBytes   DmtxMemRoundUp(sizeof(DmtxArenaChunk))
+
+static void *DefaultAlloc(size_t size, void *userData);
+static void DefaultFree(void *ptr, void *userData);
+
+static DmtxAllocator allocator = { DefaultAlloc, DefaultFree, NULL };
+
+/**
+ * \brief  Install the memory allocation hooks used by the library
+ * \param  hooks Allocation and free functions, or NULL to restore malloc/free
+ * \return DmtxPass | DmtxFail
+ *
+ * Must be called before any library object is created, and not while other
+ * threads use the library. Blocks are handed to whichever free hook is
+ * installed when they are released, so hooks should stay in place until
+ * every object created with them has been destroyed.
+ */
+extern DmtxPassFail
+dmtxSetAllocator(const DmtxAllocator *hooks)
+{
+   if(hooks == NULL) {
+      allocator.alloc = DefaultAlloc;
+      allocator.release = DefaultFree;
+      allocator.userData = NULL;
+      return DmtxPass;
+   }
+
+   if(hooks->alloc == NULL || hooks->release == NULL)
+      return DmtxFail;
+
+   allocator = *hooks;
+
+   return DmtxPass;
+}
+
+/**
+ * \brief  Default allocation hook
+ * \param  size
+ * \param  userData Unused
+ * \return Address of allocated memory, or NULL
+ */
+static void *
+DefaultAlloc(size_t size, void *userData)
+{
+   (void)userData;
+
+   return malloc(size);
+}
+
+/**
+ * \brief  Default free hook
+ * \param  ptr
+ * \param  userData Unused
+ * \return void
+ */
+static void
+DefaultFree(void *ptr, void *userData)
+{
+   (void)userData;
+
+   free(ptr);
+}
+
+/**
+ * \brief  Allocate memory through the installed hooks
+ * \param  size
+ * \return Address of allocated memory, or NULL
+ */
+static void *
+MemAlloc(size_t size)
+{
+   unsigned char *block;
+
+   if(size > (size_t)-1 - DmtxMemHeaderBytes)
+      return NULL;
+
+   block = (unsigned char *)allocator.alloc(size + DmtxMemHeaderBytes, allocator.userData);
+   if(block == NULL)
+      return NULL;
+
+   *(int *)block = DmtxMemFromHeap;
+
+   return block + DmtxMemHeaderBytes;
+}
+
+/**
+ * \brief  Allocate zeroed memory through the installed hooks
+ * \param  count
+ * \param  size
+ * \return Address of allocated memory, or NULL
+ */
+static void *
+MemCalloc(size_t count, size_t size)
+{
+   void *ptr;
+
+   if(size != 0 && count > ((size_t)-1 - DmtxMemHeaderBytes) / size)
+      return NULL;
+
+   ptr = MemAlloc(count * size);
+   if(ptr != NULL)
+      memset(ptr, 0x00, count * size);
+
+   return ptr;
+}
+
+/**
+ * \brief  Release memory from MemAlloc(), MemCalloc() or ArenaAlloc()
+ * \param  ptr Address of block, or NULL
+ * \return void
+ *
+ * Only pointers returned by those functions may be passed here, because the
+ * header in front of the block is read. Memory the caller owns, such as the
+ * pixels of an image from dmtxImageCreate(), is never released through
+ * MemFree(). A block whose header carries neither magic is left alone
+ * rather than handed to the free hook.
+ */
+static void
+MemFree(void *ptr)
+{
+   unsigned char *block;
+
+   if(ptr == NULL)
+      return;
+
+   block = (unsigned char *)ptr - DmtxMemHeaderBytes;
+
+   /* Arena blocks are released with the arena */
+   if(*(int *)block == DmtxMemFromArena)
+      return;
+
+   assert(*(int *)block == DmtxMemFromHeap);
+   if(*(int *)block != DmtxMemFromHeap)
+      return;
+
+   allocator.release(block, allocator.userData);
+}
+
+/**
+ * \brief  Create an empty arena
+ * \param  chunkSize Minimum bytes requested from the hooks at a time
+ * \return Initialized arena, or NULL on allocation failure
+ */
+static DmtxArena *
+ArenaCreate(size_t chunkSize)
+{
+   DmtxArena *arena;
+
+   arena = (DmtxArena *)MemCalloc(1, sizeof(DmtxArena));
+   if(arena == NULL)
+      return NULL;
+
+   arena->chunkSize = chunkSize;
+
+   return arena;
+}
+
+/**
+ * \brief  Free an arena together with every block carved from it
+ * \param  arena
+ * \return void
+ */
+static void
+ArenaDestroy(DmtxArena **arena)
+{
+   DmtxArenaChunk *chunk, *next;
+
+   if(arena == NULL || *arena == NULL)
+      return;
+
+   for(chunk = (*arena)->first; chunk != NULL; chunk = next) {
+      next = chunk->next;
+      MemFree(chunk);
+   }
+
+   MemFree(*arena);
+   *arena = NULL;
+}
+
+/**
+ * \brief  Allocate a block from an arena, growing it by one chunk if needed
+ * \param  arena Arena, or NULL to allocate through the hooks
+ * \param  size
+ * \return Address of block, or NULL on allocation failure
+ *
+ * Chunks beyond the current one are left over from an earlier reset or
+ * release and are reused before new ones are requested.
+ */
+static void *
+ArenaAlloc(DmtxArena *arena, size_t size)
+{
+   size_t need, chunkBytes;
+   unsigned char *block;
+   DmtxArenaChunk *chunk;
+
+   if(arena == NULL)
+      return MemAlloc(size);
+
+   if(size > (size_t)-1 - 2 * DmtxMemHeaderBytes)
+      return NULL;
+
+   /* Keep every block aligned like the header */
+   need = DmtxMemHeaderBytes + DmtxMemRoundUp(size);
+
+   chunk = arena->current;
+   while(chunk == NULL || chunk->size - chunk->used < need) {
+      if(chunk != NULL && chunk->next != NULL) {
+         chunk = chunk->next;
+         chunk->used = 0;
+      }
+      else if(chunk == NULL && arena->first != NULL) {
+         chunk = arena->first;
+         chunk->used = 0;
+      }
+      else {
+         chunkBytes = max(arena->chunkSize, need);
+         chunk = (DmtxArenaChunk *)MemAlloc(DmtxArenaChunkBytes + chunkBytes);
+         if(chunk == NULL)
+            return NULL;
+         chunk->size = chunkBytes;
+         chunk->used = 0;
+
+         /* Insert after the current chunk so no leftover chunk is skipped */
+         if(arena->current == NULL) {
+            chunk->next = arena->first;
+            arena->first = chunk;
+         }
+         else {
+            chunk->next = arena->current->next;
+            arena->current->next = chunk;
+         }
+         arena->bytes += chunkBytes;
+      }
+      arena->current = chunk;
+   }
+
+   block = (unsigned char *)chunk + DmtxArenaChunkBytes + chunk->used;
+   chunk->used += need;
+
+   *(int *)block = DmtxMemFromArena;
+
+   return block + DmtxMemHeaderBytes;
+}
+
+/**
+ * \brief  Allocate a zeroed block from an arena
+ * \param  arena Arena, or NULL to allocate through the hooks
+ * \param  count
+ * \param  size
+ * \return Address of block, or NULL on allocation failure
+ */
+static void *
+ArenaCalloc(DmtxArena *arena, size_t count, size_t size)
+{
+   void *ptr;
+
+   if(size != 0 && count > ((size_t)-1 - 2 * DmtxMemHeaderBytes) / size)
+      return NULL;
+
+   ptr = ArenaAlloc(arena, count * size);
+   if(ptr != NULL)
+      memset(ptr, 0x00, count * size);
+
+   return ptr;
+}
+
+/**
+ * \brief  Record the current fill level of an arena
+ * \param  arena Arena, or NULL
+ * \return Mark to pass to ArenaRelease()
+ */
+static DmtxArenaMark
+ArenaGetMark(DmtxArena *arena)
+{
+   DmtxArenaMark mark;
+
+   mark.chunk = (arena == NULL) ? NULL : arena->current;
+   mark.used = (mark.chunk == NULL) ? 0 : mark.chunk->used;
+
+   return mark;
+}
+
+/**
+ * \brief  Release every block allocated since a mark was taken
+ * \param  arena Arena, or NULL
+ * \param  mark
+ * \return void
+ */
+static void
+ArenaRelease(DmtxArena *arena, DmtxArenaMark mark)
+{
+   if(arena == NULL)
+      return;
+
+   arena->current = mark.chunk;
+   if(mark.chunk != NULL)
+      mark.chunk->used = mark.used;
+}
+
+/**
+ * \brief  Release every block of an arena while keeping its chunks
+ * \param  arena
+ * \return void
+ */
+static void
+ArenaReset(DmtxArena *arena)
+{
+   arena->current = NULL;
+}
@@ -0,0 +1,168 @@
+/**
+ * libdmtx - Data Matrix Encoding/Decoding Library
+ * Copyright 2008, 2009 Mike Laughton. All rights reserved.
+ * Copyright 2012-2016 Vadim A. Misbakh-Soloviov. All rights reserved.
+ *
+ * See LICENSE file in the main project directory for full
+ * terms of use and distribution.
+ *
+ * Contact:
+ * Vadim A. Misbakh-Soloviov <dmtx@mva.name>
+ * Mike Laughton <mike@dragonflylogic.com>
+ *
+ * \file dmtxbatch.c
+ * \brief Decode many images on a pool of worker threads
+ */
+
+/**
+ * \brief  Find and decode every symbol of many images using several threads
+ * \param  images Array of images to decode
+ * \param  imageCount Number of images
+ * \param  scale Scale passed to dmtxDecodeCreate() for every image
+ * \param  props Decode property/value pairs ending with DmtxUndefined, or NULL
+ * \param  constraints One scan constraint per image, or NULL for none
+ * \param  threadCount Number of workers, or 0 for one per online processor
+ * \param  executor Task hooks as for dmtxDecodeSetExecutor(), or NULL to
+ *         start library threads
+ * \return Array of imageCount results in input order, to be released with
+ *         dmtxDecodeBatchDestroy(), or NULL on failure
+ *
+ * Each worker keeps one DmtxDecode and attaches the next unclaimed image to
+ * it with dmtxDecodeSetImage(), creating a new one only when the image size
+ * changes. Properties are set with dmtxDecodeSetProp() whenever a decoder is
+ * created. DmtxPropArenaSize is ignored since results outlive the decoder.
+ *
+ * Workers claim images one at a time from a single shared queue instead of
+ * stealing from each other's deques. Images are independent and claimed
+ * often enough that a worker never idles while images remain, and the lock
+ * is held only to take an index. perf_test reports the throughput reached
+ * with each thread count.
+ *
+ * A constraint bounds the whole scan of its image rather than each region,
+ * and reports the iterations used and why scanning stopped. The status of a
+ * result is DmtxFail if its constraint cut the scan short, or if the image
+ * was NULL or no decoder could be created for it.
+ */
+extern DmtxDecodeResult *
+dmtxDecodeBatch(DmtxImage **images, int imageCount, int scale, const int *props,
+      DmtxScanConstraint *constraints, int threadCount, const DmtxExecutor *executor)
+{
+   int i, workerCount;
+   DmtxBatchJob job;
+
+   if(images == NULL || imageCount < 1 || scale < 1)
+      return NULL;
+
+   memset(&job, 0x00, sizeof(DmtxBatchJob));
+   job.images = images;
+   job.scale = scale;
+   job.props = props;
+   job.constraints = constraints;
+
+   job.results = (DmtxDecodeResult *)MemCalloc(imageCount, sizeof(DmtxDecodeResult));
+   if(job.results == NULL)
+      return NULL;
+
+   if(WorkQueueInit(&(job.queue), imageCount) == DmtxFail) {
+      MemFree(job.results);
+      return NULL;
+   }
+
+   workerCount = min(ThreadCount(executor, threadCount), imageCount);
+   ThreadRunWorkers(executor, workerCount, BatchWorker, &job);
+
+   for(i = 0; i < workerCount; i++)
+      dmtxDecodeDestroy(&(job.worker[i]));
+   WorkQueueDestroy(&(job.queue));
+
+   return job.results;
+}
+
+/**
+ * \brief  Free results returned by dmtxDecodeBatch()
+ * \param  results
+ * \param  imageCount Number of images passed to dmtxDecodeBatch()
+ * \return DmtxPass | DmtxFail
+ */
+extern DmtxPassFail
+dmtxDecodeBatchDestroy(DmtxDecodeResult **results, int imageCount)
+{
+   int i;
+
+   if(results == NULL || *results == NULL)
+      return DmtxFail;
+
+   for(i = 0; i < imageCount; i++)
+      DecodeResultClear(&((*results)[i]));
+
+   MemFree(*results);
+
+   *results = NULL;
+
+   return DmtxPass;
+}
+
+/**
+ * \brief  Worker function of dmtxDecodeBatch()
+ * \param  job DmtxBatchJob
+ * \param  worker Worker index
+ * \return void
+ */
+static void
+BatchWorker(void *job, int worker)
+{
+   int idx;
+   DmtxBatchJob *batch;
+   DmtxDecode **dec;
+   DmtxDecodeResult *result;
+
+   batch = (DmtxBatchJob *)job;
+   dec = &(batch->worker[worker]);
+
+   while((idx = WorkQueueNext(&(batch->queue))) != DmtxUndefined) {
+      result = &(batch->results[idx]);
+      result->status = DmtxFail;
+
+      if(batch->images[idx] == NULL)
+         continue;
+
+      /* Recycle the decoder unless the image size changed */
+      if(*dec != NULL && dmtxDecodeSetImage(*dec, batch->images[idx]) == DmtxFail)
+         dmtxDecodeDestroy(dec);
+
+      if(*dec == NULL && (*dec = BatchCreateDecode(batch, batch->images[idx])) == NULL)
+         continue;
+
+      if(DecodeImageAll(*dec, (batch->constraints == NULL) ? NULL :
+            &(batch->constraints[idx]), 0, result) == DmtxFail)
+         result->status = DmtxFail;
+   }
+}
+
+/**
+ * \brief  Create a decoder for one image with the properties of a batch
+ * \param  batch
+ * \param  img
+ * \return Initialized decoder, or NULL on failure
+ */
+static DmtxDecode *
+BatchCreateDecode(DmtxBatchJob *batch, DmtxImage *img)
+{
+   int i;
+   DmtxDecode *dec;
+
+   dec = dmtxDecodeCreate(img, batch->scale);
+   if(dec == NULL)
+      return NULL;
+
+   for(i = 0; batch->props != NULL && batch->props[i] != DmtxUndefined; i += 2) {
+      if(batch->props[i] == DmtxPropArenaSize)
+         continue;
+      if(dmtxDecodeSetProp(dec, batch->props[i], batch->props[i+1]) == DmtxFail) {
+         dmtxDecodeDestroy(&dec);
+         return NULL;
+      }
+   }
+
+   return dec;
+}
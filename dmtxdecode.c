@@ -30,7 +30,7 @@ dmtxDecodeCreate(DmtxImage *img, int scale)
    DmtxDecode *dec;
    int width, height;
 
-   dec = (DmtxDecode *)calloc(1, sizeof(DmtxDecode));
+   dec = (DmtxDecode *)MemCalloc(1, sizeof(DmtxDecode));
    if(dec == NULL)
       return NULL;
 
@@ -45,6 +45,9 @@ dmtxDecodeCreate(DmtxImage *img, int scale)
    dec->squareDevn = cos(50 * (M_PI/180));
    dec->sizeIdxExpected = DmtxSymbolShapeAuto;
    dec->edgeThresh = 10;
+   dec->scanPlane = DmtxScanPlaneChannels;
+   dec->pyramidLevels = 0;
+   dec->tileSize = 512;
 
    dec->xMin = 0;
    dec->xMax = width - 1;
@@ -52,9 +55,9 @@ dmtxDecodeCreate(DmtxImage *img, int scale)
    dec->yMax = height - 1;
    dec->scale = scale;
 
-   dec->cache = (unsigned char *)calloc(width * height, sizeof(unsigned char));
+   dec->cache = ScanCacheCreate(width, height);
    if(dec->cache == NULL) {
-      free(dec);
+      MemFree(dec);
       return NULL;
    }
 
@@ -75,26 +78,124 @@ dmtxDecodeDestroy(DmtxDecode **dec)
    if(dec == NULL || *dec == NULL)
       return DmtxFail;
 
-   if((*dec)->cache != NULL)
-      free((*dec)->cache);
+   ScanCacheDestroy(&((*dec)->cache));
 
-   free(*dec);
+   if((*dec)->plane != NULL) {
+      MemFree((*dec)->plane->pxl);
+      dmtxImageDestroy(&((*dec)->plane));
+   }
+
+   FlowCacheDestroy(&((*dec)->flowCache));
+
+   SaliencyDestroy(&((*dec)->saliency));
+
+   TrailDestroy(&((*dec)->trail));
+
+   DecodeDestroyPyramid(*dec);
+
+   SeedBatchDestroy(&((*dec)->seeds));
+
+   ArenaDestroy(&((*dec)->arena));
+
+   dmtxMessageDestroy(&((*dec)->layer));
+
+   MemFree(*dec);
 
    *dec = NULL;
 
    return DmtxPass;
 }
 
+/**
+ * \brief  Attach a new image of the same size to an existing decode struct
+ * \param  dec
+ * \param  img
+ * \return DmtxPass | DmtxFail
+ *
+ * Properties are kept. The scan cache is only cleared where it was touched
+ * while scanning the previous image, and the scan grid, working plane,
+ * pyramid and flow cache start over from the new pixels. Regions and
+ * messages allocated from the decode arena (DmtxPropArenaSize) for the
+ * previous image are released and must no longer be used.
+ */
+extern DmtxPassFail
+dmtxDecodeSetImage(DmtxDecode *dec, DmtxImage *img)
+{
+   if(dec == NULL || img == NULL)
+      return DmtxFail;
+
+   if(dmtxImageGetProp(img, DmtxPropWidth) / dec->scale != dec->cache->width ||
+         dmtxImageGetProp(img, DmtxPropHeight) / dec->scale != dec->cache->height)
+      return DmtxFail;
+
+   dec->image = img;
+   ScanCacheReset(dec->cache);
+   if(dec->arena != NULL)
+      ArenaReset(dec->arena);
+
+   /* The grid follows the saliency order of the new pixels */
+   if(DecodeBuildScanPlane(dec) == DmtxFail)
+      return DmtxFail;
+
+   dec->grid = InitScanGrid(dec);
+   SeedBatchReset(dec->seeds);
+
+   return DmtxPass;
+}
+
+/**
+ * \brief  Run parallel work of a decode struct on the caller's thread pool
+ * \param  dec
+ * \param  executor Task hooks, or NULL to go back to library threads
+ * \return DmtxPass | DmtxFail
+ *
+ * When an executor is set, dmtxRegionFindAll() starts no threads of its
+ * own, dmtxRegionFindNext() seeks edges at upcoming scan seeds in parallel,
+ * and dmtxDecodeMatrixRegion() reads the data regions of a symbol in
+ * parallel. Each extra worker is handed to submit() as a task, the calling
+ * thread works alongside them, and wait() must return once every task
+ * submitted with the same userData has finished. Since the caller may itself
+ * be running on the pool, possibly its only thread, wait() must run tasks
+ * that are still queued rather than only block. The thread count passed to
+ * dmtxRegionFindAll() still bounds the number of tasks per call; the other
+ * calls use one task per online processor. Executors work without pthreads
+ * when the compiler provides atomics (GCC, clang, MSVC).
+ */
+extern DmtxPassFail
+dmtxDecodeSetExecutor(DmtxDecode *dec, const DmtxExecutor *executor)
+{
+   if(dec == NULL)
+      return DmtxFail;
+
+   if(executor == NULL) {
+      memset(&(dec->executor), 0x00, sizeof(DmtxExecutor));
+      return DmtxPass;
+   }
+
+   if(executor->submit == NULL || executor->wait == NULL)
+      return DmtxFail;
+
+   dec->executor = *executor;
+
+   return DmtxPass;
+}
+
 /**
  * \brief  Set decoding behavior property
  * \param  dec
  * \param  prop
  * \param  value
  * \return DmtxPass | DmtxFail
+ *
+ * DmtxPropArenaSize fails while regions or messages allocated from the
+ * current arena are live, i.e. once scanning has begun and until the next
+ * dmtxDecodeSetImage().
  */
 extern DmtxPassFail
 dmtxDecodeSetProp(DmtxDecode *dec, int prop, int value)
 {
+   int previous;
+
    switch(prop) {
       case DmtxPropEdgeMin:
          dec->edgeMin = value;
@@ -117,6 +218,62 @@ dmtxDecodeSetProp(DmtxDecode *dec, int prop, int value)
       case DmtxPropEdgeThresh:
          dec->edgeThresh = value;
          break;
+      case DmtxPropScanPlane:
+         if(value != DmtxScanPlaneChannels && value != DmtxScanPlaneLuma &&
+               value != DmtxScanPlaneBestChannel)
+            return DmtxFail;
+         previous = dec->scanPlane;
+         dec->scanPlane = value;
+         if(DecodeBuildScanPlane(dec) == DmtxFail) {
+            /* Leave the decoder scanning the plane it scanned before */
+            dec->scanPlane = previous;
+            DecodeBuildScanPlane(dec);
+            return DmtxFail;
+         }
+         break;
+      case DmtxPropFlowCache:
+         if(DecodeResetFlowCache(dec, (value) ? DmtxTrue : DmtxFalse) == DmtxFail)
+            return DmtxFail;
+         break;
+      case DmtxPropPyramidLevels:
+         if(value < 0 || value > DecodePyramidLevelsMax(dec))
+            return DmtxFail;
+         previous = dec->pyramidLevels;
+         dec->pyramidLevels = value;
+         if(DecodeBuildPyramid(dec) == DmtxFail) {
+            dec->pyramidLevels = previous;
+            DecodeBuildPyramid(dec);
+            return DmtxFail;
+         }
+         break;
+      case DmtxPropScanCacheLimit:
+         if(value < 0)
+            return DmtxFail;
+         dec->cache->limit = value;
+         break;
+      case DmtxPropTileSize:
+         if(value < 16)
+            return DmtxFail;
+         dec->tileSize = value;
+         break;
+      case DmtxPropSaliencyCell:
+         if(value < 0 || (value > 0 && value < 8))
+            return DmtxFail;
+         dec->saliencyCell = value;
+         if(DecodeResetSaliency(dec) == DmtxFail)
+            return DmtxFail;
+         break;
+      case DmtxPropArenaSize:
+         /* Regions and messages from the arena stay valid until the next image */
+         if(value < 0 || (dec->arena != NULL && dec->arena->current != NULL))
+            return DmtxFail;
+         ArenaDestroy(&(dec->arena));
+         if(value > 0) {
+            dec->arena = ArenaCreate(value);
+            if(dec->arena == NULL)
+               return DmtxFail;
+         }
+         break;
       /* Min and Max values arrive unscaled */
       case DmtxPropXmin:
          dec->xMin = value / dec->scale;
@@ -145,6 +302,10 @@ dmtxDecodeSetProp(DmtxDecode *dec, int prop, int value)
 
    /* Reinitialize scangrid in case any inputs changed */
    dec->grid = InitScanGrid(dec);
+   SeedBatchReset(dec->seeds);
+
+   if(dec->coarse != NULL)
+      return DecodeSyncPyramid(dec);
 
    return DmtxPass;
 }
@@ -173,6 +334,28 @@ dmtxDecodeGetProp(DmtxDecode *dec, int prop)
          return dec->sizeIdxExpected;
       case DmtxPropEdgeThresh:
          return dec->edgeThresh;
+      case DmtxPropScanPlane:
+         return dec->scanPlane;
+      case DmtxPropFlowCache:
+         return (dec->flowCache != NULL) ? DmtxTrue : DmtxFalse;
+      case DmtxPropFlowCacheHits:
+         return (dec->flowCache != NULL) ? (int)dec->flowCache->hits : 0;
+      case DmtxPropFlowCacheMisses:
+         return (dec->flowCache != NULL) ? (int)dec->flowCache->misses : 0;
+      case DmtxPropPyramidLevels:
+         return dec->pyramidLevels;
+      case DmtxPropScanCacheLimit:
+         return (int)dec->cache->limit;
+      case DmtxPropScanCacheBytes:
+         return (int)dec->cache->bytes;
+      case DmtxPropTileSize:
+         return dec->tileSize;
+      case DmtxPropSaliencyCell:
+         return dec->saliencyCell;
+      case DmtxPropArenaSize:
+         return (dec->arena != NULL) ? (int)dec->arena->chunkSize : 0;
+      case DmtxPropArenaBytes:
+         return (dec->arena != NULL) ? (int)dec->arena->bytes : 0;
       case DmtxPropXmin:
          return dec->xMin;
       case DmtxPropXmax:
@@ -195,40 +378,44 @@ dmtxDecodeGetProp(DmtxDecode *dec, int prop)
 }
 
 /**
- * \brief  Returns xxx
- * \param  img
+ * \brief  Returns the scan state byte of a pixel
+ * \param  dec
  * \param  Scaled x coordinate
  * \param  Scaled y coordinate
- * \return Scaled pixel offset
+ * \return Pointer to the state byte, or NULL if the pixel is outside the
+ *         image or DmtxPropScanCacheLimit leaves no room for its tile
+ *
+ * Scan state is kept in tiles allocated on first use, so unlike earlier
+ * releases a pixel inside the image may yield NULL: once the tiles held
+ * reach DmtxPropScanCacheLimit, or when a tile cannot be allocated. Callers
+ * must check the result. Without a limit NULL inside the image only means
+ * the allocation failed.
  */
 extern unsigned char *
 dmtxDecodeGetCache(DmtxDecode *dec, int x, int y)
 {
-   int width, height;
-
    assert(dec != NULL);
 
 /* if(dec.cacheComplete == DmtxFalse)
       CacheImage(); */
 
-   width = dmtxDecodeGetProp(dec, DmtxPropWidth);
-   height = dmtxDecodeGetProp(dec, DmtxPropHeight);
-
-   if(x < 0 || x >= width || y < 0 || y >= height)
-      return NULL;
-
-   return &(dec->cache[y * width + x]);
+   return ScanCacheGet(dec->cache, x, y, DmtxTrue);
 }
 
 /**
- *
- *
+ * \brief  Read a pixel from the image being scanned
+ * \param  dec
+ * \param  x Scaled x coordinate
+ * \param  y Scaled y coordinate
+ * \param  channel Image channel, ignored while a scan plane is active
+ * \param  value
+ * \return DmtxPass | DmtxFail
  */
 extern DmtxPassFail
 dmtxDecodeGetPixelValue(DmtxDecode *dec, int x, int y, int channel, int *value)
 {
    int xUnscaled, yUnscaled;
-   DmtxPassFail err;
+   DmtxImage *img;
 
    xUnscaled = x * dec->scale;
    yUnscaled = y * dec->scale;
@@ -256,17 +443,402 @@ dmtxDecodeGetPixelValue(DmtxDecode *dec, int x, int y, int channel, int *value)
 
    return correctedPoint; */
 
-   err = dmtxImageGetPixelValue(dec->image, xUnscaled, yUnscaled, channel, value);
+   if(dec->plane != NULL) {
+      img = dec->plane;
+      channel = 0;
+   }
+   else {
+      img = dec->image;
+   }
+
+   if(xUnscaled < 0 || xUnscaled >= img->width ||
+         yUnscaled < 0 || yUnscaled >= img->height)
+      return DmtxFail;
+
+   *value = img->fetchPixel(img, xUnscaled, yUnscaled, channel);
 
-   return err;
+   return DmtxPass;
 }
 
 /**
- * \brief  Fill the region covered by the quadrilateral given by (p0,p1,p2,p3) in the cache.
+ * \brief  Return the image read by region finding and module sampling
+ * \param  dec
+ * \return Working plane if one is active, otherwise the source image
+ */
+static DmtxImage *
+DecodeScanImage(DmtxDecode *dec)
+{
+   return (dec->plane != NULL) ? dec->plane : dec->image;
+}
+
+/**
+ * \brief  (Re)build the working plane requested by DmtxPropScanPlane
+ * \param  dec
+ * \return DmtxPass | DmtxFail
+ *
+ * The plane is a snapshot of the image pixels taken when the property is set
+ * or a new image is attached. Single channel images are already contiguous
+ * and are scanned in place.
+ */
+static DmtxPassFail
+DecodeBuildScanPlane(DmtxDecode *dec)
+{
+   DmtxBoolean wanted;
+
+   if(dec->scanPlane != DmtxScanPlaneChannels &&
+         dec->scanPlane != DmtxScanPlaneLuma &&
+         dec->scanPlane != DmtxScanPlaneBestChannel)
+      wanted = DmtxFalse;
+   else
+      wanted = (dec->scanPlane != DmtxScanPlaneChannels && dec->image->channelCount > 1) ?
+            DmtxTrue : DmtxFalse;
+
+   /* A plane of the right size is refilled in place, e.g. for each video frame */
+   if(dec->plane != NULL && (wanted == DmtxFalse ||
+         ImageFillScanPlane(dec->plane, dec->image, dec->scanPlane) == DmtxFail)) {
+      MemFree(dec->plane->pxl);
+      dmtxImageDestroy(&(dec->plane));
+   }
+
+   if(dec->scanPlane != DmtxScanPlaneChannels &&
+         dec->scanPlane != DmtxScanPlaneLuma &&
+         dec->scanPlane != DmtxScanPlaneBestChannel)
+      return DmtxFail;
+
+   if(wanted == DmtxTrue && dec->plane == NULL) {
+      dec->plane = ImageCreateScanPlane(dec->image, dec->scanPlane);
+      if(dec->plane == NULL)
+         return DmtxFail;
+   }
+
+   /* Pyramid levels, cached flows and saliency came from the previous plane */
+   if(dec->coarse != NULL && DecodeBuildPyramid(dec) == DmtxFail)
+      return DmtxFail;
+
+   if(dec->saliency != NULL && DecodeResetSaliency(dec) == DmtxFail)
+      return DmtxFail;
+
+   if(dec->flowCache != NULL)
+      return DecodeResetFlowCache(dec, DmtxTrue);
+
+   return DmtxPass;
+}
+
+/**
+ * \brief  Discard all memoized point flows and hit counters
+ * \param  dec
+ * \param  enable Whether a new empty cache should replace the old one
+ * \return DmtxPass | DmtxFail
+ */
+static DmtxPassFail
+DecodeResetFlowCache(DmtxDecode *dec, DmtxBoolean enable)
+{
+   DmtxImage *img;
+   DmtxCompassKernel kernel;
+
+   FlowCacheDestroy(&(dec->flowCache));
+
+   if(enable == DmtxFalse)
+      return DmtxPass;
+
+   img = DecodeScanImage(dec);
+
+   /* Whole-tile fills read raw bytes, which generic packings cannot provide */
+   kernel = (img->fetchPixel == FetchPixelGeneric) ? NULL : SimdCompassKernel();
+
+   dec->flowCache = FlowCacheCreate(dmtxDecodeGetProp(dec, DmtxPropWidth),
+         dmtxDecodeGetProp(dec, DmtxPropHeight), img->channelCount, kernel);
+
+   return (dec->flowCache == NULL) ? DmtxFail : DmtxPass;
+}
+
+/**
+ * \brief  (Re)measure the scan order requested by DmtxPropSaliencyCell
+ * \param  dec
+ * \return DmtxPass | DmtxFail
+ *
+ * A map of the right cell size is refilled in place, e.g. for each video
+ * frame. The scan grid must be reinitialized afterwards.
+ */
+static DmtxPassFail
+DecodeResetSaliency(DmtxDecode *dec)
+{
+   if(dec->saliency != NULL && dec->saliency->cellSize != dec->saliencyCell)
+      SaliencyDestroy(&(dec->saliency));
+
+   if(dec->saliencyCell == 0)
+      return DmtxPass;
+
+   if(dec->saliency == NULL) {
+      dec->saliency = SaliencyCreate(dmtxDecodeGetProp(dec, DmtxPropWidth),
+            dmtxDecodeGetProp(dec, DmtxPropHeight), dec->saliencyCell);
+      if(dec->saliency == NULL)
+         return DmtxFail;
+   }
+
+   SaliencyFill(dec->saliency, dec);
+
+   return DmtxPass;
+}
+
+/**
+ * \brief  Return the deepest pyramid level that leaves 16 pixels per side
+ * \param  dec
+ * \return Largest value DmtxPropPyramidLevels accepts, 0 if levels are unusable
+ */
+static int
+DecodePyramidLevelsMax(DmtxDecode *dec)
+{
+   int levels;
+   DmtxImage *img;
+
+   /* Coarse locations map back to unscaled pixels */
+   if(dec->scale != 1)
+      return 0;
+
+   img = DecodeScanImage(dec);
+   levels = 0;
+   while((img->width >> (levels + 1)) >= 16 && (img->height >> (levels + 1)) >= 16)
+      levels++;
+
+   return levels;
+}
+
+/**
+ * \brief  (Re)build the coarse decoder requested by DmtxPropPyramidLevels
+ * \param  dec
+ * \return DmtxPass | DmtxFail
+ *
+ * Only the coarsest level is kept. It is built from the image actually
+ * scanned (the working plane if one is active) and scanned by an internal
+ * decoder whose candidates are confirmed at full resolution. When a new
+ * image of the same size and packing arrives, e.g. the next video frame,
+ * the level and the coarse decoder are refilled in place.
+ */
+static DmtxPassFail
+DecodeBuildPyramid(DmtxDecode *dec)
+{
+   DmtxImage *img, *coarseImg;
+
+   img = DecodeScanImage(dec);
+
+   if(dec->pyramidLevels <= 0 || dec->pyramidLevels > DecodePyramidLevelsMax(dec)) {
+      DecodeDestroyPyramid(dec);
+      return (dec->pyramidLevels == 0) ? DmtxPass : DmtxFail;
+   }
+
+   if(dec->coarse != NULL) {
+      if(ImageFillPyramidLevel(dec->coarse->image, img, dec->pyramidLevels) == DmtxPass &&
+            dmtxDecodeSetImage(dec->coarse, dec->coarse->image) == DmtxPass)
+         return DecodeSyncPyramid(dec);
+
+      DecodeDestroyPyramid(dec);
+   }
+
+   coarseImg = ImageCreatePyramidLevel(img, dec->pyramidLevels);
+   if(coarseImg == NULL)
+      return DmtxFail;
+
+   dec->coarse = dmtxDecodeCreate(coarseImg, 1);
+   if(dec->coarse == NULL) {
+      MemFree(coarseImg->pxl);
+      dmtxImageDestroy(&coarseImg);
+      return DmtxFail;
+   }
+
+   return DecodeSyncPyramid(dec);
+}
+
+/**
+ * \brief  Free the coarse decoder and its pyramid level
+ * \param  dec
+ * \return void
  */
 static void
-CacheFillQuad(DmtxDecode *dec, DmtxPixelLoc p0, DmtxPixelLoc p1, DmtxPixelLoc p2, DmtxPixelLoc p3)
+DecodeDestroyPyramid(DmtxDecode *dec)
 {
+   if(dec->coarse == NULL)
+      return;
+
+   MemFree(dec->coarse->image->pxl);
+   dmtxImageDestroy(&(dec->coarse->image));
+   dmtxDecodeDestroy(&(dec->coarse));
+}
+
+/**
+ * \brief  Copy scanning options to the coarse decoder in coarse units
+ * \param  dec
+ * \return DmtxPass | DmtxFail
+ */
+static DmtxPassFail
+DecodeSyncPyramid(DmtxDecode *dec)
+{
+   int levels;
+   DmtxDecode *coarse;
+
+   coarse = dec->coarse;
+   levels = dec->pyramidLevels;
+
+   coarse->edgeMin = (dec->edgeMin == DmtxUndefined) ? DmtxUndefined : dec->edgeMin >> levels;
+   coarse->edgeMax = (dec->edgeMax == DmtxUndefined) ? DmtxUndefined : (dec->edgeMax >> levels) + 1;
+   coarse->scanGap = max(1, dec->scanGap >> levels);
+   coarse->fnc1 = dec->fnc1;
+   coarse->squareDevn = dec->squareDevn;
+   coarse->sizeIdxExpected = dec->sizeIdxExpected;
+   coarse->edgeThresh = dec->edgeThresh;
+
+   coarse->xMin = dec->xMin >> levels;
+   coarse->xMax = min(dec->xMax >> levels, coarse->image->width - 1);
+   coarse->yMin = dec->yMin >> levels;
+   coarse->yMax = min(dec->yMax >> levels, coarse->image->height - 1);
+
+   coarse->cache->limit = dec->cache->limit;
+
+   /* Coarse cells cover the same image area, and a new level is measured once */
+   if(coarse->saliencyCell != ((dec->saliencyCell == 0) ? 0 : max(8, dec->saliencyCell >> levels))) {
+      coarse->saliencyCell = (dec->saliencyCell == 0) ? 0 : max(8, dec->saliencyCell >> levels);
+      if(DecodeResetSaliency(coarse) == DmtxFail)
+         return DmtxFail;
+   }
+
+   coarse->grid = InitScanGrid(coarse);
+   SeedBatchReset(coarse->seeds);
+
+   if((dec->flowCache != NULL) != (coarse->flowCache != NULL))
+      return DecodeResetFlowCache(coarse, (dec->flowCache != NULL) ? DmtxTrue : DmtxFalse);
+
+   return DmtxPass;
+}
+
+/**
+ * \brief  Create a decoder scanning the same image on behalf of dec
+ * \param  dec
+ * \return Worker decoder, or NULL on allocation failure
+ *
+ * A worker copies the options of dec and shares its image, working plane
+ * and pyramid level, but keeps private scan state (scan cache, flow cache,
+ * trail, grid) so several workers can scan the image at once. The flow
+ * cache in particular fills its tiles lazily and unlocked, so each worker
+ * gets its own rather than sharing the one of dec. It must be released with
+ * DecodeDestroyWorker().
+ */
+static DmtxDecode *
+DecodeCreateWorker(DmtxDecode *dec)
+{
+   DmtxDecode *worker;
+
+   worker = (DmtxDecode *)MemAlloc(sizeof(DmtxDecode));
+   if(worker == NULL)
+      return NULL;
+
+   memcpy(worker, dec, sizeof(DmtxDecode));
+   worker->flowCache = NULL;
+   worker->coarse = NULL;
+   worker->arena = NULL;
+   worker->layer = NULL;
+   worker->saliency = NULL;
+   worker->trail = NULL;
+   worker->seeds = NULL;
+
+   /* A worker already runs as one of the parallel tasks */
+   memset(&(worker->executor), 0x00, sizeof(DmtxExecutor));
+
+   worker->cache = ScanCacheCreate(dec->cache->width, dec->cache->height);
+   if(worker->cache == NULL) {
+      MemFree(worker);
+      return NULL;
+   }
+   worker->cache->limit = dec->cache->limit;
+
+   if((dec->flowCache != NULL && DecodeResetFlowCache(worker, DmtxTrue) == DmtxFail) ||
+         (dec->coarse != NULL && (worker->coarse = DecodeCreateWorker(dec->coarse)) == NULL)) {
+      DecodeDestroyWorker(&worker);
+      return NULL;
+   }
+
+   return worker;
+}
+
+/**
+ * \brief  Free a worker decoder without touching the state it shares
+ * \param  worker
+ * \return void
+ */
+static void
+DecodeDestroyWorker(DmtxDecode **worker)
+{
+   if(worker == NULL || *worker == NULL)
+      return;
+
+   ScanCacheDestroy(&((*worker)->cache));
+   FlowCacheDestroy(&((*worker)->flowCache));
+   TrailDestroy(&((*worker)->trail));
+   DecodeDestroyWorker(&((*worker)->coarse));
+
+   MemFree(*worker);
+   *worker = NULL;
+}
+
+/**
+ * \brief  Restrict a worker to scanning one rectangle from a clean state
+ * \param  worker
+ * \param  xMin
+ * \param  yMin
+ * \param  xMax
+ * \param  yMax
+ * \return DmtxPass | DmtxFail
+ *
+ * Only scan seeds are restricted; regions may extend past the rectangle.
+ * Under a scan cache limit the tiles are freed as well, so the memory left
+ * for a rectangle does not depend on what the worker scanned before.
+ */
+static DmtxPassFail
+DecodeSetTile(DmtxDecode *worker, int xMin, int yMin, int xMax, int yMax)
+{
+   int levels;
+   long limit;
+
+   if(worker->cache->limit == 0) {
+      ScanCacheReset(worker->cache);
+   }
+   else {
+      limit = worker->cache->limit;
+      ScanCacheDestroy(&(worker->cache));
+      worker->cache = ScanCacheCreate(worker->image->width / worker->scale,
+            worker->image->height / worker->scale);
+      if(worker->cache == NULL)
+         return DmtxFail;
+      worker->cache->limit = limit;
+   }
+
+   worker->xMin = xMin;
+   worker->xMax = xMax;
+   worker->yMin = yMin;
+   worker->yMax = yMax;
+   worker->grid = InitScanGrid(worker);
+
+   if(worker->coarse == NULL)
+      return DmtxPass;
+
+   levels = worker->pyramidLevels;
+
+   return DecodeSetTile(worker->coarse, xMin >> levels, yMin >> levels,
+         min(xMax >> levels, worker->coarse->image->width - 1),
+         min(yMax >> levels, worker->coarse->image->height - 1));
+}
+
+/**
+ * \brief  Fill the region covered by the quadrilateral given by (p0,p1,p2,p3) in the cache.
+ *
+ * Scanline bounds are taken from arena (if not NULL) and handed back on return.
+ * Marks ignore DmtxPropScanCacheLimit, so DmtxFail means a tile could not be
+ * allocated at all and part of the quadrilateral stayed unmarked.
+ */
+static DmtxPassFail
+CacheFillQuad(DmtxDecode *dec, DmtxArena *arena, DmtxPixelLoc p0, DmtxPixelLoc p1, DmtxPixelLoc p2, DmtxPixelLoc p3)
+{
+   DmtxPassFail passFail;
+   DmtxArenaMark mark;
    DmtxBresLine lines[4];
    DmtxPixelLoc pEmpty = { 0, 0 };
    unsigned char *cache;
@@ -289,8 +861,10 @@ CacheFillQuad(DmtxDecode *dec, DmtxPixelLoc p0, DmtxPixelLoc p1, DmtxPixelLoc p2
 
    sizeY = maxY - minY + 1;
 
-   scanlineMin = (int *)malloc(sizeY * sizeof(int));
-   scanlineMax = (int *)calloc(sizeY, sizeof(int));
+   mark = ArenaGetMark(arena);
+
+   scanlineMin = (int *)ArenaAlloc(arena, sizeY * sizeof(int));
+   scanlineMax = (int *)ArenaCalloc(arena, sizeY, sizeof(int));
 
    assert(scanlineMin); /* XXX handle this better */
    assert(scanlineMax); /* XXX handle this better */
@@ -307,45 +881,41 @@ CacheFillQuad(DmtxDecode *dec, DmtxPixelLoc p0, DmtxPixelLoc p1, DmtxPixelLoc p2
       }
    }
 
+   passFail = DmtxPass;
    for(posY = minY; posY < maxY && posY < dec->yMax; posY++) {
       idx = posY - minY;
       for(posX = scanlineMin[idx]; posX < scanlineMax[idx] && posX < dec->xMax; posX++) {
-         cache = dmtxDecodeGetCache(dec, posX, posY);
+         cache = ScanCacheGet(dec->cache, posX, posY, DmtxFalse);
          if(cache != NULL)
             *cache |= 0x80;
+         else if(posX >= 0 && posY >= 0)
+            passFail = DmtxFail;
       }
    }
 
-   free(scanlineMin);
-   free(scanlineMax);
+   MemFree(scanlineMin);
+   MemFree(scanlineMax);
+
+   ArenaRelease(arena, mark);
+
+   return passFail;
 }
 
 /**
- * \brief  Convert fitted Data Matrix region into a decoded message
+ * \brief  Mark the pixels covered by a region as visited
  * \param  dec
  * \param  reg
- * \param  fix
- * \return Decoded message
+ * \return DmtxPass | DmtxFail if a tile for the marks could not be allocated
+ *
+ * Keeps later scanning from finding the same symbol again.
  */
-extern DmtxMessage *
-dmtxDecodeMatrixRegion(DmtxDecode *dec, DmtxRegion *reg, int fix)
+static DmtxPassFail
+DecodeMarkRegion(DmtxDecode *dec, DmtxRegion *reg)
 {
-   //fprintf(stdout, "libdmtx::dmtxDecodeMatrixRegion()\n");
-   DmtxMessage *msg;
+   DmtxPassFail passFail;
    DmtxVector2 topLeft, topRight, bottomLeft, bottomRight;
    DmtxPixelLoc pxTopLeft, pxTopRight, pxBottomLeft, pxBottomRight;
 
-   msg = dmtxMessageCreate(reg->sizeIdx, DmtxFormatMatrix);
-   if(msg == NULL)
-      return NULL;
-
-   if(PopulateArrayFromMatrix(dec, reg, msg) != DmtxPass) {
-      dmtxMessageDestroy(&msg);
-      return NULL;
-   }
-
-   msg->fnc1 = dec->fnc1;
-
    topLeft.X = bottomLeft.X = topLeft.Y = topRight.Y = -0.1;
    topRight.X = bottomRight.X = bottomLeft.Y = bottomRight.Y = 1.1;
 
@@ -363,9 +933,78 @@ dmtxDecodeMatrixRegion(DmtxDecode *dec, DmtxRegion *reg, int fix)
    pxBottomRight.X = (int)(0.5 + bottomRight.X);
    pxBottomRight.Y = (int)(0.5 + bottomRight.Y);
 
-   CacheFillQuad(dec, pxTopLeft, pxTopRight, pxBottomRight, pxBottomLeft);
+   passFail = CacheFillQuad(dec, dec->arena, pxTopLeft, pxTopRight, pxBottomRight, pxBottomLeft);
+
+   /* Keep the coarse scan from finding the same symbol again */
+   if(dec->coarse != NULL) {
+      pxTopLeft.X >>= dec->pyramidLevels;
+      pxTopLeft.Y >>= dec->pyramidLevels;
+      pxTopRight.X >>= dec->pyramidLevels;
+      pxTopRight.Y >>= dec->pyramidLevels;
+      pxBottomLeft.X >>= dec->pyramidLevels;
+      pxBottomLeft.Y >>= dec->pyramidLevels;
+      pxBottomRight.X >>= dec->pyramidLevels;
+      pxBottomRight.Y >>= dec->pyramidLevels;
+      if(CacheFillQuad(dec->coarse, dec->arena, pxTopLeft, pxTopRight, pxBottomRight,
+            pxBottomLeft) == DmtxFail)
+         passFail = DmtxFail;
+   }
+
+   return passFail;
+}
+
+/**
+ * \brief  Convert fitted Data Matrix region into a decoded message
+ * \param  dec
+ * \param  reg
+ * \param  fix
+ * \return Decoded message
+ */
+extern DmtxMessage *
+dmtxDecodeMatrixRegion(DmtxDecode *dec, DmtxRegion *reg, int fix)
+{
+   //fprintf(stdout, "libdmtx::dmtxDecodeMatrixRegion()\n");
+   DmtxMessage *msg;
+
+   msg = MessageCreate(dec->arena, reg->sizeIdx, DmtxFormatMatrix);
+   if(msg == NULL)
+      return NULL;
+
+   if(dmtxDecodeMatrixRegionInto(dec, reg, fix, msg) == DmtxFail) {
+      dmtxMessageDestroy(&msg);
+      return NULL;
+   }
 
-   return dmtxDecodePopulatedArray(reg->sizeIdx, msg, fix);
+   return msg;
+}
+
+/**
+ * \brief  Convert fitted Data Matrix region into a caller-owned message
+ * \param  dec
+ * \param  reg
+ * \param  fix
+ * \param  msg Message from dmtxMessageCreate(), resized as needed
+ * \return DmtxPass | DmtxFail
+ *
+ * The message is kept on failure, so one message can serve every region of
+ * a stream and only grows when a larger symbol size is decoded.
+ */
+extern DmtxPassFail
+dmtxDecodeMatrixRegionInto(DmtxDecode *dec, DmtxRegion *reg, int fix, DmtxMessage *msg)
+{
+   if(msg == NULL || MessageResize(NULL, msg, reg->sizeIdx, DmtxFormatMatrix) == DmtxFail)
+      return DmtxFail;
+
+   if(PopulateArrayFromMatrix(dec, reg, msg) != DmtxPass)
+      return DmtxFail;
+
+   msg->fnc1 = dec->fnc1;
+
+   /* An unmarked symbol would be found and reported again */
+   if(DecodeMarkRegion(dec, reg) == DmtxFail)
+      return DmtxFail;
+
+   return DecodePopulatedArray(reg->sizeIdx, msg, fix);
 }
 
 /**
@@ -381,6 +1020,28 @@ dmtxDecodeMatrixRegion(DmtxDecode *dec, DmtxRegion *reg, int fix)
 DmtxMessage *
 dmtxDecodePopulatedArray(int sizeIdx, DmtxMessage *msg, int fix)
 {
+   if(DecodePopulatedArray(sizeIdx, msg, fix) == DmtxFail) {
+      dmtxMessageDestroy(&msg);
+      msg = NULL;
+      return NULL;
+   }
+
+   return msg;
+}
+
+/**
+ * \brief  Decode the codewords of a populated module array in place
+ * \param  sizeIdx
+ * \param  msg
+ * \param  fix
+ * \return DmtxPass | DmtxFail
+ */
+static DmtxPassFail
+DecodePopulatedArray(int sizeIdx, DmtxMessage *msg, int fix)
+{
+   unsigned char erasure[DmtxCodeSizeMax];
+   DmtxBoolean unsure;
+
    /*
     * Example msg->array indices for a 12x12 datamatrix.
     *  also, the 'L' color (usually black) is defined as 'DmtxModuleOnRGB'
@@ -402,19 +1063,43 @@ dmtxDecodePopulatedArray(int sizeIdx, DmtxMessage *msg, int fix)
     
    ModulePlacementEcc200(msg->array, msg->code, sizeIdx, DmtxModuleOnRed | DmtxModuleOnGreen | DmtxModuleOnBlue);
 
-   if(RsDecode(msg->code, sizeIdx, fix) == DmtxFail){
-      dmtxMessageDestroy(&msg);
-      msg = NULL;
-      return NULL;
-   }
+   unsure = ReadErasures(msg, sizeIdx, erasure);
 
-   if(DecodeDataStream(msg, sizeIdx, NULL) == DmtxFail) {
-      dmtxMessageDestroy(&msg);
-      msg = NULL;
-      return NULL;
+   if(RsDecode(msg->code, sizeIdx, fix, (unsure) ? erasure : NULL) == DmtxFail)
+      return DmtxFail;
+
+   return DecodeDataStream(msg, sizeIdx, NULL);
+}
+
+/**
+ * \brief  Flag the codewords holding a module of uncertain color
+ * \param  msg Message whose codewords were just read from its array
+ * \param  sizeIdx
+ * \param  erasure Receives one byte per codeword, nonzero when unsure
+ * \return DmtxTrue if any module is marked DmtxModuleUnsure
+ *
+ * The placement is walked a second time reading DmtxModuleUnsure in place
+ * of the module color, so the unsure modules of each codeword collect into
+ * the matching byte of erasure.
+ */
+static DmtxBoolean
+ReadErasures(DmtxMessage *msg, int sizeIdx, unsigned char *erasure)
+{
+   size_t i;
+
+   for(i = 0; i < msg->arraySize; i++) {
+      if(msg->array[i] & DmtxModuleUnsure)
+         break;
    }
 
-   return msg;
+   if(i == msg->arraySize)
+      return DmtxFalse;
+
+   assert(msg->codeSize <= DmtxCodeSizeMax);
+
+   ModulePlacementEcc200(msg->array, erasure, sizeIdx, DmtxModuleUnsure);
+
+   return DmtxTrue;
 }
 
 /**
@@ -427,12 +1112,54 @@ dmtxDecodePopulatedArray(int sizeIdx, DmtxMessage *msg, int fix)
 extern DmtxMessage *
 dmtxDecodeMosaicRegion(DmtxDecode *dec, DmtxRegion *reg, int fix)
 {
-   int offset;
+   DmtxMessage *msg;
+
+   msg = MessageCreate(dec->arena, reg->sizeIdx, DmtxFormatMosaic);
+   if(msg == NULL)
+      return NULL;
+
+   if(dmtxDecodeMosaicRegionInto(dec, reg, fix, msg) == DmtxFail) {
+      dmtxMessageDestroy(&msg);
+      return NULL;
+   }
+
+   return msg;
+}
+
+/**
+ * \brief  Convert fitted Data Mosaic region into a caller-owned message
+ * \param  dec
+ * \param  reg
+ * \param  fix
+ * \param  msg Message from dmtxMessageCreate(), resized as needed
+ * \return DmtxPass | DmtxFail
+ *
+ * Layers are decoded one after another into a single message kept by the
+ * decoder and appended to the output of msg.
+ */
+extern DmtxPassFail
+dmtxDecodeMosaicRegionInto(DmtxDecode *dec, DmtxRegion *reg, int fix, DmtxMessage *msg)
+{
+   int i, offset;
    int colorPlane;
-   DmtxMessage *oMsg, *rMsg, *gMsg, *bMsg;
+   DmtxImage *plane;
+   DmtxPassFail result;
+
+   if(msg == NULL || MessageResize(NULL, msg, reg->sizeIdx, DmtxFormatMosaic) == DmtxFail)
+      return DmtxFail;
+
+   if(dec->layer == NULL) {
+      dec->layer = dmtxMessageCreate(reg->sizeIdx, DmtxFormatMatrix);
+      if(dec->layer == NULL)
+         return DmtxFail;
+   }
 
    colorPlane = reg->flowBegin.plane;
 
+   /* Each mosaic layer is sampled from its own channel of the source image */
+   plane = dec->plane;
+   dec->plane = NULL;
+
    /**
     * Consider performing a color cube fit here to identify exact RGB of
     * all 6 "cube-like" corners based on pixels located within region. Then
@@ -446,42 +1173,217 @@ dmtxDecodeMosaicRegion(DmtxDecode *dec, DmtxRegion *reg, int fix)
     * identify value. An additional method will be required to get actual
     * RGB instead of just a plane in 3D. */
 
-   reg->flowBegin.plane = 0; /* kind of a hack */
-   rMsg = dmtxDecodeMatrixRegion(dec, reg, fix);
+   /* Every layer is visited even after a failure so all of them mark the cache */
+   result = DmtxPass;
+   offset = 0;
+   for(i = 0; i < 3; i++) {
+      reg->flowBegin.plane = i; /* kind of a hack */
+      if(dmtxDecodeMatrixRegionInto(dec, reg, fix, dec->layer) == DmtxFail) {
+         result = DmtxFail;
+         continue;
+      }
+      memcpy(msg->output + offset, dec->layer->output, dec->layer->outputIdx);
+      offset += dec->layer->outputIdx;
+   }
 
-   reg->flowBegin.plane = 1; /* kind of a hack */
-   gMsg = dmtxDecodeMatrixRegion(dec, reg, fix);
+   reg->flowBegin.plane = colorPlane;
+   dec->plane = plane;
 
-   reg->flowBegin.plane = 2; /* kind of a hack */
-   bMsg = dmtxDecodeMatrixRegion(dec, reg, fix);
+   msg->outputIdx = offset;
 
-   reg->flowBegin.plane = colorPlane;
+   return result;
+}
 
-   oMsg = dmtxMessageCreate(reg->sizeIdx, DmtxFormatMosaic);
+/**
+ * \brief  Find and decode every symbol of an image within a budget
+ * \param  dec
+ * \param  budget Time and iteration limits for the whole image, or NULL
+ * \param  expectedCount Number of symbols after which scanning stops early,
+ *         or 0 to scan the whole image
+ * \return Decoded symbols in scan order, to be released with
+ *         dmtxDecodeResultDestroy(), or NULL on allocation failure
+ *
+ * Scanning resumes where dmtxRegionFindNext() left off. Unlike a
+ * DmtxScanConstraint passed to dmtxRegionFindNextDeterministic(), the budget
+ * covers every region found, and on return holds the total iterations used
+ * and why scanning stopped: DmtxScanSuccess when expectedCount symbols were
+ * decoded, DmtxScanNotFound when the image was exhausted, or the limit hit.
+ * The status of the result is DmtxFail when a limit ended the scan, even if
+ * symbols were decoded before it. Symbol corners follow from the fit2raw
+ * matrix of each region. Results allocated from the decode arena
+ * (DmtxPropArenaSize) only live until the next image is attached.
+ */
+extern DmtxDecodeResult *
+dmtxDecodeFindAll(DmtxDecode *dec, DmtxScanConstraint *budget, int expectedCount)
+{
+   DmtxDecodeResult *result;
 
-   if(oMsg == NULL || rMsg == NULL || gMsg == NULL || bMsg == NULL) {
-      dmtxMessageDestroy(&oMsg);
-      dmtxMessageDestroy(&rMsg);
-      dmtxMessageDestroy(&gMsg);
-      dmtxMessageDestroy(&bMsg);
+   if(dec == NULL)
+      return NULL;
+
+   result = (DmtxDecodeResult *)MemCalloc(1, sizeof(DmtxDecodeResult));
+   if(result == NULL)
+      return NULL;
+
+   if(DecodeImageAll(dec, budget, expectedCount, result) == DmtxFail) {
+      dmtxDecodeResultDestroy(&result);
       return NULL;
    }
 
-   offset = 0;
-   memcpy(oMsg->output + offset, rMsg->output, rMsg->outputIdx);
-   offset += rMsg->outputIdx;
-   memcpy(oMsg->output + offset, gMsg->output, gMsg->outputIdx);
-   offset += gMsg->outputIdx;
-   memcpy(oMsg->output + offset, bMsg->output, bMsg->outputIdx);
-   offset += bMsg->outputIdx;
+   return result;
+}
+
+/**
+ * \brief  Free a result returned by dmtxDecodeFindAll()
+ * \param  result
+ * \return DmtxPass | DmtxFail
+ */
+extern DmtxPassFail
+dmtxDecodeResultDestroy(DmtxDecodeResult **result)
+{
+   if(result == NULL || *result == NULL)
+      return DmtxFail;
 
-   oMsg->outputIdx = offset;
+   DecodeResultClear(*result);
 
-   dmtxMessageDestroy(&rMsg);
-   dmtxMessageDestroy(&gMsg);
-   dmtxMessageDestroy(&bMsg);
+   MemFree(*result);
 
-   return oMsg;
+   *result = NULL;
+
+   return DmtxPass;
+}
+
+/**
+ * \brief  Find and decode every symbol of the image attached to a decoder
+ * \param  dec
+ * \param  constraint Limits for the whole image, or NULL for none
+ * \param  expectedCount Stop once this many symbols are decoded, or 0
+ * \param  result Receives the regions and messages, and as status whether
+ *         the scan ran to its end rather than into a limit
+ * \return DmtxPass | DmtxFail on allocation failure
+ */
+static DmtxPassFail
+DecodeImageAll(DmtxDecode *dec, DmtxScanConstraint *constraint, int expectedCount,
+      DmtxDecodeResult *result)
+{
+   int iterations;
+   DmtxScanConstraint step;
+   DmtxRegion *reg;
+   DmtxMessage *msg;
+
+   iterations = 0;
+   step.iterations = 0;
+   step.stopCause = DmtxScanNotFound;
+
+   while(expectedCount < 1 || result->count < expectedCount) {
+      if(constraint != NULL) {
+         if(constraint->maxIterations != 0 && iterations >= constraint->maxIterations) {
+            step.stopCause = DmtxScanIterLimit;
+            break;
+         }
+         if(constraint->maxTimeout != NULL && dmtxTimeExceeded(*constraint->maxTimeout)) {
+            step.stopCause = DmtxScanTimeLimit;
+            break;
+         }
+         step.maxTimeout = constraint->maxTimeout;
+         step.maxIterations = (constraint->maxIterations == 0) ? 0 :
+               constraint->maxIterations - iterations;
+         step.iterations = 0;
+      }
+
+      reg = dmtxRegionFindNextDeterministic(dec, (constraint == NULL) ? NULL : &step);
+      iterations += step.iterations;
+      if(reg == NULL)
+         break;
+
+      msg = dmtxDecodeMatrixRegion(dec, reg, DmtxUndefined);
+      if(msg == NULL) {
+         dmtxRegionDestroy(&reg);
+         continue;
+      }
+
+      if(DecodeResultAppend(result, reg, msg) == DmtxFail) {
+         dmtxMessageDestroy(&msg);
+         dmtxRegionDestroy(&reg);
+         return DmtxFail;
+      }
+      step.stopCause = DmtxScanSuccess;
+   }
+
+   if(constraint != NULL) {
+      constraint->iterations = iterations;
+      constraint->stopCause = step.stopCause;
+   }
+
+   result->status = (step.stopCause == DmtxScanIterLimit || step.stopCause == DmtxScanTimeLimit) ?
+         DmtxFail : DmtxPass;
+
+   return DmtxPass;
+}
+
+/**
+ * \brief  Append a decoded symbol to a result, growing it as needed
+ * \param  result
+ * \param  reg
+ * \param  msg
+ * \return DmtxPass | DmtxFail
+ */
+static DmtxPassFail
+DecodeResultAppend(DmtxDecodeResult *result, DmtxRegion *reg, DmtxMessage *msg)
+{
+   int capacity;
+   DmtxRegion **region;
+   DmtxMessage **message;
+
+   if(result->count == result->capacity) {
+      capacity = (result->capacity == 0) ? 4 : 2 * result->capacity;
+      region = (DmtxRegion **)MemAlloc(capacity * sizeof(DmtxRegion *));
+      message = (DmtxMessage **)MemAlloc(capacity * sizeof(DmtxMessage *));
+      if(region == NULL || message == NULL) {
+         MemFree(region);
+         MemFree(message);
+         return DmtxFail;
+      }
+      if(result->count > 0) {
+         memcpy(region, result->region, result->count * sizeof(DmtxRegion *));
+         memcpy(message, result->message, result->count * sizeof(DmtxMessage *));
+      }
+      MemFree(result->region);
+      MemFree(result->message);
+      result->region = region;
+      result->message = message;
+      result->capacity = capacity;
+   }
+
+   result->region[result->count] = reg;
+   result->message[result->count] = msg;
+   result->count++;
+
+   return DmtxPass;
+}
+
+/**
+ * \brief  Free the regions and messages held by a result
+ * \param  result
+ * \return void
+ */
+static void
+DecodeResultClear(DmtxDecodeResult *result)
+{
+   int i;
+
+   for(i = 0; i < result->count; i++) {
+      dmtxRegionDestroy(&(result->region[i]));
+      dmtxMessageDestroy(&(result->message[i]));
+   }
+
+   MemFree(result->region);
+   MemFree(result->message);
+
+   result->region = NULL;
+   result->message = NULL;
+   result->count = 0;
+   result->capacity = 0;
 }
 
 /**
@@ -497,7 +1399,8 @@ dmtxDecodeCreateDiagnostic(DmtxDecode *dec, int *totalBytes, int *headerBytes, i
    int count, channelCount;
    int rgb[3];
    double shade;
-   unsigned char *pnm, *output, *cache;
+   int cache;
+   unsigned char *pnm, *output;
 
    width = dmtxDecodeGetProp(dec, DmtxPropWidth);
    height = dmtxDecodeGetProp(dec, DmtxPropHeight);
@@ -534,19 +1437,19 @@ dmtxDecodeCreateDiagnostic(DmtxDecode *dec, int *totalBytes, int *headerBytes, i
    output = pnm + (*headerBytes);
    for(row = height - 1; row >= 0; row--) {
       for(col = 0; col < width; col++) {
-         cache = dmtxDecodeGetCache(dec, col, row);
-         if(cache == NULL) {
+         cache = ScanCacheRead(dec->cache, col, row);
+         if(cache == DmtxUndefined) {
             rgb[0] = 0;
             rgb[1] = 0;
             rgb[2] = 128;
          }
-         else if(*cache & 0x40) {
+         else if(cache & 0x40) {
             rgb[0] = 255;
             rgb[1] = 0;
             rgb[2] = 0;
          }
          else {
-            shade = (*cache & 0x80) ? 0.0 : 0.7;
+            shade = (cache & 0x80) ? 0.0 : 0.7;
             for(i = 0; i < 3; i++) {
                if(i < channelCount)
                   dmtxDecodeGetPixelValue(dec, col, row, i, &rgb[i]);
@@ -568,11 +1471,43 @@ dmtxDecodeCreateDiagnostic(DmtxDecode *dec, int *totalBytes, int *headerBytes, i
    return pnm;
 }
 
+/**
+ * \brief  Sample every module of a data region and its border once
+ * \param  dec
+ * \param  reg
+ * \param  symbol Descriptor of reg->sizeIdx
+ * \param  color Receives module colors, indexed from the border module at
+ *         (xOrigin - 1, yOrigin - 1); the four corners are not read
+ * \param  xOrigin
+ * \param  yOrigin
+ * \return void
+ */
+static void
+ReadRegionColors(DmtxDecode *dec, DmtxRegion *reg, const DmtxSymbolDescriptor *symbol,
+      int color[][DmtxMapGridMax], int xOrigin, int yOrigin)
+{
+   int row, mapWidth, mapHeight;
+
+   mapWidth = symbol->dataRegionCols;
+   mapHeight = symbol->dataRegionRows;
+
+   assert(mapWidth + 2 <= DmtxMapGridMax && mapHeight + 2 <= DmtxMapGridMax);
+
+   for(row = 0; row < mapHeight + 2; row++) {
+      if(row == 0 || row == mapHeight + 1)
+         ReadModuleColorLine(dec, reg, yOrigin - 1 + row, xOrigin, symbol,
+               reg->flowBegin.plane, DmtxDirRight, mapWidth, &color[row][1]);
+      else
+         ReadModuleColorLine(dec, reg, yOrigin - 1 + row, xOrigin - 1, symbol,
+               reg->flowBegin.plane, DmtxDirRight, mapWidth + 2, color[row]);
+   }
+}
+
 /**
  * \brief  Increment counters used to determine module values
- * \param  img
  * \param  reg
  * \param  tally
+ * \param  color Module colors from ReadRegionColors()
  * \param  xOrigin
  * \param  yOrigin
  * \param  mapWidth
@@ -581,7 +1516,7 @@ dmtxDecodeCreateDiagnostic(DmtxDecode *dec, int *totalBytes, int *headerBytes, i
  * \return void
  */
 static void
-TallyModuleJumps(DmtxDecode *dec, DmtxRegion *reg, int tally[][24], int xOrigin, int yOrigin, int mapWidth, int mapHeight, DmtxDirection dir)
+TallyModuleJumps(DmtxRegion *reg, int tally[][24], int color[][DmtxMapGridMax], int xOrigin, int yOrigin, int mapWidth, int mapHeight, DmtxDirection dir)
 {
    int extent, weight;
    int travelStep;
@@ -592,7 +1527,8 @@ TallyModuleJumps(DmtxDecode *dec, DmtxRegion *reg, int tally[][24], int xOrigin,
    int *line, *travel;
    int jumpThreshold;
    int darkOnLight;
-   int color;
+   int i;
+   int colors[DmtxModuleLineMax];
    int statusPrev, statusModule;
    int tPrev, tModule;
 
@@ -636,9 +1572,12 @@ TallyModuleJumps(DmtxDecode *dec, DmtxRegion *reg, int tally[][24], int xOrigin,
 
 
 
+      /* Gather the line from the region's color grid */
+      for(i = 0, *travel = travelStart; i <= extent; i++, *travel += travelStep)
+         colors[i] = color[symbolRow - yOrigin + 1][symbolCol - xOrigin + 1];
+
       *travel = travelStart;
-      color = ReadModuleColor(dec, reg, symbolRow, symbolCol, reg->sizeIdx, reg->flowBegin.plane);
-      tModule = (darkOnLight) ? reg->offColor - color : color - reg->offColor;
+      tModule = (darkOnLight) ? reg->offColor - colors[0] : colors[0] - reg->offColor;
 
       statusModule = (travelStep == 1 || (*line & 0x01) == 0) ? DmtxModuleOnRGB : DmtxModuleOff;
 
@@ -652,8 +1591,8 @@ TallyModuleJumps(DmtxDecode *dec, DmtxRegion *reg, int tally[][24], int xOrigin,
          /* For normal data-bearing modules capture color and decide
             module status based on comparison to previous "known" module */
 
-         color = ReadModuleColor(dec, reg, symbolRow, symbolCol, reg->sizeIdx, reg->flowBegin.plane);
-         tModule = (darkOnLight) ? reg->offColor - color : color - reg->offColor;
+         tModule = (darkOnLight) ? reg->offColor - colors[extent - weight + 1] :
+               colors[extent - weight + 1] - reg->offColor;
 
          if(statusPrev == DmtxModuleOnRGB) {
             if(tModule < tPrev - jumpThreshold){
@@ -691,11 +1630,75 @@ TallyModuleJumps(DmtxDecode *dec, DmtxRegion *reg, int tally[][24], int xOrigin,
  * \param  img
  * \param  reg
  * \return DmtxPass | DmtxFail
+ *
+ * Data regions are read independently into separate parts of the array, so
+ * with an executor set the regions of a large symbol are read in parallel.
  */
 static DmtxPassFail
 PopulateArrayFromMatrix(DmtxDecode *dec, DmtxRegion *reg, DmtxMessage *msg)
 {
    //fprintf(stdout, "libdmtx::PopulateArrayFromMatrix()\n");
+   int regionIdx, regionTotal, workerCount;
+   const DmtxSymbolDescriptor *symbol;
+   DmtxPopulateJob job;
+
+/* memset(msg->array, 0x00, msg->arraySize); */
+
+   symbol = dmtxGetSymbolDescriptor(reg->sizeIdx);
+
+   /* Capture number of regions present in barcode */
+   regionTotal = symbol->horizDataRegions * symbol->vertDataRegions;
+
+   workerCount = (dec->executor.submit != NULL) ?
+         min(ThreadCount(&(dec->executor), 0), regionTotal) : 1;
+
+   if(workerCount > 1) {
+      job.dec = dec;
+      job.reg = reg;
+      job.msg = msg;
+      if(WorkQueueInit(&(job.queue), regionTotal) == DmtxPass) {
+         ThreadRunWorkers(&(dec->executor), workerCount, PopulateArrayWorker, &job);
+         WorkQueueDestroy(&(job.queue));
+         return DmtxPass;
+      }
+   }
+
+   for(regionIdx = 0; regionIdx < regionTotal; regionIdx++)
+      PopulateDataRegion(dec, reg, msg, regionIdx);
+
+   return DmtxPass;
+}
+
+/**
+ * \brief  Worker function of PopulateArrayFromMatrix()
+ * \param  job DmtxPopulateJob
+ * \param  worker Worker index
+ * \return void
+ */
+static void
+PopulateArrayWorker(void *job, int worker)
+{
+   int regionIdx;
+   DmtxPopulateJob *populate;
+
+   (void)worker;
+   populate = (DmtxPopulateJob *)job;
+
+   while((regionIdx = WorkQueueNext(&(populate->queue))) != DmtxUndefined)
+      PopulateDataRegion(populate->dec, populate->reg, populate->msg, regionIdx);
+}
+
+/**
+ * \brief  Populate the array modules of one data region
+ * \param  dec
+ * \param  reg
+ * \param  msg
+ * \param  regionIdx Data region in row order from the bottom left
+ * \return void
+ */
+static void
+PopulateDataRegion(DmtxDecode *dec, DmtxRegion *reg, DmtxMessage *msg, int regionIdx)
+{
    int weightFactor;
    int mapWidth, mapHeight;
    int xRegionTotal, yRegionTotal;
@@ -704,84 +1707,58 @@ PopulateArrayFromMatrix(DmtxDecode *dec, DmtxRegion *reg, DmtxMessage *msg)
    int mapCol, mapRow;
    int colTmp, rowTmp, idx;
    int tally[24][24]; /* Large enough to map largest single region */
+   int color[DmtxMapGridMax][DmtxMapGridMax];
+   const DmtxSymbolDescriptor *symbol;
 
-/* memset(msg->array, 0x00, msg->arraySize); */
+   symbol = dmtxGetSymbolDescriptor(reg->sizeIdx);
 
    /* Capture number of regions present in barcode */
-   xRegionTotal = dmtxGetSymbolAttribute(DmtxSymAttribHorizDataRegions, reg->sizeIdx);
-   yRegionTotal = dmtxGetSymbolAttribute(DmtxSymAttribVertDataRegions, reg->sizeIdx);
+   xRegionTotal = symbol->horizDataRegions;
+   yRegionTotal = symbol->vertDataRegions;
 
    /* Capture region dimensions (not including border modules) */
-   mapWidth = dmtxGetSymbolAttribute(DmtxSymAttribDataRegionCols, reg->sizeIdx);
-   mapHeight = dmtxGetSymbolAttribute(DmtxSymAttribDataRegionRows, reg->sizeIdx);
+   mapWidth = symbol->dataRegionCols;
+   mapHeight = symbol->dataRegionRows;
 
    weightFactor = 2 * (mapHeight + mapWidth + 2);
    assert(weightFactor > 0);
 
-   //fprintf(stdout, "libdmtx::PopulateArrayFromMatrix::reg->sizeIdx: %d\n", reg->sizeIdx);
-   //fprintf(stdout, "libdmtx::PopulateArrayFromMatrix::reg->flowBegin.plane: %d\n", reg->flowBegin.plane);
-   //fprintf(stdout, "libdmtx::PopulateArrayFromMatrix::reg->onColor: %d\n", reg->onColor);
-   //fprintf(stdout, "libdmtx::PopulateArrayFromMatrix::reg->offColor: %d\n", reg->offColor);
-   //fprintf(stdout, "libdmtx::PopulateArrayFromMatrix::xRegionTotal: %d\n", xRegionTotal);
-   //fprintf(stdout, "libdmtx::PopulateArrayFromMatrix::yRegionTotal: %d\n", yRegionTotal);
-   //fprintf(stdout, "libdmtx::PopulateArrayFromMatrix::mapWidth: %d\n", mapWidth);
-   //fprintf(stdout, "libdmtx::PopulateArrayFromMatrix::mapHeight: %d\n", mapHeight);
-   //fprintf(stdout, "libdmtx::PopulateArrayFromMatrix::weightFactor: %d\n", weightFactor);
-   //reg->fit2raw[1][0]=0;
-   //reg->fit2raw[0][1]=0;
-   //reg->fit2raw[0][2]=0;
-   //reg->fit2raw[2][2]=1;
-   //reg->fit2raw[1][2]=0;
-   //reg->fit2raw[2][0]=10; //translation
-   //reg->fit2raw[2][1]=10; //translation
-   //reg->fit2raw[0][0]=60; //scale
-   //reg->fit2raw[1][1]=60; //scale
-   //dmtxMatrix3Print(reg->fit2raw);
-   
-
-   /* Tally module changes for each region in each direction */
-   for(yRegionCount = 0; yRegionCount < yRegionTotal; yRegionCount++) {
-
-      /* Y location of mapping region origin in symbol coordinates */
-      yOrigin = yRegionCount * (mapHeight + 2) + 1;
-
-      for(xRegionCount = 0; xRegionCount < xRegionTotal; xRegionCount++) {
-
-         /* X location of mapping region origin in symbol coordinates */
-         xOrigin = xRegionCount * (mapWidth + 2) + 1;
-         //fprintf(stdout, "libdmtx::PopulateArrayFromMatrix::xOrigin: %d\n", xOrigin);
-
-         memset(tally, 0x00, 24 * 24 * sizeof(int));
-         TallyModuleJumps(dec, reg, tally, xOrigin, yOrigin, mapWidth, mapHeight, DmtxDirUp);
-         TallyModuleJumps(dec, reg, tally, xOrigin, yOrigin, mapWidth, mapHeight, DmtxDirLeft);
-         TallyModuleJumps(dec, reg, tally, xOrigin, yOrigin, mapWidth, mapHeight, DmtxDirDown);
-         TallyModuleJumps(dec, reg, tally, xOrigin, yOrigin, mapWidth, mapHeight, DmtxDirRight);
-
-         /* Decide module status based on final tallies */
-         for(mapRow = 0; mapRow < mapHeight; mapRow++) {
-         //for(mapRow = mapHeight-1; mapRow >= 0; mapRow--) {
-            for(mapCol = 0; mapCol < mapWidth; mapCol++) {
-               
-               rowTmp = (yRegionCount * mapHeight) + mapRow;
-               rowTmp = yRegionTotal * mapHeight - rowTmp - 1;
-               colTmp = (xRegionCount * mapWidth) + mapCol;
-               idx = (rowTmp * xRegionTotal * mapWidth) + colTmp;
-               //fprintf(stdout, "libdmtx::PopulateArrayFromMatrix::idx: %d @ %d,%d\n", idx, mapCol, mapRow);
-               //fprintf(stdout, "%c ",tally[mapRow][mapCol]==DmtxModuleOff ? 'X' : ' ');
-               if(tally[mapRow][mapCol]/(double)weightFactor >= 0.5){
-                  msg->array[idx] = DmtxModuleOnRGB;
-                  //fprintf(stdout, "X ");
-               } else {
-                  msg->array[idx] = DmtxModuleOff;
-                  //fprintf(stdout, "  ");
-               }
-
-               msg->array[idx] |= DmtxModuleAssigned;
-            }
-            //fprintf(stdout, "\n");
-         }
+   xRegionCount = regionIdx % xRegionTotal;
+   yRegionCount = regionIdx / xRegionTotal;
+
+   /* X and Y location of mapping region origin in symbol coordinates */
+   xOrigin = xRegionCount * (mapWidth + 2) + 1;
+   yOrigin = yRegionCount * (mapHeight + 2) + 1;
+
+   /* Sample each module once and tally jumps across it four ways */
+   ReadRegionColors(dec, reg, symbol, color, xOrigin, yOrigin);
+
+   memset(tally, 0x00, 24 * 24 * sizeof(int));
+   TallyModuleJumps(reg, tally, color, xOrigin, yOrigin, mapWidth, mapHeight, DmtxDirUp);
+   TallyModuleJumps(reg, tally, color, xOrigin, yOrigin, mapWidth, mapHeight, DmtxDirLeft);
+   TallyModuleJumps(reg, tally, color, xOrigin, yOrigin, mapWidth, mapHeight, DmtxDirDown);
+   TallyModuleJumps(reg, tally, color, xOrigin, yOrigin, mapWidth, mapHeight, DmtxDirRight);
+
+   /* Decide module status based on final tallies */
+   for(mapRow = 0; mapRow < mapHeight; mapRow++) {
+      for(mapCol = 0; mapCol < mapWidth; mapCol++) {
+
+         rowTmp = (yRegionCount * mapHeight) + mapRow;
+         rowTmp = yRegionTotal * mapHeight - rowTmp - 1;
+         colTmp = (xRegionCount * mapWidth) + mapCol;
+         idx = (rowTmp * xRegionTotal * mapWidth) + colTmp;
+
+         if(tally[mapRow][mapCol]/(double)weightFactor >= 0.5)
+            msg->array[idx] = DmtxModuleOnRGB;
+         else
+            msg->array[idx] = DmtxModuleOff;
+
+         /* Directions that disagree leave the tally near the middle:
+            flag it when |tally - weightFactor/2| < weightFactor/8 */
+         if(abs(2 * tally[mapRow][mapCol] - weightFactor) * DmtxUnsureMargin < weightFactor)
+            msg->array[idx] |= DmtxModuleUnsure;
+
+         msg->array[idx] |= DmtxModuleAssigned;
       }
    }
-
-   return DmtxPass;
 }
@@ -88,6 +88,22 @@ DecodeDataStream(DmtxMessage *msg, int sizeIdx, unsigned char *outputStart)
    return DmtxPass;
 }
 
+/**
+ * \brief  Largest output DecodeDataStream() can produce for a symbol size
+ * \param  sizeIdx
+ * \return Output bytes
+ *
+ * Per data codeword, ASCII yields at most 2 bytes (digit pairs), C40, Text
+ * and X12 at most 3 per 2, EDIFACT 4 per 3 and Base 256 1 per 1. Latch and
+ * unlatch codewords only lower the ratio, so ASCII digits bound every mix of
+ * schemes. A macro adds a 7 byte header and a 2 byte trailer.
+ */
+static size_t
+DecodeOutputBound(int sizeIdx)
+{
+   return 2 * dmtxGetSymbolAttribute(DmtxSymAttribSymbolDataWords, sizeIdx) + 9;
+}
+
 /**
  * \brief  Determine next encodation scheme
  * \param  encScheme
@@ -131,6 +147,7 @@ static void
 PushOutputWord(DmtxMessage *msg, int value)
 {
    assert(value >= 0 && value < 256);
+   assert(msg->outputIdx < (int)msg->outputSize);
 
    msg->output[msg->outputIdx++] = (unsigned char)value;
 }
@@ -153,6 +170,7 @@ static void
 PushOutputC40TextWord(DmtxMessage *msg, C40TextState *state, int value)
 {
    assert(value >= 0 && value < 256);
+   assert(msg->outputIdx < (int)msg->outputSize);
 
    msg->output[msg->outputIdx] = (unsigned char)value;
 
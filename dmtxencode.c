@@ -30,7 +30,7 @@ dmtxEncodeCreate(void)
 {
    DmtxEncode *enc;
 
-   enc = (DmtxEncode *)calloc(1, sizeof(DmtxEncode));
+   enc = (DmtxEncode *)MemCalloc(1, sizeof(DmtxEncode));
    if(enc == NULL)
       return NULL;
 
@@ -71,14 +71,14 @@ dmtxEncodeDestroy(DmtxEncode **enc)
 
    /* Free pixel array allocated in dmtxEncodeDataMatrix() */
    if((*enc)->image != NULL && (*enc)->image->pxl != NULL) {
-      free((*enc)->image->pxl);
+      MemFree((*enc)->image->pxl);
       (*enc)->image->pxl = NULL;
    }
 
    dmtxImageDestroy(&((*enc)->image));
    dmtxMessageDestroy(&((*enc)->message));
 
-   free(*enc);
+   MemFree(*enc);
 
    *enc = NULL;
 
@@ -227,7 +227,7 @@ dmtxEncodeGetProp(DmtxEncode *enc, int prop)
    assert(bitsPerPixel % 8 == 0);
 
    /* Allocate memory for the image to be generated */
-   pxl = (unsigned char *)malloc((width * bitsPerPixel / 8 + enc->rowPadBytes) * height);
+   pxl = (unsigned char *)MemAlloc((width * bitsPerPixel / 8 + enc->rowPadBytes) * height);
    if(pxl == NULL) {
       perror("pixel malloc error");
       return DmtxFail;
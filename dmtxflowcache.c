@@ -0,0 +1,233 @@
+/**
+ * libdmtx - Data Matrix Encoding/Decoding Library
+ * Copyright 2008, 2009 Mike Laughton. All rights reserved.
+ * Copyright 2012-2016 Vadim A. Misbakh-Soloviov. All rights reserved.
+ *
+ * See LICENSE file in the main project directory for full
+ * terms of use and distribution.
+ *
+ * Contact:
+ * Vadim A. Misbakh-Soloviov <dmtx@mva.name>
+ * Mike Laughton <mike@dragonflylogic.com>
+ *
+ * \file dmtxflowcache.c
+ * \brief Memoized point flow
+ */
+
+/**
+ * Trail blazing and edge seeking evaluate GetPointFlow() on the same pixels
+ * many times over. When enabled with DmtxPropFlowCache, each result is stored
+ * the first time it is computed and reused afterwards. Storage is split into
+ * square tiles per plane that are only allocated once a pixel inside them is
+ * touched, so sparse scans stay cheap on large images. When the scanned image
+ * can be read as bytes, a new tile is filled all at once by the vector
+ * compass kernel from dmtxsimd.c instead of pixel by pixel.
+ *
+ * Tiles are allocated without locking, so a flow cache belongs to exactly
+ * one decoder and is never shared between threads. Worker decoders from
+ * DecodeCreateWorker() and the decoders of dmtxDecodeBatch() each build a
+ * flow cache of their own, and concurrent scans of one image fill separate
+ * tiles.
+ *
+ * Each entry is 16 bits:
+ *
+ *   bit 15      entry is valid
+ *   bits 12-14  depart direction
+ *   bits 0-11   flow magnitude, or DmtxFlowBlank for a blank edge
+ */
+
+/**
+ * \brief  Allocate an empty flow cache covering a scaled image
+ * \param  width Scaled image width
+ * \param  height Scaled image height
+ * \param  planeCount Number of color planes scanned
+ * \param  kernel Compass kernel used to fill whole tiles, or NULL to fill lazily
+ * \return Initialized flow cache, or NULL on allocation failure
+ */
+static DmtxFlowCache *
+FlowCacheCreate(int width, int height, int planeCount, DmtxCompassKernel kernel)
+{
+   DmtxFlowCache *cache;
+
+   cache = (DmtxFlowCache *)MemCalloc(1, sizeof(DmtxFlowCache));
+   if(cache == NULL)
+      return NULL;
+
+   cache->width = width;
+   cache->height = height;
+   cache->planeCount = planeCount;
+   cache->tileCols = (width + DmtxFlowTileMask) >> DmtxFlowTileShift;
+   cache->tileRows = (height + DmtxFlowTileMask) >> DmtxFlowTileShift;
+   cache->compassKernel = kernel;
+
+   cache->tile = (unsigned short **)MemCalloc(cache->tileCols * cache->tileRows * planeCount,
+         sizeof(unsigned short *));
+   if(cache->tile == NULL) {
+      MemFree(cache);
+      return NULL;
+   }
+
+   return cache;
+}
+
+/**
+ * \brief  Free a flow cache and all of its tiles
+ * \param  cache
+ * \return void
+ */
+static void
+FlowCacheDestroy(DmtxFlowCache **cache)
+{
+   int i, tileCount;
+
+   if(cache == NULL || *cache == NULL)
+      return;
+
+   tileCount = (*cache)->tileCols * (*cache)->tileRows * (*cache)->planeCount;
+   for(i = 0; i < tileCount; i++) {
+      if((*cache)->tile[i] != NULL)
+         MemFree((*cache)->tile[i]);
+   }
+
+   MemFree((*cache)->tile);
+   MemFree(*cache);
+
+   *cache = NULL;
+}
+
+/**
+ * \brief  Allocate a tile, computing all of its entries when a kernel is available
+ * \param  dec
+ * \param  plane
+ * \param  tileCol
+ * \param  tileRow
+ * \return New tile, or NULL on allocation failure
+ */
+static unsigned short *
+FlowCacheCreateTile(DmtxDecode *dec, int plane, int tileCol, int tileRow)
+{
+   int row, col, x, y, x0, y0;
+   int scale, step;
+   unsigned char block[(DmtxFlowTileSize + 2) * (DmtxFlowTileSize + 2)];
+   unsigned char *blockRow;
+   const unsigned char *src;
+   unsigned short *tile;
+   DmtxImage *img;
+
+   if(dec->flowCache->compassKernel == NULL)
+      return (unsigned short *)MemCalloc(DmtxFlowTileSize * DmtxFlowTileSize, sizeof(unsigned short));
+
+   tile = (unsigned short *)MemAlloc(DmtxFlowTileSize * DmtxFlowTileSize * sizeof(unsigned short));
+   if(tile == NULL)
+      return NULL;
+
+   img = DecodeScanImage(dec);
+   scale = dec->scale;
+   step = scale * img->bytesPerPixel;
+   x0 = tileCol << DmtxFlowTileShift;
+   y0 = tileRow << DmtxFlowTileShift;
+
+   /* Gather the tile plus a one pixel border, sampled at the decode scale */
+   for(row = 0; row < DmtxFlowTileSize + 2; row++) {
+      blockRow = block + row * (DmtxFlowTileSize + 2);
+      y = y0 + row - 1;
+      if(y < 0 || y * scale >= img->height) {
+         memset(blockRow, 0, DmtxFlowTileSize + 2);
+         continue;
+      }
+
+      src = img->pxl + img->originOffset + y * scale * img->rowStride + plane;
+      for(col = 0; col < DmtxFlowTileSize + 2; col++) {
+         x = x0 + col - 1;
+         blockRow[col] = (x < 0 || x * scale >= img->width) ? 0 : src[x * step];
+      }
+   }
+
+   dec->flowCache->compassKernel(block + DmtxFlowTileSize + 3, DmtxFlowTileSize + 2,
+         DmtxFlowTileSize, DmtxFlowTileSize, tile, DmtxFlowTileSize);
+
+   /* Pixels with a neighbor outside the image are blank edges, as in ComputePointFlow() */
+   if(x0 < 1 || (x0 + DmtxFlowTileSize) * scale >= img->width ||
+         y0 < 1 || (y0 + DmtxFlowTileSize) * scale >= img->height) {
+      for(row = 0; row < DmtxFlowTileSize; row++) {
+         y = y0 + row;
+         for(col = 0; col < DmtxFlowTileSize; col++) {
+            x = x0 + col;
+            if(x < 1 || (x + 1) * scale >= img->width || y < 1 || (y + 1) * scale >= img->height)
+               tile[(row << DmtxFlowTileShift) + col] = DmtxFlowValid | DmtxFlowBlank;
+         }
+      }
+   }
+
+   return tile;
+}
+
+/**
+ * \brief  Return GetPointFlow() result from the cache, computing it on a miss
+ * \param  dec
+ * \param  colorPlane
+ * \param  loc
+ * \param  arrive
+ * \return Point flow identical to ComputePointFlow()
+ *
+ * Only the thread running dec may call this, since a missing tile is
+ * allocated in place.
+ */
+static DmtxPointFlow
+FlowCacheGetPointFlow(DmtxDecode *dec, int colorPlane, DmtxPixelLoc loc, int arrive)
+{
+   int tileCol, tileRow, tileIdx;
+   DmtxBoolean tileCreated;
+   DmtxFlowCache *cache;
+   unsigned short *entry;
+   DmtxPointFlow flow;
+
+   cache = dec->flowCache;
+
+   if(loc.X < 0 || loc.X >= cache->width || loc.Y < 0 || loc.Y >= cache->height ||
+         colorPlane < 0 || colorPlane >= cache->planeCount)
+      return ComputePointFlow(dec, colorPlane, loc, arrive);
+
+   tileCol = loc.X >> DmtxFlowTileShift;
+   tileRow = loc.Y >> DmtxFlowTileShift;
+   tileIdx = (tileRow * cache->tileCols + tileCol) * cache->planeCount + colorPlane;
+
+   tileCreated = DmtxFalse;
+   if(cache->tile[tileIdx] == NULL) {
+      cache->tile[tileIdx] = FlowCacheCreateTile(dec, colorPlane, tileCol, tileRow);
+      if(cache->tile[tileIdx] == NULL)
+         return ComputePointFlow(dec, colorPlane, loc, arrive);
+      tileCreated = DmtxTrue;
+   }
+
+   entry = cache->tile[tileIdx] + ((loc.Y & DmtxFlowTileMask) << DmtxFlowTileShift) +
+         (loc.X & DmtxFlowTileMask);
+
+   if(!(*entry & DmtxFlowValid)) {
+      cache->misses++;
+      flow = ComputePointFlow(dec, colorPlane, loc, arrive);
+
+      if(flow.mag == DmtxUndefined)
+         *entry = DmtxFlowValid | DmtxFlowBlank;
+      else
+         *entry = (unsigned short)(DmtxFlowValid | (flow.depart << 12) | flow.mag);
+
+      return flow;
+   }
+
+   if(tileCreated == DmtxTrue)
+      cache->misses++;
+   else
+      cache->hits++;
+
+   if((*entry & DmtxFlowBlank) == DmtxFlowBlank)
+      return dmtxBlankEdge;
+
+   flow.plane = colorPlane;
+   flow.arrive = arrive;
+   flow.depart = (*entry >> 12) & 0x07;
+   flow.mag = *entry & DmtxFlowBlank;
+   flow.loc = loc;
+
+   return flow;
+}
@@ -68,7 +68,7 @@ dmtxImageCreate(unsigned char *pxl, int width, int height, int pack)
    if(pxl == NULL || width < 1 || height < 1)
       return NULL;
 
-   img = (DmtxImage *)calloc(1, sizeof(DmtxImage));
+   img = (DmtxImage *)MemCalloc(1, sizeof(DmtxImage));
    if(img == NULL)
       return NULL;
 
@@ -139,6 +139,8 @@ dmtxImageCreate(unsigned char *pxl, int width, int height, int pack)
          return NULL;
    }
 
+   ImageBindAccessors(img);
+
    return img;
 }
 
@@ -153,7 +155,7 @@ dmtxImageDestroy(DmtxImage **img)
    if(img == NULL || *img == NULL)
       return DmtxFail;
 
-   free(*img);
+   MemFree(*img);
 
    *img = NULL;
 
@@ -178,6 +180,8 @@ dmtxImageSetChannel(DmtxImage *img, int channelStart, int bitsPerChannel)
    img->channelStart[img->channelCount] = channelStart;
    (img->channelCount)++;
 
+   ImageBindAccessors(img);
+
    return DmtxPass;
 }
 
@@ -204,6 +208,8 @@ dmtxImageSetProp(DmtxImage *img, int prop, int value)
          break;
    }
 
+   ImageBindAccessors(img);
+
    return DmtxPass;
 }
 
@@ -430,3 +436,536 @@ GetBitsPerPixel(int pack)
 
    return DmtxUndefined;
 }
+
+/**
+ * \brief  Bind pixel readers specialized for the image's packing and layout
+ * \param  img
+ * \return void
+ *
+ * Row order is folded into originOffset and a signed rowStride so the same
+ * readers serve DmtxFlipNone and DmtxFlipY images. Packings that are not
+ * byte-aligned fall back to dmtxImageGetPixelValue().
+ */
+static void
+ImageBindAccessors(DmtxImage *img)
+{
+   int i;
+   DmtxBoolean byteAligned;
+
+   if(img->imageFlip & DmtxFlipY) {
+      img->originOffset = 0;
+      img->rowStride = img->rowSizeBytes;
+   }
+   else {
+      img->originOffset = (img->height - 1) * img->rowSizeBytes;
+      img->rowStride = -img->rowSizeBytes;
+   }
+
+   byteAligned = (img->channelCount > 0 && img->bitsPerPixel % 8 == 0) ? DmtxTrue : DmtxFalse;
+   for(i = 0; i < img->channelCount; i++) {
+      if(img->bitsPerChannel[i] != 8 || img->channelStart[i] % 8 != 0)
+         byteAligned = DmtxFalse;
+   }
+
+   if(byteAligned == DmtxFalse || (img->imageFlip & DmtxFlipX)) {
+      img->fetchPixel = FetchPixelGeneric;
+      img->fetchCompass = FetchCompassGeneric;
+      return;
+   }
+
+   switch(img->bytesPerPixel) {
+      case 1:
+         img->fetchPixel = FetchPixel8bpp;
+         img->fetchCompass = FetchCompass8bpp;
+         break;
+      case 3:
+         img->fetchPixel = FetchPixel24bpp;
+         img->fetchCompass = FetchCompass24bpp;
+         break;
+      case 4:
+         img->fetchPixel = FetchPixel32bpp;
+         img->fetchCompass = FetchCompass32bpp;
+         break;
+      default:
+         img->fetchPixel = FetchPixelGeneric;
+         img->fetchCompass = FetchCompassGeneric;
+         break;
+   }
+}
+
+/**
+ * \brief  Read one channel of an 8bpp pixel known to lie inside the image
+ */
+static int
+FetchPixel8bpp(const DmtxImage *img, int x, int y, int channel)
+{
+   return img->pxl[img->originOffset + y * img->rowStride + x + channel];
+}
+
+/**
+ * \brief  Read one channel of a 24bpp pixel known to lie inside the image
+ */
+static int
+FetchPixel24bpp(const DmtxImage *img, int x, int y, int channel)
+{
+   return img->pxl[img->originOffset + y * img->rowStride + x * 3 + channel];
+}
+
+/**
+ * \brief  Read one channel of a 32bpp pixel known to lie inside the image
+ */
+static int
+FetchPixel32bpp(const DmtxImage *img, int x, int y, int channel)
+{
+   return img->pxl[img->originOffset + y * img->rowStride + x * 4 + channel];
+}
+
+/**
+ * \brief  Read one channel of a pixel through the generic path
+ */
+static int
+FetchPixelGeneric(const DmtxImage *img, int x, int y, int channel)
+{
+   int value = 0;
+
+   dmtxImageGetPixelValue((DmtxImage *)img, x, y, channel, &value);
+
+   return value;
+}
+
+/**
+ * \brief  Read the 8 neighbors at distance step around (x,y) of an 8bpp image
+ * \param  color Output in dmtxPatternX/dmtxPatternY order
+ */
+static void
+FetchCompass8bpp(const DmtxImage *img, int x, int y, int step, int channel, int *color)
+{
+   const unsigned char *p;
+   int dx, dy;
+
+   p = img->pxl + img->originOffset + y * img->rowStride + x + channel;
+   dx = step;
+   dy = step * img->rowStride;
+
+   color[0] = p[-dx - dy];
+   color[1] = p[-dy];
+   color[2] = p[dx - dy];
+   color[3] = p[dx];
+   color[4] = p[dx + dy];
+   color[5] = p[dy];
+   color[6] = p[dy - dx];
+   color[7] = p[-dx];
+}
+
+/**
+ * \brief  Read the 8 neighbors at distance step around (x,y) of a 24bpp image
+ * \param  color Output in dmtxPatternX/dmtxPatternY order
+ */
+static void
+FetchCompass24bpp(const DmtxImage *img, int x, int y, int step, int channel, int *color)
+{
+   const unsigned char *p;
+   int dx, dy;
+
+   p = img->pxl + img->originOffset + y * img->rowStride + x * 3 + channel;
+   dx = step * 3;
+   dy = step * img->rowStride;
+
+   color[0] = p[-dx - dy];
+   color[1] = p[-dy];
+   color[2] = p[dx - dy];
+   color[3] = p[dx];
+   color[4] = p[dx + dy];
+   color[5] = p[dy];
+   color[6] = p[dy - dx];
+   color[7] = p[-dx];
+}
+
+/**
+ * \brief  Read the 8 neighbors at distance step around (x,y) of a 32bpp image
+ * \param  color Output in dmtxPatternX/dmtxPatternY order
+ */
+static void
+FetchCompass32bpp(const DmtxImage *img, int x, int y, int step, int channel, int *color)
+{
+   const unsigned char *p;
+   int dx, dy;
+
+   p = img->pxl + img->originOffset + y * img->rowStride + x * 4 + channel;
+   dx = step * 4;
+   dy = step * img->rowStride;
+
+   color[0] = p[-dx - dy];
+   color[1] = p[-dy];
+   color[2] = p[dx - dy];
+   color[3] = p[dx];
+   color[4] = p[dx + dy];
+   color[5] = p[dy];
+   color[6] = p[dy - dx];
+   color[7] = p[-dx];
+}
+
+/**
+ * \brief  Read the 8 neighbors at distance step around (x,y) through the generic path
+ * \param  color Output in dmtxPatternX/dmtxPatternY order
+ */
+static void
+FetchCompassGeneric(const DmtxImage *img, int x, int y, int step, int channel, int *color)
+{
+   int patternIdx;
+
+   for(patternIdx = 0; patternIdx < 8; patternIdx++)
+      color[patternIdx] = FetchPixelGeneric(img, x + dmtxPatternX[patternIdx] * step,
+            y + dmtxPatternY[patternIdx] * step, channel);
+}
+
+/**
+ * \brief  Create a contiguous 8-bit copy of an image for scanning
+ * \param  img Source image with byte-aligned 8-bit channels
+ * \param  scanPlane DmtxScanPlaneLuma | DmtxScanPlaneBestChannel
+ * \return Newly allocated 8bppK image owning its pixel buffer, or NULL
+ */
+static DmtxImage *
+ImageCreateScanPlane(DmtxImage *img, int scanPlane)
+{
+   unsigned char *pxl;
+   DmtxImage *plane;
+
+   pxl = (unsigned char *)MemAlloc(img->width * img->height);
+   if(pxl == NULL)
+      return NULL;
+
+   plane = dmtxImageCreate(pxl, img->width, img->height, DmtxPack8bppK);
+   if(plane == NULL) {
+      MemFree(pxl);
+      return NULL;
+   }
+
+   if(ImageFillScanPlane(plane, img, scanPlane) == DmtxFail) {
+      MemFree(pxl);
+      dmtxImageDestroy(&plane);
+      return NULL;
+   }
+
+   return plane;
+}
+
+/**
+ * \brief  Refill an existing scan plane from an image of the same size
+ * \param  plane 8bppK image created by ImageCreateScanPlane()
+ * \param  img Source image with byte-aligned 8-bit channels
+ * \param  scanPlane DmtxScanPlaneLuma | DmtxScanPlaneBestChannel
+ * \return DmtxPass | DmtxFail
+ *
+ * Rows keep the memory order of the source image, and the plane inherits its
+ * flip setting so both share the same coordinate system. Luma uses the integer
+ * weights (77R + 150G + 29B)/256; packings without RGB channels fall back to
+ * their widest channel, except YCbCr whose first channel already is luma.
+ */
+static DmtxPassFail
+ImageFillScanPlane(DmtxImage *plane, DmtxImage *img, int scanPlane)
+{
+   int i, row;
+   int r, g, b, channel;
+   unsigned char *pxl;
+   const unsigned char *src;
+
+   if(plane->width != img->width || plane->height != img->height)
+      return DmtxFail;
+
+   if(img->bytesPerPixel < 1 || img->bitsPerPixel % 8 != 0)
+      return DmtxFail;
+
+   for(i = 0; i < img->channelCount; i++) {
+      if(img->bitsPerChannel[i] != 8 || img->channelStart[i] % 8 != 0)
+         return DmtxFail;
+   }
+
+   r = g = b = DmtxUndefined;
+   channel = DmtxUndefined;
+
+   if(scanPlane == DmtxScanPlaneLuma) {
+      switch(img->pixelPacking) {
+         case DmtxPack24bppRGB:
+         case DmtxPack32bppRGBX:
+         case DmtxPack32bppXRGB:
+            r = img->channelStart[0]/8;
+            g = img->channelStart[1]/8;
+            b = img->channelStart[2]/8;
+            break;
+         case DmtxPack24bppBGR:
+         case DmtxPack32bppBGRX:
+         case DmtxPack32bppXBGR:
+            b = img->channelStart[0]/8;
+            g = img->channelStart[1]/8;
+            r = img->channelStart[2]/8;
+            break;
+         case DmtxPack24bppYCbCr:
+            channel = 0;
+            break;
+         default:
+            break;
+      }
+   }
+
+   if(r == DmtxUndefined && channel == DmtxUndefined)
+      channel = ImageWidestChannel(img);
+
+   pxl = plane->pxl;
+
+   for(row = 0; row < img->height; row++) {
+      src = img->pxl + row * img->rowSizeBytes;
+      if(channel != DmtxUndefined)
+         ChannelRow(pxl + row * img->width, src + img->channelStart[channel]/8,
+               img->width, img->bytesPerPixel);
+      else if(img->bytesPerPixel == 3)
+         LumaRow24bpp(pxl + row * img->width, src, img->width, r, g, b);
+      else
+         LumaRow32bpp(pxl + row * img->width, src, img->width, r, g, b);
+   }
+
+   dmtxImageSetProp(plane, DmtxPropImageFlip, img->imageFlip);
+
+   return DmtxPass;
+}
+
+/**
+ * \brief  Find the channel whose values are most spread out
+ * \param  img
+ * \return Channel index
+ *
+ * Variance is estimated from a sparse sample of every 4th pixel on every 4th row.
+ */
+static int
+ImageWidestChannel(DmtxImage *img)
+{
+   int row, col, i, bestChannel;
+   int value;
+   double n, sum[4] = { 0.0 }, sumSq[4] = { 0.0 };
+   double variance, bestVariance;
+   const unsigned char *src;
+
+   n = 0.0;
+   for(row = 0; row < img->height; row += 4) {
+      src = img->pxl + row * img->rowSizeBytes;
+      for(col = 0; col < img->width; col += 4) {
+         for(i = 0; i < img->channelCount; i++) {
+            value = src[col * img->bytesPerPixel + img->channelStart[i]/8];
+            sum[i] += value;
+            sumSq[i] += value * value;
+         }
+         n += 1.0;
+      }
+   }
+
+   bestChannel = 0;
+   bestVariance = -1.0;
+   for(i = 0; i < img->channelCount; i++) {
+      variance = sumSq[i]/n - (sum[i]/n) * (sum[i]/n);
+      if(variance > bestVariance) {
+         bestVariance = variance;
+         bestChannel = i;
+      }
+   }
+
+   return bestChannel;
+}
+
+/**
+ * \brief  Convert one row of 24bpp pixels to luma
+ *
+ * Byte offsets are loop invariant so compilers can vectorize the loop.
+ */
+static void
+LumaRow24bpp(unsigned char *dst, const unsigned char *src, int width, int r, int g, int b)
+{
+   int col;
+
+   for(col = 0; col < width; col++)
+      dst[col] = (unsigned char)((77 * src[col*3 + r] + 150 * src[col*3 + g] +
+            29 * src[col*3 + b] + 128) >> 8);
+}
+
+/**
+ * \brief  Convert one row of 32bpp pixels to luma
+ *
+ * Byte offsets are loop invariant so compilers can vectorize the loop.
+ */
+static void
+LumaRow32bpp(unsigned char *dst, const unsigned char *src, int width, int r, int g, int b)
+{
+   int col;
+
+   for(col = 0; col < width; col++)
+      dst[col] = (unsigned char)((77 * src[col*4 + r] + 150 * src[col*4 + g] +
+            29 * src[col*4 + b] + 128) >> 8);
+}
+
+/**
+ * \brief  Copy one channel of a row of pixels
+ * \param  src Points at the channel's byte within the first pixel
+ */
+static void
+ChannelRow(unsigned char *dst, const unsigned char *src, int width, int bytesPerPixel)
+{
+   int col;
+
+   for(col = 0; col < width; col++)
+      dst[col] = src[col * bytesPerPixel];
+}
+
+/**
+ * \brief  Create a reduced copy of an image by repeated 2x2 box averaging
+ * \param  img
+ * \param  levels Number of halvings (1 or more)
+ * \return Image owning its pixel buffer, or NULL
+ *
+ * Every byte of a pixel is averaged independently, so the copy keeps the
+ * packing and channel layout of the source. Each level is rounded up, the
+ * odd trailing row or column averaging with itself, so coarse pixel (x, y)
+ * always covers full resolution pixels from (x << levels, y << levels). The
+ * copy is stored top-down (DmtxFlipY) in a buffer large enough for the
+ * first level, which ImageFillPyramidLevel() then halves in place.
+ */
+static DmtxImage *
+ImageCreatePyramidLevel(DmtxImage *img, int levels)
+{
+   int width, height;
+   unsigned char *pxl;
+   DmtxImage *coarse;
+
+   if(levels < 1 || ImagePyramidPackingOk(img) == DmtxFalse)
+      return NULL;
+
+   width = ImagePyramidSize(img->width, levels);
+   height = ImagePyramidSize(img->height, levels);
+
+   pxl = (unsigned char *)MemAlloc(ImagePyramidSize(img->width, 1) *
+         ImagePyramidSize(img->height, 1) * img->bytesPerPixel);
+   if(pxl == NULL)
+      return NULL;
+
+   coarse = dmtxImageCreate(pxl, width, height, img->pixelPacking);
+   if(coarse == NULL) {
+      MemFree(pxl);
+      return NULL;
+   }
+   dmtxImageSetProp(coarse, DmtxPropImageFlip, DmtxFlipY);
+
+   ImageFillPyramidLevel(coarse, img, levels);
+
+   return coarse;
+}
+
+/**
+ * \brief  Refill a level made by ImageCreatePyramidLevel() from a new image
+ * \param  coarse
+ * \param  img
+ * \param  levels Number of halvings (1 or more)
+ * \return DmtxPass | DmtxFail if img does not reduce to the size and packing
+ *         of coarse
+ */
+static DmtxPassFail
+ImageFillPyramidLevel(DmtxImage *coarse, DmtxImage *img, int levels)
+{
+   int level, row, width, height, srcStride, bytesPerPixel;
+   unsigned char *pxl;
+   const unsigned char *src, *first;
+
+   if(levels < 1 || ImagePyramidPackingOk(img) == DmtxFalse ||
+         coarse->pixelPacking != img->pixelPacking ||
+         coarse->width != ImagePyramidSize(img->width, levels) ||
+         coarse->height != ImagePyramidSize(img->height, levels))
+      return DmtxFail;
+
+   bytesPerPixel = img->bytesPerPixel;
+   pxl = coarse->pxl;
+
+   /* Rows are paired by y coordinate whatever the flip of the source */
+   src = img->pxl + img->originOffset;
+   srcStride = img->rowStride;
+   width = img->width;
+   height = img->height;
+
+   for(level = 0; level < levels; level++) {
+      for(row = 0; row < (height + 1) / 2; row++) {
+         first = src + 2 * row * srcStride;
+         HalveRow(pxl + row * ((width + 1) / 2) * bytesPerPixel, first,
+               (2 * row + 1 < height) ? first + srcStride : first, width, bytesPerPixel);
+      }
+
+      /* Later levels overwrite their source from the front, ahead of reads */
+      width = (width + 1) / 2;
+      height = (height + 1) / 2;
+      src = pxl;
+      srcStride = width * bytesPerPixel;
+   }
+
+   return DmtxPass;
+}
+
+/**
+ * \brief  Whether pyramid levels can be averaged from an image byte by byte
+ * \param  img
+ * \return DmtxTrue | DmtxFalse
+ */
+static DmtxBoolean
+ImagePyramidPackingOk(DmtxImage *img)
+{
+   int i;
+
+   if(img->pixelPacking == DmtxPackCustom || img->bytesPerPixel < 1 ||
+         img->bitsPerPixel % 8 != 0 || (img->imageFlip & DmtxFlipX))
+      return DmtxFalse;
+
+   for(i = 0; i < img->channelCount; i++) {
+      if(img->bitsPerChannel[i] != 8 || img->channelStart[i] % 8 != 0)
+         return DmtxFalse;
+   }
+
+   return DmtxTrue;
+}
+
+/**
+ * \brief  Length of one side of an image after rounded-up halvings
+ * \param  length
+ * \param  levels
+ * \return Reduced length
+ */
+static int
+ImagePyramidSize(int length, int levels)
+{
+   return (length + (1 << levels) - 1) >> levels;
+}
+
+/**
+ * \brief  Average each 2x2 block of two source rows into one destination row
+ * \param  dst
+ * \param  first Source row at the lower y coordinate
+ * \param  second Source row above it, or first again for an odd final row
+ * \param  srcWidth Source width in pixels, where an odd final column is
+ *         averaged with itself
+ * \param  bytesPerPixel
+ * \return void
+ */
+static void
+HalveRow(unsigned char *dst, const unsigned char *first, const unsigned char *second,
+      int srcWidth, int bytesPerPixel)
+{
+   int i, j;
+
+   for(i = 0; i < srcWidth / 2; i++) {
+      for(j = 0; j < bytesPerPixel; j++)
+         dst[j] = (unsigned char)((first[j] + first[j + bytesPerPixel] +
+               second[j] + second[j + bytesPerPixel] + 2) >> 2);
+
+      dst += bytesPerPixel;
+      first += 2 * bytesPerPixel;
+      second += 2 * bytesPerPixel;
+   }
+
+   if(srcWidth & 1) {
+      for(j = 0; j < bytesPerPixel; j++)
+         dst[j] = (unsigned char)((first[j] + second[j] + 1) >> 1);
+   }
+}
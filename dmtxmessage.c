@@ -23,53 +23,136 @@
 extern DmtxMessage *
 dmtxMessageCreate(int sizeIdx, int symbolFormat)
 {
-   DmtxMessage *message;
-   int mappingRows, mappingCols;
-
-   assert(symbolFormat == DmtxFormatMatrix || symbolFormat == DmtxFormatMosaic);
+   return MessageCreate(NULL, sizeIdx, symbolFormat);
+}
 
-   mappingRows = dmtxGetSymbolAttribute(DmtxSymAttribMappingMatrixRows, sizeIdx);
-   mappingCols = dmtxGetSymbolAttribute(DmtxSymAttribMappingMatrixCols, sizeIdx);
+/**
+ * \brief  Allocate memory for message from an arena
+ * \param  arena Arena, or NULL to allocate through the hooks
+ * \param  sizeIdx
+ * \param  symbolFormat DmtxFormatMatrix | DmtxFormatMosaic
+ * \return Address of allocated memory
+ */
+static DmtxMessage *
+MessageCreate(DmtxArena *arena, int sizeIdx, int symbolFormat)
+{
+   DmtxMessage *message;
 
-   message = (DmtxMessage *)calloc(1, sizeof(DmtxMessage));
+   message = (DmtxMessage *)ArenaCalloc(arena, 1, sizeof(DmtxMessage));
    if(message == NULL)
       return NULL;
 
-   message->arraySize = sizeof(unsigned char) * mappingRows * mappingCols;
-
-   message->array = (unsigned char *)calloc(1, message->arraySize);
-   if(message->array == NULL) {
-      perror("Calloc failed");
+   if(MessageResize(arena, message, sizeIdx, symbolFormat) == DmtxFail) {
       dmtxMessageDestroy(&message);
       return NULL;
    }
 
-   message->codeSize = sizeof(unsigned char) *
+   return message;
+}
+
+/**
+ * \brief  Prepare an existing message to hold a symbol of a given size
+ * \param  msg Message from dmtxMessageCreate()
+ * \param  sizeIdx
+ * \param  symbolFormat DmtxFormatMatrix | DmtxFormatMosaic
+ * \return DmtxPass | DmtxFail
+ *
+ * Buffers are only reallocated when they are too small for sizeIdx, so a
+ * message can be reused for every symbol of a stream without allocating once
+ * it has seen the largest size. On failure the message keeps its old buffers.
+ */
+extern DmtxPassFail
+dmtxMessageResize(DmtxMessage *msg, int sizeIdx, int symbolFormat)
+{
+   if(msg == NULL)
+      return DmtxFail;
+
+   return MessageResize(NULL, msg, sizeIdx, symbolFormat);
+}
+
+/**
+ * \brief  Size message buffers for a symbol, growing them from an arena
+ * \param  arena Arena, or NULL to allocate through the hooks
+ * \param  msg
+ * \param  sizeIdx
+ * \param  symbolFormat DmtxFormatMatrix | DmtxFormatMosaic
+ * \return DmtxPass | DmtxFail
+ */
+static DmtxPassFail
+MessageResize(DmtxArena *arena, DmtxMessage *msg, int sizeIdx, int symbolFormat)
+{
+   int mappingRows, mappingCols;
+   size_t arraySize, codeSize, outputSize;
+
+   assert(symbolFormat == DmtxFormatMatrix || symbolFormat == DmtxFormatMosaic);
+
+   if(sizeIdx < 0 || sizeIdx >= DmtxSymbolSquareCount + DmtxSymbolRectCount)
+      return DmtxFail;
+
+   mappingRows = dmtxGetSymbolAttribute(DmtxSymAttribMappingMatrixRows, sizeIdx);
+   mappingCols = dmtxGetSymbolAttribute(DmtxSymAttribMappingMatrixCols, sizeIdx);
+
+   arraySize = sizeof(unsigned char) * mappingRows * mappingCols;
+
+   codeSize = sizeof(unsigned char) *
          dmtxGetSymbolAttribute(DmtxSymAttribSymbolDataWords, sizeIdx) +
          dmtxGetSymbolAttribute(DmtxSymAttribSymbolErrorWords, sizeIdx);
 
-   if(symbolFormat == DmtxFormatMosaic)
-      message->codeSize *= 3;
+   outputSize = sizeof(unsigned char) * DecodeOutputBound(sizeIdx);
 
-   message->code = (unsigned char *)calloc(message->codeSize, sizeof(unsigned char));
-   if(message->code == NULL) {
-      perror("Calloc failed");
-      dmtxMessageDestroy(&message);
-      return NULL;
+   /* Mosaic code and output are the concatenation of three layers */
+   if(symbolFormat == DmtxFormatMosaic) {
+      codeSize *= 3;
+      outputSize *= 3;
    }
 
-   /* XXX not sure if this is the right place or even the right approach.
-      Trying to allocate memory for the decoded data stream and will
-      initially assume that decoded data will not be larger than 2x encoded data */
-   message->outputSize = sizeof(unsigned char) * message->codeSize * 10;
-   message->output = (unsigned char *)calloc(message->outputSize, sizeof(unsigned char));
-   if(message->output == NULL) {
+   /* Room for a terminating zero, as output is commonly read as a string */
+   outputSize++;
+
+   if(MessageGrowBuffer(arena, &(msg->array), &(msg->arrayCapacity), arraySize) == DmtxFail ||
+         MessageGrowBuffer(arena, &(msg->code), &(msg->codeCapacity), codeSize) == DmtxFail ||
+         MessageGrowBuffer(arena, &(msg->output), &(msg->outputCapacity), outputSize) == DmtxFail) {
       perror("Calloc failed");
-      dmtxMessageDestroy(&message);
-      return NULL;
+      return DmtxFail;
    }
 
-   return message;
+   msg->arraySize = arraySize;
+   msg->codeSize = codeSize;
+   msg->outputSize = outputSize;
+   msg->outputIdx = 0;
+   msg->padCount = 0;
+
+   /* Reused buffers must look freshly allocated to the decoders */
+   memset(msg->output, 0x00, outputSize);
+
+   return DmtxPass;
+}
+
+/**
+ * \brief  Replace a message buffer with a larger zeroed one if needed
+ * \param  arena Arena, or NULL to allocate through the hooks
+ * \param  buf Address of buffer pointer
+ * \param  capacity Address of buffer capacity
+ * \param  size Required size
+ * \return DmtxPass | DmtxFail
+ */
+static DmtxPassFail
+MessageGrowBuffer(DmtxArena *arena, unsigned char **buf, size_t *capacity, size_t size)
+{
+   unsigned char *grown;
+
+   if(*buf != NULL && *capacity >= size)
+      return DmtxPass;
+
+   grown = (unsigned char *)ArenaCalloc(arena, max(size, 1), sizeof(unsigned char));
+   if(grown == NULL)
+      return DmtxFail;
+
+   MemFree(*buf);
+   *buf = grown;
+   *capacity = max(size, 1);
+
+   return DmtxPass;
 }
 
 /**
@@ -84,15 +167,15 @@ dmtxMessageDestroy(DmtxMessage **msg)
       return DmtxFail;
 
    if((*msg)->array != NULL)
-      free((*msg)->array);
+      MemFree((*msg)->array);
 
    if((*msg)->code != NULL)
-      free((*msg)->code);
+      MemFree((*msg)->code);
 
    if((*msg)->output != NULL)
-      free((*msg)->output);
+      MemFree((*msg)->output);
 
-   free(*msg);
+   MemFree(*msg);
 
    *msg = NULL;
 
@@ -29,11 +29,13 @@ dmtxSymbolModuleStatus(DmtxMessage *message, int sizeIdx, int symbolRow, int sym
    int mappingRow, mappingCol;
    int dataRegionRows, dataRegionCols;
    int symbolRows, mappingCols;
+   const DmtxSymbolDescriptor *symbol;
 
-   dataRegionRows = dmtxGetSymbolAttribute(DmtxSymAttribDataRegionRows, sizeIdx);
-   dataRegionCols = dmtxGetSymbolAttribute(DmtxSymAttribDataRegionCols, sizeIdx);
-   symbolRows = dmtxGetSymbolAttribute(DmtxSymAttribSymbolRows, sizeIdx);
-   mappingCols = dmtxGetSymbolAttribute(DmtxSymAttribMappingMatrixCols, sizeIdx);
+   symbol = dmtxGetSymbolDescriptor(sizeIdx);
+   dataRegionRows = symbol->dataRegionRows;
+   dataRegionCols = symbol->dataRegionCols;
+   symbolRows = symbol->symbolRows;
+   mappingCols = symbol->mappingCols;
 
    symbolRowReverse = symbolRows - symbolRow - 1;
    mappingRow = symbolRowReverse - 1 - 2 * (symbolRowReverse / (dataRegionRows+2));
@@ -56,6 +58,14 @@ dmtxSymbolModuleStatus(DmtxMessage *message, int sizeIdx, int symbolRow, int sym
    return (message->array[mappingRow * mappingCols + mappingCol] | DmtxModuleData);
 }
 
+#ifdef HAVE_PTHREAD
+static pthread_once_t placementMapOnce = PTHREAD_ONCE_INIT;
+#else
+static DmtxBoolean placementMapReady = DmtxFalse;
+#endif
+static DmtxPlacementMap placementMap[DmtxSymbolSquareCount + DmtxSymbolRectCount];
+static unsigned short placementMapModules[DmtxPlacementMapSize];
+
 /**
  * \brief  Logical relationship between bit and module locations
  * \param  modules
@@ -63,17 +73,120 @@ dmtxSymbolModuleStatus(DmtxMessage *message, int sizeIdx, int symbolRow, int sym
  * \param  sizeIdx
  * \param  moduleOnColor
  * \return Number of codewords read
+ *
+ * Modules already marked DmtxModuleAssigned are gathered into their codeword
+ * bits, and the others receive them, using the placement map of sizeIdx.
  */
 static int
 ModulePlacementEcc200(unsigned char *modules, unsigned char *codewords, int sizeIdx, int moduleOnColor)
 {
-   int row, col, chr;
+   int chr, i, mask;
+   unsigned char value, *module;
+   const unsigned short *bitModule;
+   const DmtxPlacementMap *map;
+
+   assert(moduleOnColor & (DmtxModuleOnRed | DmtxModuleOnGreen | DmtxModuleOnBlue | DmtxModuleUnsure));
+
+   map = PlacementMapGet(sizeIdx);
+   bitModule = map->module;
+
+   for(chr = 0; chr < map->codewords; chr++) {
+      value = codewords[chr];
+
+      for(mask = 0x80; mask != 0x00; mask >>= 1) {
+         module = &(modules[*(bitModule++)]);
+
+         /* If module has already been assigned then we are decoding the pattern into codewords */
+         if((*module & DmtxModuleAssigned) != 0) {
+            if((*module & moduleOnColor) != 0)
+               value |= mask;
+            else
+               value &= (0xff ^ mask);
+         }
+         /* Otherwise we are encoding the codewords into a pattern */
+         else {
+            if((value & mask) != 0x00)
+               *module |= moduleOnColor;
+
+            *module |= DmtxModuleAssigned;
+         }
+
+         *module |= DmtxModuleVisited;
+      }
+
+      codewords[chr] = value;
+   }
+
+   /* Fixed pattern of an untouched lower righthand corner */
+   for(i = 0; i < map->fixedCount; i++)
+      modules[map->fixed[i]] |= moduleOnColor;
+
+   return map->codewords;
+}
+
+/**
+ * \brief  Fetch the placement map of a symbol size
+ * \param  sizeIdx
+ * \return Placement map shared by all encoders and decoders
+ *
+ * Maps of every size are built together on first use, through pthread_once
+ * with HAVE_PTHREAD and a static flag otherwise, and never change afterward.
+ */
+static const DmtxPlacementMap *
+PlacementMapGet(int sizeIdx)
+{
+#ifdef HAVE_PTHREAD
+   pthread_once(&placementMapOnce, PlacementMapBuildAll);
+#else
+   if(placementMapReady == DmtxFalse) {
+      PlacementMapBuildAll();
+      placementMapReady = DmtxTrue;
+   }
+#endif
+
+   return &(placementMap[sizeIdx]);
+}
+
+/**
+ * \brief  Build the placement maps of all symbol sizes
+ * \return void
+ */
+static void
+PlacementMapBuildAll(void)
+{
+   int sizeIdx;
+
+   for(sizeIdx = 0; sizeIdx < DmtxSymbolSquareCount + DmtxSymbolRectCount; sizeIdx++)
+      PlacementMapBuild(&(placementMap[sizeIdx]), sizeIdx);
+}
+
+/**
+ * \brief  Walk the ECC200 placement pattern once to record the module of each bit
+ * \param  map
+ * \param  sizeIdx
+ * \return void
+ */
+static void
+PlacementMapBuild(DmtxPlacementMap *map, int sizeIdx)
+{
+   int i, row, col, chr;
    int mappingRows, mappingCols;
+   unsigned short *module;
+   unsigned char placed[DmtxModuleLineMax * DmtxModuleLineMax];
+   const DmtxSymbolDescriptor *symbol;
+
+   /* Maps of all sizes are packed in sizeIdx order */
+   for(module = placementMapModules, i = 0; i < sizeIdx; i++) {
+      symbol = dmtxGetSymbolDescriptor(i);
+      module += 8 * (symbol->symbolDataWords + symbol->symbolErrorWords);
+   }
 
-   assert(moduleOnColor & (DmtxModuleOnRed | DmtxModuleOnGreen | DmtxModuleOnBlue));
+   symbol = dmtxGetSymbolDescriptor(sizeIdx);
+   mappingRows = symbol->mappingRows;
+   mappingCols = symbol->mappingCols;
 
-   mappingRows = dmtxGetSymbolAttribute(DmtxSymAttribMappingMatrixRows, sizeIdx);
-   mappingCols = dmtxGetSymbolAttribute(DmtxSymAttribMappingMatrixCols, sizeIdx);
+   assert(mappingRows * mappingCols <= DmtxModuleLineMax * DmtxModuleLineMax);
+   memset(placed, 0x00, mappingRows * mappingCols);
 
    /* Start in the nominal location for the 8th bit of the first character */
    chr = 0;
@@ -83,19 +196,19 @@ ModulePlacementEcc200(unsigned char *modules, unsigned char *codewords, int size
    do {
       /* Repeatedly first check for one of the special corner cases */
       if((row == mappingRows) && (col == 0))
-         PatternShapeSpecial1(modules, mappingRows, mappingCols, &(codewords[chr++]), moduleOnColor);
+         PatternShapeSpecial1(module, placed, mappingRows, mappingCols, chr++);
       else if((row == mappingRows-2) && (col == 0) && (mappingCols%4 != 0))
-         PatternShapeSpecial2(modules, mappingRows, mappingCols, &(codewords[chr++]), moduleOnColor);
+         PatternShapeSpecial2(module, placed, mappingRows, mappingCols, chr++);
       else if((row == mappingRows-2) && (col == 0) && (mappingCols%8 == 4))
-         PatternShapeSpecial3(modules, mappingRows, mappingCols, &(codewords[chr++]), moduleOnColor);
+         PatternShapeSpecial3(module, placed, mappingRows, mappingCols, chr++);
       else if((row == mappingRows+4) && (col == 2) && (mappingCols%8 == 0))
-         PatternShapeSpecial4(modules, mappingRows, mappingCols, &(codewords[chr++]), moduleOnColor);
+         PatternShapeSpecial4(module, placed, mappingRows, mappingCols, chr++);
 
       /* Sweep upward diagonally, inserting successive characters */
       do {
          if((row < mappingRows) && (col >= 0) &&
-               !(modules[row*mappingCols+col] & DmtxModuleVisited))
-            PatternShapeStandard(modules, mappingRows, mappingCols, row, col, &(codewords[chr++]), moduleOnColor);
+               !placed[row*mappingCols+col])
+            PatternShapeStandard(module, placed, mappingRows, mappingCols, row, col, chr++);
          row -= 2;
          col += 2;
       } while ((row >= 0) && (col < mappingCols));
@@ -105,8 +218,8 @@ ModulePlacementEcc200(unsigned char *modules, unsigned char *codewords, int size
       /* Sweep downward diagonally, inserting successive characters */
       do {
          if((row >= 0) && (col < mappingCols) &&
-               !(modules[row*mappingCols+col] & DmtxModuleVisited))
-            PatternShapeStandard(modules, mappingRows, mappingCols, row, col, &(codewords[chr++]), moduleOnColor);
+               !placed[row*mappingCols+col])
+            PatternShapeStandard(module, placed, mappingRows, mappingCols, row, col, chr++);
          row += 2;
          col -= 2;
       } while ((row < mappingRows) && (col >= 0));
@@ -116,144 +229,149 @@ ModulePlacementEcc200(unsigned char *modules, unsigned char *codewords, int size
    } while ((row < mappingRows) || (col < mappingCols));
 
    /* If lower righthand corner is untouched then fill in the fixed pattern */
-   if(!(modules[mappingRows * mappingCols - 1] &
-         DmtxModuleVisited)) {
+   map->fixedCount = 0;
+   if(!placed[mappingRows * mappingCols - 1]) {
+      map->fixed[map->fixedCount++] = mappingRows * mappingCols - 1;
+      map->fixed[map->fixedCount++] = (mappingRows * mappingCols) - mappingCols - 2;
+   }
 
-      modules[mappingRows * mappingCols - 1] |= moduleOnColor;
-      modules[(mappingRows * mappingCols) - mappingCols - 2] |= moduleOnColor;
-   } /* XXX should this fixed pattern also be used in reading somehow? */
+   assert(module + 8 * chr <= placementMapModules + DmtxPlacementMapSize);
 
-   /* XXX compare that chr == region->dataSize here */
-   return chr; /* XXX number of codewords read off */
+   map->codewords = chr;
+   map->module = module;
 }
 
 /**
  * \brief  XXX
- * \param  modules
+ * \param  module
+ * \param  placed
  * \param  mappingRows
  * \param  mappingCols
  * \param  row
  * \param  col
- * \param  codeword
- * \param  moduleOnColor
+ * \param  chr
  * \return void
  */
 static void
-PatternShapeStandard(unsigned char *modules, int mappingRows, int mappingCols, int row, int col, unsigned char *codeword, int moduleOnColor)
+PatternShapeStandard(unsigned short *module, unsigned char *placed, int mappingRows, int mappingCols,
+      int row, int col, int chr)
 {
-   PlaceModule(modules, mappingRows, mappingCols, row-2, col-2, codeword, DmtxMaskBit1, moduleOnColor);
-   PlaceModule(modules, mappingRows, mappingCols, row-2, col-1, codeword, DmtxMaskBit2, moduleOnColor);
-   PlaceModule(modules, mappingRows, mappingCols, row-1, col-2, codeword, DmtxMaskBit3, moduleOnColor);
-   PlaceModule(modules, mappingRows, mappingCols, row-1, col-1, codeword, DmtxMaskBit4, moduleOnColor);
-   PlaceModule(modules, mappingRows, mappingCols, row-1, col,   codeword, DmtxMaskBit5, moduleOnColor);
-   PlaceModule(modules, mappingRows, mappingCols, row,   col-2, codeword, DmtxMaskBit6, moduleOnColor);
-   PlaceModule(modules, mappingRows, mappingCols, row,   col-1, codeword, DmtxMaskBit7, moduleOnColor);
-   PlaceModule(modules, mappingRows, mappingCols, row,   col,   codeword, DmtxMaskBit8, moduleOnColor);
+   PlaceModule(module, placed, mappingRows, mappingCols, row-2, col-2, chr, DmtxMaskBit1);
+   PlaceModule(module, placed, mappingRows, mappingCols, row-2, col-1, chr, DmtxMaskBit2);
+   PlaceModule(module, placed, mappingRows, mappingCols, row-1, col-2, chr, DmtxMaskBit3);
+   PlaceModule(module, placed, mappingRows, mappingCols, row-1, col-1, chr, DmtxMaskBit4);
+   PlaceModule(module, placed, mappingRows, mappingCols, row-1, col,   chr, DmtxMaskBit5);
+   PlaceModule(module, placed, mappingRows, mappingCols, row,   col-2, chr, DmtxMaskBit6);
+   PlaceModule(module, placed, mappingRows, mappingCols, row,   col-1, chr, DmtxMaskBit7);
+   PlaceModule(module, placed, mappingRows, mappingCols, row,   col,   chr, DmtxMaskBit8);
 }
 
 /**
  * \brief  XXX
- * \param  modules
+ * \param  module
+ * \param  placed
  * \param  mappingRows
  * \param  mappingCols
- * \param  codeword
- * \param  moduleOnColor
+ * \param  chr
  * \return void
  */
 static void
-PatternShapeSpecial1(unsigned char *modules, int mappingRows, int mappingCols, unsigned char *codeword, int moduleOnColor)
+PatternShapeSpecial1(unsigned short *module, unsigned char *placed, int mappingRows, int mappingCols, int chr)
 {
-   PlaceModule(modules, mappingRows, mappingCols, mappingRows-1, 0, codeword, DmtxMaskBit1, moduleOnColor);
-   PlaceModule(modules, mappingRows, mappingCols, mappingRows-1, 1, codeword, DmtxMaskBit2, moduleOnColor);
-   PlaceModule(modules, mappingRows, mappingCols, mappingRows-1, 2, codeword, DmtxMaskBit3, moduleOnColor);
-   PlaceModule(modules, mappingRows, mappingCols, 0, mappingCols-2, codeword, DmtxMaskBit4, moduleOnColor);
-   PlaceModule(modules, mappingRows, mappingCols, 0, mappingCols-1, codeword, DmtxMaskBit5, moduleOnColor);
-   PlaceModule(modules, mappingRows, mappingCols, 1, mappingCols-1, codeword, DmtxMaskBit6, moduleOnColor);
-   PlaceModule(modules, mappingRows, mappingCols, 2, mappingCols-1, codeword, DmtxMaskBit7, moduleOnColor);
-   PlaceModule(modules, mappingRows, mappingCols, 3, mappingCols-1, codeword, DmtxMaskBit8, moduleOnColor);
+   PlaceModule(module, placed, mappingRows, mappingCols, mappingRows-1, 0, chr, DmtxMaskBit1);
+   PlaceModule(module, placed, mappingRows, mappingCols, mappingRows-1, 1, chr, DmtxMaskBit2);
+   PlaceModule(module, placed, mappingRows, mappingCols, mappingRows-1, 2, chr, DmtxMaskBit3);
+   PlaceModule(module, placed, mappingRows, mappingCols, 0, mappingCols-2, chr, DmtxMaskBit4);
+   PlaceModule(module, placed, mappingRows, mappingCols, 0, mappingCols-1, chr, DmtxMaskBit5);
+   PlaceModule(module, placed, mappingRows, mappingCols, 1, mappingCols-1, chr, DmtxMaskBit6);
+   PlaceModule(module, placed, mappingRows, mappingCols, 2, mappingCols-1, chr, DmtxMaskBit7);
+   PlaceModule(module, placed, mappingRows, mappingCols, 3, mappingCols-1, chr, DmtxMaskBit8);
 }
 
 /**
  * \brief  XXX
- * \param  modules
+ * \param  module
+ * \param  placed
  * \param  mappingRows
  * \param  mappingCols
- * \param  codeword
- * \param  moduleOnColor
+ * \param  chr
  * \return void
  */
 static void
-PatternShapeSpecial2(unsigned char *modules, int mappingRows, int mappingCols, unsigned char *codeword, int moduleOnColor)
+PatternShapeSpecial2(unsigned short *module, unsigned char *placed, int mappingRows, int mappingCols, int chr)
 {
-   PlaceModule(modules, mappingRows, mappingCols, mappingRows-3, 0, codeword, DmtxMaskBit1, moduleOnColor);
-   PlaceModule(modules, mappingRows, mappingCols, mappingRows-2, 0, codeword, DmtxMaskBit2, moduleOnColor);
-   PlaceModule(modules, mappingRows, mappingCols, mappingRows-1, 0, codeword, DmtxMaskBit3, moduleOnColor);
-   PlaceModule(modules, mappingRows, mappingCols, 0, mappingCols-4, codeword, DmtxMaskBit4, moduleOnColor);
-   PlaceModule(modules, mappingRows, mappingCols, 0, mappingCols-3, codeword, DmtxMaskBit5, moduleOnColor);
-   PlaceModule(modules, mappingRows, mappingCols, 0, mappingCols-2, codeword, DmtxMaskBit6, moduleOnColor);
-   PlaceModule(modules, mappingRows, mappingCols, 0, mappingCols-1, codeword, DmtxMaskBit7, moduleOnColor);
-   PlaceModule(modules, mappingRows, mappingCols, 1, mappingCols-1, codeword, DmtxMaskBit8, moduleOnColor);
+   PlaceModule(module, placed, mappingRows, mappingCols, mappingRows-3, 0, chr, DmtxMaskBit1);
+   PlaceModule(module, placed, mappingRows, mappingCols, mappingRows-2, 0, chr, DmtxMaskBit2);
+   PlaceModule(module, placed, mappingRows, mappingCols, mappingRows-1, 0, chr, DmtxMaskBit3);
+   PlaceModule(module, placed, mappingRows, mappingCols, 0, mappingCols-4, chr, DmtxMaskBit4);
+   PlaceModule(module, placed, mappingRows, mappingCols, 0, mappingCols-3, chr, DmtxMaskBit5);
+   PlaceModule(module, placed, mappingRows, mappingCols, 0, mappingCols-2, chr, DmtxMaskBit6);
+   PlaceModule(module, placed, mappingRows, mappingCols, 0, mappingCols-1, chr, DmtxMaskBit7);
+   PlaceModule(module, placed, mappingRows, mappingCols, 1, mappingCols-1, chr, DmtxMaskBit8);
 }
 
 /**
  * \brief  XXX
- * \param  modules
+ * \param  module
+ * \param  placed
  * \param  mappingRows
  * \param  mappingCols
- * \param  codeword
- * \param  moduleOnColor
+ * \param  chr
  * \return void
  */
 static void
-PatternShapeSpecial3(unsigned char *modules, int mappingRows, int mappingCols, unsigned char *codeword, int moduleOnColor)
+PatternShapeSpecial3(unsigned short *module, unsigned char *placed, int mappingRows, int mappingCols, int chr)
 {
-   PlaceModule(modules, mappingRows, mappingCols, mappingRows-3, 0, codeword, DmtxMaskBit1, moduleOnColor);
-   PlaceModule(modules, mappingRows, mappingCols, mappingRows-2, 0, codeword, DmtxMaskBit2, moduleOnColor);
-   PlaceModule(modules, mappingRows, mappingCols, mappingRows-1, 0, codeword, DmtxMaskBit3, moduleOnColor);
-   PlaceModule(modules, mappingRows, mappingCols, 0, mappingCols-2, codeword, DmtxMaskBit4, moduleOnColor);
-   PlaceModule(modules, mappingRows, mappingCols, 0, mappingCols-1, codeword, DmtxMaskBit5, moduleOnColor);
-   PlaceModule(modules, mappingRows, mappingCols, 1, mappingCols-1, codeword, DmtxMaskBit6, moduleOnColor);
-   PlaceModule(modules, mappingRows, mappingCols, 2, mappingCols-1, codeword, DmtxMaskBit7, moduleOnColor);
-   PlaceModule(modules, mappingRows, mappingCols, 3, mappingCols-1, codeword, DmtxMaskBit8, moduleOnColor);
+   PlaceModule(module, placed, mappingRows, mappingCols, mappingRows-3, 0, chr, DmtxMaskBit1);
+   PlaceModule(module, placed, mappingRows, mappingCols, mappingRows-2, 0, chr, DmtxMaskBit2);
+   PlaceModule(module, placed, mappingRows, mappingCols, mappingRows-1, 0, chr, DmtxMaskBit3);
+   PlaceModule(module, placed, mappingRows, mappingCols, 0, mappingCols-2, chr, DmtxMaskBit4);
+   PlaceModule(module, placed, mappingRows, mappingCols, 0, mappingCols-1, chr, DmtxMaskBit5);
+   PlaceModule(module, placed, mappingRows, mappingCols, 1, mappingCols-1, chr, DmtxMaskBit6);
+   PlaceModule(module, placed, mappingRows, mappingCols, 2, mappingCols-1, chr, DmtxMaskBit7);
+   PlaceModule(module, placed, mappingRows, mappingCols, 3, mappingCols-1, chr, DmtxMaskBit8);
 }
 
 /**
  * \brief  XXX
- * \param  modules
+ * \param  module
+ * \param  placed
  * \param  mappingRows
  * \param  mappingCols
- * \param  codeword
- * \param  moduleOnColor
+ * \param  chr
  * \return void
  */
 static void
-PatternShapeSpecial4(unsigned char *modules, int mappingRows, int mappingCols, unsigned char *codeword, int moduleOnColor)
+PatternShapeSpecial4(unsigned short *module, unsigned char *placed, int mappingRows, int mappingCols, int chr)
 {
-   PlaceModule(modules, mappingRows, mappingCols, mappingRows-1, 0, codeword, DmtxMaskBit1, moduleOnColor);
-   PlaceModule(modules, mappingRows, mappingCols, mappingRows-1, mappingCols-1, codeword, DmtxMaskBit2, moduleOnColor);
-   PlaceModule(modules, mappingRows, mappingCols, 0, mappingCols-3, codeword, DmtxMaskBit3, moduleOnColor);
-   PlaceModule(modules, mappingRows, mappingCols, 0, mappingCols-2, codeword, DmtxMaskBit4, moduleOnColor);
-   PlaceModule(modules, mappingRows, mappingCols, 0, mappingCols-1, codeword, DmtxMaskBit5, moduleOnColor);
-   PlaceModule(modules, mappingRows, mappingCols, 1, mappingCols-3, codeword, DmtxMaskBit6, moduleOnColor);
-   PlaceModule(modules, mappingRows, mappingCols, 1, mappingCols-2, codeword, DmtxMaskBit7, moduleOnColor);
-   PlaceModule(modules, mappingRows, mappingCols, 1, mappingCols-1, codeword, DmtxMaskBit8, moduleOnColor);
+   PlaceModule(module, placed, mappingRows, mappingCols, mappingRows-1, 0, chr, DmtxMaskBit1);
+   PlaceModule(module, placed, mappingRows, mappingCols, mappingRows-1, mappingCols-1, chr, DmtxMaskBit2);
+   PlaceModule(module, placed, mappingRows, mappingCols, 0, mappingCols-3, chr, DmtxMaskBit3);
+   PlaceModule(module, placed, mappingRows, mappingCols, 0, mappingCols-2, chr, DmtxMaskBit4);
+   PlaceModule(module, placed, mappingRows, mappingCols, 0, mappingCols-1, chr, DmtxMaskBit5);
+   PlaceModule(module, placed, mappingRows, mappingCols, 1, mappingCols-3, chr, DmtxMaskBit6);
+   PlaceModule(module, placed, mappingRows, mappingCols, 1, mappingCols-2, chr, DmtxMaskBit7);
+   PlaceModule(module, placed, mappingRows, mappingCols, 1, mappingCols-1, chr, DmtxMaskBit8);
 }
 
 /**
- * \brief  XXX
- * \param  modules
+ * \brief  Record the module carrying one codeword bit
+ * \param  module
+ * \param  placed
  * \param  mappingRows
  * \param  mappingCols
  * \param  row
  * \param  col
- * \param  codeword
+ * \param  chr
  * \param  mask
- * \param  moduleOnColor
  * \return void
  */
 static void
-PlaceModule(unsigned char *modules, int mappingRows, int mappingCols, int row, int col, unsigned char *codeword, int mask, int moduleOnColor)
+PlaceModule(unsigned short *module, unsigned char *placed, int mappingRows, int mappingCols,
+      int row, int col, int chr, int mask)
 {
+   int shift, idx;
+
    if(row < 0) {
       row += mappingRows;
       col += 4 - ((mappingRows+4)%8);
@@ -263,20 +381,12 @@ PlaceModule(unsigned char *modules, int mappingRows, int mappingCols, int row, i
       row += 4 - ((mappingCols+4)%8);
    }
 
-   /* If module has already been assigned then we are decoding the pattern into codewords */
-   if((modules[row*mappingCols+col] & DmtxModuleAssigned) != 0) {
-      if((modules[row*mappingCols+col] & moduleOnColor) != 0)
-         *codeword |= mask;
-      else
-         *codeword &= (0xff ^ mask);
-   }
-   /* Otherwise we are encoding the codewords into a pattern */
-   else {
-      if((*codeword & mask) != 0x00)
-         modules[row*mappingCols+col] |= moduleOnColor;
+   idx = row * mappingCols + col;
+   assert(row >= 0 && row < mappingRows && col >= 0 && col < mappingCols);
 
-      modules[row*mappingCols+col] |= DmtxModuleAssigned;
-   }
+   for(shift = 0; (mask << shift) != DmtxMaskBit1; shift++)
+      ;
 
-   modules[row*mappingCols+col] |= DmtxModuleVisited;
+   module[chr * 8 + shift] = (unsigned short)idx;
+   placed[(unsigned short)idx] = 1;
 }
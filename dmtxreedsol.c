@@ -26,6 +26,7 @@
 
 #define NN                      255
 #define MAX_ERROR_WORD_COUNT     68
+#define ERASURE_SPARE_WORDS       2 /* Check words held back when erasures are flagged */
 
 /* GF add (a + b) */
 #define GfAdd(a,b) \
@@ -89,42 +90,35 @@ static DmtxByte antilog301[] =
 static DmtxPassFail
 RsEncode(DmtxMessage *message, int sizeIdx)
 {
-   int i, j;
+   int i;
    int blockStride, blockIdx;
    int blockErrorWords, symbolDataWords, symbolErrorWords, symbolTotalWords;
    DmtxPassFail passFail;
-   DmtxByte val, *eccPtr;
-   DmtxByte genStorage[MAX_ERROR_WORD_COUNT];
+   DmtxByte *eccPtr;
+   DmtxGfLfsrKernel lfsr;
+   const DmtxRsTable *table;
+   const DmtxSymbolDescriptor *symbol;
    DmtxByte eccStorage[MAX_ERROR_WORD_COUNT];
-   DmtxByteList gen = dmtxByteListBuild(genStorage, sizeof(genStorage));
    DmtxByteList ecc = dmtxByteListBuild(eccStorage, sizeof(eccStorage));
 
-   blockStride = dmtxGetSymbolAttribute(DmtxSymAttribInterleavedBlocks, sizeIdx);
-   blockErrorWords = dmtxGetSymbolAttribute(DmtxSymAttribBlockErrorWords, sizeIdx);
-   symbolDataWords = dmtxGetSymbolAttribute(DmtxSymAttribSymbolDataWords, sizeIdx);
-   symbolErrorWords = dmtxGetSymbolAttribute(DmtxSymAttribSymbolErrorWords, sizeIdx);
+   symbol = dmtxGetSymbolDescriptor(sizeIdx);
+   blockStride = symbol->interleavedBlocks;
+   blockErrorWords = symbol->blockErrorWords;
+   symbolDataWords = symbol->symbolDataWords;
+   symbolErrorWords = symbol->symbolErrorWords;
    symbolTotalWords = symbolDataWords + symbolErrorWords;
 
-   /* Populate generator polynomial */
-   RsGenPoly(&gen, blockErrorWords);
+   /* Generator polynomial and feedback rows shared by every block */
+   table = RsGetTable(sizeIdx);
+   lfsr = SimdGfLfsrKernel(blockErrorWords);
 
    /* For each interleaved block... */
    for(blockIdx = 0; blockIdx < blockStride; blockIdx++)
    {
       /* Generate error codewords */
       dmtxByteListInit(&ecc, blockErrorWords, 0, &passFail); CHKPASS;
-      for(i = blockIdx; i < symbolDataWords; i += blockStride)
-      {
-         val = GfAdd(ecc.b[blockErrorWords-1], message->code[i]);
-
-         for(j = blockErrorWords - 1; j > 0; j--)
-         {
-            DMTX_CHECK_BOUNDS(&ecc, j); DMTX_CHECK_BOUNDS(&ecc, j-1); DMTX_CHECK_BOUNDS(&gen, j);
-            ecc.b[j] = GfAdd(ecc.b[j-1], GfMult(gen.b[j], val));
-         }
-
-         ecc.b[0] = GfMult(gen.b[0], val);
-      }
+      lfsr(ecc.b, table, message->code + blockIdx,
+            SymbolBlockDataSize(symbol, blockIdx), blockStride);
 
       /* Copy to output message */
       eccPtr = ecc.b + blockErrorWords;
@@ -143,12 +137,17 @@ RsEncode(DmtxMessage *message, int sizeIdx)
  * \param code
  * \param sizeIdx
  * \param fix
+ * \param erasure Nonzero for each codeword read with low confidence, or NULL
  * \return Function success (DmtxPass|DmtxFail)
+ *
+ * A block with flagged codewords is first decoded treating them as erasures,
+ * which costs one check word each instead of two. If that fails the block is
+ * decoded again as if nothing had been flagged.
  */
 #undef CHKPASS
 #define CHKPASS { if(passFail == DmtxFail) return DmtxFail; }
 static DmtxPassFail
-RsDecode(unsigned char *code, int sizeIdx, int fix)
+RsDecode(unsigned char *code, int sizeIdx, int fix, const unsigned char *erasure)
 {
    int i;
    int blockStride, blockIdx;
@@ -158,36 +157,67 @@ RsDecode(unsigned char *code, int sizeIdx, int fix)
    DmtxBoolean error, repairable;
    DmtxPassFail passFail;
    unsigned char *word;
-   DmtxByte elpStorage[MAX_ERROR_WORD_COUNT];
+   DmtxGfLfsrKernel lfsr;
+   const DmtxRsTable *table;
+   const DmtxSymbolDescriptor *symbol;
+   DmtxByte remStorage[MAX_ERROR_WORD_COUNT];
    DmtxByte synStorage[MAX_ERROR_WORD_COUNT+1];
    DmtxByte recStorage[NN];
-   DmtxByte locStorage[NN];
-   DmtxByteList elp = dmtxByteListBuild(elpStorage, sizeof(elpStorage));
+   DmtxByte eraStorage[NN];
+   DmtxByteList rem = dmtxByteListBuild(remStorage, sizeof(remStorage));
    DmtxByteList syn = dmtxByteListBuild(synStorage, sizeof(synStorage));
    DmtxByteList rec = dmtxByteListBuild(recStorage, sizeof(recStorage));
-   DmtxByteList loc = dmtxByteListBuild(locStorage, sizeof(locStorage));
-
-   blockStride = dmtxGetSymbolAttribute(DmtxSymAttribInterleavedBlocks, sizeIdx);
-   blockErrorWords = dmtxGetSymbolAttribute(DmtxSymAttribBlockErrorWords, sizeIdx);
-   blockMaxCorrectable = dmtxGetSymbolAttribute(DmtxSymAttribBlockMaxCorrectable, sizeIdx);
-   symbolDataWords = dmtxGetSymbolAttribute(DmtxSymAttribSymbolDataWords, sizeIdx);
-   symbolErrorWords = dmtxGetSymbolAttribute(DmtxSymAttribSymbolErrorWords, sizeIdx);
+   DmtxByteList era = dmtxByteListBuild(eraStorage, sizeof(eraStorage));
+
+   symbol = dmtxGetSymbolDescriptor(sizeIdx);
+   blockStride = symbol->interleavedBlocks;
+   blockErrorWords = symbol->blockErrorWords;
+   blockMaxCorrectable = symbol->blockMaxCorrectable;
+   symbolDataWords = symbol->symbolDataWords;
+   symbolErrorWords = symbol->symbolErrorWords;
    symbolTotalWords = symbolDataWords + symbolErrorWords;
 
+   table = RsGetTable(sizeIdx);
+   lfsr = SimdGfLfsrKernel(blockErrorWords);
+
    /* For each interleaved block */
    for(blockIdx = 0; blockIdx < blockStride; blockIdx++)
    {
       /* Data word count depends on blockIdx due to special case at 144x144 */
-      blockDataWords = dmtxGetBlockDataSize(sizeIdx, blockIdx);
+      blockDataWords = SymbolBlockDataSize(symbol, blockIdx);
 //      blockTotalWords = blockErrorWords + blockDataWords;
 
+      /* Remainder of the received block (rem) by the generator is zero
+         unless errors are present: re-encode the data words and compare */
+      dmtxByteListInit(&rem, blockErrorWords, 0, &passFail); CHKPASS;
+      lfsr(rem.b, table, code + blockIdx, blockDataWords, blockStride);
+
+      /* Start with final error word and work backward */
+      word = code + symbolTotalWords + blockIdx - blockStride;
+      for(error = DmtxFalse, i = 0; i < blockErrorWords; i++)
+      {
+         rem.b[i] = GfAdd(rem.b[i], *word);
+         if(rem.b[i] != 0)
+            error = DmtxTrue;
+         word -= blockStride;
+      }
+
+      /* Error free blocks are left as they are */
+      if(!error)
+         continue;
+
       /* Populate received list (rec) with data and error codewords */
       dmtxByteListInit(&rec, 0, 0, &passFail); CHKPASS;
+      dmtxByteListInit(&era, 0, 0, &passFail); CHKPASS;
 
       /* Start with final error word and work backward */
       word = code + symbolTotalWords + blockIdx - blockStride;
       for(i = 0; i < blockErrorWords; i++)
       {
+         if(erasure != NULL && erasure[word - code] != 0)
+         {
+            dmtxByteListPush(&era, rec.length, &passFail); CHKPASS;
+         }
          dmtxByteListPush(&rec, *word, &passFail); CHKPASS;
          word -= blockStride;
       }
@@ -196,30 +226,31 @@ RsDecode(unsigned char *code, int sizeIdx, int fix)
       word = code + blockIdx + (blockStride * (blockDataWords - 1));
       for(i = 0; i < blockDataWords; i++)
       {
+         if(erasure != NULL && erasure[word - code] != 0)
+         {
+            dmtxByteListPush(&era, rec.length, &passFail); CHKPASS;
+         }
          dmtxByteListPush(&rec, *word, &passFail); CHKPASS;
          word -= blockStride;
       }
 
       /* Compute syndromes (syn) */
-      error = RsComputeSyndromes(&syn, &rec, blockErrorWords);
+      RsComputeSyndromes(&syn, &rem, blockErrorWords);
 
-      /* Error(s) detected: Attempt repair */
-      if(error)
+      /* Attempt repair, with erasures first if any */
+      repairable = DmtxFalse;
+      if(era.length > 0 && era.length <= 2 * blockMaxCorrectable - ERASURE_SPARE_WORDS)
+         repairable = RsRepairBlock(&rec, &syn, &era, blockErrorWords, blockMaxCorrectable);
+
+      if(!repairable)
       {
-         /* Find error locator polynomial (elp) */
-         repairable = RsFindErrorLocatorPoly(&elp, &syn, blockErrorWords, blockMaxCorrectable);
-         if(!repairable)
-            return DmtxFail;
-
-         /* Find error positions (loc) */
-         repairable = RsFindErrorLocations(&loc, &elp);
-         if(!repairable)
-            return DmtxFail;
-
-         /* Find error values and repair */
-         RsRepairErrors(&rec, &loc, &elp, &syn);
+         dmtxByteListInit(&era, 0, 0, &passFail); CHKPASS;
+         repairable = RsRepairBlock(&rec, &syn, &era, blockErrorWords, blockMaxCorrectable);
       }
 
+      if(!repairable)
+         return DmtxFail;
+
       /*
        * Overwrite output with correct/corrected values
        */
@@ -244,6 +275,55 @@ RsDecode(unsigned char *code, int sizeIdx, int fix)
    return DmtxPass;
 }
 
+/**
+ * Locate and repair the errors of one block.
+ * Erasures are known error positions, so each one needs a single check word
+ * to repair where an error of unknown position needs two. The block is left
+ * untouched when it cannot be repaired.
+ * \param rec
+ * \param syn
+ * \param era Positions in rec of erased codewords
+ * \param blockErrorWords
+ * \param blockMaxCorrectable
+ * \return Is block repaired? (DmtxTrue|DmtxFalse)
+ */
+#undef CHKPASS
+#define CHKPASS { if(passFail == DmtxFail) return DmtxFalse; }
+static DmtxBoolean
+RsRepairBlock(DmtxByteList *rec, const DmtxByteList *syn, const DmtxByteList *era,
+      int blockErrorWords, int blockMaxCorrectable)
+{
+   int i;
+   DmtxBoolean repairable;
+   DmtxPassFail passFail;
+   DmtxByte elpStorage[MAX_ERROR_WORD_COUNT+1];
+   DmtxByte locStorage[NN];
+   DmtxByteList elp = dmtxByteListBuild(elpStorage, sizeof(elpStorage));
+   DmtxByteList loc = dmtxByteListBuild(locStorage, sizeof(locStorage));
+
+   /* Find error locator polynomial (elp) */
+   repairable = RsFindErrorLocatorPoly(&elp, syn, era, blockErrorWords, blockMaxCorrectable);
+   if(!repairable)
+      return DmtxFalse;
+
+   /* Find error positions (loc) */
+   repairable = RsFindErrorLocations(&loc, &elp);
+   if(!repairable)
+      return DmtxFalse;
+
+   /* Roots beyond the end of a shortened block mean a miscorrection */
+   for(i = 0; i < loc.length; i++)
+   {
+      if(loc.b[i] >= rec->length)
+         return DmtxFalse;
+   }
+
+   /* Find error values and repair */
+   passFail = RsRepairErrors(rec, &loc, &elp, syn); CHKPASS;
+
+   return DmtxTrue;
+}
+
 /**
  * Populate generator polynomial.
  * More detailed description.
@@ -276,14 +356,98 @@ RsGenPoly(DmtxByteList *gen, int errorWordCount)
    return DmtxPass;
 }
 
+#ifdef HAVE_PTHREAD
+static pthread_once_t rsTableOnce = PTHREAD_ONCE_INIT;
+#else
+static DmtxBoolean rsTableReady = DmtxFalse;
+#endif
+static DmtxRsTable rsTable[DmtxRsTableCount];
+static DmtxRsTable *rsTableOfSize[DmtxSymbolSquareCount + DmtxSymbolRectCount];
+static DmtxByte rsFeedback[256 * DmtxRsFeedbackSize];
+
 /**
- * Populate generator polynomial.
- * Assume we have received bits grouped into mm-bit symbols in rec[i],
- * i=0..(nn-1),  and rec[i] is index form (ie as powers of alpha). We first
- * compute the 2*tt syndromes by substituting alpha**i into rec(X) and
- * evaluating, storing the syndromes in syn[i], i=1..2tt (leave syn[0] zero).
+ * Fetch the generator polynomial and LFSR feedback rows of a symbol size.
+ * Tables for every block size are built together on first use and never
+ * change afterward, so encoders and decoders on any thread share them.
+ * \param sizeIdx
+ * \return Table of the block error word count of sizeIdx
+ */
+static const DmtxRsTable *
+RsGetTable(int sizeIdx)
+{
+#ifdef HAVE_PTHREAD
+   pthread_once(&rsTableOnce, RsBuildTables);
+#else
+   if(rsTableReady == DmtxFalse)
+   {
+      RsBuildTables();
+      rsTableReady = DmtxTrue;
+   }
+#endif
+
+   return rsTableOfSize[sizeIdx];
+}
+
+/**
+ * Build one table per distinct block error word count.
+ * Row v of the feedback holds v * gen, which is what the LFSR adds to its
+ * register when v is shifted out, so encoding costs one row per codeword.
+ * Rows are zero beyond the error word count.
+ * \return void
+ */
+static void
+RsBuildTables(void)
+{
+   int sizeIdx, errorWords, tableCount, feedbackUsed;
+   int i, v, j;
+   DmtxRsTable *table;
+   DmtxByteList gen;
+
+   tableCount = feedbackUsed = 0;
+
+   for(sizeIdx = 0; sizeIdx < DmtxSymbolSquareCount + DmtxSymbolRectCount; sizeIdx++)
+   {
+      errorWords = dmtxGetSymbolDescriptor(sizeIdx)->blockErrorWords;
+
+      for(i = 0; i < tableCount; i++)
+      {
+         if(rsTable[i].errorWords == errorWords)
+            break;
+      }
+
+      table = &rsTable[i];
+      rsTableOfSize[sizeIdx] = table;
+      if(i < tableCount)
+         continue;
+
+      assert(tableCount < DmtxRsTableCount);
+      tableCount++;
+
+      table->errorWords = errorWords;
+      table->width = (errorWords + 31) & ~31;
+      table->feedback = rsFeedback + 256 * feedbackUsed;
+      feedbackUsed += table->width;
+      assert(feedbackUsed <= DmtxRsFeedbackSize);
+
+      gen = dmtxByteListBuild(table->gen, sizeof(table->gen));
+      RsGenPoly(&gen, errorWords);
+
+      for(v = 0; v < 256; v++)
+      {
+         for(j = 0; j < errorWords; j++)
+            table->feedback[v * table->width + j] = GfMult(gen.b[j], v);
+      }
+   }
+}
+
+/**
+ * Compute the syndromes of a block.
+ * The received polynomial and its remainder by the generator take the same
+ * values at alpha**1 .. alpha**blockErrorWords, the roots of the generator,
+ * so evaluating the short remainder gives the 2tt syndromes syn[i], i=1..2tt
+ * (leave syn[0] zero).
  * \param syn
- * \param rec
+ * \param rem Error words recomputed from the data plus those received
  * \param blockErrorWords
  * \return Are error(s) present? (DmtxPass|DmtxFail)
  */
@@ -291,22 +455,20 @@ RsGenPoly(DmtxByteList *gen, int errorWordCount)
 #undef CHKPASS
 #define CHKPASS { if(passFail == DmtxFail) return DmtxTrue; }
 static DmtxBoolean
-RsComputeSyndromes(DmtxByteList *syn, const DmtxByteList *rec, int blockErrorWords)
+RsComputeSyndromes(DmtxByteList *syn, const DmtxByteList *rem, int blockErrorWords)
 {
-   int i, j;
+   int i;
    DmtxPassFail passFail;
    DmtxBoolean error = DmtxFalse;
 
    /* Initialize all coefficients to 0 */
    dmtxByteListInit(syn, blockErrorWords + 1, 0, &passFail); CHKPASS;
 
+   SimdGfPolyEvalKernel(blockErrorWords)(rem->b, rem->length, 1, blockErrorWords, syn->b + 1);
+
+   /* Non-zero syndrome indicates presence of error(s) */
    for(i = 1; i < syn->length; i++)
    {
-      /* Calculate syndrome at i */
-      for(j = 0; j < rec->length; j++) /* alternatively: j < blockTotalWords */
-         syn->b[i] = GfAdd(syn->b[i], GfMultAntilog(rec->b[j], i*j));
-
-      /* Non-zero syndrome indicates presence of error(s) */
       if(syn->b[i] != 0)
          error = DmtxTrue;
    }
@@ -316,9 +478,17 @@ RsComputeSyndromes(DmtxByteList *syn, const DmtxByteList *rec, int blockErrorWor
 
 /**
  * Find the error location polynomial using Berlekamp-Massey.
- * More detailed description.
+ * Iteration starts from the erasure locator, the product of (1 + X x) over
+ * the erased positions X, and only the remaining syndromes are used to find
+ * errors at unknown positions. The result locates errors and erasures alike,
+ * and a block is repairable while twice its unknown errors plus its erasures
+ * fit within twice maxCorrectable, less ERASURE_SPARE_WORDS when erasures are
+ * present. Flags on correct codewords spend that margin, and with a single
+ * spare word about one block in a thousand pushed past capacity by wrong
+ * flags still found a wrong codeword instead of falling back.
  * \param elpOut
  * \param syn
+ * \param era Positions of erased codewords (may be empty)
  * \param errorWordCount
  * \param maxCorrectable
  * \return Is block repairable? (DmtxTrue|DmtxFalse)
@@ -327,74 +497,89 @@ RsComputeSyndromes(DmtxByteList *syn, const DmtxByteList *rec, int blockErrorWor
 #undef CHKPASS
 #define CHKPASS { if(passFail == DmtxFail) return DmtxFalse; }
 static DmtxBoolean
-RsFindErrorLocatorPoly(DmtxByteList *elpOut, const DmtxByteList *syn, int errorWordCount, int maxCorrectable)
+RsFindErrorLocatorPoly(DmtxByteList *elpOut, const DmtxByteList *syn, const DmtxByteList *era,
+      int errorWordCount, int maxCorrectable)
 {
-   int i, iNext, j;
-   int m, mCmp, lambda;
-   DmtxByte disTmp, disStorage[MAX_ERROR_WORD_COUNT+1];
-   DmtxByte elpStorage[MAX_ERROR_WORD_COUNT+2][MAX_ERROR_WORD_COUNT];
-   DmtxByteList dis, elp[MAX_ERROR_WORD_COUNT+2];
+   int i, j, m, n;
+   int lambda, lambdaNext;
+   DmtxByte dis, disPrev, coef;
+   DmtxByte elpStorage[MAX_ERROR_WORD_COUNT+1];
+   DmtxByte prevStorage[MAX_ERROR_WORD_COUNT+1];
+   DmtxByte tmpStorage[MAX_ERROR_WORD_COUNT+1];
+   DmtxByteList elp, prev, tmp;
    DmtxPassFail passFail;
 
-   dis = dmtxByteListBuild(disStorage, sizeof(disStorage));
-   dmtxByteListInit(&dis, 0, 0, &passFail); CHKPASS;
+   elp = dmtxByteListBuild(elpStorage, sizeof(elpStorage));
+   prev = dmtxByteListBuild(prevStorage, sizeof(prevStorage));
+   tmp = dmtxByteListBuild(tmpStorage, sizeof(tmpStorage));
+
+   if(era->length > errorWordCount)
+      return DmtxFalse;
 
-   for(i = 0; i < MAX_ERROR_WORD_COUNT + 2; i++)
+   /* Erasure locator: multiply in (1 + X x) for each erased position */
+   dmtxByteListInit(&elp, era->length + 1, 0, &passFail); CHKPASS;
+   elp.b[0] = 1;
+   for(i = 0; i < era->length; i++)
    {
-      elp[i] = dmtxByteListBuild(elpStorage[i], sizeof(elpStorage[i]));
-      dmtxByteListInit(&elp[i], 0, 0, &passFail); CHKPASS;
+      for(j = i + 1; j > 0; j--)
+         elp.b[j] = GfAdd(elp.b[j], GfMultAntilog(elp.b[j-1], era->b[i]));
    }
 
-   /* iNext = 0 */
-   dmtxByteListPush(&elp[0], 1, &passFail); CHKPASS;
-   dmtxByteListPush(&dis, 1, &passFail); CHKPASS;
+   dmtxByteListCopy(&prev, &elp, &passFail); CHKPASS;
+   lambda = era->length;
+   disPrev = 1;
+   m = 1;
 
-   /* iNext = 1 */
-   dmtxByteListPush(&elp[1], 1, &passFail); CHKPASS;
-   dmtxByteListPush(&dis, syn->b[1], &passFail); CHKPASS;
-
-   for(iNext = 2, i = 1; /* explicit break */; i = iNext++)
+   for(n = era->length; n < errorWordCount; n++)
    {
-      if(dis.b[i] == 0)
+      /* Calculate discrepancy against syndrome n+1 */
+      for(dis = syn->b[n+1], j = 1; j <= lambda && j < elp.length; j++)
+         dis = GfAdd(dis, GfMult(elp.b[j], syn->b[n+1-j]));
+
+      if(dis == 0)
       {
-         /* Simple case: Copy directly from previous iteration */
-         dmtxByteListCopy(&elp[iNext], &elp[i], &passFail); CHKPASS;
+         m++;
+         continue;
       }
-      else
+
+      /* elp -= (dis/disPrev) x^m prev */
+      dmtxByteListCopy(&tmp, &elp, &passFail); CHKPASS;
+      coef = antilog301[(NN - log301[disPrev] + log301[dis]) % NN];
+      while(elp.length < prev.length + m)
       {
-         /* Find earlier iteration (m) that provides maximal (m - lambda) */
-         for(m = 0, mCmp = 1; mCmp < i; mCmp++)
-            if(dis.b[mCmp] != 0 && (mCmp - elp[mCmp].length) >= (m - elp[m].length))
-               m = mCmp;
-
-         /* Calculate error location polynomial elp[i] (set 1st term) */
-         for(lambda = elp[m].length - 1, j = 0; j <= lambda; j++)
-            elp[iNext].b[j+i-m] = (elp[i - 1].b[j] == 0) ? 0 :
-                  antilog301[(NN - log301[dis.b[m]] +
-                  log301[dis.b[i]] + log301[elp[m].b[j]]) % NN];
-
-         /* Calculate error location polynomial elp[i] (add 2nd term) */
-         for(lambda = elp[i].length - 1, j = 0; j <= lambda; j++)
-            elp[iNext].b[j] = GfAdd(elp[iNext].b[j], elp[i].b[j]);
-
-         elp[iNext].length = max(elp[i].length, elp[m].length + i - m);
+         dmtxByteListPush(&elp, 0, &passFail); CHKPASS;
       }
+      for(j = 0; j < prev.length; j++)
+         elp.b[j+m] = GfAdd(elp.b[j+m], GfMult(coef, prev.b[j]));
 
-      lambda = elp[iNext].length - 1;
-      if(i == errorWordCount || i >= lambda + maxCorrectable)
-         break;
+      if(2 * lambda <= n + era->length)
+      {
+         lambdaNext = n + 1 + era->length - lambda;
+         dmtxByteListCopy(&prev, &tmp, &passFail); CHKPASS;
+         lambda = lambdaNext;
+         disPrev = dis;
+         m = 1;
+      }
+      else
+      {
+         m++;
+      }
+   }
 
-      /* Calculate discrepancy dis.b[i] */
-      for(disTmp = syn->b[iNext], j = 1; j <= lambda; j++)
-         disTmp = GfAdd(disTmp, GfMult(syn->b[iNext-j], elp[iNext].b[j]));
+   /* With erasures keep syndromes unused as a check against miscorrection */
+   if(2 * lambda - era->length > 2 * maxCorrectable - ((era->length > 0) ? ERASURE_SPARE_WORDS : 0))
+      return DmtxFalse;
 
-      assert(dis.length == iNext);
-      dmtxByteListPush(&dis, disTmp, &passFail); CHKPASS;
+   /* Degree of elp must match lambda for the Chien search to agree */
+   while(elp.length < lambda + 1)
+   {
+      dmtxByteListPush(&elp, 0, &passFail); CHKPASS;
    }
+   elp.length = lambda + 1;
 
-   dmtxByteListCopy(elpOut, &elp[iNext], &passFail); CHKPASS;
+   dmtxByteListCopy(elpOut, &elp, &passFail); CHKPASS;
 
-   return (lambda <= maxCorrectable) ? DmtxTrue : DmtxFalse;
+   return DmtxTrue;
 }
 
 /**
@@ -412,24 +597,18 @@ RsFindErrorLocatorPoly(DmtxByteList *elpOut, const DmtxByteList *syn, int errorW
 static DmtxBoolean
 RsFindErrorLocations(DmtxByteList *loc, const DmtxByteList *elp)
 {
-   int i, j;
+   int i;
    int lambda = elp->length - 1;
    DmtxPassFail passFail;
-   DmtxByte q, regStorage[MAX_ERROR_WORD_COUNT];
-   DmtxByteList reg = dmtxByteListBuild(regStorage, sizeof(regStorage));
+   DmtxByte val[NN];
 
-   dmtxByteListCopy(&reg, elp, &passFail); CHKPASS;
    dmtxByteListInit(loc, 0, 0, &passFail); CHKPASS;
 
+   SimdGfPolyEvalKernel(NN)(elp->b, elp->length, 1, NN, val);
+
    for(i = 1; i <= NN; i++)
    {
-      for(q = 1, j = 1; j <= lambda; j++)
-      {
-         reg.b[j] = GfMultAntilog(reg.b[j], j);
-         q = GfAdd(q, reg.b[j]);
-      }
-
-      if(q == 0)
+      if(val[i-1] == 0)
       {
          dmtxByteListPush(loc, NN - i, &passFail); CHKPASS;
       }
@@ -441,7 +620,8 @@ RsFindErrorLocations(DmtxByteList *loc, const DmtxByteList *elp)
 /**
  * Find the error values and repair.
  * Solve for the error value at the error location and correct the error. The
- * procedure is that found in Lin and Costello.
+ * procedure is that found in Lin and Costello. Erasures need no special care
+ * here since elp already locates them like any other error.
  * For the cases where the number of errors is known to be too large to
  * correct, the information symbols as received are output (the advantage of
  * systematic encoding is that hopefully some of the information symbols will
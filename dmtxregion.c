@@ -24,10 +24,22 @@
  */
 extern DmtxRegion *
 dmtxRegionCreate(DmtxRegion *reg)
+{
+   return RegionCreate(NULL, reg);
+}
+
+/**
+ * \brief  Create copy of existing region struct in an arena
+ * \param  arena Arena, or NULL to allocate through the hooks
+ * \param  reg
+ * \return Initialized DmtxRegion struct
+ */
+static DmtxRegion *
+RegionCreate(DmtxArena *arena, DmtxRegion *reg)
 {
    DmtxRegion *regCopy;
 
-   regCopy = (DmtxRegion *)malloc(sizeof(DmtxRegion));
+   regCopy = (DmtxRegion *)ArenaAlloc(arena, sizeof(DmtxRegion));
    if(regCopy == NULL)
       return NULL;
 
@@ -47,7 +59,7 @@ dmtxRegionDestroy(DmtxRegion **reg)
    if(reg == NULL || *reg == NULL)
       return DmtxFail;
 
-   free(*reg);
+   MemFree(*reg);
 
    *reg = NULL;
 
@@ -95,28 +107,54 @@ dmtxRegionFindNextDeterministic(DmtxDecode *dec, DmtxScanConstraint *constraint)
 {
    int locStatus;
    int iterations = 0;
+   int workerCount;
    DmtxPixelLoc loc;
    DmtxRegion   *reg;
+   DmtxDecode   *scan;
+   DmtxScanGrid *grid, before;
+   DmtxSeedBatch *batch;
+
+   /* With a pyramid the coarsest level drives the scan */
+   scan = (dec->coarse != NULL) ? dec->coarse : dec;
+   grid = &(scan->grid);
+
+   /* With an executor, edges at upcoming seeds are sought in parallel */
+   workerCount = (dec->executor.submit != NULL) ? ThreadCount(&(dec->executor), 0) : 1;
+   batch = NULL;
+   if(workerCount > 1 && SeedBatchReserve(scan, workerCount * DmtxSeedsPerWorker) == DmtxPass)
+      batch = scan->seeds;
+   else
+      SeedBatchReset(scan->seeds);
 
    /* Continue until we find a region or run out of chances */
-   for(;;) {
-      locStatus = PopGridLocation(&(dec->grid), &loc);
+   for(reg = NULL;;) {
+      before = *grid;
+      locStatus = PopGridLocation(grid, &loc);
       if(locStatus == DmtxRangeEnd) {
          if(constraint != NULL)
             constraint->stopCause = DmtxScanNotFound;
          break;
       }
 
+      /* Seeds left over from an earlier call are used up first */
+      if(batch != NULL) {
+         if(batch->next == batch->count || batch->seed[batch->next].loc.X != loc.X ||
+               batch->seed[batch->next].loc.Y != loc.Y)
+            SeedBatchFill(scan, batch, before, workerCount);
+         batch->next++;
+      }
+
       /* Iterations counts the number of calls to ScanPixel */
       ++iterations;
       /* Scan location for presence of valid barcode region */
-      reg = dmtxRegionScanPixel(dec, loc.X, loc.Y);
+      if(dec->coarse != NULL)
+         reg = PyramidScanPixel(dec, loc.X, loc.Y);
+      else
+         reg = dmtxRegionScanPixel(dec, loc.X, loc.Y);
       if(reg != NULL) {
-         if(constraint != NULL) {
-            constraint->iterations = iterations;
+         if(constraint != NULL)
             constraint->stopCause = DmtxScanSuccess;
-         }
-         return reg;
+         break;
       }
 
       /* Ran out of iterations? */
@@ -134,7 +172,508 @@ dmtxRegionFindNextDeterministic(DmtxDecode *dec, DmtxScanConstraint *constraint)
    if(constraint)
       constraint->iterations = iterations;
 
-   return NULL;
+   return reg;
+}
+
+/**
+ * \brief  Make sure the seed batch of a scanning decoder holds enough seeds
+ * \param  dec Decoder whose grid drives the scan
+ * \param  capacity Number of seeds sought per fill
+ * \return DmtxPass | DmtxFail
+ *
+ * The batch is kept on the decoder so seeds sought ahead of a region found
+ * serve the next call. It is emptied whenever the scan grid starts over.
+ */
+static DmtxPassFail
+SeedBatchReserve(DmtxDecode *dec, int capacity)
+{
+   DmtxSeed *seed;
+
+   if(dec->seeds == NULL) {
+      dec->seeds = (DmtxSeedBatch *)MemCalloc(1, sizeof(DmtxSeedBatch));
+      if(dec->seeds == NULL)
+         return DmtxFail;
+   }
+
+   if(dec->seeds->capacity < capacity) {
+      seed = (DmtxSeed *)MemAlloc(capacity * sizeof(DmtxSeed));
+      if(seed == NULL)
+         return DmtxFail;
+
+      MemFree(dec->seeds->seed);
+      dec->seeds->seed = seed;
+      dec->seeds->capacity = capacity;
+      dec->seeds->count = dec->seeds->next = 0;
+   }
+
+   return DmtxPass;
+}
+
+/**
+ * \brief  Drop the seeds sought so far, e.g. when the scan grid starts over
+ * \param  batch Seed batch, or NULL
+ * \return void
+ */
+static void
+SeedBatchReset(DmtxSeedBatch *batch)
+{
+   if(batch != NULL)
+      batch->count = batch->next = 0;
+}
+
+/**
+ * \brief  Free the seed batch of a decoder
+ * \param  batch
+ * \return void
+ */
+static void
+SeedBatchDestroy(DmtxSeedBatch **batch)
+{
+   if(batch == NULL || *batch == NULL)
+      return;
+
+   MemFree((*batch)->seed);
+   MemFree(*batch);
+
+   *batch = NULL;
+}
+
+/**
+ * \brief  Seek edges at the next seeds of a scan grid in parallel
+ * \param  dec Decoder whose grid drives the scan
+ * \param  batch Batch receiving the seeds
+ * \param  grid Copy of the scan grid, left where the scan stands
+ * \param  workerCount Number of executor workers
+ * \return void
+ *
+ * MatrixRegionSeekEdge() reads nothing but the image and the assigned bits
+ * within two pixels of the seed, and the scan changes only those bits while
+ * the batch waits. Each seed therefore keeps a snapshot of them, and
+ * SeedBatchFlow() seeks the edge again if they changed before the scan got
+ * there. Regions found are the same as with a serial scan; a scan limit may
+ * be noticed up to one batch late.
+ */
+static void
+SeedBatchFill(DmtxDecode *dec, DmtxSeedBatch *batch, DmtxScanGrid grid, int workerCount)
+{
+   batch->count = 0;
+   batch->next = 0;
+   while(batch->count < batch->capacity &&
+         PopGridLocation(&grid, &(batch->seed[batch->count].loc)) != DmtxRangeEnd)
+      batch->count++;
+
+   if(batch->count == 0 || WorkQueueInit(&(batch->queue), batch->count) == DmtxFail) {
+      batch->count = 0;
+      return;
+   }
+
+   /* Seekers only read the shared scan state; the flow cache is not theirs */
+   batch->seeker = *dec;
+   batch->seeker.flowCache = NULL;
+   batch->seeker.seeds = NULL;
+
+   ThreadRunWorkers(&(dec->executor), min(workerCount, batch->count), SeedBatchWorker, batch);
+
+   WorkQueueDestroy(&(batch->queue));
+}
+
+/**
+ * \brief  Worker function of SeedBatchFill()
+ * \param  job DmtxSeedBatch
+ * \param  worker Worker index
+ * \return void
+ */
+static void
+SeedBatchWorker(void *job, int worker)
+{
+   int item;
+   DmtxSeed *seed;
+   DmtxSeedBatch *batch;
+
+   (void)worker;
+   batch = (DmtxSeedBatch *)job;
+
+   while((item = WorkQueueNext(&(batch->queue))) != DmtxUndefined) {
+      seed = &(batch->seed[item]);
+      seed->occupied = SeedOccupied(&(batch->seeker), seed->loc);
+
+      /* MatrixRegionLocate() gives up on an assigned seed before seeking */
+      seed->flow = ((seed->occupied & (1 << 12)) != 0) ? dmtxBlankEdge :
+            MatrixRegionSeekEdge(&(batch->seeker), seed->loc);
+   }
+}
+
+/**
+ * \brief  Collect the assigned bits of the 5x5 pixels centered on a seed
+ * \param  dec
+ * \param  loc Seed location
+ * \return One bit per pixel in row order, pixels outside the image clear
+ */
+static int
+SeedOccupied(DmtxDecode *dec, DmtxPixelLoc loc)
+{
+   int x, y, cache, occupied;
+
+   occupied = 0;
+   for(y = -2; y <= 2; y++) {
+      for(x = -2; x <= 2; x++) {
+         cache = ScanCacheRead(dec->cache, loc.X + x, loc.Y + y);
+         occupied <<= 1;
+         if(cache != DmtxUndefined && (cache & 0x80) != 0x00)
+            occupied |= 1;
+      }
+   }
+
+   return occupied;
+}
+
+/**
+ * \brief  Edge at a seed, reused from the seed batch while still valid
+ * \param  dec
+ * \param  loc Seed location
+ * \return Same point flow as MatrixRegionSeekEdge()
+ */
+static DmtxPointFlow
+SeedBatchFlow(DmtxDecode *dec, DmtxPixelLoc loc)
+{
+   DmtxSeed *seed;
+   DmtxSeedBatch *batch;
+
+   /* The scan has just popped seed next - 1 */
+   batch = dec->seeds;
+   if(batch != NULL && batch->next >= 1 && batch->next <= batch->count) {
+      seed = &(batch->seed[batch->next - 1]);
+      if(seed->loc.X == loc.X && seed->loc.Y == loc.Y &&
+            seed->occupied == SeedOccupied(dec, loc))
+         return seed->flow;
+   }
+
+   return MatrixRegionSeekEdge(dec, loc);
+}
+
+/**
+ * \brief  Find all barcode regions of an image using several threads
+ * \param  dec Pointer to DmtxDecode information struct
+ * \param  threadCount Number of workers, or 0 for one per online processor
+ * \param  regionCount Set to the number of regions found (may be NULL)
+ * \return NULL-terminated array of regions to be released with
+ *         dmtxRegionListDestroy(), or NULL on failure
+ *
+ * The scan area is cut into square tiles of DmtxPropTileSize scaled pixels.
+ * A worker scans the seeds of one tile at a time with the usual
+ * dmtxRegionFindNext() pipeline, following edges past the tile borders as
+ * needed. Workers keep private visited/assigned bits, reset for each tile,
+ * and mark every region they find so it is not found again from the same
+ * tile. A symbol spanning several tiles is found once per tile and only the
+ * copy from the first tile is kept. Since tiles never see each other's
+ * state, the result, in tile order, is the same for any thread count.
+ * Workers are submitted to the executor of dec, if one is set, rather than
+ * started as library threads.
+ *
+ * The scan state of dec itself is not used or changed; regions are decoded
+ * afterwards as usual, e.g. with dmtxDecodeMatrixRegion().
+ */
+extern DmtxRegion **
+dmtxRegionFindAll(DmtxDecode *dec, int threadCount, int *regionCount)
+{
+   int i, j, k, tileCount, workerCount, total;
+   DmtxBoolean failed, duplicate;
+   DmtxRegion **regions;
+   DmtxFindAllJob job;
+
+   if(regionCount != NULL)
+      *regionCount = 0;
+
+   if(dec == NULL || dec->xMax < dec->xMin || dec->yMax < dec->yMin)
+      return NULL;
+
+   memset(&job, 0x00, sizeof(DmtxFindAllJob));
+   job.tileSize = dec->tileSize;
+   job.xMin = dec->xMin;
+   job.yMin = dec->yMin;
+   job.xMax = dec->xMax;
+   job.yMax = dec->yMax;
+   job.tileCols = (job.xMax - job.xMin) / job.tileSize + 1;
+   tileCount = job.tileCols * ((job.yMax - job.yMin) / job.tileSize + 1);
+
+   job.found = (DmtxRegionList *)MemCalloc(tileCount, sizeof(DmtxRegionList));
+   if(job.found == NULL)
+      return NULL;
+
+   if(WorkQueueInit(&(job.queue), tileCount) == DmtxFail) {
+      MemFree(job.found);
+      return NULL;
+   }
+
+   workerCount = min(ThreadCount(&(dec->executor), threadCount), tileCount);
+   failed = DmtxFalse;
+   for(i = 0; i < workerCount && failed == DmtxFalse; i++) {
+      job.worker[i] = DecodeCreateWorker(dec);
+      if(job.worker[i] == NULL)
+         failed = DmtxTrue;
+   }
+
+   if(failed == DmtxFalse)
+      ThreadRunWorkers(&(dec->executor), workerCount, FindAllWorker, &job);
+
+   for(i = 0; i < workerCount; i++)
+      DecodeDestroyWorker(&(job.worker[i]));
+   WorkQueueDestroy(&(job.queue));
+
+   total = 0;
+   for(i = 0; i < tileCount; i++) {
+      total += job.found[i].count;
+      if(job.found[i].failed == DmtxTrue)
+         failed = DmtxTrue;
+   }
+
+   regions = (failed == DmtxTrue) ? NULL :
+         (DmtxRegion **)MemCalloc(total + 1, sizeof(DmtxRegion *));
+
+   /* Merge tiles in order, dropping regions already found from an earlier tile */
+   total = 0;
+   for(i = 0; i < tileCount; i++) {
+      for(j = 0; j < job.found[i].count; j++) {
+         duplicate = DmtxFalse;
+         for(k = 0; k < total && duplicate == DmtxFalse && regions != NULL; k++) {
+            if(RegionContainsCenter(regions[k], job.found[i].region[j]) == DmtxTrue ||
+                  RegionContainsCenter(job.found[i].region[j], regions[k]) == DmtxTrue)
+               duplicate = DmtxTrue;
+         }
+
+         if(regions == NULL || duplicate == DmtxTrue)
+            dmtxRegionDestroy(&(job.found[i].region[j]));
+         else
+            regions[total++] = job.found[i].region[j];
+      }
+      MemFree(job.found[i].region);
+   }
+   MemFree(job.found);
+
+   if(regions != NULL && regionCount != NULL)
+      *regionCount = total;
+
+   return regions;
+}
+
+/**
+ * \brief  Free a region array returned by dmtxRegionFindAll()
+ * \param  regions
+ * \return DmtxPass | DmtxFail
+ */
+extern DmtxPassFail
+dmtxRegionListDestroy(DmtxRegion ***regions)
+{
+   int i;
+
+   if(regions == NULL || *regions == NULL)
+      return DmtxFail;
+
+   for(i = 0; (*regions)[i] != NULL; i++)
+      dmtxRegionDestroy(&((*regions)[i]));
+
+   MemFree(*regions);
+
+   *regions = NULL;
+
+   return DmtxPass;
+}
+
+/**
+ * \brief  Worker function of dmtxRegionFindAll()
+ * \param  job DmtxFindAllJob
+ * \param  worker Worker index
+ * \return void
+ */
+static void
+FindAllWorker(void *job, int worker)
+{
+   int tile, xMin, yMin;
+   DmtxRegion *reg;
+   DmtxFindAllJob *findAll;
+   DmtxDecode *dec;
+
+   findAll = (DmtxFindAllJob *)job;
+   dec = findAll->worker[worker];
+
+   while((tile = WorkQueueNext(&(findAll->queue))) != DmtxUndefined) {
+      xMin = findAll->xMin + (tile % findAll->tileCols) * findAll->tileSize;
+      yMin = findAll->yMin + (tile / findAll->tileCols) * findAll->tileSize;
+
+      if(DecodeSetTile(dec, xMin, yMin,
+            min(xMin + findAll->tileSize - 1, findAll->xMax),
+            min(yMin + findAll->tileSize - 1, findAll->yMax)) == DmtxFail) {
+         findAll->found[tile].failed = DmtxTrue;
+         continue;
+      }
+
+      while((reg = dmtxRegionFindNext(dec, NULL)) != NULL) {
+         if(DecodeMarkRegion(dec, reg) == DmtxFail ||
+               RegionListAppend(&(findAll->found[tile]), reg) == DmtxFail) {
+            findAll->found[tile].failed = DmtxTrue;
+            dmtxRegionDestroy(&reg);
+            break;
+         }
+      }
+   }
+}
+
+/**
+ * \brief  Append a region to a list, growing it as needed
+ * \param  list
+ * \param  reg
+ * \return DmtxPass | DmtxFail
+ */
+static DmtxPassFail
+RegionListAppend(DmtxRegionList *list, DmtxRegion *reg)
+{
+   int capacity;
+   DmtxRegion **region;
+
+   if(list->count == list->capacity) {
+      capacity = (list->capacity == 0) ? 4 : 2 * list->capacity;
+      region = (DmtxRegion **)MemAlloc(capacity * sizeof(DmtxRegion *));
+      if(region == NULL) {
+         list->failed = DmtxTrue;
+         return DmtxFail;
+      }
+      if(list->count > 0)
+         memcpy(region, list->region, list->count * sizeof(DmtxRegion *));
+      MemFree(list->region);
+      list->region = region;
+      list->capacity = capacity;
+   }
+
+   list->region[list->count++] = reg;
+
+   return DmtxPass;
+}
+
+/**
+ * \brief  Test whether the center of one region lies inside another
+ * \param  reg
+ * \param  other
+ * \return DmtxTrue | DmtxFalse
+ */
+static DmtxBoolean
+RegionContainsCenter(DmtxRegion *reg, DmtxRegion *other)
+{
+   DmtxVector2 center;
+
+   center.X = center.Y = 0.5;
+   dmtxMatrix3VMultiplyBy(&center, other->fit2raw);
+   dmtxMatrix3VMultiplyBy(&center, reg->raw2fit);
+
+   return (center.X >= 0.0 && center.X <= 1.0 && center.Y >= 0.0 && center.Y <= 1.0) ?
+         DmtxTrue : DmtxFalse;
+}
+
+/**
+ * \brief  Find a symbol again near where it was in the previous frame
+ * \param  dec Pointer to DmtxDecode information struct
+ * \param  prev Region found in the previous frame
+ * \param  constraint Pointer to constraint for the fallback scan (NULL if none)
+ * \return Detected region (if found)
+ *
+ * The previous corners are shifted by up to about one module in each
+ * direction, and every shift passing the dmtxRegionUpdateCorners() shape
+ * checks and the finder, calibration and quiet zone checks of
+ * MatrixRegionFindSize() at the previous symbol size is scored by
+ * calibration contrast. The best one is returned without scanning. If no
+ * shift passes, the symbol is searched for with
+ * dmtxRegionFindNextDeterministic() instead, and constraint is filled in by
+ * that scan. A tracked region reports zero iterations and DmtxScanSuccess.
+ *
+ * prev is only read. A region allocated from the decode arena
+ * (DmtxPropArenaSize) does not survive dmtxDecodeSetImage(), so such a
+ * region should be copied before the next frame is attached.
+ */
+extern DmtxRegion *
+dmtxRegionTrack(DmtxDecode *dec, DmtxRegion *prev, DmtxScanConstraint *constraint)
+{
+   int radius, contrast, bestContrast;
+   double pitch;
+   DmtxVector2 p00, p10, p01, vOR, vOT, shift;
+   DmtxRegion reg, best;
+
+   bestContrast = 0;
+
+   if(prev != NULL && prev->sizeIdx >= 0 &&
+         prev->sizeIdx < DmtxSymbolSquareCount + DmtxSymbolRectCount) {
+      p00.X = p00.Y = p10.Y = p01.X = 0.0;
+      p10.X = p01.Y = 1.0;
+      dmtxMatrix3VMultiplyBy(&p00, prev->fit2raw);
+      dmtxMatrix3VMultiplyBy(&p10, prev->fit2raw);
+      dmtxMatrix3VMultiplyBy(&p01, prev->fit2raw);
+
+      /* Search about one module around the previous position */
+      pitch = min(dmtxVector2Mag(dmtxVector2Sub(&vOR, &p10, &p00)) /
+            dmtxGetSymbolDescriptor(prev->sizeIdx)->symbolCols,
+            dmtxVector2Mag(dmtxVector2Sub(&vOT, &p01, &p00)) /
+            dmtxGetSymbolDescriptor(prev->sizeIdx)->symbolRows);
+      radius = max(1, min(DmtxTrackRadiusMax, (int)(pitch + 0.5)));
+
+      for(shift.Y = -radius; shift.Y <= radius; shift.Y++) {
+         for(shift.X = -radius; shift.X <= radius; shift.X++) {
+            if(TrackVerify(dec, prev, shift, &reg) == DmtxFail)
+               continue;
+
+            contrast = abs(reg.onColor - reg.offColor);
+            if(contrast > bestContrast) {
+               bestContrast = contrast;
+               best = reg;
+            }
+         }
+      }
+   }
+
+   if(bestContrast == 0)
+      return dmtxRegionFindNextDeterministic(dec, constraint);
+
+   if(constraint != NULL) {
+      constraint->iterations = 0;
+      constraint->stopCause = DmtxScanSuccess;
+   }
+
+   return RegionCreate(dec->arena, &best);
+}
+
+/**
+ * \brief  Test whether a symbol of the previous size lies at shifted corners
+ * \param  dec Pointer to DmtxDecode information struct
+ * \param  prev Region found in the previous frame
+ * \param  shift Offset added to every corner of prev
+ * \param  reg Set to the shifted region
+ * \return DmtxPass | DmtxFail
+ */
+static DmtxPassFail
+TrackVerify(DmtxDecode *dec, DmtxRegion *prev, DmtxVector2 shift, DmtxRegion *reg)
+{
+   int colorOnAvg, colorOffAvg;
+   DmtxVector2 p00, p10, p11, p01;
+
+   memcpy(reg, prev, sizeof(DmtxRegion));
+
+   p00.X = p00.Y = p10.Y = p01.X = 0.0;
+   p10.X = p11.X = p11.Y = p01.Y = 1.0;
+   dmtxMatrix3VMultiplyBy(&p00, prev->fit2raw);
+   dmtxMatrix3VMultiplyBy(&p10, prev->fit2raw);
+   dmtxMatrix3VMultiplyBy(&p11, prev->fit2raw);
+   dmtxMatrix3VMultiplyBy(&p01, prev->fit2raw);
+
+   dmtxVector2AddTo(&p00, &shift);
+   dmtxVector2AddTo(&p10, &shift);
+   dmtxVector2AddTo(&p11, &shift);
+   dmtxVector2AddTo(&p01, &shift);
+
+   if(dmtxRegionUpdateCorners(dec, reg, p00, p10, p11, p01) == DmtxFail)
+      return DmtxFail;
+
+   ReadCalibrationColors(dec, reg, dmtxGetSymbolDescriptor(prev->sizeIdx), &colorOnAvg, &colorOffAvg);
+   if(abs(colorOnAvg - colorOffAvg) < 20)
+      return DmtxFail;
+
+   return MatrixRegionCheckSize(dec, reg, prev->sizeIdx, colorOnAvg, colorOffAvg);
 }
 
 /**
@@ -146,54 +685,161 @@ dmtxRegionFindNextDeterministic(DmtxDecode *dec, DmtxScanConstraint *constraint)
 extern DmtxRegion *
 dmtxRegionScanPixel(DmtxDecode *dec, int x, int y)
 {
-   unsigned char *cache;
    DmtxRegion reg;
+
+   if(MatrixRegionLocate(dec, x, y, &reg) == DmtxFail)
+      return NULL;
+
+   /* Calculate the best fitting symbol size */
+   if(MatrixRegionFindSize(dec, &reg) == DmtxFail)
+      return NULL;
+
+   /* Found a valid matrix region */
+   return RegionCreate(dec->arena, &reg);
+}
+
+/**
+ * \brief  Locate the finder and calibration edges of a region at a pixel
+ * \param  dec Pointer to DmtxDecode information struct
+ * \param  x Scaled x coordinate
+ * \param  y Scaled y coordinate
+ * \param  reg Region receiving the fitted transforms
+ * \return DmtxPass | DmtxFail
+ */
+static DmtxPassFail
+MatrixRegionLocate(DmtxDecode *dec, int x, int y, DmtxRegion *reg)
+{
+   int cache;
    DmtxPointFlow flowBegin;
    DmtxPixelLoc loc;
 
    loc.X = x;
    loc.Y = y;
 
-   cache = dmtxDecodeGetCache(dec, loc.X, loc.Y);
-   if(cache == NULL)
-      return NULL;
+   cache = ScanCacheRead(dec->cache, loc.X, loc.Y);
+   if(cache == DmtxUndefined)
+      return DmtxFail;
 
-   if((int)(*cache & 0x80) != 0x00)
-      return NULL;
+   if((cache & 0x80) != 0x00)
+      return DmtxFail;
 
    /* Test for presence of any reasonable edge at this location */
-   flowBegin = MatrixRegionSeekEdge(dec, loc);
+   flowBegin = (dec->seeds != NULL) ? SeedBatchFlow(dec, loc) : MatrixRegionSeekEdge(dec, loc);
    if(flowBegin.mag < (int)(dec->edgeThresh * 7.65 + 0.5))
-      return NULL;
+      return DmtxFail;
 
-   memset(&reg, 0x00, sizeof(DmtxRegion));
+   memset(reg, 0x00, sizeof(DmtxRegion));
 
    /* Determine barcode orientation */
-   if(MatrixRegionOrientation(dec, &reg, flowBegin) == DmtxFail)
-      return NULL;
-   if(dmtxRegionUpdateXfrms(dec, &reg) == DmtxFail)
-      return NULL;
+   if(MatrixRegionOrientation(dec, reg, flowBegin) == DmtxFail)
+      return DmtxFail;
+   if(dmtxRegionUpdateXfrms(dec, reg) == DmtxFail)
+      return DmtxFail;
 
    /* Define top edge */
-   if(MatrixRegionAlignCalibEdge(dec, &reg, DmtxEdgeTop) == DmtxFail)
-      return NULL;
-   if(dmtxRegionUpdateXfrms(dec, &reg) == DmtxFail)
-      return NULL;
+   if(MatrixRegionAlignCalibEdge(dec, reg, DmtxEdgeTop) == DmtxFail)
+      return DmtxFail;
+   if(dmtxRegionUpdateXfrms(dec, reg) == DmtxFail)
+      return DmtxFail;
 
    /* Define right edge */
-   if(MatrixRegionAlignCalibEdge(dec, &reg, DmtxEdgeRight) == DmtxFail)
-      return NULL;
-   if(dmtxRegionUpdateXfrms(dec, &reg) == DmtxFail)
+   if(MatrixRegionAlignCalibEdge(dec, reg, DmtxEdgeRight) == DmtxFail)
+      return DmtxFail;
+   if(dmtxRegionUpdateXfrms(dec, reg) == DmtxFail)
+      return DmtxFail;
+
+   CALLBACK_MATRIX(reg);
+
+   return DmtxPass;
+}
+
+/**
+ * \brief  Scan a pixel of the coarsest pyramid level and confirm any region
+ *         found there at full resolution
+ * \param  dec Pointer to full resolution DmtxDecode information struct
+ * \param  x Coarse x coordinate
+ * \param  y Coarse y coordinate
+ * \return Detected region (if any)
+ *
+ * The coarse corners are tried first as they are. If no symbol size fits
+ * them, full resolution detection is restarted from the strongest edge found
+ * near the coarse left edge.
+ */
+static DmtxRegion *
+PyramidScanPixel(DmtxDecode *dec, int x, int y)
+{
+   int i, side, col, row;
+   DmtxRegion reg;
+   DmtxVector2 corner[4];
+   DmtxPixelLoc loc, leftLoc;
+   DmtxPointFlow flow, best;
+
+   if(MatrixRegionLocate(dec->coarse, x, y, &reg) == DmtxFail)
       return NULL;
 
-   CALLBACK_MATRIX(&reg);
+   side = 1 << dec->pyramidLevels;
+   leftLoc = PyramidLocToFull(reg.leftLoc, dec->pyramidLevels);
 
-   /* Calculate the best fitting symbol size */
-   if(MatrixRegionFindSize(dec, &reg) == DmtxFail)
+   /* Move fitted corners to the centers of their full resolution blocks */
+   for(i = 0; i < 4; i++) {
+      corner[i].X = (i == 1 || i == 2) ? 1.0 : 0.0;
+      corner[i].Y = (i == 2 || i == 3) ? 1.0 : 0.0;
+      dmtxMatrix3VMultiplyBy(&corner[i], reg.fit2raw);
+      corner[i].X = corner[i].X * side + (side - 1) / 2.0;
+      corner[i].Y = corner[i].Y * side + (side - 1) / 2.0;
+   }
+
+   reg.finalPos = PyramidLocToFull(reg.finalPos, dec->pyramidLevels);
+   reg.finalNeg = PyramidLocToFull(reg.finalNeg, dec->pyramidLevels);
+   reg.boundMin = PyramidLocToFull(reg.boundMin, dec->pyramidLevels);
+   reg.boundMax = PyramidLocToFull(reg.boundMax, dec->pyramidLevels);
+   reg.flowBegin.loc = PyramidLocToFull(reg.flowBegin.loc, dec->pyramidLevels);
+   reg.locR = PyramidLocToFull(reg.locR, dec->pyramidLevels);
+   reg.locT = PyramidLocToFull(reg.locT, dec->pyramidLevels);
+   reg.leftLoc = leftLoc;
+   reg.bottomLoc = PyramidLocToFull(reg.bottomLoc, dec->pyramidLevels);
+   reg.topLoc = PyramidLocToFull(reg.topLoc, dec->pyramidLevels);
+   reg.rightLoc = PyramidLocToFull(reg.rightLoc, dec->pyramidLevels);
+
+   if(dmtxRegionUpdateCorners(dec, &reg, corner[0], corner[1], corner[2], corner[3]) == DmtxPass &&
+         MatrixRegionFindSize(dec, &reg) == DmtxPass)
+      return RegionCreate(dec->arena, &reg);
+
+   /* Coarse corners were too rough for this symbol; seed a full resolution scan */
+   best = dmtxBlankEdge;
+   for(row = -side/2; row < side + side/2; row++) {
+      for(col = -side/2; col < side + side/2; col++) {
+         loc.X = leftLoc.X + col;
+         loc.Y = leftLoc.Y + row;
+         flow = GetPointFlow(dec, reg.flowBegin.plane, loc, dmtxNeighborNone);
+         if(flow.mag > best.mag)
+            best = flow;
+      }
+   }
+
+   if(best.mag == DmtxUndefined)
       return NULL;
 
-   /* Found a valid matrix region */
-   return dmtxRegionCreate(&reg);
+   return dmtxRegionScanPixel(dec, best.loc.X, best.loc.Y);
+}
+
+/**
+ * \brief  Convert a coarse pyramid location to the first full resolution
+ *         pixel of its block
+ * \param  loc Coarse location
+ * \param  levels Number of pyramid levels
+ * \return Full resolution location
+ *
+ * ImageCreatePyramidLevel() pairs rows and columns from y = 0 and x = 0 and
+ * rounds odd remainders up, so a plain shift is exact for every image size.
+ */
+static DmtxPixelLoc
+PyramidLocToFull(DmtxPixelLoc loc, int levels)
+{
+   loc.X <<= levels;
+   loc.Y <<= levels;
+
+   return loc;
 }
 
 /**
@@ -210,7 +856,7 @@ MatrixRegionSeekEdge(DmtxDecode *dec, DmtxPixelLoc loc)
    DmtxPointFlow flowPos, flowPosBack;
    DmtxPointFlow flowNeg, flowNegBack;
 
-   channelCount = dec->image->channelCount;
+   channelCount = DecodeScanImage(dec)->channelCount;
 
    /* Find whether red, green, or blue shows the strongest edge */
    strongIdx = 0;
@@ -256,7 +902,6 @@ MatrixRegionOrientation(DmtxDecode *dec, DmtxRegion *reg, DmtxPointFlow begin)
    DmtxPassFail err;
    DmtxBestLine line1x, line2x;
    DmtxBestLine line2n, line2p;
-   DmtxFollow fTmp;
 
    if(dec->sizeIdxExpected == DmtxSymbolSquareAuto ||
          (dec->sizeIdxExpected >= DmtxSymbol10x10 &&
@@ -279,10 +924,14 @@ MatrixRegionOrientation(DmtxDecode *dec, DmtxRegion *reg, DmtxPointFlow begin)
       maxDiagonal = DmtxUndefined;
    }
 
+   /* No trail can be laid where the scan cache has no room */
+   if(dmtxDecodeGetCache(dec, begin.loc.X, begin.loc.Y) == NULL)
+      return DmtxFail;
+
    /* Follow to end in both directions */
    err = TrailBlazeContinuous(dec, reg, begin, maxDiagonal);
    if(err == DmtxFail || reg->stepsTotal < 40) {
-      TrailClear(dec, reg, 0x40);
+      TrailClear(dec, 0x40);
       return DmtxFail;
    }
 
@@ -296,29 +945,26 @@ MatrixRegionOrientation(DmtxDecode *dec, DmtxRegion *reg, DmtxPointFlow begin)
          minArea = (2 * dec->edgeMin * dec->edgeMin)/(scale * scale);
 
       if((reg->boundMax.X - reg->boundMin.X) * (reg->boundMax.Y - reg->boundMin.Y) < minArea) {
-         TrailClear(dec, reg, 0x40);
+         TrailClear(dec, 0x40);
          return DmtxFail;
       }
    }
 
    line1x = FindBestSolidLine(dec, reg, 0, 0, +1, DmtxUndefined);
    if(line1x.mag < 5) {
-      TrailClear(dec, reg, 0x40);
+      TrailClear(dec, 0x40);
       return DmtxFail;
    }
 
    err = FindTravelLimits(dec, reg, &line1x);
    if(line1x.distSq < 100 || line1x.devn * 10 >= sqrt((double)line1x.distSq)) {
-      TrailClear(dec, reg, 0x40);
+      TrailClear(dec, 0x40);
       return DmtxFail;
    }
    assert(line1x.stepPos >= line1x.stepNeg);
 
-   fTmp = FollowSeek(dec, reg, line1x.stepPos + 5);
-   line2p = FindBestSolidLine(dec, reg, fTmp.step, line1x.stepNeg, +1, line1x.angle);
-
-   fTmp = FollowSeek(dec, reg, line1x.stepNeg - 5);
-   line2n = FindBestSolidLine(dec, reg, fTmp.step, line1x.stepPos, -1, line1x.angle);
+   line2p = FindBestSolidLine(dec, reg, line1x.stepPos + 5, line1x.stepNeg, +1, line1x.angle);
+   line2n = FindBestSolidLine(dec, reg, line1x.stepNeg - 5, line1x.stepPos, -1, line1x.angle);
    if(max(line2p.mag, line2n.mag) < 5)
       return DmtxFail;
 
@@ -632,44 +1278,95 @@ RightAngleTrueness(DmtxVector2 c0, DmtxVector2 c1, DmtxVector2 c2, double angle)
 }
 
 /**
- * \brief  Read color of Data Matrix module location
+ * \brief  Read colors of consecutive modules along a symbol row or column
  * \param  dec
  * \param  reg
- * \param  symbolRow
- * \param  symbolCol
- * \param  sizeIdx
- * \return Averaged module color
+ * \param  symbolRow Row of the first module
+ * \param  symbolCol Column of the first module
+ * \param  symbol Descriptor of the symbol size
+ * \param  colorPlane
+ * \param  dir Direction of travel from one module to the next
+ * \param  count Number of modules to read
+ * \param  color Receives the averaged color of each module
+ * \return void
+ *
+ * Each module is the average of 5 samples around its center. The homogeneous
+ * coordinates of fit2raw change by a constant amount from one module to the
+ * next, so every sample location is found with one pass of adds and a single
+ * divide instead of a full matrix multiply. Samples falling outside the image
+ * are left out of the average.
  */
-static int
-ReadModuleColor(DmtxDecode *dec, DmtxRegion *reg, int symbolRow, int symbolCol,
-      int sizeIdx, int colorPlane)
+static void
+ReadModuleColorLine(DmtxDecode *dec, DmtxRegion *reg, int symbolRow, int symbolCol,
+      const DmtxSymbolDescriptor *symbol, int colorPlane, DmtxDirection dir, int count, int *color)
 {
-   int i;
+   int i, j, k;
    int symbolRows, symbolCols;
-   int color, colorTmp;
+   int xLimit, yLimit, scale, channel;
+   int sum, samples;
+   int x[5 * DmtxModuleLineMax], y[5 * DmtxModuleLineMax];
+   double u, v, w, xRaw, yRaw;
+   double hx[5], hy[5], hw[5], dx, dy, dw;
    double sampleX[] = { 0.5, 0.4, 0.5, 0.6, 0.5 };
    double sampleY[] = { 0.5, 0.5, 0.4, 0.5, 0.6 };
-   DmtxVector2 p;
-
-   symbolRows = dmtxGetSymbolAttribute(DmtxSymAttribSymbolRows, sizeIdx);
-   symbolCols = dmtxGetSymbolAttribute(DmtxSymAttribSymbolCols, sizeIdx);
+   DmtxImage *img;
 
-   color = 0;
-   for(i = 0; i < 5; i++) {
+   assert(count > 0 && count <= DmtxModuleLineMax);
 
-      p.X = (1.0/symbolCols) * (symbolCol + sampleX[i]);
-      p.Y = (1.0/symbolRows) * (symbolRow + sampleY[i]);
+   symbolRows = symbol->symbolRows;
+   symbolCols = symbol->symbolCols;
 
-      dmtxMatrix3VMultiplyBy(&p, reg->fit2raw);
+   /* Homogeneous sample coordinates of the first module */
+   for(j = 0; j < 5; j++) {
+      u = (1.0/symbolCols) * (symbolCol + sampleX[j]);
+      v = (1.0/symbolRows) * (symbolRow + sampleY[j]);
+      hx[j] = u * reg->fit2raw[0][0] + v * reg->fit2raw[1][0] + reg->fit2raw[2][0];
+      hy[j] = u * reg->fit2raw[0][1] + v * reg->fit2raw[1][1] + reg->fit2raw[2][1];
+      hw[j] = u * reg->fit2raw[0][2] + v * reg->fit2raw[1][2] + reg->fit2raw[2][2];
+   }
 
-      //fprintf(stdout, "%dx%d\n", (int)(p.X + 0.5), (int)(p.Y + 0.5));
+   /* Change in homogeneous coordinates per module */
+   u = (dir == DmtxDirRight) ? 1.0/symbolCols : (dir == DmtxDirLeft) ? -1.0/symbolCols : 0.0;
+   v = (dir == DmtxDirUp) ? 1.0/symbolRows : (dir == DmtxDirDown) ? -1.0/symbolRows : 0.0;
+   dx = u * reg->fit2raw[0][0] + v * reg->fit2raw[1][0];
+   dy = u * reg->fit2raw[0][1] + v * reg->fit2raw[1][1];
+   dw = u * reg->fit2raw[0][2] + v * reg->fit2raw[1][2];
+
+   img = DecodeScanImage(dec);
+   channel = (dec->plane != NULL) ? 0 : colorPlane;
+   scale = dec->scale;
+   xLimit = (img->width + scale - 1) / scale;
+   yLimit = (img->height + scale - 1) / scale;
+
+   /* Pixel location of every sample, or -1 where it leaves the image */
+   for(i = 0, k = 0; i < count; i++) {
+      for(j = 0; j < 5; j++, k++) {
+         w = hw[j] + i * dw;
+         if(fabs(w) <= DmtxAlmostZero) {
+            x[k] = y[k] = -1;
+            continue;
+         }
+         xRaw = (hx[j] + i * dx) / w + 0.5;
+         yRaw = (hy[j] + i * dy) / w + 0.5;
+         if(xRaw <= -1.0 || xRaw >= xLimit || yRaw <= -1.0 || yRaw >= yLimit)
+            x[k] = y[k] = -1;
+         else {
+            x[k] = (int)xRaw;
+            y[k] = (int)yRaw;
+         }
+      }
+   }
 
-      dmtxDecodeGetPixelValue(dec, (int)(p.X + 0.5), (int)(p.Y + 0.5),
-            colorPlane, &colorTmp);
-      color += colorTmp;
+   for(i = 0, k = 0; i < count; i++) {
+      sum = samples = 0;
+      for(j = 0; j < 5; j++, k++) {
+         if(x[k] == -1)
+            continue;
+         sum += img->fetchPixel(img, x[k] * scale, y[k] * scale, channel);
+         samples++;
+      }
+      color[i] = (samples > 0) ? sum/samples : 0;
    }
-   //fprintf(stdout, "\n");
-   return color/5;
 }
 
 /**
@@ -677,25 +1374,21 @@ ReadModuleColor(DmtxDecode *dec, DmtxRegion *reg, int symbolRow, int symbolCol,
  * \param  image
  * \param  reg
  * \return DmtxPass | DmtxFail
+ *
+ * Sizes near the measured module pitch are tested first, and all of them
+ * are read so the one with the best calibration contrast is verified, the
+ * same rule the full search applies to every size. The two can still pick
+ * differently when a size outside the pruned set has better contrast and
+ * also passes MatrixRegionCheckSize(), i.e. when the jump tallies disagree
+ * with the pitch count by more than 2 modules. perf_test counts how often
+ * that happens. If the pruned sizes fail, every size is searched as before.
  */
 static DmtxPassFail
 MatrixRegionFindSize(DmtxDecode *dec, DmtxRegion *reg)
 {
-   int row, col;
    int sizeIdxBeg, sizeIdxEnd;
-   int sizeIdx, bestSizeIdx;
-   int symbolRows, symbolCols;
-   int jumpCount, errors;
-   int color;
-   int colorOnAvg, bestColorOnAvg;
-   int colorOffAvg, bestColorOffAvg;
-   int contrast, bestContrast;
-//   DmtxImage *img;
-
-//   img = dec->image;
-   bestSizeIdx = DmtxUndefined;
-   bestContrast = 0;
-   bestColorOnAvg = bestColorOffAvg = 0;
+   int sizeIdx, candidateCount;
+   int candidate[DmtxSymbolSquareCount + DmtxSymbolRectCount];
 
    if(dec->sizeIdxExpected == DmtxSymbolShapeAuto) {
       sizeIdxBeg = 0;
@@ -714,35 +1407,47 @@ MatrixRegionFindSize(DmtxDecode *dec, DmtxRegion *reg)
       sizeIdxEnd = dec->sizeIdxExpected + 1;
    }
 
-   /* Test each barcode size to find best contrast in calibration modules */
-   for(sizeIdx = sizeIdxBeg; sizeIdx < sizeIdxEnd; sizeIdx++) {
+   /* Try the sizes matching the measured module pitch before all of them */
+   candidateCount = (sizeIdxEnd - sizeIdxBeg > 1) ?
+         EstimateSizeCandidates(dec, reg, sizeIdxBeg, sizeIdxEnd, candidate) : 0;
+   if(candidateCount > 0 && MatrixRegionBestSize(dec, reg, candidate, candidateCount) == DmtxPass)
+      return DmtxPass;
 
-      symbolRows = dmtxGetSymbolAttribute(DmtxSymAttribSymbolRows, sizeIdx);
-      symbolCols = dmtxGetSymbolAttribute(DmtxSymAttribSymbolCols, sizeIdx);
-      colorOnAvg = colorOffAvg = 0;
+   candidateCount = 0;
+   for(sizeIdx = sizeIdxBeg; sizeIdx < sizeIdxEnd; sizeIdx++)
+      candidate[candidateCount++] = sizeIdx;
 
-      /* Sum module colors along horizontal calibration bar */
-      row = symbolRows - 1;
-      for(col = 0; col < symbolCols; col++) {
-         color = ReadModuleColor(dec, reg, row, col, sizeIdx, reg->flowBegin.plane);
-         if((col & 0x01) != 0x00)
-            colorOffAvg += color;
-         else
-            colorOnAvg += color;
-      }
+   return MatrixRegionBestSize(dec, reg, candidate, candidateCount);
+}
 
-      /* Sum module colors along vertical calibration bar */
-      col = symbolCols - 1;
-      for(row = 0; row < symbolRows; row++) {
-         color = ReadModuleColor(dec, reg, row, col, sizeIdx, reg->flowBegin.plane);
-         if((row & 0x01) != 0x00)
-            colorOffAvg += color;
-         else
-            colorOnAvg += color;
-      }
+/**
+ * \brief  Verify the candidate size with the best calibration contrast
+ * \param  dec
+ * \param  reg
+ * \param  candidate Size indices to compare
+ * \param  candidateCount Number of candidates
+ * \return DmtxPass | DmtxFail
+ *
+ * Every candidate is read; the first one reaching the highest contrast is
+ * the only one passed to MatrixRegionCheckSize().
+ */
+static DmtxPassFail
+MatrixRegionBestSize(DmtxDecode *dec, DmtxRegion *reg, const int *candidate, int candidateCount)
+{
+   int i, sizeIdx, bestSizeIdx;
+   int colorOnAvg, bestColorOnAvg;
+   int colorOffAvg, bestColorOffAvg;
+   int contrast, bestContrast;
+
+   bestSizeIdx = DmtxUndefined;
+   bestContrast = 0;
+   bestColorOnAvg = bestColorOffAvg = 0;
 
-      colorOnAvg = (colorOnAvg * 2)/(symbolRows + symbolCols);
-      colorOffAvg = (colorOffAvg * 2)/(symbolRows + symbolCols);
+   /* Test each barcode size to find best contrast in calibration modules */
+   for(i = 0; i < candidateCount; i++) {
+      sizeIdx = candidate[i];
+
+      ReadCalibrationColors(dec, reg, dmtxGetSymbolDescriptor(sizeIdx), &colorOnAvg, &colorOffAvg);
 
       contrast = abs(colorOnAvg - colorOffAvg);
       if(contrast < 20)
@@ -760,14 +1465,247 @@ MatrixRegionFindSize(DmtxDecode *dec, DmtxRegion *reg)
    if(bestSizeIdx == DmtxUndefined || bestContrast < 20)
       return DmtxFail;
 
-   reg->sizeIdx = bestSizeIdx;
-   reg->onColor = bestColorOnAvg;
-   reg->offColor = bestColorOffAvg;
+   return MatrixRegionCheckSize(dec, reg, bestSizeIdx, bestColorOnAvg, bestColorOffAvg);
+}
+
+/**
+ * \brief  Narrow the symbol sizes worth testing using the module pitch
+ * \param  dec
+ * \param  reg
+ * \param  sizeIdxBeg First size index allowed
+ * \param  sizeIdxEnd One past the last size index allowed
+ * \param  candidate Receives up to DmtxPitchCandidateMax size indices, closest first
+ * \return Number of candidates, or 0 if the pitch could not be measured
+ *
+ * A first count is taken 1.5 pixels inside the outer edges, which lies on
+ * the calibration bars whenever modules are at least 3 pixels wide. Each bar
+ * is then counted again through the module centers implied by the other.
+ * Sizes within 2 modules of both counts are kept, as MatrixRegionCheckSize()
+ * tolerates that much.
+ */
+static int
+EstimateSizeCandidates(DmtxDecode *dec, DmtxRegion *reg, int sizeIdxBeg, int sizeIdxEnd, int *candidate)
+{
+   int i, sizeIdx, count;
+   int rows, cols, rowsEst, colsEst;
+   int dist, distance[DmtxPitchCandidateMax];
+   double width, height;
+   DmtxVector2 p00, p10, p11, p01;
+
+   p00.X = p01.X = 0.0;
+   p10.X = p11.X = 1.0;
+   p00.Y = p10.Y = 0.0;
+   p01.Y = p11.Y = 1.0;
+   dmtxMatrix3VMultiplyBy(&p00, reg->fit2raw);
+   dmtxMatrix3VMultiplyBy(&p10, reg->fit2raw);
+   dmtxMatrix3VMultiplyBy(&p11, reg->fit2raw);
+   dmtxMatrix3VMultiplyBy(&p01, reg->fit2raw);
+
+   /* Side lengths in pixels, taking the shorter of each opposite pair */
+   width = min(hypot(p10.X - p00.X, p10.Y - p00.Y), hypot(p11.X - p01.X, p11.Y - p01.Y));
+   height = min(hypot(p01.X - p00.X, p01.Y - p00.Y), hypot(p11.X - p10.X, p11.Y - p10.Y));
+   if(width < 1.0 || height < 1.0)
+      return 0;
+
+   colsEst = CountBarModules(dec, reg, DmtxDirRight, 1.5/height);
+   rowsEst = CountBarModules(dec, reg, DmtxDirUp, 1.5/width);
+   if(colsEst == DmtxUndefined || rowsEst == DmtxUndefined)
+      return 0;
+
+   cols = CountBarModules(dec, reg, DmtxDirRight, 0.5/rowsEst);
+   rows = CountBarModules(dec, reg, DmtxDirUp, 0.5/colsEst);
+   if(cols == DmtxUndefined || rows == DmtxUndefined)
+      return 0;
+   colsEst = cols;
+   rowsEst = rows;
+
+   /* Keep the closest sizes, earlier sizes first on ties */
+   count = 0;
+   for(sizeIdx = sizeIdxBeg; sizeIdx < sizeIdxEnd; sizeIdx++) {
+      rows = dmtxGetSymbolDescriptor(sizeIdx)->symbolRows;
+      cols = dmtxGetSymbolDescriptor(sizeIdx)->symbolCols;
+      if(abs(rows - rowsEst) > 2 || abs(cols - colsEst) > 2)
+         continue;
+
+      dist = abs(rows - rowsEst) + abs(cols - colsEst);
+      if(count == DmtxPitchCandidateMax && dist >= distance[count - 1])
+         continue;
+
+      if(count < DmtxPitchCandidateMax)
+         count++;
+      for(i = count - 1; i > 0 && dist < distance[i - 1]; i--) {
+         distance[i] = distance[i - 1];
+         candidate[i] = candidate[i - 1];
+      }
+      distance[i] = dist;
+      candidate[i] = sizeIdx;
+   }
+
+   return count;
+}
+
+/**
+ * \brief  Count the modules of a calibration bar from its light/dark transitions
+ * \param  dec
+ * \param  reg
+ * \param  dir DmtxDirRight for the top bar, DmtxDirUp for the right bar
+ * \param  depth Distance of the sampled line inside the outer edge, in fitted units
+ * \return Module count, or DmtxUndefined if the bar could not be read
+ *
+ * Calibration bars alternate one module on and one off, starting on and
+ * ending off, so a bar of n modules has n - 1 transitions. The bar is
+ * sampled once per pixel and thresholded with hysteresis against noise.
+ */
+static int
+CountBarModules(DmtxDecode *dec, DmtxRegion *reg, DmtxDirection dir, double depth)
+{
+   int i, n;
+   int xLimit, yLimit, scale, channel;
+   int lo, hi, mid, hysteresis, dark, transitions;
+   int value[DmtxPitchSamplesMax];
+   double t;
+   DmtxVector2 p0, p1, p;
+   DmtxImage *img;
+
+   if(depth <= 0.0 || depth >= 0.5)
+      return DmtxUndefined;
+
+   p0.X = (dir == DmtxDirRight) ? 0.0 : 1.0 - depth;
+   p0.Y = (dir == DmtxDirRight) ? 1.0 - depth : 0.0;
+   p1.X = (dir == DmtxDirRight) ? 1.0 : 1.0 - depth;
+   p1.Y = (dir == DmtxDirRight) ? 1.0 - depth : 1.0;
+
+   p = p0;
+   if(dmtxMatrix3VMultiplyBy(&p, reg->fit2raw) == DmtxFail ||
+         dmtxMatrix3VMultiplyBy(&p1, reg->fit2raw) == DmtxFail)
+      return DmtxUndefined;
+
+   /* Smallest symbols need 2 pixels per module to be counted at all */
+   n = (int)hypot(p1.X - p.X, p1.Y - p.Y);
+   if(n < 20)
+      return DmtxUndefined;
+   n = min(n, DmtxPitchSamplesMax);
+
+   img = DecodeScanImage(dec);
+   channel = (dec->plane != NULL) ? 0 : reg->flowBegin.plane;
+   scale = dec->scale;
+   xLimit = (img->width + scale - 1) / scale;
+   yLimit = (img->height + scale - 1) / scale;
+
+   lo = INT_MAX;
+   hi = INT_MIN;
+   for(i = 0; i < n; i++) {
+      t = (i + 0.5) / n;
+      p.X = (dir == DmtxDirRight) ? t : p0.X;
+      p.Y = (dir == DmtxDirRight) ? p0.Y : t;
+      if(dmtxMatrix3VMultiplyBy(&p, reg->fit2raw) == DmtxFail)
+         return DmtxUndefined;
+
+      p.X += 0.5;
+      p.Y += 0.5;
+      if(p.X < 0.0 || p.X >= xLimit || p.Y < 0.0 || p.Y >= yLimit)
+         return DmtxUndefined;
+
+      value[i] = img->fetchPixel(img, (int)p.X * scale, (int)p.Y * scale, channel);
+      lo = min(lo, value[i]);
+      hi = max(hi, value[i]);
+   }
+
+   if(hi - lo < 20)
+      return DmtxUndefined;
+
+   mid = (lo + hi)/2;
+   hysteresis = (hi - lo)/8;
+
+   dark = (value[0] < mid) ? 1 : 0;
+   transitions = 0;
+   for(i = 1; i < n; i++) {
+      if(dark == 1 && value[i] > mid + hysteresis) {
+         dark = 0;
+         transitions++;
+      }
+      else if(dark == 0 && value[i] < mid - hysteresis) {
+         dark = 1;
+         transitions++;
+      }
+   }
+
+   return transitions + 1;
+}
+
+/**
+ * \brief  Average the on and off module colors of the calibration bars
+ * \param  dec
+ * \param  reg
+ * \param  symbol Descriptor of the symbol size assumed when locating modules
+ * \param  colorOnAvg Set to the average color of modules expected on
+ * \param  colorOffAvg Set to the average color of modules expected off
+ * \return void
+ */
+static void
+ReadCalibrationColors(DmtxDecode *dec, DmtxRegion *reg, const DmtxSymbolDescriptor *symbol,
+      int *colorOnAvg, int *colorOffAvg)
+{
+   int row, col;
+   int symbolRows, symbolCols;
+   int color;
+   int colors[DmtxModuleLineMax];
+
+   symbolRows = symbol->symbolRows;
+   symbolCols = symbol->symbolCols;
+   *colorOnAvg = *colorOffAvg = 0;
+
+   /* Sum module colors along horizontal calibration bar */
+   ReadModuleColorLine(dec, reg, symbolRows - 1, 0, symbol, reg->flowBegin.plane,
+         DmtxDirRight, symbolCols, colors);
+   for(col = 0; col < symbolCols; col++) {
+      color = colors[col];
+      if((col & 0x01) != 0x00)
+         *colorOffAvg += color;
+      else
+         *colorOnAvg += color;
+   }
+
+   /* Sum module colors along vertical calibration bar */
+   ReadModuleColorLine(dec, reg, 0, symbolCols - 1, symbol, reg->flowBegin.plane,
+         DmtxDirUp, symbolRows, colors);
+   for(row = 0; row < symbolRows; row++) {
+      color = colors[row];
+      if((row & 0x01) != 0x00)
+         *colorOffAvg += color;
+      else
+         *colorOnAvg += color;
+   }
+
+   *colorOnAvg = (*colorOnAvg * 2)/(symbolRows + symbolCols);
+   *colorOffAvg = (*colorOffAvg * 2)/(symbolRows + symbolCols);
+}
+
+/**
+ * \brief  Assign a symbol size to a region and verify its finder, calibration
+ *         and quiet zone modules
+ * \param  dec
+ * \param  reg
+ * \param  sizeIdx
+ * \param  colorOnAvg Average color of on modules from ReadCalibrationColors()
+ * \param  colorOffAvg Average color of off modules from ReadCalibrationColors()
+ * \return DmtxPass | DmtxFail
+ */
+static DmtxPassFail
+MatrixRegionCheckSize(DmtxDecode *dec, DmtxRegion *reg, int sizeIdx, int colorOnAvg, int colorOffAvg)
+{
+   int jumpCount, errors;
+   const DmtxSymbolDescriptor *symbol;
+
+   reg->sizeIdx = sizeIdx;
+   reg->onColor = colorOnAvg;
+   reg->offColor = colorOffAvg;
 
-   reg->symbolRows = dmtxGetSymbolAttribute(DmtxSymAttribSymbolRows, reg->sizeIdx);
-   reg->symbolCols = dmtxGetSymbolAttribute(DmtxSymAttribSymbolCols, reg->sizeIdx);
-   reg->mappingRows = dmtxGetSymbolAttribute(DmtxSymAttribMappingMatrixRows, reg->sizeIdx);
-   reg->mappingCols = dmtxGetSymbolAttribute(DmtxSymAttribMappingMatrixCols, reg->sizeIdx);
+   symbol = dmtxGetSymbolDescriptor(sizeIdx);
+   reg->symbolRows = symbol->symbolRows;
+   reg->symbolCols = symbol->symbolCols;
+   reg->mappingRows = symbol->mappingRows;
+   reg->mappingCols = symbol->mappingCols;
 
    /* Tally jumps on horizontal calibration bar to verify sizeIdx */
    jumpCount = CountJumpTally(dec, reg, 0, reg->symbolRows - 1, DmtxDirRight);
@@ -823,22 +1761,18 @@ MatrixRegionFindSize(DmtxDecode *dec, DmtxRegion *reg)
 static int
 CountJumpTally(DmtxDecode *dec, DmtxRegion *reg, int xStart, int yStart, DmtxDirection dir)
 {
-   int x, xInc = 0;
-   int y, yInc = 0;
+   int i, count;
    int state = DmtxModuleOn;
    int jumpCount = 0;
    int jumpThreshold;
    int tModule, tPrev;
    int darkOnLight;
-   int color;
+   int colors[DmtxModuleLineMax];
 
    assert(xStart == 0 || yStart == 0);
    assert(dir == DmtxDirRight || dir == DmtxDirUp);
 
-   if(dir == DmtxDirRight)
-      xInc = 1;
-   else
-      yInc = 1;
+   count = (dir == DmtxDirRight) ? reg->symbolCols - xStart : reg->symbolRows - yStart;
 
    if(xStart == -1 || xStart == reg->symbolCols ||
          yStart == -1 || yStart == reg->symbolRows)
@@ -846,17 +1780,14 @@ CountJumpTally(DmtxDecode *dec, DmtxRegion *reg, int xStart, int yStart, DmtxDir
 
    darkOnLight = (int)(reg->offColor > reg->onColor);
    jumpThreshold = abs((int)(0.4 * (reg->onColor - reg->offColor) + 0.5));
-   color = ReadModuleColor(dec, reg, yStart, xStart, reg->sizeIdx, reg->flowBegin.plane);
-   tModule = (darkOnLight) ? reg->offColor - color : color - reg->offColor;
+   ReadModuleColorLine(dec, reg, yStart, xStart, dmtxGetSymbolDescriptor(reg->sizeIdx), reg->flowBegin.plane,
+         dir, count, colors);
+   tModule = (darkOnLight) ? reg->offColor - colors[0] : colors[0] - reg->offColor;
 
-   for(x = xStart + xInc, y = yStart + yInc;
-         (dir == DmtxDirRight && x < reg->symbolCols) ||
-         (dir == DmtxDirUp && y < reg->symbolRows);
-         x += xInc, y += yInc) {
+   for(i = 1; i < count; i++) {
 
       tPrev = tModule;
-      color = ReadModuleColor(dec, reg, y, x, reg->sizeIdx, reg->flowBegin.plane);
-      tModule = (darkOnLight) ? reg->offColor - color : color - reg->offColor;
+      tModule = (darkOnLight) ? reg->offColor - colors[i] : colors[i] - reg->offColor;
 
       if(state == DmtxModuleOff) {
          if(tModule > tPrev + jumpThreshold) {
@@ -876,29 +1807,51 @@ CountJumpTally(DmtxDecode *dec, DmtxRegion *reg, int xStart, int yStart, DmtxDir
 }
 
 /**
- *
- *
+ * \brief  Return the flow at a pixel, consulting the flow cache when enabled
+ * \param  dec
+ * \param  colorPlane
+ * \param  loc
+ * \param  arrive
+ * \return Point flow
  */
 static DmtxPointFlow
 GetPointFlow(DmtxDecode *dec, int colorPlane, DmtxPixelLoc loc, int arrive)
+{
+   if(dec->flowCache != NULL)
+      return FlowCacheGetPointFlow(dec, colorPlane, loc, arrive);
+
+   return ComputePointFlow(dec, colorPlane, loc, arrive);
+}
+
+/**
+ * \brief  Compute the strongest compass flow at a pixel
+ * \param  dec
+ * \param  colorPlane
+ * \param  loc
+ * \param  arrive
+ * \return Point flow, or dmtxBlankEdge if a neighbor falls outside the image
+ */
+static DmtxPointFlow
+ComputePointFlow(DmtxDecode *dec, int colorPlane, DmtxPixelLoc loc, int arrive)
 {
    static const int coefficient[] = {  0,  1,  2,  1,  0, -1, -2, -1 };
-   int err;
    int patternIdx, coefficientIdx;
    int compass, compassMax;
    int mag[4] = { 0 };
-   int xAdjust, yAdjust;
+   int scale;
    int color, colorPattern[8];
+   DmtxImage *img;
    DmtxPointFlow flow;
 
-   for(patternIdx = 0; patternIdx < 8; patternIdx++) {
-      xAdjust = loc.X + dmtxPatternX[patternIdx];
-      yAdjust = loc.Y + dmtxPatternY[patternIdx];
-      err = dmtxDecodeGetPixelValue(dec, xAdjust, yAdjust, colorPlane,
-            &colorPattern[patternIdx]);
-      if(err == DmtxFail)
-         return dmtxBlankEdge;
-   }
+   img = DecodeScanImage(dec);
+
+   /* All 8 neighbors must fall inside the image */
+   scale = dec->scale;
+   if((loc.X - 1) * scale < 0 || (loc.X + 1) * scale >= img->width ||
+         (loc.Y - 1) * scale < 0 || (loc.Y + 1) * scale >= img->height)
+      return dmtxBlankEdge;
+
+   img->fetchCompass(img, loc.X * scale, loc.Y * scale, scale, colorPlane, colorPattern);
 
    /* Calculate this pixel's flow intensity for each direction (-45, 0, 45, 90) */
    compassMax = 0;
@@ -955,7 +1908,7 @@ FindStrongestNeighbor(DmtxDecode *dec, DmtxPointFlow center, int sign)
    int strongIdx;
    int attempt, attemptDiff;
    int occupied;
-   unsigned char *cache;
+   int cache;
    DmtxPixelLoc loc;
    DmtxPointFlow flow[8];
 
@@ -968,11 +1921,11 @@ FindStrongestNeighbor(DmtxDecode *dec, DmtxPointFlow center, int sign)
       loc.X = center.loc.X + dmtxPatternX[i];
       loc.Y = center.loc.Y + dmtxPatternY[i];
 
-      cache = dmtxDecodeGetCache(dec, loc.X, loc.Y);
-      if(cache == NULL)
+      cache = ScanCacheRead(dec->cache, loc.X, loc.Y);
+      if(cache == DmtxUndefined)
          continue;
 
-      if((int)(*cache & 0x80) != 0x00) {
+      if((cache & 0x80) != 0x00) {
          if(++occupied > 2)
             return dmtxBlankEdge;
          else
@@ -997,127 +1950,108 @@ FindStrongestNeighbor(DmtxDecode *dec, DmtxPointFlow center, int sign)
 }
 
 /**
- *
- *
+ * \brief  Empty the trail workspace and record its first point
+ * \param  dec
+ * \param  loc
+ * \return DmtxPass | DmtxFail
  */
-static DmtxFollow
-FollowSeek(DmtxDecode *dec, DmtxRegion *reg, int seek)
+static DmtxPassFail
+TrailStart(DmtxDecode *dec, DmtxPixelLoc loc)
 {
-   int i;
-   int sign;
-   DmtxFollow follow;
-
-   follow.loc = reg->flowBegin.loc;
-   follow.step = 0;
-   follow.ptr = dmtxDecodeGetCache(dec, follow.loc.X, follow.loc.Y);
-   assert(follow.ptr != NULL);
-   follow.neighbor = *follow.ptr;
-
-   sign = (seek > 0) ? +1 : -1;
-   for(i = 0; i != seek; i += sign) {
-      follow = FollowStep(dec, reg, follow, sign);
-      assert(follow.ptr != NULL);
-      assert(abs(follow.step) <= reg->stepsTotal);
-   }
+   if(dec->trail != NULL)
+      dec->trail->count = 0;
 
-   return follow;
+   return TrailPush(dec, loc);
 }
 
 /**
- *
- *
+ * \brief  Append a point to the trail workspace, growing it if needed
+ * \param  dec
+ * \param  loc
+ * \return DmtxPass | DmtxFail
  */
-static DmtxFollow
-FollowSeekLoc(DmtxDecode *dec, DmtxPixelLoc loc)
+static DmtxPassFail
+TrailPush(DmtxDecode *dec, DmtxPixelLoc loc)
 {
-   DmtxFollow follow;
+   int capacity;
+   DmtxTrail *trail;
+   DmtxPixelLoc *grown;
 
-   follow.loc = loc;
-   follow.step = 0;
-   follow.ptr = dmtxDecodeGetCache(dec, follow.loc.X, follow.loc.Y);
-   assert(follow.ptr != NULL);
-   follow.neighbor = *follow.ptr;
+   if(dec->trail == NULL) {
+      dec->trail = (DmtxTrail *)MemCalloc(1, sizeof(DmtxTrail));
+      if(dec->trail == NULL)
+         return DmtxFail;
+   }
+   trail = dec->trail;
 
-   return follow;
-}
+   if(trail->count == trail->capacity) {
+      capacity = (trail->capacity == 0) ? 256 : trail->capacity * 2;
+      grown = (DmtxPixelLoc *)MemAlloc(capacity * sizeof(DmtxPixelLoc));
+      if(grown == NULL)
+         return DmtxFail;
+      if(trail->count > 0)
+         memcpy(grown, trail->loc, trail->count * sizeof(DmtxPixelLoc));
+      MemFree(trail->loc);
+      trail->loc = grown;
+      trail->capacity = capacity;
+   }
 
+   trail->loc[trail->count++] = loc;
+
+   return DmtxPass;
+}
 
 /**
+ * \brief  Location of a step along the continuous trail of a region
+ * \param  dec
+ * \param  reg Region whose trail is in the workspace
+ * \param  step Steps from the trail start, negative for downstream
+ * \return Trail location
  *
- *
+ * The trail is a loop of stepsTotal + 1 points: positive steps climb the
+ * upstream branch to finalPos, jump to finalNeg and return down the other
+ * branch to the start. TrailBlazeContinuous() stores the points in that
+ * order, so any step wraps onto its index.
  */
-static DmtxFollow
-FollowStep(DmtxDecode *dec, DmtxRegion *reg, DmtxFollow followBeg, int sign)
+static DmtxPixelLoc
+TrailLoc(DmtxDecode *dec, DmtxRegion *reg, int step)
 {
-   int patternIdx;
-   int stepMod;
-   int factor;
-   DmtxFollow follow;
-
-   assert(abs(sign) == 1);
-   assert((int)(followBeg.neighbor & 0x40) != 0x00);
+   int count;
 
-   factor = reg->stepsTotal + 1;
-   if(sign > 0)
-      stepMod = (factor + (followBeg.step % factor)) % factor;
-   else
-      stepMod = (factor - (followBeg.step % factor)) % factor;
-
-   /* End of positive trail -- magic jump */
-   if(sign > 0 && stepMod == reg->jumpToNeg) {
-      follow.loc = reg->finalNeg;
-   }
-   /* End of negative trail -- magic jump */
-   else if(sign < 0 && stepMod == reg->jumpToPos) {
-      follow.loc = reg->finalPos;
-   }
-   /* Trail in progress -- normal jump */
-   else {
-      patternIdx = (sign < 0) ? followBeg.neighbor & 0x07 : ((followBeg.neighbor & 0x38) >> 3);
-      follow.loc.X = followBeg.loc.X + dmtxPatternX[patternIdx];
-      follow.loc.Y = followBeg.loc.Y + dmtxPatternY[patternIdx];
-   }
+   count = reg->stepsTotal + 1;
+   assert(dec->trail != NULL && dec->trail->count == count);
 
-   follow.step = followBeg.step + sign;
-   follow.ptr = dmtxDecodeGetCache(dec, follow.loc.X, follow.loc.Y);
-   assert(follow.ptr != NULL);
-   follow.neighbor = *follow.ptr;
+   step %= count;
+   if(step < 0)
+      step += count;
 
-   return follow;
+   return dec->trail->loc[step];
 }
 
 /**
- *
- *
+ * \brief  Free a trail workspace
+ * \param  trail
+ * \return void
  */
-static DmtxFollow
-FollowStep2(DmtxDecode *dec, DmtxFollow followBeg, int sign)
+static void
+TrailDestroy(DmtxTrail **trail)
 {
-   int patternIdx;
-   DmtxFollow follow;
-
-   assert(abs(sign) == 1);
-   assert((int)(followBeg.neighbor & 0x40) != 0x00);
-
-   patternIdx = (sign < 0) ? followBeg.neighbor & 0x07 : ((followBeg.neighbor & 0x38) >> 3);
-   follow.loc.X = followBeg.loc.X + dmtxPatternX[patternIdx];
-   follow.loc.Y = followBeg.loc.Y + dmtxPatternY[patternIdx];
+   if(trail == NULL || *trail == NULL)
+      return;
 
-   follow.step = followBeg.step + sign;
-   follow.ptr = dmtxDecodeGetCache(dec, follow.loc.X, follow.loc.Y);
-   assert(follow.ptr != NULL);
-   follow.neighbor = *follow.ptr;
+   MemFree((*trail)->loc);
+   MemFree(*trail);
 
-   return follow;
+   *trail = NULL;
 }
 
 /**
- * vaiiiooo
- * --------
- * 0x80 v = visited bit
- * 0x40 a = assigned bit
- * 0x38 u = 3 bits points upstream 0-7
- * 0x07 d = 3 bits points downstream 0-7
+ * Scan cache bits of a trail location
+ * -----------------------------------
+ * 0x80 visited bit, cleared again once the trail is complete
+ * 0x40 assigned bit, kept while the location belongs to a region
+ *
+ * The trail itself is kept as a point array in dec->trail (see TrailLoc()).
  */
 static DmtxPassFail
 TrailBlazeContinuous(DmtxDecode *dec, DmtxRegion *reg, DmtxPointFlow flowBegin, int maxDiagonal)
@@ -1125,23 +2059,25 @@ TrailBlazeContinuous(DmtxDecode *dec, DmtxRegion *reg, DmtxPointFlow flowBegin,
    int posAssigns, negAssigns, clears;
    int sign;
    int steps;
-   unsigned char *cache, *cacheNext, *cacheBeg;
+   int i, j;
+   unsigned char *cacheNext, *cacheBeg;
+   DmtxPassFail err;
    DmtxPointFlow flow, flowNext;
-   DmtxPixelLoc boundMin, boundMax;
+   DmtxPixelLoc boundMin, boundMax, locTmp;
 
    boundMin = boundMax = flowBegin.loc;
    cacheBeg = dmtxDecodeGetCache(dec, flowBegin.loc.X, flowBegin.loc.Y);
-   if(cacheBeg == NULL)
+   if(cacheBeg == NULL || TrailStart(dec, flowBegin.loc) == DmtxFail)
       return DmtxFail;
    *cacheBeg = (0x80 | 0x40); /* Mark location as visited and assigned */
 
    reg->flowBegin = flowBegin;
 
+   err = DmtxPass;
    posAssigns = negAssigns = 0;
    for(sign = 1; sign >= -1; sign -= 2) {
 
       flow = flowBegin;
-      cache = cacheBeg;
 
       for(steps = 0; ; steps++) {
 
@@ -1160,21 +2096,16 @@ TrailBlazeContinuous(DmtxDecode *dec, DmtxRegion *reg, DmtxPointFlow flowBegin,
             break;
          assert(!(*cacheNext & 0x80));
 
-         /* Mark departure from current location. If flowing downstream
-          * (sign < 0) then departure vector here is the arrival vector
-          * of the next location. Upstream flow uses the opposite rule. */
-         *cache |= (sign < 0) ? flowNext.arrive : flowNext.arrive << 3;
+         if(TrailPush(dec, flowNext.loc) == DmtxFail) {
+            err = DmtxFail;
+            break;
+         }
 
-         /* Mark known direction for next location */
-         /* If testing downstream (sign < 0) then next upstream is opposite of next arrival */
-         /* If testing upstream (sign > 0) then next downstream is opposite of next arrival */
-         *cacheNext = (sign < 0) ? (((flowNext.arrive + 4)%8) << 3) : ((flowNext.arrive + 4)%8);
-         *cacheNext |= (0x80 | 0x40); /* Mark location as visited and assigned */
+         *cacheNext = (0x80 | 0x40); /* Mark location as visited and assigned */
          if(sign > 0)
             posAssigns++;
          else
             negAssigns++;
-         cache = cacheNext;
          flow = flowNext;
 
          if(flow.loc.X > boundMax.X)
@@ -1202,9 +2133,20 @@ TrailBlazeContinuous(DmtxDecode *dec, DmtxRegion *reg, DmtxPointFlow flowBegin,
    reg->boundMin = boundMin;
    reg->boundMax = boundMax;
 
+   /* Downstream points were appended outward; the loop returns inward */
+   for(i = reg->jumpToNeg + 1, j = reg->stepsTotal; i < j; i++, j--) {
+      locTmp = dec->trail->loc[i];
+      dec->trail->loc[i] = dec->trail->loc[j];
+      dec->trail->loc[j] = locTmp;
+   }
+
    /* Clear "visited" bit from trail */
-   clears = TrailClear(dec, reg, 0x80);
+   clears = TrailClear(dec, 0x80);
    assert(posAssigns + negAssigns == clears - 1);
+   assert(clears == reg->stepsTotal + 1);
+
+   if(err == DmtxFail)
+      return DmtxFail;
 
    /* XXX clean this up ... redundant test above */
    if(maxDiagonal != DmtxUndefined && (boundMax.X - boundMin.X > maxDiagonal ||
@@ -1228,12 +2170,10 @@ TrailBlazeGapped(DmtxDecode *dec, DmtxRegion *reg, DmtxBresLine line, int stream
    int travel, outward;
    int xDiff, yDiff;
    int steps;
-   int stepDir, dirMap[] = { 0, 1, 2, 7, 8, 3, 6, 5, 4 };
    DmtxPassFail err;
    DmtxPixelLoc beforeStep, afterStep;
    DmtxPointFlow flow, flowNext;
    DmtxPixelLoc loc0;
-   int xStep, yStep;
 
    loc0 = line.loc;
    flow = GetPointFlow(dec, reg->flowBegin.plane, loc0, dmtxNeighborNone);
@@ -1243,7 +2183,7 @@ TrailBlazeGapped(DmtxDecode *dec, DmtxRegion *reg, DmtxBresLine line, int stream
 
    beforeStep = loc0;
    beforeCache = dmtxDecodeGetCache(dec, loc0.X, loc0.Y);
-   if(beforeCache == NULL)
+   if(beforeCache == NULL || TrailStart(dec, loc0) == DmtxFail)
       return DmtxFail;
    else
       *beforeCache = 0x00; /* probably should just overwrite one direction */
@@ -1275,24 +2215,13 @@ TrailBlazeGapped(DmtxDecode *dec, DmtxRegion *reg, DmtxBresLine line, int stream
 
       afterStep = line.loc;
       afterCache = dmtxDecodeGetCache(dec, afterStep.X, afterStep.Y);
-      if(afterCache == NULL)
+      if(afterCache == NULL || TrailPush(dec, afterStep) == DmtxFail)
          break;
 
-      /* Determine step direction using pure magic */
-      xStep = afterStep.X - beforeStep.X;
-      yStep = afterStep.Y - beforeStep.Y;
-      assert(abs(xStep) <= 1 && abs(yStep) <= 1);
-      stepDir = dirMap[3 * yStep + xStep + 4];
-      assert(stepDir != 8);
+      assert(abs(afterStep.X - beforeStep.X) <= 1 && abs(afterStep.Y - beforeStep.Y) <= 1);
 
-      if(streamDir < 0) {
-         *beforeCache |= (0x40 | stepDir);
-         *afterCache = (((stepDir + 4)%8) << 3);
-      }
-      else {
-         *beforeCache |= (0x40 | (stepDir << 3));
-         *afterCache = ((stepDir + 4)%8);
-      }
+      *beforeCache |= 0x40;
+      *afterCache = 0x00;
 
       /* Guaranteed to have taken one step since top of loop */
       xDiff = line.loc.X - loc0.X;
@@ -1309,28 +2238,29 @@ TrailBlazeGapped(DmtxDecode *dec, DmtxRegion *reg, DmtxBresLine line, int stream
 }
 
 /**
- *
- *
+ * \brief  Clear scan cache bits along the trail in the workspace
+ * \param  dec
+ * \param  clearMask Bits to clear, each expected to be set at every point
+ * \return Number of trail points cleared
  */
 static int
-TrailClear(DmtxDecode *dec, DmtxRegion *reg, int clearMask)
+TrailClear(DmtxDecode *dec, int clearMask)
 {
-   int clears;
-   DmtxFollow follow;
+   int i, count;
+   unsigned char *cache;
 
    assert((clearMask | 0xff) == 0xff);
 
-   /* Clear "visited" bit from trail */
-   clears = 0;
-   follow = FollowSeek(dec, reg, 0);
-   while(abs(follow.step) <= reg->stepsTotal) {
-      assert((int)(*follow.ptr & clearMask) != 0x00);
-      *follow.ptr &= (clearMask ^ 0xff);
-      follow = FollowStep(dec, reg, follow, +1);
-      clears++;
+   count = (dec->trail == NULL) ? 0 : dec->trail->count;
+
+   for(i = 0; i < count; i++) {
+      cache = dmtxDecodeGetCache(dec, dec->trail->loc[i].X, dec->trail->loc[i].Y);
+      assert(cache != NULL);
+      assert((int)(*cache & clearMask) != 0x00);
+      *cache &= (clearMask ^ 0xff);
    }
 
-   return clears;
+   return count;
 }
 
 /**
@@ -1340,26 +2270,16 @@ TrailClear(DmtxDecode *dec, DmtxRegion *reg, int clearMask)
 static DmtxBestLine
 FindBestSolidLine(DmtxDecode *dec, DmtxRegion *reg, int step0, int step1, int streamDir, int houghAvoid)
 {
-   int hough[3][DMTX_HOUGH_RES] = { { 0 } };
-   int houghMin, houghMax;
-   char houghTest[DMTX_HOUGH_RES];
-   int i;
    int step;
    int sign;
    int tripSteps;
-   int angleBest;
-   int hOffset, hOffsetBest;
-   int xDiff, yDiff;
-   int dH;
+   DmtxHough hough;
    DmtxRay2 rH;
-   DmtxFollow follow;
    DmtxBestLine line;
-   DmtxPixelLoc rHp;
+   DmtxPixelLoc loc, rHp;
 
    memset(&line, 0x00, sizeof(DmtxBestLine));
    memset(&rH, 0x00, sizeof(DmtxRay2));
-   angleBest = 0;
-   hOffset = hOffsetBest = 0;
 
    sign = 0;
 
@@ -1386,69 +2306,27 @@ FindBestSolidLine(DmtxDecode *dec, DmtxRegion *reg, int step0, int step1, int st
    }
    assert(sign == streamDir);
 
-   follow = FollowSeek(dec, reg, step0);
-   rHp = follow.loc;
+   rHp = TrailLoc(dec, reg, step0);
 
    line.stepBeg = line.stepPos = line.stepNeg = step0;
-   line.locBeg = follow.loc;
-   line.locPos = follow.loc;
-   line.locNeg = follow.loc;
+   line.locBeg = rHp;
+   line.locPos = rHp;
+   line.locNeg = rHp;
 
-   /* Predetermine which angles to test */
-   for(i = 0; i < DMTX_HOUGH_RES; i++) {
-      if(houghAvoid == DmtxUndefined) {
-         houghTest[i] = 1;
-      }
-      else {
-         houghMin = (houghAvoid + DMTX_HOUGH_RES/6) % DMTX_HOUGH_RES;
-         houghMax = (houghAvoid - DMTX_HOUGH_RES/6 + DMTX_HOUGH_RES) % DMTX_HOUGH_RES;
-         if(houghMin > houghMax)
-            houghTest[i] = (i > houghMin || i < houghMax) ? 1 : 0;
-         else
-            houghTest[i] = (i > houghMin && i < houghMax) ? 1 : 0;
-      }
-   }
+   HoughInit(&hough, houghAvoid);
 
    /* Test each angle for steps along path */
    for(step = 0; step < tripSteps; step++) {
 
-      xDiff = follow.loc.X - rHp.X;
-      yDiff = follow.loc.Y - rHp.Y;
-
-      /* Increment Hough accumulator */
-      for(i = 0; i < DMTX_HOUGH_RES; i++) {
-
-         if((int)houghTest[i] == 0)
-            continue;
-
-         dH = (rHvX[i] * yDiff) - (rHvY[i] * xDiff);
-         if(dH >= -384 && dH <= 384) {
-
-            if(dH > 128)
-               hOffset = 2;
-            else if(dH >= -128)
-               hOffset = 1;
-            else
-               hOffset = 0;
+      loc = TrailLoc(dec, reg, step0 + step * sign);
+      hough.kernel(&hough, loc.X - rHp.X, loc.Y - rHp.Y);
 
-            hough[hOffset][i]++;
-
-            /* New angle takes over lead */
-            if(hough[hOffset][i] > hough[hOffsetBest][angleBest]) {
-               angleBest = i;
-               hOffsetBest = hOffset;
-            }
-         }
-      }
-
-/*    CALLBACK_POINT_PLOT(follow.loc, (sign > 1) ? 4 : 3, 1, 2); */
-
-      follow = FollowStep(dec, reg, follow, sign);
+/*    CALLBACK_POINT_PLOT(loc, (sign > 1) ? 4 : 3, 1, 2); */
    }
 
-   line.angle = angleBest;
-   line.hOffset = hOffsetBest;
-   line.mag = hough[hOffsetBest][angleBest];
+   line.angle = hough.angleBest;
+   line.hOffset = hough.offsetBest;
+   line.mag = hough.mag;
 
    return line;
 }
@@ -1458,87 +2336,73 @@ FindBestSolidLine(DmtxDecode *dec, DmtxRegion *reg, int step0, int step1, int st
  *
  */
 static DmtxBestLine
-FindBestSolidLine2(DmtxDecode *dec, DmtxPixelLoc loc0, int tripSteps, int sign, int houghAvoid)
+FindBestSolidLine2(DmtxDecode *dec, DmtxPixelLoc loc0, int tripSteps, int houghAvoid)
 {
-   int hough[3][DMTX_HOUGH_RES] = { { 0 } };
-   int houghMin, houghMax;
-   char houghTest[DMTX_HOUGH_RES];
-   int i;
    int step;
-   int angleBest;
-   int hOffset, hOffsetBest;
-   int xDiff, yDiff;
-   int dH;
+   DmtxHough hough;
    DmtxRay2 rH;
    DmtxBestLine line;
-   DmtxPixelLoc rHp;
-   DmtxFollow follow;
+   DmtxPixelLoc loc, rHp;
 
    memset(&line, 0x00, sizeof(DmtxBestLine));
    memset(&rH, 0x00, sizeof(DmtxRay2));
-   angleBest = 0;
-   hOffset = hOffsetBest = 0;
 
-   follow = FollowSeekLoc(dec, loc0);
-   rHp = line.locBeg = line.locPos = line.locNeg = follow.loc;
+   rHp = line.locBeg = line.locPos = line.locNeg = loc0;
    line.stepBeg = line.stepPos = line.stepNeg = 0;
 
-   /* Predetermine which angles to test */
-   for(i = 0; i < DMTX_HOUGH_RES; i++) {
-      if(houghAvoid == DmtxUndefined) {
-         houghTest[i] = 1;
-      }
-      else {
-         houghMin = (houghAvoid + DMTX_HOUGH_RES/6) % DMTX_HOUGH_RES;
-         houghMax = (houghAvoid - DMTX_HOUGH_RES/6 + DMTX_HOUGH_RES) % DMTX_HOUGH_RES;
-         if(houghMin > houghMax)
-            houghTest[i] = (i > houghMin || i < houghMax) ? 1 : 0;
-         else
-            houghTest[i] = (i > houghMin && i < houghMax) ? 1 : 0;
-      }
-   }
+   HoughInit(&hough, houghAvoid);
 
-   /* Test each angle for steps along path */
+   /* Test each angle for steps along the gapped trail in the workspace */
    for(step = 0; step < tripSteps; step++) {
 
-      xDiff = follow.loc.X - rHp.X;
-      yDiff = follow.loc.Y - rHp.Y;
+      loc = dec->trail->loc[step];
+      hough.kernel(&hough, loc.X - rHp.X, loc.Y - rHp.Y);
 
-      /* Increment Hough accumulator */
-      for(i = 0; i < DMTX_HOUGH_RES; i++) {
+/*    CALLBACK_POINT_PLOT(loc, 3, 1, 2); */
+   }
 
-         if((int)houghTest[i] == 0)
-            continue;
+   line.angle = hough.angleBest;
+   line.hOffset = hough.offsetBest;
+   line.mag = hough.mag;
 
-         dH = (rHvX[i] * yDiff) - (rHvY[i] * xDiff);
-         if(dH >= -384 && dH <= 384) {
-            if(dH > 128)
-               hOffset = 2;
-            else if(dH >= -128)
-               hOffset = 1;
-            else
-               hOffset = 0;
-
-            hough[hOffset][i]++;
-
-            /* New angle takes over lead */
-            if(hough[hOffset][i] > hough[hOffsetBest][angleBest]) {
-               angleBest = i;
-               hOffsetBest = hOffset;
-            }
-         }
-      }
+   return line;
+}
 
-/*    CALLBACK_POINT_PLOT(follow.loc, (sign > 1) ? 4 : 3, 1, 2); */
+/**
+ * \brief  Prepare an empty Hough accumulator for FindBestSolidLine()
+ * \param  hough
+ * \param  houghAvoid Angle whose neighborhood is not tested, or DmtxUndefined
+ * \return void
+ *
+ * Angles near houghAvoid and the padding lanes past DMTX_HOUGH_RES are masked
+ * out so they never collect votes. Like the original loop, the leader starts
+ * at angle 0 and offset 0 with no votes.
+ */
+static void
+HoughInit(DmtxHough *hough, int houghAvoid)
+{
+   int i;
+   int houghMin, houghMax;
 
-      follow = FollowStep2(dec, follow, sign);
-   }
+   memset(hough, 0x00, sizeof(DmtxHough));
 
-   line.angle = angleBest;
-   line.hOffset = hOffsetBest;
-   line.mag = hough[hOffsetBest][angleBest];
+   houghMin = (houghAvoid + DMTX_HOUGH_RES/6) % DMTX_HOUGH_RES;
+   houghMax = (houghAvoid - DMTX_HOUGH_RES/6 + DMTX_HOUGH_RES) % DMTX_HOUGH_RES;
 
-   return line;
+   /* Predetermine which angles to test */
+   for(i = 0; i < DMTX_HOUGH_RES; i++) {
+      if(houghAvoid == DmtxUndefined)
+         hough->test[i] = -1;
+      else if(houghMin > houghMax)
+         hough->test[i] = (i > houghMin || i < houghMax) ? -1 : 0;
+      else
+         hough->test[i] = (i > houghMin && i < houghMax) ? -1 : 0;
+
+      hough->pair[2*i] = (short)rHvX[i];
+      hough->pair[2*i+1] = (short)-rHvY[i];
+   }
+
+   hough->kernel = SimdHoughKernel();
 }
 
 /**
@@ -1556,18 +2420,19 @@ FindTravelLimits(DmtxDecode *dec, DmtxRegion *reg, DmtxBestLine *line)
    int posWander, posWanderMin, posWanderMax, posWanderMinLock, posWanderMaxLock;
    int negWander, negWanderMin, negWanderMax, negWanderMinLock, negWanderMaxLock;
    int cosAngle, sinAngle;
-   DmtxFollow followPos, followNeg;
+   int stepPos, stepNeg;
+   DmtxPixelLoc locPos, locNeg;
    DmtxPixelLoc loc0, posMax, negMax;
 
    /* line->stepBeg is already known to sit on the best Hough line */
-   followPos = followNeg = FollowSeek(dec, reg, line->stepBeg);
-   loc0 = followPos.loc;
+   stepPos = stepNeg = line->stepBeg;
+   loc0 = TrailLoc(dec, reg, line->stepBeg);
 
    cosAngle = rHvX[line->angle];
    sinAngle = rHvY[line->angle];
 
    distSqMax = 0;
-   posMax = negMax = followPos.loc;
+   posMax = negMax = loc0;
 
    posTravel = negTravel = 0;
    posWander = posWanderMin = posWanderMax = posWanderMinLock = posWanderMaxLock = 0;
@@ -1579,18 +2444,19 @@ FindTravelLimits(DmtxDecode *dec, DmtxRegion *reg, DmtxBestLine *line)
       negRunning = (int)(i < 10 || abs(negWander) < abs(negTravel));
 
       if(posRunning != 0) {
-         xDiff = followPos.loc.X - loc0.X;
-         yDiff = followPos.loc.Y - loc0.Y;
+         locPos = TrailLoc(dec, reg, stepPos);
+         xDiff = locPos.X - loc0.X;
+         yDiff = locPos.Y - loc0.Y;
          posTravel = (cosAngle * xDiff) + (sinAngle * yDiff);
          posWander = (cosAngle * yDiff) - (sinAngle * xDiff);
 
          if(posWander >= -3*256 && posWander <= 3*256) {
-            distSq = DistanceSquared(followPos.loc, negMax);
+            distSq = DistanceSquared(locPos, negMax);
             if(distSq > distSqMax) {
-               posMax = followPos.loc;
+               posMax = locPos;
                distSqMax = distSq;
-               line->stepPos = followPos.step;
-               line->locPos = followPos.loc;
+               line->stepPos = stepPos;
+               line->locPos = locPos;
                posWanderMinLock = posWanderMin;
                posWanderMaxLock = posWanderMax;
             }
@@ -1605,18 +2471,19 @@ FindTravelLimits(DmtxDecode *dec, DmtxRegion *reg, DmtxBestLine *line)
       }
 
       if(negRunning != 0) {
-         xDiff = followNeg.loc.X - loc0.X;
-         yDiff = followNeg.loc.Y - loc0.Y;
+         locNeg = TrailLoc(dec, reg, stepNeg);
+         xDiff = locNeg.X - loc0.X;
+         yDiff = locNeg.Y - loc0.Y;
          negTravel = (cosAngle * xDiff) + (sinAngle * yDiff);
          negWander = (cosAngle * yDiff) - (sinAngle * xDiff);
 
          if(negWander >= -3*256 && negWander < 3*256) {
-            distSq = DistanceSquared(followNeg.loc, posMax);
+            distSq = DistanceSquared(locNeg, posMax);
             if(distSq > distSqMax) {
-               negMax = followNeg.loc;
+               negMax = locNeg;
                distSqMax = distSq;
-               line->stepNeg = followNeg.step;
-               line->locNeg = followNeg.loc;
+               line->stepNeg = stepNeg;
+               line->locNeg = locNeg;
                negWanderMinLock = negWanderMin;
                negWanderMaxLock = negWanderMax;
             }
@@ -1630,11 +2497,11 @@ FindTravelLimits(DmtxDecode *dec, DmtxRegion *reg, DmtxBestLine *line)
          break;
       }
 
-/*  CALLBACK_POINT_PLOT(followPos.loc, 2, 1, 2);
-    CALLBACK_POINT_PLOT(followNeg.loc, 4, 1, 2); */
+/*  CALLBACK_POINT_PLOT(locPos, 2, 1, 2);
+    CALLBACK_POINT_PLOT(locNeg, 4, 1, 2); */
 
-      followPos = FollowStep(dec, reg, followPos, +1);
-      followNeg = FollowStep(dec, reg, followNeg, -1);
+      stepPos++;
+      stepNeg--;
    }
    line->devn = max(posWanderMaxLock - posWanderMinLock, negWanderMaxLock - negWanderMinLock)/256;
    line->distSq = distSqMax;
@@ -1659,7 +2526,6 @@ MatrixRegionAlignCalibEdge(DmtxDecode *dec, DmtxRegion *reg, int edgeLoc)
    DmtxVector2 pTmp;
    DmtxPixelLoc loc0, loc1, locOrigin;
    DmtxBresLine line;
-   DmtxFollow follow;
    DmtxBestLine bestLine;
 
    /* Determine pixel coordinates of origin */
@@ -1684,7 +2550,7 @@ MatrixRegionAlignCalibEdge(DmtxDecode *dec, DmtxRegion *reg, int edgeLoc)
    if(edgeLoc == DmtxEdgeTop) {
       streamDir = reg->polarity * -1;
       avoidAngle = reg->leftLine.angle;
-      follow = FollowSeekLoc(dec, reg->locT);
+      loc0 = reg->locT;
       pTmp.X = 0.8;
       pTmp.Y = (symbolShape == DmtxSymbolRectAuto) ? 0.2 : 0.6;
    }
@@ -1692,7 +2558,7 @@ MatrixRegionAlignCalibEdge(DmtxDecode *dec, DmtxRegion *reg, int edgeLoc)
       assert(edgeLoc == DmtxEdgeRight);
       streamDir = reg->polarity;
       avoidAngle = reg->bottomLine.angle;
-      follow = FollowSeekLoc(dec, reg->locR);
+      loc0 = reg->locR;
       pTmp.X = (symbolShape == DmtxSymbolSquareAuto) ? 0.7 : 0.9;
       pTmp.Y = 0.8;
    }
@@ -1701,11 +2567,10 @@ MatrixRegionAlignCalibEdge(DmtxDecode *dec, DmtxRegion *reg, int edgeLoc)
    loc1.X = (int)(pTmp.X + 0.5);
    loc1.Y = (int)(pTmp.Y + 0.5);
 
-   loc0 = follow.loc;
    line = BresLineInit(loc0, loc1, locOrigin);
    steps = TrailBlazeGapped(dec, reg, line, streamDir);
 
-   bestLine = FindBestSolidLine2(dec, loc0, steps, streamDir, avoidAngle);
+   bestLine = FindBestSolidLine2(dec, loc0, steps, avoidAngle);
    if(bestLine.mag < 5) {
       ;
    }
@@ -0,0 +1,211 @@
+/**
+ * libdmtx - Data Matrix Encoding/Decoding Library
+ * Copyright 2008, 2009 Mike Laughton. All rights reserved.
+ * Copyright 2012-2016 Vadim A. Misbakh-Soloviov. All rights reserved.
+ *
+ * See LICENSE file in the main project directory for full
+ * terms of use and distribution.
+ *
+ * Contact:
+ * Vadim A. Misbakh-Soloviov <dmtx@mva.name>
+ * Mike Laughton <mike@dragonflylogic.com>
+ *
+ * \file dmtxscancache.c
+ * \brief Per-pixel scan state
+ */
+
+/**
+ * Region detection keeps one byte of state per scaled pixel (visited and
+ * assigned bits, see TrailBlazeContinuous()). Only a small part of a large
+ * image is ever visited, so the bytes are kept in square tiles that are
+ * allocated the first time a pixel inside them is written.
+ * Reading a pixel of a missing tile returns zero without allocating. An
+ * optional limit caps the memory held by tiles; once it is reached, scan
+ * state writes to new tiles fail as if the pixel were outside the image, and
+ * are counted in refused. Marks over decoded regions are never dropped: they
+ * keep later scans from finding the same symbol again, so they allocate
+ * tiles past the limit.
+ *
+ * Every pointer handed out grows a bounding box kept for its tile, so a reset
+ * between images only clears the boxes of the tiles touched since the last
+ * reset. Tiles stay allocated for reuse.
+ */
+
+/**
+ * \brief  Allocate an empty scan cache covering a scaled image
+ * \param  width Scaled image width
+ * \param  height Scaled image height
+ * \return Initialized scan cache, or NULL on allocation failure
+ */
+static DmtxScanCache *
+ScanCacheCreate(int width, int height)
+{
+   int i, tileCount;
+   DmtxScanCache *cache;
+
+   cache = (DmtxScanCache *)MemCalloc(1, sizeof(DmtxScanCache));
+   if(cache == NULL)
+      return NULL;
+
+   cache->width = width;
+   cache->height = height;
+   cache->tileCols = (width + DmtxScanTileMask) >> DmtxScanTileShift;
+   cache->tileRows = (height + DmtxScanTileMask) >> DmtxScanTileShift;
+
+   tileCount = cache->tileCols * cache->tileRows;
+
+   cache->tile = (unsigned char **)MemCalloc(tileCount, sizeof(unsigned char *));
+   cache->dirtyBox = (DmtxScanTileBox *)MemAlloc(tileCount * sizeof(DmtxScanTileBox));
+   cache->dirtyTile = (int *)MemAlloc(tileCount * sizeof(int));
+   if(cache->tile == NULL || cache->dirtyBox == NULL || cache->dirtyTile == NULL) {
+      MemFree(cache->tile);
+      MemFree(cache->dirtyBox);
+      MemFree(cache->dirtyTile);
+      MemFree(cache);
+      return NULL;
+   }
+
+   for(i = 0; i < tileCount; i++) {
+      cache->dirtyBox[i].xMin = cache->dirtyBox[i].yMin = DmtxScanTileSize;
+      cache->dirtyBox[i].xMax = cache->dirtyBox[i].yMax = 0;
+   }
+
+   return cache;
+}
+
+/**
+ * \brief  Free a scan cache and all of its tiles
+ * \param  cache
+ * \return void
+ */
+static void
+ScanCacheDestroy(DmtxScanCache **cache)
+{
+   int i, tileCount;
+
+   if(cache == NULL || *cache == NULL)
+      return;
+
+   tileCount = (*cache)->tileCols * (*cache)->tileRows;
+   for(i = 0; i < tileCount; i++) {
+      if((*cache)->tile[i] != NULL)
+         MemFree((*cache)->tile[i]);
+   }
+
+   MemFree((*cache)->tile);
+   MemFree((*cache)->dirtyBox);
+   MemFree((*cache)->dirtyTile);
+   MemFree(*cache);
+
+   *cache = NULL;
+}
+
+/**
+ * \brief  Return the writable state byte of a pixel, allocating its tile
+ * \param  cache
+ * \param  x Scaled x coordinate
+ * \param  y Scaled y coordinate
+ * \param  capped Whether a new tile must fit within the memory limit
+ * \return Pointer that stays valid for the life of the cache, or NULL if the
+ *         pixel is outside the image, its tile cannot be allocated, or a
+ *         capped tile would exceed the memory limit
+ */
+static unsigned char *
+ScanCacheGet(DmtxScanCache *cache, int x, int y, DmtxBoolean capped)
+{
+   int idx, xTile, yTile;
+   unsigned char **tile;
+   DmtxScanTileBox *box;
+
+   if(x < 0 || x >= cache->width || y < 0 || y >= cache->height)
+      return NULL;
+
+   idx = (y >> DmtxScanTileShift) * cache->tileCols + (x >> DmtxScanTileShift);
+   tile = &(cache->tile[idx]);
+
+   if(*tile == NULL) {
+      if(capped == DmtxTrue && cache->limit > 0 &&
+            cache->bytes + DmtxScanTileBytes > cache->limit) {
+         cache->refused++;
+         return NULL;
+      }
+
+      *tile = (unsigned char *)MemCalloc(DmtxScanTileBytes, sizeof(unsigned char));
+      if(*tile == NULL)
+         return NULL;
+
+      cache->bytes += DmtxScanTileBytes;
+   }
+
+   xTile = x & DmtxScanTileMask;
+   yTile = y & DmtxScanTileMask;
+   box = &(cache->dirtyBox[idx]);
+
+   if(box->xMin > box->xMax) {
+      cache->dirtyTile[cache->dirtyCount++] = idx;
+      box->xMin = box->xMax = (unsigned char)xTile;
+      box->yMin = box->yMax = (unsigned char)yTile;
+   }
+   else {
+      if(xTile < box->xMin)
+         box->xMin = (unsigned char)xTile;
+      else if(xTile > box->xMax)
+         box->xMax = (unsigned char)xTile;
+
+      if(yTile < box->yMin)
+         box->yMin = (unsigned char)yTile;
+      else if(yTile > box->yMax)
+         box->yMax = (unsigned char)yTile;
+   }
+
+   return *tile + ((y & DmtxScanTileMask) << DmtxScanTileShift) + (x & DmtxScanTileMask);
+}
+
+/**
+ * \brief  Read the state byte of a pixel without allocating
+ * \param  cache
+ * \param  x Scaled x coordinate
+ * \param  y Scaled y coordinate
+ * \return State byte, 0 if never written, or DmtxUndefined outside the image
+ */
+static int
+ScanCacheRead(const DmtxScanCache *cache, int x, int y)
+{
+   const unsigned char *tile;
+
+   if(x < 0 || x >= cache->width || y < 0 || y >= cache->height)
+      return DmtxUndefined;
+
+   tile = cache->tile[(y >> DmtxScanTileShift) * cache->tileCols + (x >> DmtxScanTileShift)];
+   if(tile == NULL)
+      return 0;
+
+   return tile[((y & DmtxScanTileMask) << DmtxScanTileShift) + (x & DmtxScanTileMask)];
+}
+
+/**
+ * \brief  Zero every pixel handed out since the last reset
+ * \param  cache
+ * \return void
+ */
+static void
+ScanCacheReset(DmtxScanCache *cache)
+{
+   int i, row;
+   unsigned char *tile;
+   DmtxScanTileBox *box;
+
+   for(i = 0; i < cache->dirtyCount; i++) {
+      tile = cache->tile[cache->dirtyTile[i]];
+      box = &(cache->dirtyBox[cache->dirtyTile[i]]);
+
+      for(row = box->yMin; row <= box->yMax; row++)
+         memset(tile + (row << DmtxScanTileShift) + box->xMin, 0x00, box->xMax - box->xMin + 1);
+
+      box->xMin = box->yMin = DmtxScanTileSize;
+      box->xMax = box->yMax = 0;
+   }
+
+   cache->dirtyCount = 0;
+   cache->refused = 0;
+}
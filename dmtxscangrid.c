@@ -56,6 +56,12 @@ InitScanGrid(DmtxDecode *dec)
    /* Values that get reset for every level */
    grid.total = 1;
    grid.extent = grid.maxExtent;
+   grid.saliency = dec->saliency;
+   if(grid.saliency != NULL) {
+      grid.cellBegin = 0;
+      grid.cellEnd = (grid.saliency->activeCount > 0) ?
+            grid.saliency->activeCount : grid.saliency->cellCount;
+   }
 
    SetDerivedFields(&grid);
 
@@ -106,17 +112,48 @@ GetGridCoordinates(DmtxScanGrid *grid, DmtxPixelLoc *locPtr)
       grid->xCenter += grid->jumpSize;
    }
 
-   /* Jump to next cross pattern vertically if current row is done */
-   if(grid->xCenter > grid->maxExtent) {
-      grid->xCenter = grid->startPos;
-      grid->yCenter += grid->jumpSize;
+   if(grid->saliency == NULL) {
+      /* Jump to next cross pattern vertically if current row is done */
+      if(grid->xCenter > grid->maxExtent) {
+         grid->xCenter = grid->startPos;
+         grid->yCenter += grid->jumpSize;
+      }
+
+      /* Increment level when vertical step goes too far */
+      if(grid->yCenter > grid->maxExtent) {
+         grid->total *= 4;
+         grid->extent /= 2;
+         SetDerivedFields(grid);
+      }
    }
+   else {
+      /* Jump to next cross pattern vertically if current row of cell is done */
+      if(grid->xCenter > grid->xEnd) {
+         grid->xCenter = grid->xStart;
+         grid->yCenter += grid->jumpSize;
+      }
 
-   /* Increment level when vertical step goes too far */
-   if(grid->yCenter > grid->maxExtent) {
-      grid->total *= 4;
-      grid->extent /= 2;
-      SetDerivedFields(grid);
+      /* Move to next cell when done, and increment level after the last one */
+      while(grid->yCenter > grid->yEnd && grid->extent > 0 && grid->extent >= grid->minExtent) {
+         if(++(grid->cellPos) < grid->cellEnd) {
+            SetCellFields(grid);
+            continue;
+         }
+
+         grid->total *= 4;
+         grid->extent /= 2;
+
+         /* Start over from the largest crosses for the quiet cells */
+         if((grid->extent == 0 || grid->extent < grid->minExtent) &&
+               grid->cellEnd < grid->saliency->cellCount) {
+            grid->cellBegin = grid->cellEnd;
+            grid->cellEnd = grid->saliency->cellCount;
+            grid->total = 1;
+            grid->extent = grid->maxExtent;
+         }
+
+         SetDerivedFields(grid);
+      }
    }
 
    if(grid->extent == 0 || grid->extent < grid->minExtent) {
@@ -175,4 +212,203 @@ SetDerivedFields(DmtxScanGrid *grid)
    grid->startPos = grid->extent / 2;
    grid->pixelCount = 0;
    grid->xCenter = grid->yCenter = grid->startPos;
+
+   if(grid->saliency != NULL) {
+      grid->cellPos = grid->cellBegin;
+      SetCellFields(grid);
+   }
+}
+
+/**
+ * \brief  Point grid at the first cross pattern of the current saliency cell
+ * \param  grid
+ * \return void
+ *
+ * Cells with any edge energy are scanned first, from the largest crosses
+ * down to the smallest, visiting the cells of each level in order of
+ * decreasing energy. The quiet cells follow in a second pass of their own.
+ * A cross belongs to the cell containing its center, with the outer cells
+ * extended to cover centers beyond the image edges. Every cross of a level
+ * therefore belongs to exactly one cell. A cell holding no cross center at
+ * the current level is left with yCenter past yEnd so it is skipped.
+ */
+static void
+SetCellFields(DmtxScanGrid *grid)
+{
+   int cell, cellSize, col, row, lo;
+
+   cellSize = grid->saliency->cellSize;
+   cell = grid->saliency->order[grid->cellPos];
+   col = cell % grid->saliency->cols;
+   row = cell / grid->saliency->cols;
+
+   /* Horizontal range of cross centers in grid coordinates */
+   lo = col * cellSize - grid->xOffset;
+   grid->xStart = (col == 0 || lo <= grid->startPos) ? grid->startPos :
+         grid->startPos + (lo - grid->startPos + grid->jumpSize - 1) / grid->jumpSize * grid->jumpSize;
+   grid->xEnd = (col == grid->saliency->cols - 1) ? grid->maxExtent :
+         min(grid->maxExtent, (col + 1) * cellSize - 1 - grid->xOffset);
+
+   /* Vertical range of cross centers in grid coordinates */
+   lo = row * cellSize - grid->yOffset;
+   grid->yCenter = (row == 0 || lo <= grid->startPos) ? grid->startPos :
+         grid->startPos + (lo - grid->startPos + grid->jumpSize - 1) / grid->jumpSize * grid->jumpSize;
+   grid->yEnd = (row == grid->saliency->rows - 1) ? grid->maxExtent :
+         min(grid->maxExtent, (row + 1) * cellSize - 1 - grid->yOffset);
+
+   grid->xCenter = grid->xStart;
+   grid->pixelCount = 0;
+
+   if(grid->xStart > grid->xEnd)
+      grid->yCenter = grid->yEnd + 1;
+}
+
+/**
+ * \brief  Allocate a saliency map for a scaled image
+ * \param  width Scaled image width
+ * \param  height Scaled image height
+ * \param  cellSize Width and height of a cell in scaled pixels
+ * \return Saliency map in raster order, or NULL on allocation failure
+ */
+static DmtxSaliency *
+SaliencyCreate(int width, int height, int cellSize)
+{
+   int i;
+   DmtxSaliency *saliency;
+
+   saliency = (DmtxSaliency *)MemCalloc(1, sizeof(DmtxSaliency));
+   if(saliency == NULL)
+      return NULL;
+
+   saliency->cellSize = cellSize;
+   saliency->cols = (width + cellSize - 1) / cellSize;
+   saliency->rows = (height + cellSize - 1) / cellSize;
+   saliency->cellCount = saliency->cols * saliency->rows;
+
+   saliency->energy = (int *)MemCalloc(saliency->cellCount, sizeof(int));
+   saliency->order = (int *)MemAlloc(saliency->cellCount * sizeof(int));
+   if(saliency->energy == NULL || saliency->order == NULL) {
+      SaliencyDestroy(&saliency);
+      return NULL;
+   }
+
+   for(i = 0; i < saliency->cellCount; i++)
+      saliency->order[i] = i;
+
+   return saliency;
+}
+
+/**
+ * \brief  Free a saliency map
+ * \param  saliency
+ * \return void
+ */
+static void
+SaliencyDestroy(DmtxSaliency **saliency)
+{
+   if(saliency == NULL || *saliency == NULL)
+      return;
+
+   MemFree((*saliency)->energy);
+   MemFree((*saliency)->order);
+   MemFree(*saliency);
+
+   *saliency = NULL;
+}
+
+/**
+ * \brief  Measure the edge energy of every cell and sort cells by it
+ * \param  saliency
+ * \param  dec
+ * \return void
+ *
+ * The image is sampled on a lattice of about 8x8 points per cell, each point
+ * being the sum of a 2x2 pixel block to damp sensor noise. A point counts as
+ * an edge when any channel differs from its right or lower lattice neighbor
+ * by at least DmtxPropEdgeThresh percent of full scale, so flat background
+ * scores zero. Ties keep raster order.
+ */
+static void
+SaliencyFill(DmtxSaliency *saliency, DmtxDecode *dec)
+{
+   int i, x, y, step, thresh, channel, channelCount;
+   int width, height, value, valueRight, valueDown;
+   DmtxBoolean edge;
+
+   width = dmtxDecodeGetProp(dec, DmtxPropWidth);
+   height = dmtxDecodeGetProp(dec, DmtxPropHeight);
+   channelCount = DecodeScanImage(dec)->channelCount;
+   step = max(2, saliency->cellSize / 8);
+   thresh = 4 * ((dec->edgeThresh * 255 + 50) / 100);
+
+   memset(saliency->energy, 0x00, saliency->cellCount * sizeof(int));
+
+   for(y = 0; y + step + 1 < height; y += step) {
+      for(x = 0; x + step + 1 < width; x += step) {
+         edge = DmtxFalse;
+         for(channel = 0; channel < channelCount && edge == DmtxFalse; channel++) {
+            value = SaliencySample(dec, x, y, channel);
+            valueRight = SaliencySample(dec, x + step, y, channel);
+            valueDown = SaliencySample(dec, x, y + step, channel);
+            if(abs(value - valueRight) >= thresh || abs(value - valueDown) >= thresh)
+               edge = DmtxTrue;
+         }
+         if(edge == DmtxTrue)
+            saliency->energy[(y / saliency->cellSize) * saliency->cols + x / saliency->cellSize]++;
+      }
+   }
+
+   saliency->activeCount = 0;
+   for(i = 0; i < saliency->cellCount; i++) {
+      if(saliency->energy[i] > 0)
+         saliency->activeCount++;
+   }
+
+   /* Sort keys combining energy with reversed cell index, decoded in place */
+   for(i = 0; i < saliency->cellCount; i++)
+      saliency->order[i] = saliency->energy[i] * saliency->cellCount + (saliency->cellCount - 1 - i);
+
+   qsort(saliency->order, saliency->cellCount, sizeof(int), SaliencyCompare);
+
+   for(i = 0; i < saliency->cellCount; i++)
+      saliency->order[i] = saliency->cellCount - 1 - saliency->order[i] % saliency->cellCount;
+}
+
+/**
+ * \brief  Sum one channel over the 2x2 pixel block at a lattice point
+ * \param  dec
+ * \param  x Scaled x coordinate of the top left pixel
+ * \param  y Scaled y coordinate of the top left pixel
+ * \param  channel
+ * \return Sum of the four pixel values
+ */
+static int
+SaliencySample(DmtxDecode *dec, int x, int y, int channel)
+{
+   int i, value, sum;
+
+   sum = 0;
+   for(i = 0; i < 4; i++) {
+      if(dmtxDecodeGetPixelValue(dec, x + (i & 0x01), y + (i >> 1), channel, &value) == DmtxPass)
+         sum += value;
+   }
+
+   return sum;
+}
+
+/**
+ * \brief  qsort() comparison putting larger sort keys first
+ * \param  a
+ * \param  b
+ * \return Negative, zero or positive
+ */
+static int
+SaliencyCompare(const void *a, const void *b)
+{
+   int keyA, keyB;
+
+   keyA = *(const int *)a;
+   keyB = *(const int *)b;
+
+   return (keyA < keyB) ? 1 : (keyA > keyB) ? -1 : 0;
 }
@@ -0,0 +1,850 @@
+/**
+ * libdmtx - Data Matrix Encoding/Decoding Library
+ * Copyright 2008, 2009 Mike Laughton. All rights reserved.
+ * Copyright 2012-2016 Vadim A. Misbakh-Soloviov. All rights reserved.
+ *
+ * See LICENSE file in the main project directory for full
+ * terms of use and distribution.
+ *
+ * Contact:
+ * Vadim A. Misbakh-Soloviov <dmtx@mva.name>
+ * Mike Laughton <mike@dragonflylogic.com>
+ *
+ * \file dmtxsimd.c
+ * \brief Vector kernels with runtime CPU dispatch
+ */
+
+/**
+ * Each kernel exists as a portable scalar version plus SSE2 and AVX2 versions
+ * on x86 compilers that support them. Polynomial evaluation needs PSHUFB, so
+ * its only vector version uses SSSE3 instead. The GF(256) kernels are left
+ * scalar on MSVC, which lacks the runtime checks to pick among them. The
+ * fastest version supported by the running CPU is chosen once at runtime, the
+ * GF(256) kernels stay scalar for blocks too small to fill a vector, and every
+ * version produces bit-identical results. Define DMTX_NO_SIMD at build time to use the
+ * scalar versions only.
+ */
+
+#if !defined(DMTX_NO_SIMD) && (defined(__GNUC__) || defined(__clang__)) && \
+      (defined(__x86_64__) || defined(__i386__))
+#define DMTX_SIMD_X86_DISPATCH
+#include <immintrin.h>
+#define DMTX_TARGET_SSE2  __attribute__((target("sse2")))
+#define DMTX_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define DMTX_TARGET_AVX2  __attribute__((target("avx2")))
+#elif !defined(DMTX_NO_SIMD) && defined(_MSC_VER) && defined(_M_X64)
+#define DMTX_SIMD_SSE2_ONLY
+#include <emmintrin.h>
+#define DMTX_TARGET_SSE2
+#endif
+
+/**
+ * \brief  Compute packed point flows for a block of 8-bit pixels
+ * \param  src First pixel of the block; its 8 neighbors must be readable
+ * \param  srcStride Byte step from row y to row y+1
+ * \param  width Pixels per row
+ * \param  height Rows
+ * \param  dst First output entry
+ * \param  dstStride Entry step between output rows
+ * \return void
+ *
+ * Each output entry holds DmtxFlowValid | depart << 12 | mag, matching what
+ * ComputePointFlow() returns for an interior pixel. The four compass sums are
+ * the closed form of its coefficient[] convolution over dmtxPatternX/Y.
+ */
+static void
+CompassKernelScalar(const unsigned char *src, int srcStride, int width, int height,
+      unsigned short *dst, int dstStride)
+{
+   int row, col;
+   int compass, compassMax, magMax;
+   int mag[4];
+   const unsigned char *s;
+   const unsigned char *below, *above;
+
+   for(row = 0; row < height; row++) {
+      s = src + row * srcStride;
+      below = s - srcStride;
+      above = s + srcStride;
+
+      for(col = 0; col < width; col++) {
+         /* Pattern positions 0-7 start below-left and proceed counterclockwise */
+         mag[0] = below[col] + 2 * below[col + 1] + s[col + 1]
+               - above[col] - 2 * above[col - 1] - s[col - 1];
+         mag[1] = below[col + 1] + 2 * s[col + 1] + above[col + 1]
+               - above[col - 1] - 2 * s[col - 1] - below[col - 1];
+         mag[2] = s[col + 1] + 2 * above[col + 1] + above[col]
+               - s[col - 1] - 2 * below[col - 1] - below[col];
+         mag[3] = above[col + 1] + 2 * above[col] + above[col - 1]
+               - below[col - 1] - 2 * below[col] - below[col + 1];
+
+         compassMax = 0;
+         magMax = abs(mag[0]);
+         for(compass = 1; compass < 4; compass++) {
+            if(abs(mag[compass]) > magMax) {
+               magMax = abs(mag[compass]);
+               compassMax = compass;
+            }
+         }
+
+         if(mag[compassMax] > 0)
+            compassMax += 4;
+
+         dst[row * dstStride + col] = (unsigned short)(DmtxFlowValid | (compassMax << 12) | magMax);
+      }
+   }
+}
+
+#if defined(DMTX_SIMD_X86_DISPATCH) || defined(DMTX_SIMD_SSE2_ONLY)
+/**
+ * \brief  SSE2 version of CompassKernelScalar(), 8 pixels per step
+ */
+static DMTX_TARGET_SSE2 void
+CompassKernelSse2(const unsigned char *src, int srcStride, int width, int height,
+      unsigned short *dst, int dstStride)
+{
+   int row, col;
+   const unsigned char *s, *below, *above;
+   __m128i zero, valid, four;
+   __m128i bl, b, br, r, ar, a, al, l;
+   __m128i m0, m1, m2, m3, a0, a1, a2, a3;
+   __m128i best, bestSigned, idx, gt, out;
+
+   zero = _mm_setzero_si128();
+   valid = _mm_set1_epi16((short)DmtxFlowValid);
+   four = _mm_set1_epi16(4);
+
+#define DMTX_LOAD8(p) _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(p)), zero)
+#define DMTX_ABS16(v) _mm_max_epi16((v), _mm_sub_epi16(zero, (v)))
+#define DMTX_SELECT(mask, x, y) _mm_or_si128(_mm_and_si128((mask), (x)), _mm_andnot_si128((mask), (y)))
+
+   for(row = 0; row < height; row++) {
+      s = src + row * srcStride;
+      below = s - srcStride;
+      above = s + srcStride;
+
+      for(col = 0; col + 8 <= width; col += 8) {
+         bl = DMTX_LOAD8(below + col - 1);
+         b  = DMTX_LOAD8(below + col);
+         br = DMTX_LOAD8(below + col + 1);
+         r  = DMTX_LOAD8(s + col + 1);
+         ar = DMTX_LOAD8(above + col + 1);
+         a  = DMTX_LOAD8(above + col);
+         al = DMTX_LOAD8(above + col - 1);
+         l  = DMTX_LOAD8(s + col - 1);
+
+         m0 = _mm_sub_epi16(_mm_add_epi16(_mm_add_epi16(b, r), _mm_add_epi16(br, br)),
+               _mm_add_epi16(_mm_add_epi16(a, l), _mm_add_epi16(al, al)));
+         m1 = _mm_sub_epi16(_mm_add_epi16(_mm_add_epi16(br, ar), _mm_add_epi16(r, r)),
+               _mm_add_epi16(_mm_add_epi16(al, bl), _mm_add_epi16(l, l)));
+         m2 = _mm_sub_epi16(_mm_add_epi16(_mm_add_epi16(r, a), _mm_add_epi16(ar, ar)),
+               _mm_add_epi16(_mm_add_epi16(l, b), _mm_add_epi16(bl, bl)));
+         m3 = _mm_sub_epi16(_mm_add_epi16(_mm_add_epi16(ar, al), _mm_add_epi16(a, a)),
+               _mm_add_epi16(_mm_add_epi16(bl, br), _mm_add_epi16(b, b)));
+
+         a0 = DMTX_ABS16(m0);
+         a1 = DMTX_ABS16(m1);
+         a2 = DMTX_ABS16(m2);
+         a3 = DMTX_ABS16(m3);
+
+         /* Strictly greater comparisons keep the lowest compass on ties */
+         best = a0;
+         bestSigned = m0;
+         idx = zero;
+
+         gt = _mm_cmpgt_epi16(a1, best);
+         best = DMTX_SELECT(gt, a1, best);
+         bestSigned = DMTX_SELECT(gt, m1, bestSigned);
+         idx = DMTX_SELECT(gt, _mm_set1_epi16(1), idx);
+
+         gt = _mm_cmpgt_epi16(a2, best);
+         best = DMTX_SELECT(gt, a2, best);
+         bestSigned = DMTX_SELECT(gt, m2, bestSigned);
+         idx = DMTX_SELECT(gt, _mm_set1_epi16(2), idx);
+
+         gt = _mm_cmpgt_epi16(a3, best);
+         best = DMTX_SELECT(gt, a3, best);
+         bestSigned = DMTX_SELECT(gt, m3, bestSigned);
+         idx = DMTX_SELECT(gt, _mm_set1_epi16(3), idx);
+
+         idx = _mm_add_epi16(idx, _mm_and_si128(_mm_cmpgt_epi16(bestSigned, zero), four));
+         out = _mm_or_si128(_mm_or_si128(valid, _mm_slli_epi16(idx, 12)), best);
+
+         _mm_storeu_si128((__m128i *)(dst + row * dstStride + col), out);
+      }
+
+      if(col < width)
+         CompassKernelScalar(s + col, srcStride, width - col, 1, dst + row * dstStride + col, dstStride);
+   }
+
+#undef DMTX_LOAD8
+#undef DMTX_ABS16
+#undef DMTX_SELECT
+}
+#endif
+
+#if defined(DMTX_SIMD_X86_DISPATCH)
+/**
+ * \brief  AVX2 version of CompassKernelScalar(), 16 pixels per step
+ */
+static DMTX_TARGET_AVX2 void
+CompassKernelAvx2(const unsigned char *src, int srcStride, int width, int height,
+      unsigned short *dst, int dstStride)
+{
+   int row, col;
+   const unsigned char *s, *below, *above;
+   __m256i zero, valid, four;
+   __m256i bl, b, br, r, ar, a, al, l;
+   __m256i m0, m1, m2, m3, a0, a1, a2, a3;
+   __m256i best, bestSigned, idx, gt, out;
+
+   zero = _mm256_setzero_si256();
+   valid = _mm256_set1_epi16((short)DmtxFlowValid);
+   four = _mm256_set1_epi16(4);
+
+#define DMTX_LOAD16(p) _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(p)))
+
+   for(row = 0; row < height; row++) {
+      s = src + row * srcStride;
+      below = s - srcStride;
+      above = s + srcStride;
+
+      for(col = 0; col + 16 <= width; col += 16) {
+         bl = DMTX_LOAD16(below + col - 1);
+         b  = DMTX_LOAD16(below + col);
+         br = DMTX_LOAD16(below + col + 1);
+         r  = DMTX_LOAD16(s + col + 1);
+         ar = DMTX_LOAD16(above + col + 1);
+         a  = DMTX_LOAD16(above + col);
+         al = DMTX_LOAD16(above + col - 1);
+         l  = DMTX_LOAD16(s + col - 1);
+
+         m0 = _mm256_sub_epi16(_mm256_add_epi16(_mm256_add_epi16(b, r), _mm256_add_epi16(br, br)),
+               _mm256_add_epi16(_mm256_add_epi16(a, l), _mm256_add_epi16(al, al)));
+         m1 = _mm256_sub_epi16(_mm256_add_epi16(_mm256_add_epi16(br, ar), _mm256_add_epi16(r, r)),
+               _mm256_add_epi16(_mm256_add_epi16(al, bl), _mm256_add_epi16(l, l)));
+         m2 = _mm256_sub_epi16(_mm256_add_epi16(_mm256_add_epi16(r, a), _mm256_add_epi16(ar, ar)),
+               _mm256_add_epi16(_mm256_add_epi16(l, b), _mm256_add_epi16(bl, bl)));
+         m3 = _mm256_sub_epi16(_mm256_add_epi16(_mm256_add_epi16(ar, al), _mm256_add_epi16(a, a)),
+               _mm256_add_epi16(_mm256_add_epi16(bl, br), _mm256_add_epi16(b, b)));
+
+         a0 = _mm256_abs_epi16(m0);
+         a1 = _mm256_abs_epi16(m1);
+         a2 = _mm256_abs_epi16(m2);
+         a3 = _mm256_abs_epi16(m3);
+
+         best = a0;
+         bestSigned = m0;
+         idx = zero;
+
+         gt = _mm256_cmpgt_epi16(a1, best);
+         best = _mm256_blendv_epi8(best, a1, gt);
+         bestSigned = _mm256_blendv_epi8(bestSigned, m1, gt);
+         idx = _mm256_blendv_epi8(idx, _mm256_set1_epi16(1), gt);
+
+         gt = _mm256_cmpgt_epi16(a2, best);
+         best = _mm256_blendv_epi8(best, a2, gt);
+         bestSigned = _mm256_blendv_epi8(bestSigned, m2, gt);
+         idx = _mm256_blendv_epi8(idx, _mm256_set1_epi16(2), gt);
+
+         gt = _mm256_cmpgt_epi16(a3, best);
+         best = _mm256_blendv_epi8(best, a3, gt);
+         bestSigned = _mm256_blendv_epi8(bestSigned, m3, gt);
+         idx = _mm256_blendv_epi8(idx, _mm256_set1_epi16(3), gt);
+
+         idx = _mm256_add_epi16(idx, _mm256_and_si256(_mm256_cmpgt_epi16(bestSigned, zero), four));
+         out = _mm256_or_si256(_mm256_or_si256(valid, _mm256_slli_epi16(idx, 12)), best);
+
+         _mm256_storeu_si256((__m256i *)(dst + row * dstStride + col), out);
+      }
+
+      if(col < width)
+         CompassKernelScalar(s + col, srcStride, width - col, 1, dst + row * dstStride + col, dstStride);
+   }
+
+#undef DMTX_LOAD16
+}
+#endif
+
+/**
+ * \brief  Pick the fastest compass kernel supported by the running CPU
+ * \return Kernel function
+ */
+static DmtxCompassKernel
+SimdPickCompassKernel(void)
+{
+#if defined(DMTX_SIMD_X86_DISPATCH)
+   __builtin_cpu_init();
+   if(__builtin_cpu_supports("avx2"))
+      return CompassKernelAvx2;
+   if(__builtin_cpu_supports("sse2"))
+      return CompassKernelSse2;
+#elif defined(DMTX_SIMD_SSE2_ONLY)
+   return CompassKernelSse2;
+#endif
+
+   return CompassKernelScalar;
+}
+
+/**
+ * \brief  Add the votes of one trail point to a Hough accumulator
+ * \param  hough Accumulator from HoughInit()
+ * \param  xDiff Point X relative to the start of the trail
+ * \param  yDiff Point Y relative to the start of the trail
+ * \return void
+ *
+ * Each tested angle votes for one of three offset bands when the point lies
+ * within 384/256 pixels of the line through the trail start. Angles are
+ * visited in ascending order and the leader only changes when a vote makes
+ * some entry strictly greater than it, so the leader is always the first
+ * entry to reach the highest count.
+ */
+static void
+HoughKernelScalar(DmtxHough *hough, int xDiff, int yDiff)
+{
+   int i;
+   int dH, hOffset;
+
+   for(i = 0; i < DMTX_HOUGH_RES; i++) {
+
+      if(hough->test[i] == 0)
+         continue;
+
+      dH = (rHvX[i] * yDiff) - (rHvY[i] * xDiff);
+      if(dH >= -384 && dH <= 384) {
+         if(dH > 128)
+            hOffset = 2;
+         else if(dH >= -128)
+            hOffset = 1;
+         else
+            hOffset = 0;
+
+         hough->count[hOffset][i]++;
+
+         /* New angle takes over lead */
+         if(hough->count[hOffset][i] > hough->mag) {
+            hough->angleBest = i;
+            hough->offsetBest = hOffset;
+            hough->mag = hough->count[hOffset][i];
+         }
+      }
+   }
+}
+
+#if defined(DMTX_SIMD_X86_DISPATCH) || defined(DMTX_SIMD_SSE2_ONLY)
+/**
+ * \brief  Hand the lead to the lowest angle whose count reached mag + 1
+ * \param  hough
+ * \param  angle Lowest such angle, or DmtxUndefined if the point made none
+ * \return void
+ *
+ * Vector kernels vote for every angle at once and resolve the leader once per
+ * point. Before the point every count was at most mag, and each angle gained
+ * at most one vote, so the entries now equal to mag + 1 are exactly those the
+ * scalar loop would have promoted, and it would have kept the lowest angle.
+ */
+static void
+HoughPromote(DmtxHough *hough, int angle)
+{
+   int hOffset;
+
+   if(angle == DmtxUndefined)
+      return;
+
+   hOffset = 0;
+   while(hough->count[hOffset][angle] != hough->mag + 1)
+      hOffset++;
+   assert(hOffset <= 2);
+
+   hough->angleBest = angle;
+   hough->offsetBest = hOffset;
+   hough->mag++;
+}
+
+/**
+ * \brief  SSE2 version of HoughKernelScalar(), 4 angles per step
+ *
+ * _mm_madd_epi16() forms rHvX[i] * yDiff - rHvY[i] * xDiff exactly from the
+ * interleaved pairs, so points further than 32767 pixels from the trail start
+ * are left to the scalar loop.
+ */
+static DMTX_TARGET_SSE2 void
+HoughKernelSse2(DmtxHough *hough, int xDiff, int yDiff)
+{
+   int i, lane, bits, angle;
+   __m128i diff, dH, inRange, in0, in1, in2, c0, c1, c2, hit;
+   __m128i lo, hi, neg, pos, target;
+
+   if(xDiff < -32768 || xDiff > 32767 || yDiff < -32768 || yDiff > 32767) {
+      HoughKernelScalar(hough, xDiff, yDiff);
+      return;
+   }
+
+   diff = _mm_set1_epi32((int)(((unsigned int)xDiff << 16) | ((unsigned int)yDiff & 0xffff)));
+   lo = _mm_set1_epi32(-385);
+   hi = _mm_set1_epi32(385);
+   neg = _mm_set1_epi32(-128);
+   pos = _mm_set1_epi32(128);
+   target = _mm_set1_epi32(hough->mag + 1);
+   angle = DmtxUndefined;
+
+   for(i = 0; i < DmtxHoughLanes; i += 4) {
+      dH = _mm_madd_epi16(_mm_loadu_si128((const __m128i *)(hough->pair + 2*i)), diff);
+
+      /* Branchless bucketing: masks are -1 in lanes that gain a vote */
+      inRange = _mm_and_si128(_mm_loadu_si128((const __m128i *)(hough->test + i)),
+            _mm_and_si128(_mm_cmpgt_epi32(dH, lo), _mm_cmplt_epi32(dH, hi)));
+      in0 = _mm_and_si128(inRange, _mm_cmplt_epi32(dH, neg));
+      in2 = _mm_and_si128(inRange, _mm_cmpgt_epi32(dH, pos));
+      in1 = _mm_andnot_si128(_mm_or_si128(in0, in2), inRange);
+
+      c0 = _mm_sub_epi32(_mm_loadu_si128((const __m128i *)(hough->count[0] + i)), in0);
+      c1 = _mm_sub_epi32(_mm_loadu_si128((const __m128i *)(hough->count[1] + i)), in1);
+      c2 = _mm_sub_epi32(_mm_loadu_si128((const __m128i *)(hough->count[2] + i)), in2);
+      _mm_storeu_si128((__m128i *)(hough->count[0] + i), c0);
+      _mm_storeu_si128((__m128i *)(hough->count[1] + i), c1);
+      _mm_storeu_si128((__m128i *)(hough->count[2] + i), c2);
+
+      if(angle == DmtxUndefined) {
+         hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi32(c0, target),
+               _mm_cmpeq_epi32(c1, target)), _mm_cmpeq_epi32(c2, target));
+         bits = _mm_movemask_ps(_mm_castsi128_ps(hit));
+         if(bits != 0) {
+            for(lane = 0; (bits & (1 << lane)) == 0; lane++)
+               ;
+            angle = i + lane;
+         }
+      }
+   }
+
+   HoughPromote(hough, angle);
+}
+#endif
+
+#if defined(DMTX_SIMD_X86_DISPATCH)
+/**
+ * \brief  AVX2 version of HoughKernelScalar(), 8 angles per step
+ */
+static DMTX_TARGET_AVX2 void
+HoughKernelAvx2(DmtxHough *hough, int xDiff, int yDiff)
+{
+   int i, lane, bits, angle;
+   __m256i diff, dH, inRange, in0, in1, in2, c0, c1, c2, hit;
+   __m256i lo, hi, neg, pos, target;
+
+   if(xDiff < -32768 || xDiff > 32767 || yDiff < -32768 || yDiff > 32767) {
+      HoughKernelScalar(hough, xDiff, yDiff);
+      return;
+   }
+
+   diff = _mm256_set1_epi32((int)(((unsigned int)xDiff << 16) | ((unsigned int)yDiff & 0xffff)));
+   lo = _mm256_set1_epi32(-385);
+   hi = _mm256_set1_epi32(385);
+   neg = _mm256_set1_epi32(-128);
+   pos = _mm256_set1_epi32(128);
+   target = _mm256_set1_epi32(hough->mag + 1);
+   angle = DmtxUndefined;
+
+   for(i = 0; i < DmtxHoughLanes; i += 8) {
+      dH = _mm256_madd_epi16(_mm256_loadu_si256((const __m256i *)(hough->pair + 2*i)), diff);
+
+      inRange = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(hough->test + i)),
+            _mm256_and_si256(_mm256_cmpgt_epi32(dH, lo), _mm256_cmpgt_epi32(hi, dH)));
+      in0 = _mm256_and_si256(inRange, _mm256_cmpgt_epi32(neg, dH));
+      in2 = _mm256_and_si256(inRange, _mm256_cmpgt_epi32(dH, pos));
+      in1 = _mm256_andnot_si256(_mm256_or_si256(in0, in2), inRange);
+
+      c0 = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i *)(hough->count[0] + i)), in0);
+      c1 = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i *)(hough->count[1] + i)), in1);
+      c2 = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i *)(hough->count[2] + i)), in2);
+      _mm256_storeu_si256((__m256i *)(hough->count[0] + i), c0);
+      _mm256_storeu_si256((__m256i *)(hough->count[1] + i), c1);
+      _mm256_storeu_si256((__m256i *)(hough->count[2] + i), c2);
+
+      if(angle == DmtxUndefined) {
+         hit = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi32(c0, target),
+               _mm256_cmpeq_epi32(c1, target)), _mm256_cmpeq_epi32(c2, target));
+         bits = _mm256_movemask_ps(_mm256_castsi256_ps(hit));
+         if(bits != 0) {
+            for(lane = 0; (bits & (1 << lane)) == 0; lane++)
+               ;
+            angle = i + lane;
+         }
+      }
+   }
+
+   HoughPromote(hough, angle);
+}
+#endif
+
+/**
+ * \brief  Pick the fastest Hough kernel supported by the running CPU
+ * \return Kernel function
+ */
+static DmtxHoughKernel
+SimdPickHoughKernel(void)
+{
+#if defined(DMTX_SIMD_X86_DISPATCH)
+   __builtin_cpu_init();
+   if(__builtin_cpu_supports("avx2"))
+      return HoughKernelAvx2;
+   if(__builtin_cpu_supports("sse2"))
+      return HoughKernelSse2;
+#elif defined(DMTX_SIMD_SSE2_ONLY)
+   return HoughKernelSse2;
+#endif
+
+   return HoughKernelScalar;
+}
+
+/**
+ * \brief  Divide the data words of a block by a generator polynomial
+ * \param  rem Zeroed on entry, receives the remainder
+ * \param  table Generator and feedback rows from RsGetTable()
+ * \param  data First data word of the block
+ * \param  dataWords Number of data words
+ * \param  stride Distance between data words of the block
+ * \return void
+ *
+ * This is the LFSR of the encoder, which leaves the error words in rem. The
+ * error words received with the same data differ from it only when the block
+ * holds errors.
+ */
+static void
+GfLfsrScalar(DmtxByte *rem, const DmtxRsTable *table, const unsigned char *data,
+      int dataWords, int stride)
+{
+   int i, j, length;
+   const DmtxByte *row;
+
+   length = table->errorWords;
+
+   for(i = 0; i < dataWords; i++) {
+      row = table->feedback + GfAdd(rem[length-1], data[i * stride]) * table->width;
+
+      for(j = length - 1; j > 0; j--)
+         rem[j] = GfAdd(rem[j-1], row[j]);
+
+      rem[0] = row[0];
+   }
+}
+
+/**
+ * \brief  Evaluate a polynomial at consecutive powers of alpha
+ * \param  poly Coefficients, lowest degree first
+ * \param  length Number of coefficients
+ * \param  first Exponent of the first point
+ * \param  count Number of points, at most NN
+ * \param  out Receives poly(alpha**(first + i)) for each point i
+ * \return void
+ *
+ * Term j is carried from point to point by multiplying it by alpha**j, which
+ * is the Chien search when first is 1 and count is NN.
+ */
+static void
+GfPolyEvalScalar(const DmtxByte *poly, int length, int first, int count, DmtxByte *out)
+{
+   int i, j;
+   DmtxByte q, reg[NN];
+
+   assert(length <= NN && count <= NN);
+
+   for(j = 0; j < length; j++)
+      reg[j] = GfMultAntilog(poly[j], (j * first) % NN);
+
+   for(i = 0; i < count; i++) {
+      for(q = 0, j = 0; j < length; j++) {
+         q = GfAdd(q, reg[j]);
+         reg[j] = GfMultAntilog(reg[j], j);
+      }
+      out[i] = q;
+   }
+}
+
+#if defined(DMTX_SIMD_X86_DISPATCH)
+/**
+ * \brief  Build split-nibble product tables for a constant
+ * \param  factor
+ * \param  lo Receives factor * i for i in 0-15
+ * \param  hi Receives factor * (i << 4) for i in 0-15
+ * \return void
+ *
+ * Any product factor * x is then lo[x & 0x0f] + hi[x >> 4], which PSHUFB
+ * looks up 16 or 32 bytes at a time.
+ */
+static void
+GfNibbleTables(DmtxByte factor, DmtxByte *lo, DmtxByte *hi)
+{
+   int i, bit;
+   DmtxByte power[8];
+
+   /* factor * 2**bit, reducing by the primitive polynomial 301 */
+   power[0] = factor;
+   for(bit = 1; bit < 8; bit++)
+      power[bit] = (DmtxByte)((power[bit-1] << 1) ^ ((power[bit-1] & 0x80) ? 0x2d : 0x00));
+
+   lo[0] = hi[0] = 0;
+   for(bit = 0; bit < 4; bit++) {
+      for(i = 1 << bit; i < 2 << bit; i++) {
+         lo[i] = lo[i - (1 << bit)] ^ power[bit];
+         hi[i] = hi[i - (1 << bit)] ^ power[bit + 4];
+      }
+   }
+}
+
+/**
+ * \brief  SSE2 version of GfLfsrScalar()
+ *
+ * Rather than shifting the register, the window over a zeroed buffer slides
+ * down by one codeword per data word and the whole feedback row is added in
+ * vector chunks. Bytes above the register only ever receive the zero padding
+ * of the rows.
+ */
+static DMTX_TARGET_SSE2 void
+GfLfsrSse2(DmtxByte *rem, const DmtxRsTable *table, const unsigned char *data,
+      int dataWords, int stride)
+{
+   int i, j, length, width;
+   const DmtxByte *row;
+   DmtxByte *reg, window[NN + DmtxRsRowMax];
+
+   length = table->errorWords;
+   width = table->width;
+
+   assert(dataWords + length <= NN);
+
+   memset(window, 0x00, dataWords + width);
+   reg = window + dataWords;
+
+   for(i = 0; i < dataWords; i++) {
+      row = table->feedback + GfAdd(reg[length-1], data[i * stride]) * width;
+      reg--;
+      for(j = 0; j < width; j += 16) {
+         _mm_storeu_si128((__m128i *)(reg + j),
+               _mm_xor_si128(_mm_loadu_si128((const __m128i *)(reg + j)),
+               _mm_loadu_si128((const __m128i *)(row + j))));
+      }
+   }
+
+   memcpy(rem, reg, length);
+}
+
+/**
+ * \brief  SSSE3 version of GfPolyEvalScalar(), 16 points per step
+ *
+ * Term j holds poly[j] * alpha**(j * point) for 16 consecutive points, and
+ * moves on to the next 16 points with one multiplication by alpha**(16 * j).
+ * Terms are accumulated into the output one coefficient at a time so only
+ * one pair of tables is live.
+ */
+static DMTX_TARGET_SSSE3 void
+GfPolyEvalSsse3(const DmtxByte *poly, int length, int first, int count, DmtxByte *out)
+{
+   int i, j, e;
+   DmtxByte lo[16], hi[16], term[16], acc[NN + 16];
+   __m128i tableLo, tableHi, nibble, x;
+
+   assert(count <= NN);
+
+   memset(acc, 0x00, sizeof(acc));
+   nibble = _mm_set1_epi8(0x0f);
+
+   for(j = 0; j < length; j++) {
+      if(poly[j] == 0)
+         continue;
+
+      /* Term at the first 16 points, stepping the exponent by j */
+      e = (log301[poly[j]] + j * first) % NN;
+      for(i = 0; i < 16; i++) {
+         term[i] = antilog301[e];
+         e += j;
+         if(e >= NN)
+            e -= NN;
+      }
+
+      GfNibbleTables(antilog301[(16 * j) % NN], lo, hi);
+      tableLo = _mm_loadu_si128((const __m128i *)lo);
+      tableHi = _mm_loadu_si128((const __m128i *)hi);
+      x = _mm_loadu_si128((const __m128i *)term);
+
+      for(i = 0; i < count; i += 16) {
+         _mm_storeu_si128((__m128i *)(acc + i),
+               _mm_xor_si128(_mm_loadu_si128((const __m128i *)(acc + i)), x));
+         x = _mm_xor_si128(_mm_shuffle_epi8(tableLo, _mm_and_si128(x, nibble)),
+               _mm_shuffle_epi8(tableHi, _mm_and_si128(_mm_srli_epi16(x, 4), nibble)));
+      }
+   }
+
+   memcpy(out, acc, count);
+}
+
+/**
+ * \brief  AVX2 version of GfLfsrScalar()
+ */
+static DMTX_TARGET_AVX2 void
+GfLfsrAvx2(DmtxByte *rem, const DmtxRsTable *table, const unsigned char *data,
+      int dataWords, int stride)
+{
+   int i, j, length, width;
+   const DmtxByte *row;
+   DmtxByte *reg, window[NN + DmtxRsRowMax];
+
+   length = table->errorWords;
+   width = table->width;
+
+   assert(dataWords + length <= NN);
+
+   memset(window, 0x00, dataWords + width);
+   reg = window + dataWords;
+
+   for(i = 0; i < dataWords; i++) {
+      row = table->feedback + GfAdd(reg[length-1], data[i * stride]) * width;
+      reg--;
+      for(j = 0; j < width; j += 32) {
+         _mm256_storeu_si256((__m256i *)(reg + j),
+               _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(reg + j)),
+               _mm256_loadu_si256((const __m256i *)(row + j))));
+      }
+   }
+
+   memcpy(rem, reg, length);
+}
+#endif
+
+/**
+ * \brief  Pick the fastest LFSR kernel supported by the running CPU
+ * \return Kernel function
+ */
+static DmtxGfLfsrKernel
+SimdPickGfLfsrKernel(void)
+{
+#if defined(DMTX_SIMD_X86_DISPATCH)
+   __builtin_cpu_init();
+   if(__builtin_cpu_supports("avx2"))
+      return GfLfsrAvx2;
+   if(__builtin_cpu_supports("sse2"))
+      return GfLfsrSse2;
+#endif
+
+   return GfLfsrScalar;
+}
+
+/**
+ * \brief  Pick the fastest polynomial evaluation kernel supported by the running CPU
+ * \return Kernel function
+ *
+ * There is no AVX2 version: preparing 32 starting terms per coefficient costs
+ * more than the wider steps save, even for the 255 points of a Chien search.
+ */
+static DmtxGfPolyEvalKernel
+SimdPickGfPolyEvalKernel(void)
+{
+#if defined(DMTX_SIMD_X86_DISPATCH)
+   __builtin_cpu_init();
+   if(__builtin_cpu_supports("ssse3"))
+      return GfPolyEvalSsse3;
+#endif
+
+   return GfPolyEvalScalar;
+}
+
+#ifdef HAVE_PTHREAD
+static pthread_once_t simdKernelOnce = PTHREAD_ONCE_INIT;
+#else
+static DmtxBoolean simdKernelReady = DmtxFalse;
+#endif
+static DmtxCompassKernel simdCompassKernel;
+static DmtxHoughKernel simdHoughKernel;
+static DmtxGfLfsrKernel simdGfLfsrKernel;
+static DmtxGfPolyEvalKernel simdGfPolyEvalKernel;
+
+/**
+ * \brief  Query the running CPU and pick every kernel
+ * \return void
+ */
+static void
+SimdPickKernels(void)
+{
+   simdCompassKernel = SimdPickCompassKernel();
+   simdHoughKernel = SimdPickHoughKernel();
+   simdGfLfsrKernel = SimdPickGfLfsrKernel();
+   simdGfPolyEvalKernel = SimdPickGfPolyEvalKernel();
+}
+
+/**
+ * \brief  Pick the kernels on first use
+ * \return void
+ *
+ * The CPU does not change while the process runs, so kernels are picked once
+ * and every decoder on any thread shares the choice.
+ */
+static void
+SimdInitKernels(void)
+{
+#ifdef HAVE_PTHREAD
+   pthread_once(&simdKernelOnce, SimdPickKernels);
+#else
+   if(simdKernelReady == DmtxFalse) {
+      SimdPickKernels();
+      simdKernelReady = DmtxTrue;
+   }
+#endif
+}
+
+/**
+ * \brief  Fastest compass kernel supported by the running CPU
+ * \return Kernel function
+ */
+static DmtxCompassKernel
+SimdCompassKernel(void)
+{
+   SimdInitKernels();
+   return simdCompassKernel;
+}
+
+/**
+ * \brief  Fastest Hough kernel supported by the running CPU
+ * \return Kernel function
+ */
+static DmtxHoughKernel
+SimdHoughKernel(void)
+{
+   SimdInitKernels();
+   return simdHoughKernel;
+}
+
+/**
+ * \brief  Fastest LFSR kernel for blocks with a given error word count
+ * \param  errorWords Block error words, which is the width of the LFSR
+ * \return Kernel function
+ *
+ * A scalar step only touches errorWords bytes while a vector step touches a
+ * whole feedback row, so narrow registers stay scalar.
+ */
+static DmtxGfLfsrKernel
+SimdGfLfsrKernel(int errorWords)
+{
+   if(errorWords < DmtxGfSimdMinWidth)
+      return GfLfsrScalar;
+
+   SimdInitKernels();
+   return simdGfLfsrKernel;
+}
+
+/**
+ * \brief  Fastest polynomial evaluation kernel for a given point count
+ * \param  count Number of points to evaluate
+ * \return Kernel function
+ *
+ * Vector versions prepare one run of starting terms per coefficient, which
+ * only pays off when the points fill a few vectors.
+ */
+static DmtxGfPolyEvalKernel
+SimdGfPolyEvalKernel(int count)
+{
+   if(count < DmtxGfSimdMinPoints)
+      return GfPolyEvalScalar;
+
+   SimdInitKernels();
+   return simdGfPolyEvalKernel;
+}
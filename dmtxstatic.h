@@ -57,6 +57,34 @@
 #define DmtxChannelUnsupportedChar  0x01 << 0
 #define DmtxChannelCannotUnlatch    0x01 << 1
 
+#define DmtxFlowTileShift              6
+#define DmtxFlowTileSize               (1 << DmtxFlowTileShift)
+#define DmtxFlowTileMask               (DmtxFlowTileSize - 1)
+#define DmtxFlowValid             0x8000
+#define DmtxFlowBlank             0x0fff
+
+#define DmtxModuleLineMax            144
+#define DmtxMapGridMax                26 /* Largest data region plus its border */
+#define DmtxCodeSizeMax             2178 /* Data and error codewords of 144x144 */
+#define DmtxUnsureMargin               4 /* Unsure within 1/8 of weightFactor of 50% */
+#define DmtxRsTableCount              16 /* Distinct block error word counts */
+#define DmtxRsRowMax                  96 /* Largest block error word count rounded up to 32 */
+#define DmtxRsFeedbackSize           736 /* Rounded row lengths of all tables */
+#define DmtxGfSimdMinWidth            14 /* Narrower LFSRs are faster in scalar code */
+#define DmtxGfSimdMinPoints           32 /* Fewer evaluation points are faster in scalar code */
+#define DmtxPlacementMapSize       92624 /* Codeword bits of all sizes */
+#define DmtxPitchSamplesMax         1024
+#define DmtxPitchCandidateMax          3
+
+#define DmtxScanTileShift              6
+#define DmtxScanTileSize               (1 << DmtxScanTileShift)
+#define DmtxScanTileMask               (DmtxScanTileSize - 1)
+#define DmtxScanTileBytes              (DmtxScanTileSize * DmtxScanTileSize)
+
+#define DmtxThreadMax                 64
+#define DmtxSeedsPerWorker            32
+#define DmtxTrackRadiusMax            8
+
 #undef min
 #define min(X,Y) (((X) < (Y)) ? (X) : (Y))
 
@@ -94,15 +122,14 @@ typedef enum {
 } DmtxMaskBit;
 
 /**
- * @struct DmtxFollow
- * @brief DmtxFollow
+ * @struct DmtxTrail
+ * @brief Points of the most recently blazed trail, reused from region to region
  */
-typedef struct DmtxFollow_struct {
-   unsigned char  *ptr;
-   unsigned char   neighbor;
-   int             step;
-   DmtxPixelLoc    loc;
-} DmtxFollow;
+struct DmtxTrail_struct {
+   int             capacity;
+   int             count;
+   DmtxPixelLoc   *loc;
+};
 
 /**
  * @struct DmtxBresLine
@@ -124,31 +151,293 @@ typedef struct DmtxBresLine_struct {
    DmtxPixelLoc    loc1;
 } DmtxBresLine;
 
+typedef void (*DmtxCompassKernel)(const unsigned char *src, int srcStride, int width, int height,
+      unsigned short *dst, int dstStride);
+
+#define DmtxHoughLanes             184 /* DMTX_HOUGH_RES rounded up to a multiple of 8 */
+
+/**
+ * @struct DmtxHough
+ * @brief Hough accumulator of FindBestSolidLine() with its running leader
+ */
+typedef struct DmtxHough_struct {
+   int             count[3][DmtxHoughLanes]; /* Votes per offset band and angle */
+   int             test[DmtxHoughLanes];     /* -1 for angles to test, 0 otherwise */
+   short           pair[2*DmtxHoughLanes];   /* rHvX[i] and -rHvY[i] interleaved */
+   int             angleBest;
+   int             offsetBest;
+   int             mag;         /* Votes of the leading angle and offset */
+   void          (*kernel)(struct DmtxHough_struct *hough, int xDiff, int yDiff);
+} DmtxHough;
+
+typedef void (*DmtxHoughKernel)(DmtxHough *hough, int xDiff, int yDiff);
+
+/**
+ * @struct DmtxRsTable
+ * @brief Generator polynomial and LFSR feedback of one block error word count
+ */
+typedef struct DmtxRsTable_struct {
+   int             errorWords;
+   int             width;       /* Row length rounded up to 32 for vector kernels */
+   DmtxByte        gen[DmtxRsRowMax];
+   DmtxByte       *feedback;    /* 256 rows of width bytes, row v holding v * gen */
+} DmtxRsTable;
+
+typedef void (*DmtxGfLfsrKernel)(DmtxByte *rem, const DmtxRsTable *table, const unsigned char *data,
+      int dataWords, int stride);
+typedef void (*DmtxGfPolyEvalKernel)(const DmtxByte *poly, int length, int first, int count, DmtxByte *out);
+
+/**
+ * @struct DmtxSaliency
+ * @brief Edge energy of scan grid cells and the order they are visited in
+ */
+struct DmtxSaliency_struct {
+   int             cellSize;    /* Width and height of a cell in scaled pixels */
+   int             cols;
+   int             rows;
+   int             cellCount;
+   int             activeCount; /* Cells with nonzero energy, sorted first */
+   int            *energy;      /* Sampled edge count of each cell */
+   int            *order;       /* Cell indices by decreasing energy */
+};
+
+/**
+ * @struct DmtxFlowCache
+ * @brief DmtxFlowCache
+ */
+struct DmtxFlowCache_struct {
+   int             width;
+   int             height;
+   int             planeCount;
+   int             tileCols;
+   int             tileRows;
+   DmtxCompassKernel compassKernel; /* Fills whole tiles, or NULL to fill per pixel */
+   unsigned short **tile;       /* tileCols * tileRows * planeCount, NULL until touched */
+   long            hits;
+   long            misses;
+};
+
+/**
+ * @struct DmtxScanTileBox
+ * @brief Inclusive pixel bounds within one scan cache tile, empty while xMin > xMax
+ */
+typedef struct DmtxScanTileBox_struct {
+   unsigned char   xMin;
+   unsigned char   yMin;
+   unsigned char   xMax;
+   unsigned char   yMax;
+} DmtxScanTileBox;
+
+/**
+ * @struct DmtxScanCache
+ * @brief DmtxScanCache
+ */
+struct DmtxScanCache_struct {
+   int             width;
+   int             height;
+   int             tileCols;
+   int             tileRows;
+   long            bytes;       /* Memory held by allocated tiles */
+   long            limit;       /* Cap on bytes, or 0 for no limit */
+   int             refused;     /* Tile allocations the limit refused since the last reset */
+   unsigned char **tile;        /* tileCols * tileRows, NULL until written */
+   DmtxScanTileBox *dirtyBox;   /* Per tile bounds of pixels handed out since the last reset */
+   int            *dirtyTile;   /* Indices of tiles with a non-empty dirtyBox */
+   int             dirtyCount;
+};
+
+/**
+ * @struct DmtxArenaChunk
+ * @brief One block of memory handed out piecewise by a DmtxArena
+ */
+typedef struct DmtxArenaChunk_struct {
+   struct DmtxArenaChunk_struct *next;
+   size_t          size;        /* Usable bytes following the chunk header */
+   size_t          used;
+} DmtxArenaChunk;
+
+/**
+ * @struct DmtxArena
+ * @brief DmtxArena
+ */
+struct DmtxArena_struct {
+   DmtxArenaChunk *first;
+   DmtxArenaChunk *current;     /* Chunk being filled, or NULL before the first allocation */
+   size_t          chunkSize;
+   long            bytes;       /* Memory held by all chunks */
+};
+
+/**
+ * @struct DmtxArenaMark
+ * @brief Arena fill level returned by ArenaGetMark()
+ */
+typedef struct DmtxArenaMark_struct {
+   DmtxArenaChunk *chunk;
+   size_t          used;
+} DmtxArenaMark;
+
+/**
+ * @struct DmtxPlacementMap
+ * @brief Mapping matrix module carrying each codeword bit of one symbol size
+ */
+typedef struct DmtxPlacementMap_struct {
+   int             codewords;   /* Number of codewords placed */
+   int             fixedCount;  /* Corner pattern modules that are always on */
+   int             fixed[2];
+   unsigned short *module;      /* 8 modules per codeword, most significant bit first */
+} DmtxPlacementMap;
+
+typedef void (*DmtxWorkerFunc)(void *job, int worker);
+
+/* Without pthreads, executor tasks claim work with the compiler's atomics */
+#if !defined(HAVE_PTHREAD) && (defined(__GNUC__) || defined(__clang__))
+#define DMTX_QUEUE_ATOMIC
+typedef int DmtxAtomicInt;
+#define DmtxAtomicFetchInc(p) __atomic_fetch_add((p), 1, __ATOMIC_RELAXED)
+#elif !defined(HAVE_PTHREAD) && defined(_MSC_VER)
+#define DMTX_QUEUE_ATOMIC
+typedef long DmtxAtomicInt;
+#define DmtxAtomicFetchInc(p) (_InterlockedIncrement(p) - 1)
+#else
+typedef int DmtxAtomicInt;
+#endif
+
+/**
+ * @struct DmtxWorkQueue
+ * @brief Numbered work items claimed one at a time by worker threads
+ */
+typedef struct DmtxWorkQueue_struct {
+   DmtxAtomicInt   next;
+   int             count;
+#ifdef HAVE_PTHREAD
+   pthread_mutex_t lock;
+#endif
+} DmtxWorkQueue;
+
+/**
+ * @struct DmtxRegionList
+ * @brief Growable list of regions
+ */
+typedef struct DmtxRegionList_struct {
+   DmtxRegion    **region;
+   int             count;
+   int             capacity;
+   DmtxBoolean     failed;      /* An allocation failed while filling the list */
+} DmtxRegionList;
+
+/**
+ * @struct DmtxFindAllJob
+ * @brief Shared state of a tile-parallel dmtxRegionFindAll() call
+ */
+typedef struct DmtxFindAllJob_struct {
+   DmtxDecode     *worker[DmtxThreadMax];
+   DmtxWorkQueue   queue;       /* One item per tile */
+   int             tileSize;
+   int             tileCols;
+   int             xMin;
+   int             yMin;
+   int             xMax;
+   int             yMax;
+   DmtxRegionList *found;       /* Regions found from the seeds of each tile */
+} DmtxFindAllJob;
+
+/**
+ * @struct DmtxBatchJob
+ * @brief Shared state of a dmtxDecodeBatch() call
+ */
+typedef struct DmtxBatchJob_struct {
+   DmtxImage     **images;
+   int             scale;
+   const int      *props;
+   DmtxScanConstraint *constraints;
+   DmtxDecodeResult *results;
+   DmtxWorkQueue   queue;       /* One item per image */
+   DmtxDecode     *worker[DmtxThreadMax]; /* Decoder recycled by each worker */
+} DmtxBatchJob;
+
+/**
+ * @struct DmtxSeed
+ * @brief Scan grid location with the edge sought there ahead of the scan
+ */
+typedef struct DmtxSeed_struct {
+   DmtxPixelLoc    loc;
+   DmtxPointFlow   flow;        /* MatrixRegionSeekEdge() result */
+   int             occupied;    /* Assigned bits around loc when flow was sought */
+} DmtxSeed;
+
+/**
+ * @struct DmtxSeedBatch
+ * @brief Seeds whose edges are sought in parallel before the scan reaches them
+ */
+typedef struct DmtxSeedBatch_struct {
+   DmtxSeed       *seed;
+   int             capacity;
+   int             count;
+   int             next;        /* Seeds of the batch the scan has reached */
+   DmtxDecode      seeker;      /* Copy of the scanning decoder without flow cache */
+   DmtxWorkQueue   queue;       /* One item per seed */
+} DmtxSeedBatch;
+
+/**
+ * @struct DmtxPopulateJob
+ * @brief Shared state of reading the data regions of one symbol in parallel
+ */
+typedef struct DmtxPopulateJob_struct {
+   DmtxDecode     *dec;
+   DmtxRegion     *reg;
+   DmtxMessage    *msg;
+   DmtxWorkQueue   queue;       /* One item per data region */
+} DmtxPopulateJob;
+
 typedef struct C40TextState_struct {
    int             shift;
    DmtxBoolean     upperShift;
 } C40TextState;
 
 /* dmtxregion.c */
+static DmtxRegion *RegionCreate(DmtxArena *arena, DmtxRegion *reg);
+static void FindAllWorker(void *job, int worker);
+static DmtxPassFail RegionListAppend(DmtxRegionList *list, DmtxRegion *reg);
+static DmtxBoolean RegionContainsCenter(DmtxRegion *reg, DmtxRegion *other);
+static DmtxPassFail TrackVerify(DmtxDecode *dec, DmtxRegion *prev, DmtxVector2 shift, DmtxRegion *reg);
 static double RightAngleTrueness(DmtxVector2 c0, DmtxVector2 c1, DmtxVector2 c2, double angle);
+static DmtxPassFail MatrixRegionLocate(DmtxDecode *dec, int x, int y, DmtxRegion *reg);
+static DmtxRegion *PyramidScanPixel(DmtxDecode *dec, int x, int y);
+static DmtxPassFail SeedBatchReserve(DmtxDecode *dec, int capacity);
+static void SeedBatchReset(DmtxSeedBatch *batch);
+static void SeedBatchDestroy(DmtxSeedBatch **batch);
+static void SeedBatchFill(DmtxDecode *dec, DmtxSeedBatch *batch, DmtxScanGrid grid, int workerCount);
+static void SeedBatchWorker(void *job, int worker);
+static int SeedOccupied(DmtxDecode *dec, DmtxPixelLoc loc);
+static DmtxPointFlow SeedBatchFlow(DmtxDecode *dec, DmtxPixelLoc loc);
+static DmtxPixelLoc PyramidLocToFull(DmtxPixelLoc loc, int levels);
 static DmtxPointFlow MatrixRegionSeekEdge(DmtxDecode *dec, DmtxPixelLoc loc0);
 static DmtxPassFail MatrixRegionOrientation(DmtxDecode *dec, DmtxRegion *reg, DmtxPointFlow flowBegin);
 static long DistanceSquared(DmtxPixelLoc a, DmtxPixelLoc b);
-static int ReadModuleColor(DmtxDecode *dec, DmtxRegion *reg, int symbolRow, int symbolCol, int sizeIdx, int colorPlane);
+static void ReadModuleColorLine(DmtxDecode *dec, DmtxRegion *reg, int symbolRow, int symbolCol,
+      const DmtxSymbolDescriptor *symbol, int colorPlane, DmtxDirection dir, int count, int *color);
 
 static DmtxPassFail MatrixRegionFindSize(DmtxDecode *dec, DmtxRegion *reg);
+static DmtxPassFail MatrixRegionBestSize(DmtxDecode *dec, DmtxRegion *reg, const int *candidate, int candidateCount);
+static int EstimateSizeCandidates(DmtxDecode *dec, DmtxRegion *reg, int sizeIdxBeg, int sizeIdxEnd, int *candidate);
+static int CountBarModules(DmtxDecode *dec, DmtxRegion *reg, DmtxDirection dir, double depth);
+static void ReadCalibrationColors(DmtxDecode *dec, DmtxRegion *reg, const DmtxSymbolDescriptor *symbol,
+      int *colorOnAvg, int *colorOffAvg);
+static DmtxPassFail MatrixRegionCheckSize(DmtxDecode *dec, DmtxRegion *reg, int sizeIdx, int colorOnAvg, int colorOffAvg);
 static int CountJumpTally(DmtxDecode *dec, DmtxRegion *reg, int xStart, int yStart, DmtxDirection dir);
 static DmtxPointFlow GetPointFlow(DmtxDecode *dec, int colorPlane, DmtxPixelLoc loc, int arrive);
+static DmtxPointFlow ComputePointFlow(DmtxDecode *dec, int colorPlane, DmtxPixelLoc loc, int arrive);
 static DmtxPointFlow FindStrongestNeighbor(DmtxDecode *dec, DmtxPointFlow center, int sign);
-static DmtxFollow FollowSeek(DmtxDecode *dec, DmtxRegion *reg, int seek);
-static DmtxFollow FollowSeekLoc(DmtxDecode *dec, DmtxPixelLoc loc);
-static DmtxFollow FollowStep(DmtxDecode *dec, DmtxRegion *reg, DmtxFollow followBeg, int sign);
-static DmtxFollow FollowStep2(DmtxDecode *dec, DmtxFollow followBeg, int sign);
+static DmtxPassFail TrailStart(DmtxDecode *dec, DmtxPixelLoc loc);
+static DmtxPassFail TrailPush(DmtxDecode *dec, DmtxPixelLoc loc);
+static DmtxPixelLoc TrailLoc(DmtxDecode *dec, DmtxRegion *reg, int step);
+static void TrailDestroy(DmtxTrail **trail);
 static DmtxPassFail TrailBlazeContinuous(DmtxDecode *dec, DmtxRegion *reg, DmtxPointFlow flowBegin, int maxDiagonal);
 static int TrailBlazeGapped(DmtxDecode *dec, DmtxRegion *reg, DmtxBresLine line, int streamDir);
-static int TrailClear(DmtxDecode *dec, DmtxRegion *reg, int clearMask);
+static int TrailClear(DmtxDecode *dec, int clearMask);
 static DmtxBestLine FindBestSolidLine(DmtxDecode *dec, DmtxRegion *reg, int step0, int step1, int streamDir, int houghAvoid);
-static DmtxBestLine FindBestSolidLine2(DmtxDecode *dec, DmtxPixelLoc loc0, int tripSteps, int sign, int houghAvoid);
+static DmtxBestLine FindBestSolidLine2(DmtxDecode *dec, DmtxPixelLoc loc0, int tripSteps, int houghAvoid);
+static void HoughInit(DmtxHough *hough, int houghAvoid);
 static DmtxPassFail FindTravelLimits(DmtxDecode *dec, DmtxRegion *reg, DmtxBestLine *line);
 static DmtxPassFail MatrixRegionAlignCalibEdge(DmtxDecode *dec, DmtxRegion *reg, int whichEdge);
 static DmtxBresLine BresLineInit(DmtxPixelLoc loc0, DmtxPixelLoc loc1, DmtxPixelLoc locInside);
@@ -157,11 +446,95 @@ static DmtxPassFail BresLineStep(DmtxBresLine *line, int travel, int outward);
 /*static void WriteDiagnosticImage(DmtxDecode *dec, DmtxRegion *reg, char *imagePath);*/
 
 /* dmtxdecode.c */
-static void TallyModuleJumps(DmtxDecode *dec, DmtxRegion *reg, int tally[][24], int xOrigin, int yOrigin, int mapWidth, int mapHeight, DmtxDirection dir);
+static DmtxImage *DecodeScanImage(DmtxDecode *dec);
+static DmtxPassFail DecodeBuildScanPlane(DmtxDecode *dec);
+static DmtxPassFail DecodeResetFlowCache(DmtxDecode *dec, DmtxBoolean enable);
+static DmtxPassFail DecodeResetSaliency(DmtxDecode *dec);
+static int DecodePyramidLevelsMax(DmtxDecode *dec);
+static DmtxPassFail DecodeBuildPyramid(DmtxDecode *dec);
+static void DecodeDestroyPyramid(DmtxDecode *dec);
+static DmtxPassFail DecodeSyncPyramid(DmtxDecode *dec);
+static DmtxDecode *DecodeCreateWorker(DmtxDecode *dec);
+static void DecodeDestroyWorker(DmtxDecode **worker);
+static DmtxPassFail DecodeSetTile(DmtxDecode *worker, int xMin, int yMin, int xMax, int yMax);
+static DmtxPassFail DecodeMarkRegion(DmtxDecode *dec, DmtxRegion *reg);
+static void ReadRegionColors(DmtxDecode *dec, DmtxRegion *reg, const DmtxSymbolDescriptor *symbol,
+      int color[][DmtxMapGridMax], int xOrigin, int yOrigin);
+static void TallyModuleJumps(DmtxRegion *reg, int tally[][24], int color[][DmtxMapGridMax], int xOrigin, int yOrigin, int mapWidth, int mapHeight, DmtxDirection dir);
 static DmtxPassFail PopulateArrayFromMatrix(DmtxDecode *dec, DmtxRegion *reg, DmtxMessage *msg);
+static void PopulateArrayWorker(void *job, int worker);
+static void PopulateDataRegion(DmtxDecode *dec, DmtxRegion *reg, DmtxMessage *msg, int regionIdx);
+static DmtxPassFail DecodePopulatedArray(int sizeIdx, DmtxMessage *msg, int fix);
+static DmtxBoolean ReadErasures(DmtxMessage *msg, int sizeIdx, unsigned char *erasure);
+static DmtxPassFail DecodeImageAll(DmtxDecode *dec, DmtxScanConstraint *constraint, int expectedCount,
+      DmtxDecodeResult *result);
+static DmtxPassFail DecodeResultAppend(DmtxDecodeResult *result, DmtxRegion *reg, DmtxMessage *msg);
+static void DecodeResultClear(DmtxDecodeResult *result);
+
+/* dmtxmessage.c */
+static DmtxMessage *MessageCreate(DmtxArena *arena, int sizeIdx, int symbolFormat);
+static DmtxPassFail MessageResize(DmtxArena *arena, DmtxMessage *msg, int sizeIdx, int symbolFormat);
+static DmtxPassFail MessageGrowBuffer(DmtxArena *arena, unsigned char **buf, size_t *capacity, size_t size);
+
+/* dmtxflowcache.c */
+static DmtxFlowCache *FlowCacheCreate(int width, int height, int planeCount, DmtxCompassKernel kernel);
+static void FlowCacheDestroy(DmtxFlowCache **cache);
+static unsigned short *FlowCacheCreateTile(DmtxDecode *dec, int plane, int tileCol, int tileRow);
+static DmtxPointFlow FlowCacheGetPointFlow(DmtxDecode *dec, int colorPlane, DmtxPixelLoc loc, int arrive);
+
+/* dmtxscancache.c */
+static DmtxScanCache *ScanCacheCreate(int width, int height);
+static void ScanCacheDestroy(DmtxScanCache **cache);
+static unsigned char *ScanCacheGet(DmtxScanCache *cache, int x, int y, DmtxBoolean capped);
+static int ScanCacheRead(const DmtxScanCache *cache, int x, int y);
+static void ScanCacheReset(DmtxScanCache *cache);
+
+/* dmtxalloc.c */
+static void *MemAlloc(size_t size);
+static void *MemCalloc(size_t count, size_t size);
+static void MemFree(void *ptr);
+static DmtxArena *ArenaCreate(size_t chunkSize);
+static void ArenaDestroy(DmtxArena **arena);
+static void *ArenaAlloc(DmtxArena *arena, size_t size);
+static void *ArenaCalloc(DmtxArena *arena, size_t count, size_t size);
+static DmtxArenaMark ArenaGetMark(DmtxArena *arena);
+static void ArenaRelease(DmtxArena *arena, DmtxArenaMark mark);
+static void ArenaReset(DmtxArena *arena);
+
+/* dmtxbatch.c */
+static void BatchWorker(void *job, int worker);
+static DmtxDecode *BatchCreateDecode(DmtxBatchJob *batch, DmtxImage *img);
+
+/* dmtxthread.c */
+static int ThreadCount(const DmtxExecutor *executor, int requested);
+static DmtxPassFail WorkQueueInit(DmtxWorkQueue *queue, int itemCount);
+static void WorkQueueDestroy(DmtxWorkQueue *queue);
+static int WorkQueueNext(DmtxWorkQueue *queue);
+#ifndef HAVE_PTHREAD
+static void ThreadBuildSharedTables(void);
+#endif
+static void ThreadRunWorkers(const DmtxExecutor *executor, int workerCount, DmtxWorkerFunc func, void *job);
+
+/* dmtxsimd.c */
+static void CompassKernelScalar(const unsigned char *src, int srcStride, int width, int height, unsigned short *dst, int dstStride);
+static DmtxCompassKernel SimdPickCompassKernel(void);
+static void HoughKernelScalar(DmtxHough *hough, int xDiff, int yDiff);
+static DmtxHoughKernel SimdPickHoughKernel(void);
+static void GfLfsrScalar(DmtxByte *rem, const DmtxRsTable *table, const unsigned char *data,
+      int dataWords, int stride);
+static void GfPolyEvalScalar(const DmtxByte *poly, int length, int first, int count, DmtxByte *out);
+static DmtxGfLfsrKernel SimdPickGfLfsrKernel(void);
+static DmtxGfPolyEvalKernel SimdPickGfPolyEvalKernel(void);
+static void SimdPickKernels(void);
+static void SimdInitKernels(void);
+static DmtxCompassKernel SimdCompassKernel(void);
+static DmtxHoughKernel SimdHoughKernel(void);
+static DmtxGfLfsrKernel SimdGfLfsrKernel(int errorWords);
+static DmtxGfPolyEvalKernel SimdGfPolyEvalKernel(int count);
 
 /* dmtxdecodescheme.c */
 static DmtxPassFail DecodeDataStream(DmtxMessage *msg, int sizeIdx, unsigned char *outputStart);
+static size_t DecodeOutputBound(int sizeIdx);
 static int GetEncodationScheme(unsigned char cw);
 static void PushOutputWord(DmtxMessage *msg, int value);
 static void PushOutputC40TextWord(DmtxMessage *msg, C40TextState *state, int value);
@@ -183,20 +556,29 @@ static void PrintPattern(DmtxEncode *encode);
 
 /* dmtxplacemod.c */
 static int ModulePlacementEcc200(unsigned char *modules, unsigned char *codewords, int sizeIdx, int moduleOnColor);
-static void PatternShapeStandard(unsigned char *modules, int mappingRows, int mappingCols, int row, int col, unsigned char *codeword, int moduleOnColor);
-static void PatternShapeSpecial1(unsigned char *modules, int mappingRows, int mappingCols, unsigned char *codeword, int moduleOnColor);
-static void PatternShapeSpecial2(unsigned char *modules, int mappingRows, int mappingCols, unsigned char *codeword, int moduleOnColor);
-static void PatternShapeSpecial3(unsigned char *modules, int mappingRows, int mappingCols, unsigned char *codeword, int moduleOnColor);
-static void PatternShapeSpecial4(unsigned char *modules, int mappingRows, int mappingCols, unsigned char *codeword, int moduleOnColor);
-static void PlaceModule(unsigned char *modules, int mappingRows, int mappingCols, int row, int col,
-      unsigned char *codeword, int mask, int moduleOnColor);
+static const DmtxPlacementMap *PlacementMapGet(int sizeIdx);
+static void PlacementMapBuildAll(void);
+static void PlacementMapBuild(DmtxPlacementMap *map, int sizeIdx);
+static void PatternShapeStandard(unsigned short *module, unsigned char *placed, int mappingRows, int mappingCols,
+      int row, int col, int chr);
+static void PatternShapeSpecial1(unsigned short *module, unsigned char *placed, int mappingRows, int mappingCols, int chr);
+static void PatternShapeSpecial2(unsigned short *module, unsigned char *placed, int mappingRows, int mappingCols, int chr);
+static void PatternShapeSpecial3(unsigned short *module, unsigned char *placed, int mappingRows, int mappingCols, int chr);
+static void PatternShapeSpecial4(unsigned short *module, unsigned char *placed, int mappingRows, int mappingCols, int chr);
+static void PlaceModule(unsigned short *module, unsigned char *placed, int mappingRows, int mappingCols,
+      int row, int col, int chr, int mask);
 
 /* dmtxreedsol.c */
 static DmtxPassFail RsEncode(DmtxMessage *message, int sizeIdx);
-static DmtxPassFail RsDecode(unsigned char *code, int sizeIdx, int fix);
+static DmtxPassFail RsDecode(unsigned char *code, int sizeIdx, int fix, const unsigned char *erasure);
+static DmtxBoolean RsRepairBlock(DmtxByteList *rec, const DmtxByteList *syn, const DmtxByteList *era,
+      int blockErrorWords, int blockMaxCorrectable);
 static DmtxPassFail RsGenPoly(DmtxByteList *gen, int errorWordCount);
-static DmtxBoolean RsComputeSyndromes(DmtxByteList *syn, const DmtxByteList *rec, int blockErrorWords);
-static DmtxBoolean RsFindErrorLocatorPoly(DmtxByteList *elp, const DmtxByteList *syn, int errorWordCount, int maxCorrectable);
+static const DmtxRsTable *RsGetTable(int sizeIdx);
+static void RsBuildTables(void);
+static DmtxBoolean RsComputeSyndromes(DmtxByteList *syn, const DmtxByteList *rem, int blockErrorWords);
+static DmtxBoolean RsFindErrorLocatorPoly(DmtxByteList *elp, const DmtxByteList *syn, const DmtxByteList *era,
+      int errorWordCount, int maxCorrectable);
 static DmtxBoolean RsFindErrorLocations(DmtxByteList *loc, const DmtxByteList *elp);
 static DmtxPassFail RsRepairErrors(DmtxByteList *rec, const DmtxByteList *loc, const DmtxByteList *elp, const DmtxByteList *syn);
 
@@ -205,12 +587,40 @@ static DmtxScanGrid InitScanGrid(DmtxDecode *dec);
 static int PopGridLocation(DmtxScanGrid *grid, /*@out@*/ DmtxPixelLoc *locPtr);
 static int GetGridCoordinates(DmtxScanGrid *grid, /*@out@*/ DmtxPixelLoc *locPtr);
 static void SetDerivedFields(DmtxScanGrid *grid);
+static void SetCellFields(DmtxScanGrid *grid);
+static DmtxSaliency *SaliencyCreate(int width, int height, int cellSize);
+static void SaliencyDestroy(DmtxSaliency **saliency);
+static void SaliencyFill(DmtxSaliency *saliency, DmtxDecode *dec);
+static int SaliencySample(DmtxDecode *dec, int x, int y, int channel);
+static int SaliencyCompare(const void *a, const void *b);
 
 /* dmtxsymbol.c */
+static int SymbolBlockDataSize(const DmtxSymbolDescriptor *symbol, int blockIdx);
 static int FindSymbolSize(int dataWords, int sizeIdxRequest);
 
 /* dmtximage.c */
 static int GetBitsPerPixel(int pack);
+static void ImageBindAccessors(DmtxImage *img);
+static DmtxImage *ImageCreateScanPlane(DmtxImage *img, int scanPlane);
+static DmtxPassFail ImageFillScanPlane(DmtxImage *plane, DmtxImage *img, int scanPlane);
+static int ImageWidestChannel(DmtxImage *img);
+static void LumaRow24bpp(unsigned char *dst, const unsigned char *src, int width, int r, int g, int b);
+static void LumaRow32bpp(unsigned char *dst, const unsigned char *src, int width, int r, int g, int b);
+static void ChannelRow(unsigned char *dst, const unsigned char *src, int width, int bytesPerPixel);
+static DmtxImage *ImageCreatePyramidLevel(DmtxImage *img, int levels);
+static DmtxPassFail ImageFillPyramidLevel(DmtxImage *coarse, DmtxImage *img, int levels);
+static DmtxBoolean ImagePyramidPackingOk(DmtxImage *img);
+static int ImagePyramidSize(int length, int levels);
+static void HalveRow(unsigned char *dst, const unsigned char *first, const unsigned char *second,
+      int srcWidth, int bytesPerPixel);
+static int FetchPixel8bpp(const DmtxImage *img, int x, int y, int channel);
+static int FetchPixel24bpp(const DmtxImage *img, int x, int y, int channel);
+static int FetchPixel32bpp(const DmtxImage *img, int x, int y, int channel);
+static int FetchPixelGeneric(const DmtxImage *img, int x, int y, int channel);
+static void FetchCompass8bpp(const DmtxImage *img, int x, int y, int step, int channel, /*@out@*/ int *color);
+static void FetchCompass24bpp(const DmtxImage *img, int x, int y, int step, int channel, /*@out@*/ int *color);
+static void FetchCompass32bpp(const DmtxImage *img, int x, int y, int step, int channel, /*@out@*/ int *color);
+static void FetchCompassGeneric(const DmtxImage *img, int x, int y, int step, int channel, /*@out@*/ int *color);
 
 /* dmtxencodestream.c */
 static DmtxEncodeStream StreamInit(DmtxByteList *input, DmtxByteList *output);
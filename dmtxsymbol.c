@@ -37,6 +37,59 @@ getSizeIdxFromSymbolDimension(int rows, int cols)
 }
 
 
+/* Rows, cols, data region rows and cols, horiz and vert data regions, mapping
+   rows and cols, interleaved blocks, block data words, long blocks, block error
+   words and max correctable, symbol data words, error words and max correctable */
+static const DmtxSymbolDescriptor symbolDescriptor[DmtxSymbolSquareCount + DmtxSymbolRectCount] = {
+   {  10,  10,  8,  8, 1, 1,   8,   8,  1,   3, 0,  5,  2,    3,   5,   2 }, /* 10x10 */
+   {  12,  12, 10, 10, 1, 1,  10,  10,  1,   5, 0,  7,  3,    5,   7,   3 }, /* 12x12 */
+   {  14,  14, 12, 12, 1, 1,  12,  12,  1,   8, 0, 10,  5,    8,  10,   5 }, /* 14x14 */
+   {  16,  16, 14, 14, 1, 1,  14,  14,  1,  12, 0, 12,  6,   12,  12,   6 }, /* 16x16 */
+   {  18,  18, 16, 16, 1, 1,  16,  16,  1,  18, 0, 14,  7,   18,  14,   7 }, /* 18x18 */
+   {  20,  20, 18, 18, 1, 1,  18,  18,  1,  22, 0, 18,  9,   22,  18,   9 }, /* 20x20 */
+   {  22,  22, 20, 20, 1, 1,  20,  20,  1,  30, 0, 20, 10,   30,  20,  10 }, /* 22x22 */
+   {  24,  24, 22, 22, 1, 1,  22,  22,  1,  36, 0, 24, 12,   36,  24,  12 }, /* 24x24 */
+   {  26,  26, 24, 24, 1, 1,  24,  24,  1,  44, 0, 28, 14,   44,  28,  14 }, /* 26x26 */
+   {  32,  32, 14, 14, 2, 2,  28,  28,  1,  62, 0, 36, 18,   62,  36,  18 }, /* 32x32 */
+   {  36,  36, 16, 16, 2, 2,  32,  32,  1,  86, 0, 42, 21,   86,  42,  21 }, /* 36x36 */
+   {  40,  40, 18, 18, 2, 2,  36,  36,  1, 114, 0, 48, 24,  114,  48,  24 }, /* 40x40 */
+   {  44,  44, 20, 20, 2, 2,  40,  40,  1, 144, 0, 56, 28,  144,  56,  28 }, /* 44x44 */
+   {  48,  48, 22, 22, 2, 2,  44,  44,  1, 174, 0, 68, 34,  174,  68,  34 }, /* 48x48 */
+   {  52,  52, 24, 24, 2, 2,  48,  48,  2, 102, 0, 42, 21,  204,  84,  42 }, /* 52x52 */
+   {  64,  64, 14, 14, 4, 4,  56,  56,  2, 140, 0, 56, 28,  280, 112,  56 }, /* 64x64 */
+   {  72,  72, 16, 16, 4, 4,  64,  64,  4,  92, 0, 36, 18,  368, 144,  72 }, /* 72x72 */
+   {  80,  80, 18, 18, 4, 4,  72,  72,  4, 114, 0, 48, 24,  456, 192,  96 }, /* 80x80 */
+   {  88,  88, 20, 20, 4, 4,  80,  80,  4, 144, 0, 56, 28,  576, 224, 112 }, /* 88x88 */
+   {  96,  96, 22, 22, 4, 4,  88,  88,  4, 174, 0, 68, 34,  696, 272, 136 }, /* 96x96 */
+   { 104, 104, 24, 24, 4, 4,  96,  96,  6, 136, 0, 56, 28,  816, 336, 168 }, /* 104x104 */
+   { 120, 120, 18, 18, 6, 6, 108, 108,  6, 175, 0, 68, 34, 1050, 408, 204 }, /* 120x120 */
+   { 132, 132, 20, 20, 6, 6, 120, 120,  8, 163, 0, 62, 31, 1304, 496, 248 }, /* 132x132 */
+   { 144, 144, 22, 22, 6, 6, 132, 132, 10, 155, 8, 62, 31, 1558, 620, 310 }, /* 144x144 */
+   {   8,  18,  6, 16, 1, 1,   6,  16,  1,   5, 0,  7,  3,    5,   7,   3 }, /* 8x18 */
+   {   8,  32,  6, 14, 2, 1,   6,  28,  1,  10, 0, 11,  5,   10,  11,   5 }, /* 8x32 */
+   {  12,  26, 10, 24, 1, 1,  10,  24,  1,  16, 0, 14,  7,   16,  14,   7 }, /* 12x26 */
+   {  12,  36, 10, 16, 2, 1,  10,  32,  1,  22, 0, 18,  9,   22,  18,   9 }, /* 12x36 */
+   {  16,  36, 14, 16, 2, 1,  14,  32,  1,  32, 0, 24, 12,   32,  24,  12 }, /* 16x36 */
+   {  16,  48, 14, 22, 2, 1,  14,  44,  1,  49, 0, 28, 14,   49,  28,  14 }, /* 16x48 */
+};
+
+/**
+ * \brief  Retrieve all properties of a symbol size at once
+ * \param  sizeIdx
+ * \return Constant descriptor, or NULL for an invalid sizeIdx
+ *
+ * Code visiting many modules or blocks of one size should fetch this once
+ * instead of calling dmtxGetSymbolAttribute() for each value it needs.
+ */
+extern const DmtxSymbolDescriptor *
+dmtxGetSymbolDescriptor(int sizeIdx)
+{
+   if(sizeIdx < 0 || sizeIdx >= DmtxSymbolSquareCount + DmtxSymbolRectCount)
+      return NULL;
+
+   return &(symbolDescriptor[sizeIdx]);
+}
+
 /**
  * \brief  Retrieve property based on symbol size
  * \param  attribute
@@ -46,93 +99,41 @@ getSizeIdxFromSymbolDimension(int rows, int cols)
 extern int
 dmtxGetSymbolAttribute(int attribute, int sizeIdx)
 {
-   static const int symbolRows[] = { 10, 12, 14, 16, 18, 20,  22,  24,  26,
-                                                 32, 36, 40,  44,  48,  52,
-                                                 64, 72, 80,  88,  96, 104,
-                                                        120, 132, 144,
-                                                  8,  8, 12,  12,  16,  16 };
-
-   static const int symbolCols[] = { 10, 12, 14, 16, 18, 20,  22,  24,  26,
-                                                 32, 36, 40,  44,  48,  52,
-                                                 64, 72, 80,  88,  96, 104,
-                                                        120, 132, 144,
-                                                 18, 32, 26,  36,  36,  48 };
-
-   static const int dataRegionRows[] = { 8, 10, 12, 14, 16, 18, 20, 22, 24,
-                                                    14, 16, 18, 20, 22, 24,
-                                                    14, 16, 18, 20, 22, 24,
-                                                            18, 20, 22,
-                                                     6,  6, 10, 10, 14, 14 };
-
-   static const int dataRegionCols[] = { 8, 10, 12, 14, 16, 18, 20, 22, 24,
-                                                    14, 16, 18, 20, 22, 24,
-                                                    14, 16, 18, 20, 22, 24,
-                                                            18, 20, 22,
-                                                    16, 14, 24, 16, 16, 22 };
-
-   static const int horizDataRegions[] = { 1, 1, 1, 1, 1, 1, 1, 1, 1,
-                                                    2, 2, 2, 2, 2, 2,
-                                                    4, 4, 4, 4, 4, 4,
-                                                          6, 6, 6,
-                                                    1, 2, 1, 2, 2, 2 };
-
-   static const int interleavedBlocks[] = { 1, 1, 1, 1, 1, 1, 1,  1, 1,
-                                                     1, 1, 1, 1,  1, 2,
-                                                     2, 4, 4, 4,  4, 6,
-                                                           6, 8, 10,
-                                                     1, 1, 1, 1,  1, 1 };
-
-   static const int symbolDataWords[] = { 3, 5, 8,  12,   18,   22,   30,   36,  44,
-                                                    62,   86,  114,  144,  174, 204,
-                                                   280,  368,  456,  576,  696, 816,
-                                                              1050, 1304, 1558,
-                                                     5,   10,   16,   22,   32,  49 };
-
-   static const int blockErrorWords[] = { 5, 7, 10, 12, 14, 18, 20, 24, 28,
-                                                    36, 42, 48, 56, 68, 42,
-                                                    56, 36, 48, 56, 68, 56,
-                                                            68, 62, 62,
-                                                     7, 11, 14, 18, 24, 28 };
-
-   static const int blockMaxCorrectable[] = { 2, 3, 5,  6,  7,  9,  10,  12,  14,
-                                                       18, 21, 24,  28,  34,  21,
-                                                       28, 18, 24,  28,  34,  28,
-                                                               34,  31,  31,
-                                                   3,  5,  7,   9,  12,  14 };
+   const DmtxSymbolDescriptor *symbol;
 
-   if(sizeIdx < 0 || sizeIdx >= DmtxSymbolSquareCount + DmtxSymbolRectCount)
+   symbol = dmtxGetSymbolDescriptor(sizeIdx);
+   if(symbol == NULL)
       return DmtxUndefined;
 
    switch(attribute) {
       case DmtxSymAttribSymbolRows:
-         return symbolRows[sizeIdx];
+         return symbol->symbolRows;
       case DmtxSymAttribSymbolCols:
-         return symbolCols[sizeIdx];
+         return symbol->symbolCols;
       case DmtxSymAttribDataRegionRows:
-         return dataRegionRows[sizeIdx];
+         return symbol->dataRegionRows;
       case DmtxSymAttribDataRegionCols:
-         return dataRegionCols[sizeIdx];
+         return symbol->dataRegionCols;
       case DmtxSymAttribHorizDataRegions:
-         return horizDataRegions[sizeIdx];
+         return symbol->horizDataRegions;
       case DmtxSymAttribVertDataRegions:
-         return (sizeIdx < DmtxSymbolSquareCount) ? horizDataRegions[sizeIdx] : 1;
+         return symbol->vertDataRegions;
       case DmtxSymAttribMappingMatrixRows:
-         return dataRegionRows[sizeIdx] *
-               dmtxGetSymbolAttribute(DmtxSymAttribVertDataRegions, sizeIdx);
+         return symbol->mappingRows;
       case DmtxSymAttribMappingMatrixCols:
-         return dataRegionCols[sizeIdx] * horizDataRegions[sizeIdx];
+         return symbol->mappingCols;
       case DmtxSymAttribInterleavedBlocks:
-         return interleavedBlocks[sizeIdx];
+         return symbol->interleavedBlocks;
       case DmtxSymAttribBlockErrorWords:
-         return blockErrorWords[sizeIdx];
+         return symbol->blockErrorWords;
       case DmtxSymAttribBlockMaxCorrectable:
-         return blockMaxCorrectable[sizeIdx];
+         return symbol->blockMaxCorrectable;
       case DmtxSymAttribSymbolDataWords:
-         return symbolDataWords[sizeIdx];
+         return symbol->symbolDataWords;
       case DmtxSymAttribSymbolErrorWords:
-         return blockErrorWords[sizeIdx] * interleavedBlocks[sizeIdx];
+         return symbol->symbolErrorWords;
       case DmtxSymAttribSymbolMaxCorrectable:
-         return blockMaxCorrectable[sizeIdx] * interleavedBlocks[sizeIdx];
+         return symbol->symbolMaxCorrectable;
    }
 
    return DmtxUndefined;
@@ -147,19 +148,25 @@ dmtxGetSymbolAttribute(int attribute, int sizeIdx)
 extern int
 dmtxGetBlockDataSize(int sizeIdx, int blockIdx)
 {
-   int symbolDataWords;
-   int interleavedBlocks;
-   int count;
-
-   symbolDataWords = dmtxGetSymbolAttribute(DmtxSymAttribSymbolDataWords, sizeIdx);
-   interleavedBlocks = dmtxGetSymbolAttribute(DmtxSymAttribInterleavedBlocks, sizeIdx);
+   const DmtxSymbolDescriptor *symbol;
 
-   if(symbolDataWords < 1 || interleavedBlocks < 1)
+   symbol = dmtxGetSymbolDescriptor(sizeIdx);
+   if(symbol == NULL)
       return DmtxUndefined;
 
-   count = (int)(symbolDataWords/interleavedBlocks);
+   return SymbolBlockDataSize(symbol, blockIdx);
+}
 
-   return (sizeIdx == DmtxSymbol144x144 && blockIdx < 8) ? count + 1 : count;
+/**
+ * \brief  Data size of one block of a symbol size
+ * \param  symbol
+ * \param  blockIdx
+ * \return Number of data words in block blockIdx
+ */
+static int
+SymbolBlockDataSize(const DmtxSymbolDescriptor *symbol, int blockIdx)
+{
+   return (blockIdx < symbol->longBlocks) ? symbol->blockDataWords + 1 : symbol->blockDataWords;
 }
 
 /**
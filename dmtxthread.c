@@ -0,0 +1,239 @@
+/**
+ * libdmtx - Data Matrix Encoding/Decoding Library
+ * Copyright 2008, 2009 Mike Laughton. All rights reserved.
+ * Copyright 2012-2016 Vadim A. Misbakh-Soloviov. All rights reserved.
+ *
+ * See LICENSE file in the main project directory for full
+ * terms of use and distribution.
+ *
+ * Contact:
+ * Vadim A. Misbakh-Soloviov <dmtx@mva.name>
+ * Mike Laughton <mike@dragonflylogic.com>
+ *
+ * \file dmtxthread.c
+ * \brief Worker threads
+ */
+
+/**
+ * Parallel entry points describe their work as a queue of numbered items
+ * and a function run by every worker. Workers claim items from the queue
+ * until it is empty, so the split between workers does not matter as long
+ * as each item is processed independently. Workers run on library threads
+ * or, when the caller installed a DmtxExecutor, as tasks of the caller's own
+ * thread pool. Without HAVE_PTHREAD only an executor can run workers, and
+ * queues are claimed with atomic adds; where the compiler has no atomics,
+ * or no executor is installed, the calling thread processes every item
+ * itself.
+ */
+
+/**
+ * \brief  Resolve a requested worker count
+ * \param  executor Caller's task hooks, or NULL for library threads
+ * \param  requested Worker count, or 0 or less for one per online processor
+ * \return Worker count to use, at least 1
+ */
+static int
+ThreadCount(const DmtxExecutor *executor, int requested)
+{
+   long online = 1;
+
+#if !defined(HAVE_PTHREAD)
+#if defined(DMTX_QUEUE_ATOMIC)
+   if(executor == NULL || executor->submit == NULL)
+      return 1;
+#else
+   (void)executor;
+   return 1;
+#endif
+#else
+   (void)executor;
+#endif
+
+   if(requested > 0)
+      return min(requested, DmtxThreadMax);
+
+#if defined(_SC_NPROCESSORS_ONLN)
+   online = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+   return (online < 1) ? 1 : (int)min(online, DmtxThreadMax);
+}
+
+/**
+ * \brief  Initialize a queue of numbered work items
+ * \param  queue
+ * \param  itemCount
+ * \return DmtxPass | DmtxFail
+ */
+static DmtxPassFail
+WorkQueueInit(DmtxWorkQueue *queue, int itemCount)
+{
+   queue->next = 0;
+   queue->count = itemCount;
+#ifdef HAVE_PTHREAD
+   if(pthread_mutex_init(&(queue->lock), NULL) != 0)
+      return DmtxFail;
+#endif
+
+   return DmtxPass;
+}
+
+/**
+ * \brief  Release resources held by a work queue
+ * \param  queue
+ * \return void
+ */
+static void
+WorkQueueDestroy(DmtxWorkQueue *queue)
+{
+#ifdef HAVE_PTHREAD
+   pthread_mutex_destroy(&(queue->lock));
+#else
+   (void)queue;
+#endif
+}
+
+/**
+ * \brief  Claim the next unprocessed work item
+ * \param  queue
+ * \return Item index, or DmtxUndefined when every item has been claimed
+ */
+static int
+WorkQueueNext(DmtxWorkQueue *queue)
+{
+   int item;
+
+#if defined(HAVE_PTHREAD)
+   pthread_mutex_lock(&(queue->lock));
+   item = (queue->next < queue->count) ? queue->next++ : DmtxUndefined;
+   pthread_mutex_unlock(&(queue->lock));
+#elif defined(DMTX_QUEUE_ATOMIC)
+   /* Claims past the end only push next further; results are published by
+      the executor's wait() */
+   item = (int)DmtxAtomicFetchInc(&(queue->next));
+   if(item >= queue->count)
+      item = DmtxUndefined;
+#else
+   item = (queue->next < queue->count) ? queue->next++ : DmtxUndefined;
+#endif
+
+   return item;
+}
+
+/**
+ * @struct DmtxThreadArg
+ * @brief Start routine argument for one worker thread
+ */
+typedef struct DmtxThreadArg_struct {
+   DmtxWorkerFunc  func;
+   void           *job;
+   int             worker;
+} DmtxThreadArg;
+
+/**
+ * \brief  Executor task calling a worker function
+ * \param  arg DmtxThreadArg
+ * \return void
+ */
+static void
+ThreadTask(void *arg)
+{
+   DmtxThreadArg *threadArg;
+
+   threadArg = (DmtxThreadArg *)arg;
+   threadArg->func(threadArg->job, threadArg->worker);
+}
+
+#ifdef HAVE_PTHREAD
+/**
+ * \brief  pthread start routine calling a worker function
+ * \param  arg DmtxThreadArg
+ * \return NULL
+ */
+static void *
+ThreadStart(void *arg)
+{
+   ThreadTask(arg);
+
+   return NULL;
+}
+#else
+/**
+ * \brief  Build the tables every worker reads before any worker starts
+ * \return void
+ *
+ * Without HAVE_PTHREAD these tables are built on first use behind a plain
+ * flag rather than pthread_once(), which is only safe while a single thread
+ * runs library code.
+ */
+static void
+ThreadBuildSharedTables(void)
+{
+   RsGetTable(0);
+   PlacementMapGet(0);
+   SimdInitKernels();
+}
+#endif
+
+/**
+ * \brief  Run a worker function on several threads and wait for all of them
+ * \param  executor Caller's task hooks, or NULL to start library threads
+ * \param  workerCount Number of workers from ThreadCount()
+ * \param  func Called once per worker with the worker index
+ * \param  job Shared job description passed to func
+ * \return void
+ *
+ * Worker 0 runs on the calling thread. If a thread cannot be started, its
+ * share of the queue is simply left to the workers that did start. With an
+ * executor the other workers are submitted as tasks instead, and may start
+ * after the calling thread has emptied the queue; wait() then has to run
+ * them, which is why it must run queued tasks rather than only block.
+ */
+static void
+ThreadRunWorkers(const DmtxExecutor *executor, int workerCount, DmtxWorkerFunc func, void *job)
+{
+   int i;
+   DmtxBoolean submit;
+   DmtxThreadArg arg[DmtxThreadMax];
+#ifdef HAVE_PTHREAD
+   pthread_t thread[DmtxThreadMax];
+   DmtxBoolean started[DmtxThreadMax];
+#endif
+
+   submit = (workerCount > 1 && executor != NULL && executor->submit != NULL) ?
+         DmtxTrue : DmtxFalse;
+
+   assert(workerCount >= 1 && workerCount <= DmtxThreadMax);
+#ifndef HAVE_PTHREAD
+   assert(workerCount == 1 || submit == DmtxTrue);
+   if(submit == DmtxTrue)
+      ThreadBuildSharedTables();
+#endif
+
+   for(i = 1; i < workerCount; i++) {
+      arg[i].func = func;
+      arg[i].job = job;
+      arg[i].worker = i;
+      if(submit == DmtxTrue) {
+         executor->submit(ThreadTask, &arg[i], executor->userData);
+      }
+#ifdef HAVE_PTHREAD
+      else {
+         started[i] = (pthread_create(&thread[i], NULL, ThreadStart, &arg[i]) == 0) ?
+               DmtxTrue : DmtxFalse;
+      }
+#endif
+   }
+
+   func(job, 0);
+
+   if(submit == DmtxTrue)
+      executor->wait(executor->userData);
+
+#ifdef HAVE_PTHREAD
+   for(i = 1; i < workerCount && submit == DmtxFalse; i++) {
+      if(started[i] == DmtxTrue)
+         pthread_join(thread[i], NULL);
+   }
+#endif
+}
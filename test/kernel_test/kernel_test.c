@@ -0,0 +1,268 @@
+/**
+ * libdmtx - Data Matrix Encoding/Decoding Library
+ *
+ * See LICENSE file in the main project directory for full
+ * terms of use and distribution.
+ *
+ * \file kernel_test.c
+ *
+ * Checks that every vector kernel the running CPU supports matches its scalar
+ * version exactly. The library is included whole so its internal kernels can
+ * be called directly.
+ */
+
+#include "../../dmtx.c"
+
+#define KernelMax 3
+
+typedef struct {
+   const char *name;
+   DmtxCompassKernel compass;
+   DmtxHoughKernel hough;
+   DmtxGfLfsrKernel lfsr;
+   DmtxGfPolyEvalKernel polyEval;
+} KernelSet;
+
+static void FatalError(const char *kernel, const char *msg, int idx);
+static int kernelSetsSupported(KernelSet *sets);
+static void compassKernelTest(const KernelSet *sets, int setCount);
+static void houghKernelTest(const KernelSet *sets, int setCount);
+static void gfLfsrKernelTest(const KernelSet *sets, int setCount);
+static void gfPolyEvalKernelTest(const KernelSet *sets, int setCount);
+
+int
+main(int argc, char *argv[])
+{
+   int setCount;
+   KernelSet sets[KernelMax];
+
+   (void)argc;
+   (void)argv;
+
+   srand(1);
+   setCount = kernelSetsSupported(sets);
+
+   compassKernelTest(sets, setCount);
+   houghKernelTest(sets, setCount);
+   gfLfsrKernelTest(sets, setCount);
+   gfPolyEvalKernelTest(sets, setCount);
+
+   fprintf(stdout, "%d kernel sets match the scalar kernels\n", setCount);
+
+   exit(0);
+}
+
+static void
+FatalError(const char *kernel, const char *msg, int idx)
+{
+   fprintf(stdout, "FAIL: %s %s (%d)\n", kernel, msg, idx);
+   exit(1);
+}
+
+/**
+ * List the scalar kernels first, then each vector set the CPU runs. A set
+ * without a version of some kernel reuses the scalar one.
+ */
+static int
+kernelSetsSupported(KernelSet *sets)
+{
+   int setCount = 0;
+
+   sets[setCount].name = "scalar";
+   sets[setCount].compass = CompassKernelScalar;
+   sets[setCount].hough = HoughKernelScalar;
+   sets[setCount].lfsr = GfLfsrScalar;
+   sets[setCount].polyEval = GfPolyEvalScalar;
+   setCount++;
+
+#if defined(DMTX_SIMD_X86_DISPATCH)
+   __builtin_cpu_init();
+   if(__builtin_cpu_supports("sse2")) {
+      sets[setCount] = sets[0];
+      sets[setCount].name = "sse2";
+      sets[setCount].compass = CompassKernelSse2;
+      sets[setCount].hough = HoughKernelSse2;
+      sets[setCount].lfsr = GfLfsrSse2;
+      if(__builtin_cpu_supports("ssse3"))
+         sets[setCount].polyEval = GfPolyEvalSsse3;
+      setCount++;
+   }
+   if(__builtin_cpu_supports("avx2")) {
+      sets[setCount] = sets[0];
+      sets[setCount].name = "avx2";
+      sets[setCount].compass = CompassKernelAvx2;
+      sets[setCount].hough = HoughKernelAvx2;
+      sets[setCount].lfsr = GfLfsrAvx2;
+      setCount++;
+   }
+#elif defined(DMTX_SIMD_SSE2_ONLY)
+   sets[setCount] = sets[0];
+   sets[setCount].name = "sse2";
+   sets[setCount].compass = CompassKernelSse2;
+   sets[setCount].hough = HoughKernelSse2;
+   setCount++;
+#endif
+
+   return setCount;
+}
+
+/**
+ * Fill every block width up to a full tile, including the ragged tails the
+ * vector loops finish one pixel at a time, from noise and from saturated
+ * edges that push the compass sums to their limits.
+ */
+static void
+compassKernelTest(const KernelSet *sets, int setCount)
+{
+   int i, k, pass, width;
+   int stride = DmtxFlowTileSize + 2;
+   unsigned char src[(DmtxFlowTileSize + 2) * (DmtxFlowTileSize + 2)];
+   unsigned short expect[DmtxFlowTileSize * DmtxFlowTileSize];
+   unsigned short result[DmtxFlowTileSize * DmtxFlowTileSize];
+
+   for(pass = 0; pass < 2; pass++) {
+      for(i = 0; i < (int)sizeof(src); i++)
+         src[i] = (pass == 0) ? (unsigned char)rand() : ((rand() & 1) ? 255 : 0);
+
+      for(width = 1; width <= DmtxFlowTileSize; width++) {
+         sets[0].compass(src + stride + 1, stride, width, DmtxFlowTileSize,
+               expect, DmtxFlowTileSize);
+
+         for(k = 1; k < setCount; k++) {
+            memset(result, 0x00, sizeof(result));
+            sets[k].compass(src + stride + 1, stride, width, DmtxFlowTileSize,
+                  result, DmtxFlowTileSize);
+
+            for(i = 0; i < DmtxFlowTileSize; i++) {
+               if(memcmp(expect + i * DmtxFlowTileSize, result + i * DmtxFlowTileSize,
+                     width * sizeof(unsigned short)) != 0)
+                  FatalError(sets[k].name, "compass kernel differs at width", width);
+            }
+         }
+      }
+   }
+}
+
+/**
+ * Vote the same trail points into one accumulator per kernel, with and
+ * without an avoided angle range, and compare the counts and the leader
+ * after every point.
+ */
+static void
+houghKernelTest(const KernelSet *sets, int setCount)
+{
+   int i, k, point;
+   int xDiff, yDiff;
+   int avoid[] = { DmtxUndefined, 0, 45, 90, 179 };
+   DmtxHough expect, result[KernelMax];
+
+   for(i = 0; i < (int)(sizeof(avoid) / sizeof(avoid[0])); i++) {
+      HoughInit(&expect, avoid[i]);
+      for(k = 1; k < setCount; k++)
+         HoughInit(&result[k], avoid[i]);
+
+      for(point = 0; point < 400; point++) {
+         xDiff = rand() % 129 - 64;
+         yDiff = rand() % 129 - 64;
+
+         sets[0].hough(&expect, xDiff, yDiff);
+         for(k = 1; k < setCount; k++) {
+            sets[k].hough(&result[k], xDiff, yDiff);
+
+            if(memcmp(expect.count, result[k].count, sizeof(expect.count)) != 0)
+               FatalError(sets[k].name, "Hough counts differ after point", point);
+            if(expect.angleBest != result[k].angleBest ||
+                  expect.offsetBest != result[k].offsetBest ||
+                  expect.mag != result[k].mag)
+               FatalError(sets[k].name, "Hough leader differs after point", point);
+         }
+      }
+   }
+}
+
+/**
+ * Divide random interleaved data by the generator of every symbol size. The
+ * scalar kernel is itself checked against the encoder and decoder: the error
+ * words it yields must leave a codeword the decoder finds clean.
+ */
+static void
+gfLfsrKernelTest(const KernelSet *sets, int setCount)
+{
+   int i, k, sizeIdx, blockIdx, trial;
+   int blockStride, blockDataWords, symbolWords;
+   DmtxByte expect[MAX_ERROR_WORD_COUNT], result[MAX_ERROR_WORD_COUNT];
+   unsigned char code[DmtxCodeSizeMax], check[DmtxCodeSizeMax];
+   const DmtxRsTable *table;
+   const DmtxSymbolDescriptor *symbol;
+   DmtxMessage *msg;
+
+   for(sizeIdx = 0; sizeIdx < DmtxSymbolSquareCount + DmtxSymbolRectCount; sizeIdx++) {
+      symbol = dmtxGetSymbolDescriptor(sizeIdx);
+      table = RsGetTable(sizeIdx);
+      blockStride = symbol->interleavedBlocks;
+      symbolWords = symbol->symbolDataWords + symbol->symbolErrorWords;
+
+      msg = dmtxMessageCreate(sizeIdx, DmtxFormatMatrix);
+      if(msg == NULL)
+         FatalError("scalar", "cannot create message for size", sizeIdx);
+
+      for(trial = 0; trial < 8; trial++) {
+         for(i = 0; i < symbol->symbolDataWords; i++)
+            code[i] = (trial == 0) ? 0xff : (unsigned char)rand();
+
+         for(blockIdx = 0; blockIdx < blockStride; blockIdx++) {
+            blockDataWords = SymbolBlockDataSize(symbol, blockIdx);
+
+            memset(expect, 0x00, sizeof(expect));
+            sets[0].lfsr(expect, table, code + blockIdx, blockDataWords, blockStride);
+
+            for(k = 1; k < setCount; k++) {
+               memset(result, 0x00, sizeof(result));
+               sets[k].lfsr(result, table, code + blockIdx, blockDataWords, blockStride);
+               if(memcmp(expect, result, symbol->blockErrorWords) != 0)
+                  FatalError(sets[k].name, "LFSR remainder differs for size", sizeIdx);
+            }
+         }
+
+         memcpy(msg->code, code, symbol->symbolDataWords);
+         if(RsEncode(msg, sizeIdx) == DmtxFail)
+            FatalError("scalar", "cannot encode size", sizeIdx);
+
+         memcpy(check, msg->code, symbolWords);
+         if(RsDecode(check, sizeIdx, 0, NULL) == DmtxFail ||
+               memcmp(check, msg->code, symbolWords) != 0)
+            FatalError("scalar", "encoded codeword is not clean for size", sizeIdx);
+      }
+
+      dmtxMessageDestroy(&msg);
+   }
+}
+
+/**
+ * Evaluate random polynomials at every point count and compare each kernel
+ * with the sum of terms computed one at a time.
+ */
+static void
+gfPolyEvalKernelTest(const KernelSet *sets, int setCount)
+{
+   int i, j, k, length, count, first;
+   DmtxByte poly[NN], expect[NN], result[NN];
+
+   for(count = 1; count <= NN; count++) {
+      length = 1 + rand() % 70;
+      first = rand() % 3;
+      for(j = 0; j < length; j++)
+         poly[j] = (rand() % 4 == 0) ? 0 : (DmtxByte)rand();
+
+      for(i = 0; i < count; i++) {
+         for(expect[i] = 0, j = 0; j < length; j++)
+            expect[i] = GfAdd(expect[i], GfMultAntilog(poly[j], (j * (first + i)) % NN));
+      }
+
+      for(k = 0; k < setCount; k++) {
+         sets[k].polyEval(poly, length, first, count, result);
+         if(memcmp(expect, result, count) != 0)
+            FatalError(sets[k].name, "polynomial values differ at count", count);
+      }
+   }
+}
@@ -0,0 +1,449 @@
+/**
+ * libdmtx - Data Matrix Encoding/Decoding Library
+ *
+ * See LICENSE file in the main project directory for full
+ * terms of use and distribution.
+ *
+ * \file perf_test.c
+ *
+ * Micro-benchmarks of internal stages, printed as tables for comparing
+ * builds. Nothing is checked here; kernel_test covers correctness. Build once
+ * as usual and once with -DDMTX_NO_SIMD to see what the vector kernels gain.
+ * The library is included whole so its internal functions can be timed.
+ */
+
+#include "../../dmtx.c"
+#include <time.h>
+
+#define PerfCodewordsPerSize 4000000
+#define PerfBatchImages      32
+#define PerfCanvasSize       640
+#define PerfFindSizeReps     50
+
+static double perfSeconds(void);
+static double perfWallSeconds(void);
+static void reedSolomonPerfTest(void);
+static void batchPerfTest(void);
+static unsigned char *perfSymbolImage(int sizeIdx, double angle, unsigned int *seed);
+static void findSizePerfTest(void);
+static void pixelReaderTime(DmtxDecode *dec, double *pixel, double *flow);
+static void pixelReaderPerfTest(void);
+
+int
+main(int argc, char *argv[])
+{
+   (void)argc;
+   (void)argv;
+
+   reedSolomonPerfTest();
+   batchPerfTest();
+   findSizePerfTest();
+   pixelReaderPerfTest();
+
+   exit(0);
+}
+
+static double
+perfSeconds(void)
+{
+   return (double)clock() / CLOCKS_PER_SEC;
+}
+
+static double
+perfWallSeconds(void)
+{
+   DmtxTime t = dmtxTimeNow();
+
+   return (double)t.sec + t.usec / 1e6;
+}
+
+/**
+ * Encode and decode the same codeword of every symbol size repeatedly and
+ * report millions of codewords per second. The LFSR columns run just the
+ * remainder kernel over every block: "scalar" always uses the portable
+ * version and "picked" whatever SimdGfLfsrKernel() picks for that block
+ * width. The decode columns run RsDecode() on a clean copy and on a copy
+ * holding half the errors each block can correct.
+ */
+static void
+reedSolomonPerfTest(void)
+{
+   int i, k, rep, reps, sizeIdx, blockIdx;
+   int blockStride, dataWords, symbolWords, errorCount;
+   unsigned long sum = 0;
+   double t, lfsrScalar, lfsrPicked, decodeClean, decodeErrors;
+   unsigned char reference[DmtxCodeSizeMax], work[DmtxCodeSizeMax];
+   DmtxByte rem[MAX_ERROR_WORD_COUNT];
+   DmtxGfLfsrKernel picked;
+   const DmtxRsTable *table;
+   const DmtxSymbolDescriptor *symbol;
+   DmtxMessage *msg;
+
+   fprintf(stdout, "size     codewords  lfsr scalar  lfsr picked  decode clean  decode errors  (Mcw/s)\n");
+
+   for(sizeIdx = 0; sizeIdx < DmtxSymbolSquareCount + DmtxSymbolRectCount; sizeIdx++) {
+      symbol = dmtxGetSymbolDescriptor(sizeIdx);
+      table = RsGetTable(sizeIdx);
+      picked = SimdGfLfsrKernel(symbol->blockErrorWords);
+      blockStride = symbol->interleavedBlocks;
+      dataWords = symbol->symbolDataWords;
+      symbolWords = dataWords + symbol->symbolErrorWords;
+      errorCount = (symbol->blockMaxCorrectable + 1) / 2;
+      reps = PerfCodewordsPerSize / symbolWords + 1;
+
+      msg = dmtxMessageCreate(sizeIdx, DmtxFormatMatrix);
+      if(msg == NULL)
+         exit(1);
+      for(i = 0; i < dataWords; i++)
+         msg->code[i] = (unsigned char)(i * 37 + 11);
+      RsEncode(msg, sizeIdx);
+      memcpy(reference, msg->code, symbolWords);
+
+      t = perfSeconds();
+      for(rep = 0; rep < reps; rep++) {
+         for(blockIdx = 0; blockIdx < blockStride; blockIdx++) {
+            memset(rem, 0x00, symbol->blockErrorWords);
+            GfLfsrScalar(rem, table, reference + blockIdx,
+                  SymbolBlockDataSize(symbol, blockIdx), blockStride);
+            sum += rem[0];
+         }
+      }
+      lfsrScalar = perfSeconds() - t;
+
+      t = perfSeconds();
+      for(rep = 0; rep < reps; rep++) {
+         for(blockIdx = 0; blockIdx < blockStride; blockIdx++) {
+            memset(rem, 0x00, symbol->blockErrorWords);
+            picked(rem, table, reference + blockIdx,
+                  SymbolBlockDataSize(symbol, blockIdx), blockStride);
+            sum += rem[0];
+         }
+      }
+      lfsrPicked = perfSeconds() - t;
+
+      t = perfSeconds();
+      for(rep = 0; rep < reps; rep++) {
+         memcpy(work, reference, symbolWords);
+         sum += RsDecode(work, sizeIdx, 0, NULL);
+      }
+      decodeClean = perfSeconds() - t;
+
+      t = perfSeconds();
+      for(rep = 0; rep < reps; rep++) {
+         memcpy(work, reference, symbolWords);
+         for(k = 0; k < errorCount; k++) {
+            for(i = 0; i < blockStride; i++)
+               work[((k * 7 + rep) % (symbolWords / blockStride)) * blockStride + i] ^= 0x5a;
+         }
+         sum += RsDecode(work, sizeIdx, 0, NULL);
+      }
+      decodeErrors = perfSeconds() - t;
+
+      fprintf(stdout, "%3dx%-3d  %9d  %11.1f  %11.1f  %12.1f  %13.1f\n",
+            symbol->symbolRows, symbol->symbolCols, symbolWords,
+            reps * symbolWords / (lfsrScalar * 1e6), reps * symbolWords / (lfsrPicked * 1e6),
+            reps * symbolWords / (decodeClean * 1e6), reps * symbolWords / (decodeErrors * 1e6));
+
+      dmtxMessageDestroy(&msg);
+   }
+
+   /* Keep the results live so the loops are not optimized away */
+   if(sum == 1)
+      fprintf(stdout, "\n");
+}
+
+/**
+ * Decode the same set of 640x480 images with dmtxDecodeBatch() on 1, 2, 4,
+ * ... threads up to one per online processor and report images per second
+ * of wall time, and the speedup over one thread.
+ */
+static void
+batchPerfTest(void)
+{
+   int i, row, threads, online, symWidth, symHeight;
+   double t, single, rate;
+   char str[32];
+   unsigned char *pxl[PerfBatchImages];
+   DmtxImage *img[PerfBatchImages];
+   DmtxEncode *enc;
+   DmtxDecodeResult *results;
+
+   for(i = 0; i < PerfBatchImages; i++) {
+      sprintf(str, "PERF-%04d-%d", i, i * 104729);
+      enc = dmtxEncodeCreate();
+      if(enc == NULL)
+         exit(1);
+      dmtxEncodeSetProp(enc, DmtxPropModuleSize, 4 + i % 3);
+      dmtxEncodeSetProp(enc, DmtxPropMarginSize, 8);
+#ifdef HAVE_READER_PROGRAMMING
+      dmtxEncodeDataMatrix(enc, strlen(str), (unsigned char *)str, DmtxFalse);
+#else
+      dmtxEncodeDataMatrix(enc, strlen(str), (unsigned char *)str);
+#endif
+      symWidth = dmtxImageGetProp(enc->image, DmtxPropWidth);
+      symHeight = dmtxImageGetProp(enc->image, DmtxPropHeight);
+
+      pxl[i] = (unsigned char *)malloc(640 * 480 * 3);
+      if(pxl[i] == NULL)
+         exit(1);
+      memset(pxl[i], 0xff, 640 * 480 * 3);
+      for(row = 0; row < symHeight; row++)
+         memcpy(pxl[i] + ((100 + row) * 640 + 50 + i * 9) * 3,
+               enc->image->pxl + row * symWidth * 3, symWidth * 3);
+      dmtxEncodeDestroy(&enc);
+
+      img[i] = dmtxImageCreate(pxl[i], 640, 480, DmtxPack24bppRGB);
+      if(img[i] == NULL)
+         exit(1);
+   }
+
+   online = ThreadCount(NULL, 0);
+   fprintf(stdout, "\nbatch of %d images, %d online processors\n", PerfBatchImages, online);
+   fprintf(stdout, "threads  images/s  speedup\n");
+
+   single = 0.0;
+   for(threads = 1;; threads = min(threads * 2, online)) {
+      t = perfWallSeconds();
+      results = dmtxDecodeBatch(img, PerfBatchImages, 1, NULL, NULL, threads, NULL);
+      t = perfWallSeconds() - t;
+      if(results == NULL)
+         exit(1);
+      dmtxDecodeBatchDestroy(&results, PerfBatchImages);
+
+      rate = PerfBatchImages / t;
+      if(threads == 1)
+         single = rate;
+      fprintf(stdout, "%7d  %8.1f  %7.2f\n", threads, rate, rate / single);
+
+      if(threads == online)
+         break;
+   }
+
+   for(i = 0; i < PerfBatchImages; i++) {
+      dmtxImageDestroy(&img[i]);
+      free(pxl[i]);
+   }
+}
+
+/**
+ * Encode a symbol of one size, rotate it by angle degrees about the canvas
+ * center with nearest neighbor sampling, and add uniform noise of +-24.
+ */
+static unsigned char *
+perfSymbolImage(int sizeIdx, double angle, unsigned int *seed)
+{
+   int i, x, y, xSym, ySym, symWidth, symHeight, moduleSize, noise;
+   double c, s, xc, yc;
+   const char *str = "42"; /* One codeword fits every size */
+   unsigned char *pxl, *src;
+   DmtxEncode *enc;
+
+   enc = dmtxEncodeCreate();
+   if(enc == NULL)
+      exit(1);
+   moduleSize = min(5, max(2, 400 / dmtxGetSymbolDescriptor(sizeIdx)->symbolCols));
+   dmtxEncodeSetProp(enc, DmtxPropModuleSize, moduleSize);
+   dmtxEncodeSetProp(enc, DmtxPropMarginSize, 2 * moduleSize);
+   dmtxEncodeSetProp(enc, DmtxPropSizeRequest, sizeIdx);
+#ifdef HAVE_READER_PROGRAMMING
+   dmtxEncodeDataMatrix(enc, strlen(str), (unsigned char *)str, DmtxFalse);
+#else
+   dmtxEncodeDataMatrix(enc, strlen(str), (unsigned char *)str);
+#endif
+   if(enc->image == NULL)
+      exit(1);
+   symWidth = dmtxImageGetProp(enc->image, DmtxPropWidth);
+   symHeight = dmtxImageGetProp(enc->image, DmtxPropHeight);
+   src = enc->image->pxl;
+
+   pxl = (unsigned char *)malloc(PerfCanvasSize * PerfCanvasSize * 3);
+   if(pxl == NULL)
+      exit(1);
+
+   c = cos(angle * M_PI / 180.0);
+   s = sin(angle * M_PI / 180.0);
+   xc = PerfCanvasSize / 2.0;
+   yc = PerfCanvasSize / 2.0;
+   for(y = 0; y < PerfCanvasSize; y++) {
+      for(x = 0; x < PerfCanvasSize; x++) {
+         xSym = (int)floor(c * (x - xc) + s * (y - yc) + symWidth / 2.0);
+         ySym = (int)floor(-s * (x - xc) + c * (y - yc) + symHeight / 2.0);
+         *seed = *seed * 1103515245u + 12345u;
+         noise = (int)((*seed >> 16) % 49) - 24;
+         for(i = 0; i < 3; i++) {
+            if(xSym < 0 || xSym >= symWidth || ySym < 0 || ySym >= symHeight)
+               pxl[(y * PerfCanvasSize + x) * 3 + i] = 255 - 24 + noise;
+            else
+               pxl[(y * PerfCanvasSize + x) * 3 + i] = (unsigned char)max(0, min(255,
+                     src[(ySym * symWidth + xSym) * 3 + i] + noise));
+         }
+      }
+   }
+
+   dmtxEncodeDestroy(&enc);
+
+   return pxl;
+}
+
+/**
+ * Locate one rotated, noisy symbol of every size, then time the pruned size
+ * search of MatrixRegionFindSize() against the full search over every size
+ * on each region found, and count the regions where the two choose a
+ * different size or only one of them succeeds.
+ */
+static void
+findSizePerfTest(void)
+{
+   int i, rep, sizeIdx, regions, differ;
+   int candidate[DmtxSymbolSquareCount + DmtxSymbolRectCount];
+   unsigned int seed = 1;
+   double t, pruned, full;
+   DmtxPassFail prunedPass, fullPass;
+   unsigned char *pxl;
+   DmtxImage *img;
+   DmtxDecode *dec;
+   DmtxRegion *reg, prunedReg, fullReg;
+
+   for(i = 0; i < DmtxSymbolSquareCount + DmtxSymbolRectCount; i++)
+      candidate[i] = i;
+
+   regions = differ = 0;
+   pruned = full = 0.0;
+   for(sizeIdx = 0; sizeIdx < DmtxSymbolSquareCount + DmtxSymbolRectCount; sizeIdx++) {
+      pxl = perfSymbolImage(sizeIdx, (sizeIdx * 17) % 40 - 20, &seed);
+      img = dmtxImageCreate(pxl, PerfCanvasSize, PerfCanvasSize, DmtxPack24bppRGB);
+      dec = dmtxDecodeCreate(img, 1);
+      if(img == NULL || dec == NULL)
+         exit(1);
+
+      reg = dmtxRegionFindNext(dec, NULL);
+      if(reg != NULL) {
+         regions++;
+         prunedPass = fullPass = DmtxFail;
+
+         t = perfSeconds();
+         for(rep = 0; rep < PerfFindSizeReps; rep++) {
+            prunedReg = *reg;
+            prunedPass = MatrixRegionFindSize(dec, &prunedReg);
+         }
+         pruned += perfSeconds() - t;
+
+         t = perfSeconds();
+         for(rep = 0; rep < PerfFindSizeReps; rep++) {
+            fullReg = *reg;
+            fullPass = MatrixRegionBestSize(dec, &fullReg, candidate,
+                  DmtxSymbolSquareCount + DmtxSymbolRectCount);
+         }
+         full += perfSeconds() - t;
+
+         if(prunedPass != fullPass || (prunedPass == DmtxPass && prunedReg.sizeIdx != fullReg.sizeIdx))
+            differ++;
+
+         dmtxRegionDestroy(&reg);
+      }
+
+      dmtxDecodeDestroy(&dec);
+      dmtxImageDestroy(&img);
+      free(pxl);
+   }
+
+   fprintf(stdout, "\nsize search on %d of %d symbol sizes found\n", regions,
+         DmtxSymbolSquareCount + DmtxSymbolRectCount);
+   fprintf(stdout, "pruned %.1f us/region  full %.1f us/region  differing choices %d\n",
+         pruned * 1e6 / (regions * PerfFindSizeReps), full * 1e6 / (regions * PerfFindSizeReps), differ);
+}
+
+/**
+ * Read channel 0 of every interior pixel once with dmtxDecodeGetPixelValue()
+ * and once with GetPointFlow(), and return the seconds spent on each.
+ */
+static void
+pixelReaderTime(DmtxDecode *dec, double *pixel, double *flow)
+{
+   int x, y, width, height, value = 0;
+   unsigned long sum = 0;
+   double t;
+   DmtxPixelLoc loc;
+
+   width = dmtxDecodeGetProp(dec, DmtxPropWidth);
+   height = dmtxDecodeGetProp(dec, DmtxPropHeight);
+
+   t = perfSeconds();
+   for(y = 1; y < height - 1; y++) {
+      for(x = 1; x < width - 1; x++) {
+         dmtxDecodeGetPixelValue(dec, x, y, 0, &value);
+         sum += value;
+      }
+   }
+   *pixel = perfSeconds() - t;
+
+   t = perfSeconds();
+   for(loc.Y = 1; loc.Y < height - 1; loc.Y++) {
+      for(loc.X = 1; loc.X < width - 1; loc.X++)
+         sum += GetPointFlow(dec, 0, loc, dmtxNeighborNone).mag;
+   }
+   *flow = perfSeconds() - t;
+
+   /* Keep the results live so the loops are not optimized away */
+   if(sum == 1)
+      fprintf(stdout, "\n");
+}
+
+/**
+ * Time the pixel readers bound by dmtxImageCreate() against the generic
+ * fallback on a 5 megapixel 8bpp image and on 1280x960 24bpp and 32bpp
+ * images, in both row orders, and report millions of pixels per second.
+ */
+static void
+pixelReaderPerfTest(void)
+{
+   int i, p, f, width, height, bytesPerPixel;
+   double pixels, boundPixel, boundFlow, genericPixel, genericFlow;
+   unsigned char *pxl;
+   DmtxImage *img;
+   DmtxDecode *dec;
+   int pack[] = { DmtxPack8bppK, DmtxPack24bppRGB, DmtxPack32bppRGBX };
+   int flip[] = { DmtxFlipNone, DmtxFlipY };
+   const char *packName[] = { "8bpp", "24bpp", "32bpp" };
+   const char *flipName[] = { "none", "y" };
+
+   fprintf(stdout, "\npixel readers (Mpx/s)\n");
+   fprintf(stdout, "packing  size       flip  pixel bound  pixel generic  flow bound  flow generic\n");
+
+   for(p = 0; p < 3; p++) {
+      width = (p == 0) ? 2592 : 1280;
+      height = (p == 0) ? 1944 : 960;
+      bytesPerPixel = (p == 0) ? 1 : p + 2;
+
+      pxl = (unsigned char *)malloc(width * height * bytesPerPixel);
+      if(pxl == NULL)
+         exit(1);
+      for(i = 0; i < width * height * bytesPerPixel; i++)
+         pxl[i] = (unsigned char)((i * 7 + i / 613) & 0xff);
+
+      for(f = 0; f < 2; f++) {
+         img = dmtxImageCreate(pxl, width, height, pack[p]);
+         if(img == NULL || dmtxImageSetProp(img, DmtxPropImageFlip, flip[f]) == DmtxFail)
+            exit(1);
+         dec = dmtxDecodeCreate(img, 1);
+         if(dec == NULL)
+            exit(1);
+
+         pixelReaderTime(dec, &boundPixel, &boundFlow);
+
+         img->fetchPixel = FetchPixelGeneric;
+         img->fetchCompass = FetchCompassGeneric;
+         pixelReaderTime(dec, &genericPixel, &genericFlow);
+
+         pixels = (width - 2) * (double)(height - 2) / 1e6;
+         fprintf(stdout, "%-7s  %4dx%-4d  %-4s  %11.1f  %13.1f  %10.1f  %12.1f\n",
+               packName[p], width, height, flipName[f], pixels / boundPixel,
+               pixels / genericPixel, pixels / boundFlow, pixels / genericFlow);
+
+         dmtxDecodeDestroy(&dec);
+         dmtxImageDestroy(&img);
+      }
+
+      free(pxl);
+   }
+}
@@ -0,0 +1,201 @@
+/**
+ * libdmtx - Data Matrix Encoding/Decoding Library
+ *
+ * See LICENSE file in the main project directory for full
+ * terms of use and distribution.
+ *
+ * \file reedsol_test.c
+ *
+ * Randomized errors-and-erasures decoding of every symbol size. The library
+ * is included whole so RsEncode() and RsDecode() can be called directly.
+ */
+
+#include "../../dmtx.c"
+
+#define ReedSolTrials 300
+
+typedef struct {
+   unsigned char reference[DmtxCodeSizeMax];
+   unsigned char code[DmtxCodeSizeMax];
+   unsigned char erasure[DmtxCodeSizeMax];
+   unsigned char used[DmtxCodeSizeMax];
+} ReedSolCase;
+
+static void FatalError(const char *msg, int sizeIdx, int trial);
+static int randomPosition(ReedSolCase *rs, const DmtxSymbolDescriptor *symbol, int blockIdx);
+static void reedSolCaseInit(ReedSolCase *rs, DmtxMessage *msg, int sizeIdx);
+static void erasureCapacityTest(void);
+static void wrongErasureTest(void);
+
+int
+main(int argc, char *argv[])
+{
+   (void)argc;
+   (void)argv;
+
+   srand(1);
+
+   erasureCapacityTest();
+   wrongErasureTest();
+
+   exit(0);
+}
+
+static void
+FatalError(const char *msg, int sizeIdx, int trial)
+{
+   fprintf(stdout, "FAIL: %s (size %d, trial %d)\n", msg, sizeIdx, trial);
+   exit(1);
+}
+
+/**
+ * Pick a codeword of one interleaved block not yet touched by this case.
+ */
+static int
+randomPosition(ReedSolCase *rs, const DmtxSymbolDescriptor *symbol, int blockIdx)
+{
+   int pos, blockWords, blockStride;
+
+   blockStride = symbol->interleavedBlocks;
+   blockWords = SymbolBlockDataSize(symbol, blockIdx) + symbol->blockErrorWords;
+
+   do {
+      /* Error words follow all data words, so index the two parts apart */
+      pos = rand() % blockWords;
+      if(pos < SymbolBlockDataSize(symbol, blockIdx))
+         pos = pos * blockStride + blockIdx;
+      else
+         pos = symbol->symbolDataWords + (pos - SymbolBlockDataSize(symbol, blockIdx)) *
+               blockStride + blockIdx;
+   } while(rs->used[pos]);
+
+   rs->used[pos] = 1;
+
+   return pos;
+}
+
+/**
+ * Encode random data and reset the received copy to match it.
+ */
+static void
+reedSolCaseInit(ReedSolCase *rs, DmtxMessage *msg, int sizeIdx)
+{
+   int i;
+   const DmtxSymbolDescriptor *symbol = dmtxGetSymbolDescriptor(sizeIdx);
+   int symbolWords = symbol->symbolDataWords + symbol->symbolErrorWords;
+
+   for(i = 0; i < symbol->symbolDataWords; i++)
+      msg->code[i] = (unsigned char)rand();
+
+   if(RsEncode(msg, sizeIdx) == DmtxFail)
+      FatalError("cannot encode", sizeIdx, 0);
+
+   memcpy(rs->reference, msg->code, symbolWords);
+   memcpy(rs->code, msg->code, symbolWords);
+   memset(rs->erasure, 0x00, symbolWords);
+   memset(rs->used, 0x00, symbolWords);
+}
+
+/**
+ * Give each block e errors at unknown positions and f flagged erasures, some
+ * of which hold their correct value, for random e and f within capacity. An
+ * erasure costs one check word and an error two, and erasure decoding holds
+ * ERASURE_SPARE_WORDS back, so capacity is 2e + f <= 2 * blockMaxCorrectable,
+ * less ERASURE_SPARE_WORDS when f > 0. Every block must be repaired exactly.
+ */
+static void
+erasureCapacityTest(void)
+{
+   int i, sizeIdx, trial, blockIdx, pos;
+   int capacity, errors, erasures, symbolWords;
+   const DmtxSymbolDescriptor *symbol;
+   DmtxMessage *msg;
+   ReedSolCase rs;
+
+   for(sizeIdx = 0; sizeIdx < DmtxSymbolSquareCount + DmtxSymbolRectCount; sizeIdx++) {
+      symbol = dmtxGetSymbolDescriptor(sizeIdx);
+      symbolWords = symbol->symbolDataWords + symbol->symbolErrorWords;
+      msg = dmtxMessageCreate(sizeIdx, DmtxFormatMatrix);
+      if(msg == NULL)
+         FatalError("cannot create message", sizeIdx, 0);
+
+      for(trial = 0; trial < ReedSolTrials; trial++) {
+         reedSolCaseInit(&rs, msg, sizeIdx);
+
+         for(blockIdx = 0; blockIdx < symbol->interleavedBlocks; blockIdx++) {
+            erasures = rand() % (2 * symbol->blockMaxCorrectable - ERASURE_SPARE_WORDS + 1);
+            capacity = 2 * symbol->blockMaxCorrectable - ((erasures > 0) ? ERASURE_SPARE_WORDS : 0);
+            errors = rand() % ((capacity - erasures) / 2 + 1);
+
+            for(i = 0; i < erasures; i++) {
+               pos = randomPosition(&rs, symbol, blockIdx);
+               rs.erasure[pos] = 1;
+               if(rand() % 4 != 0)
+                  rs.code[pos] ^= (unsigned char)(1 + rand() % 255);
+            }
+
+            for(i = 0; i < errors; i++) {
+               pos = randomPosition(&rs, symbol, blockIdx);
+               rs.code[pos] ^= (unsigned char)(1 + rand() % 255);
+            }
+         }
+
+         if(RsDecode(rs.code, sizeIdx, 0, rs.erasure) == DmtxFail)
+            FatalError("errors and erasures within capacity not repaired", sizeIdx, trial);
+         if(memcmp(rs.code, rs.reference, symbolWords) != 0)
+            FatalError("errors and erasures within capacity repaired wrongly", sizeIdx, trial);
+      }
+
+      dmtxMessageDestroy(&msg);
+   }
+}
+
+/**
+ * Flag only codewords that hold their correct value, so many that the errors
+ * and flags together exceed what erasure decoding can take. The decoder must
+ * fall back to errors-only decoding, which repairs blockMaxCorrectable errors.
+ */
+static void
+wrongErasureTest(void)
+{
+   int i, sizeIdx, trial, blockIdx, pos;
+   int errors, erasures, symbolWords;
+   const DmtxSymbolDescriptor *symbol;
+   DmtxMessage *msg;
+   ReedSolCase rs;
+
+   for(sizeIdx = 0; sizeIdx < DmtxSymbolSquareCount + DmtxSymbolRectCount; sizeIdx++) {
+      symbol = dmtxGetSymbolDescriptor(sizeIdx);
+      symbolWords = symbol->symbolDataWords + symbol->symbolErrorWords;
+      msg = dmtxMessageCreate(sizeIdx, DmtxFormatMatrix);
+      if(msg == NULL)
+         FatalError("cannot create message", sizeIdx, 0);
+
+      for(trial = 0; trial < ReedSolTrials; trial++) {
+         reedSolCaseInit(&rs, msg, sizeIdx);
+
+         for(blockIdx = 0; blockIdx < symbol->interleavedBlocks; blockIdx++) {
+            errors = 1 + rand() % symbol->blockMaxCorrectable;
+            erasures = 2 * symbol->blockMaxCorrectable - 2 * errors;
+            erasures += rand() % (2 * symbol->blockMaxCorrectable - erasures);
+
+            for(i = 0; i < errors; i++) {
+               pos = randomPosition(&rs, symbol, blockIdx);
+               rs.code[pos] ^= (unsigned char)(1 + rand() % 255);
+            }
+
+            for(i = 0; i < erasures; i++) {
+               pos = randomPosition(&rs, symbol, blockIdx);
+               rs.erasure[pos] = 1;
+            }
+         }
+
+         if(RsDecode(rs.code, sizeIdx, 0, rs.erasure) == DmtxFail)
+            FatalError("errors with wrong erasure flags not repaired", sizeIdx, trial);
+         if(memcmp(rs.code, rs.reference, symbolWords) != 0)
+            FatalError("errors with wrong erasure flags repaired wrongly", sizeIdx, trial);
+      }
+
+      dmtxMessageDestroy(&msg);
+   }
+}
@@ -19,7 +19,27 @@
 #include <string.h>
 #include "../../dmtx.h"
 
+#define TestTaskMax 64
+#define BatchImageCount 6
+#define ExecutorCallMax 64
+#define TestAllocMagic 0x54455354
+#define TestAllocHeader 16
+
+typedef struct {
+   void (*task)(void *arg);
+   void *arg;
+} TestTask;
+
+typedef struct {
+   int allocs;
+   int frees;
+   int live;
+} TestAllocCount;
+
 char *programName;
+static TestTask testTask[TestTaskMax];
+static int testTaskCount;
+static int testTaskSubmitted;
 
 static void FatalError(int idx, char* msg)
 {
@@ -29,6 +49,37 @@ static void FatalError(int idx, char* msg)
 
 static void timeAddTest(void);
 static void timePrint(DmtxTime t);
+static unsigned char *testImageCreate(const char *str, int moduleSize, int width, int height,
+      int x, int y);
+static void testImagePaste(unsigned char *pxl, int width, int height, const char *str,
+      int moduleSize, int x, int y);
+static DmtxBoolean testDecodeNext(DmtxDecode *dec, const char *str);
+static DmtxBoolean testDecodeRegion(DmtxDecode *dec, DmtxRegion *reg, const char *str);
+static void pyramidOddHeightTest(void);
+static void pyramidLevelsLimitTest(void);
+static void testExecutorSubmit(void (*task)(void *arg), void *arg, void *userData);
+static void testExecutorWait(void *userData);
+static void batchDecodeTest(void);
+static int testResultMatch(DmtxDecodeResult *result, const char **str, int strCount);
+static void findAllLimitTest(void);
+static DmtxBoolean testRegionEqual(DmtxRegion *reg0, DmtxRegion *reg1);
+static void findAllSeamTest(void);
+static void regionTrackTest(void);
+static void executorScanTest(void);
+static void *testAlloc(size_t size, void *userData);
+static void testFree(void *ptr, void *userData);
+static void allocatorArenaTest(void);
+static void scanCacheLimitTest(void);
+static unsigned char *testSymbolCreate(const char *str, int sizeIdx, int *width, int *height);
+static DmtxBoolean testDecodeInto(unsigned char *pxl, int width, int height, DmtxMessage *msg);
+static void testMacroSymbol(int macro, int sizeIdx);
+static void messageReuseTest(void);
+static void setImageResetTest(void);
+static void saliencyOrderTest(void);
+static void flowCacheTest(void);
+static void *testAllocRefuse(size_t size, void *userData);
+static void testRelease(void *ptr, void *userData);
+static void scanPlaneTest(void);
 
 int
 main(int argc, char *argv[])
@@ -36,6 +87,20 @@ main(int argc, char *argv[])
    programName = argv[0];
 
    timeAddTest();
+   pyramidOddHeightTest();
+   pyramidLevelsLimitTest();
+   batchDecodeTest();
+   findAllLimitTest();
+   findAllSeamTest();
+   regionTrackTest();
+   executorScanTest();
+   allocatorArenaTest();
+   scanCacheLimitTest();
+   messageReuseTest();
+   setImageResetTest();
+   saliencyOrderTest();
+   flowCacheTest();
+   scanPlaneTest();
 
    exit(0);
 }
@@ -98,6 +163,373 @@ timeAddTest(void)
    }
 }
 
+/**
+ * Encode str and paste the symbol onto a white 24bpp canvas with its top
+ * left corner at column x of memory row y.
+ */
+static unsigned char *
+testImageCreate(const char *str, int moduleSize, int width, int height, int x, int y)
+{
+   unsigned char *pxl;
+
+   pxl = (unsigned char *)malloc(width * height * 3);
+   if(pxl == NULL)
+      FatalError(3, "testImageCreate\n");
+   memset(pxl, 0xff, width * height * 3);
+
+   testImagePaste(pxl, width, height, str, moduleSize, x, y);
+
+   return pxl;
+}
+
+/**
+ * Encode str and paste the symbol onto an existing 24bpp canvas.
+ */
+static void
+testImagePaste(unsigned char *pxl, int width, int height, const char *str, int moduleSize,
+      int x, int y)
+{
+   int row, symWidth, symHeight;
+   DmtxEncode *enc;
+
+   enc = dmtxEncodeCreate();
+   if(enc == NULL)
+      FatalError(1, "testImagePaste\n");
+
+   dmtxEncodeSetProp(enc, DmtxPropModuleSize, moduleSize);
+   dmtxEncodeSetProp(enc, DmtxPropMarginSize, 2 * moduleSize);
+#ifdef HAVE_READER_PROGRAMMING
+   dmtxEncodeDataMatrix(enc, strlen(str), (unsigned char *)str, DmtxFalse);
+#else
+   dmtxEncodeDataMatrix(enc, strlen(str), (unsigned char *)str);
+#endif
+
+   symWidth = dmtxImageGetProp(enc->image, DmtxPropWidth);
+   symHeight = dmtxImageGetProp(enc->image, DmtxPropHeight);
+   if(x + symWidth > width || y + symHeight > height)
+      FatalError(2, "testImagePaste\n");
+
+   for(row = 0; row < symHeight; row++)
+      memcpy(pxl + ((y + row) * width + x) * 3, enc->image->pxl + row * symWidth * 3,
+            symWidth * 3);
+
+   dmtxEncodeDestroy(&enc);
+}
+
+/**
+ * Find the next region of dec and check that it decodes to str.
+ */
+static DmtxBoolean
+testDecodeNext(DmtxDecode *dec, const char *str)
+{
+   DmtxBoolean match;
+   DmtxRegion *reg;
+
+   reg = dmtxRegionFindNext(dec, NULL);
+   if(reg == NULL)
+      return DmtxFalse;
+
+   match = testDecodeRegion(dec, reg, str);
+   dmtxRegionDestroy(&reg);
+
+   return match;
+}
+
+/**
+ * Check that reg decodes to str.
+ */
+static DmtxBoolean
+testDecodeRegion(DmtxDecode *dec, DmtxRegion *reg, const char *str)
+{
+   DmtxBoolean match;
+   DmtxMessage *msg;
+
+   msg = dmtxDecodeMatrixRegion(dec, reg, DmtxUndefined);
+   match = (msg != NULL && msg->outputIdx == strlen(str) &&
+         memcmp(msg->output, str, msg->outputIdx) == 0) ? DmtxTrue : DmtxFalse;
+
+   dmtxMessageDestroy(&msg);
+
+   return match;
+}
+
+/**
+ * Odd image heights leave a remainder row at every pyramid level. For the
+ * default bottom-up layout that row is y = 0, so the coarse scan must still
+ * land on the right full resolution rows. The symbol is 120 pixels tall and
+ * sits a few rows above the bottom edge.
+ */
+static void
+pyramidOddHeightTest(void)
+{
+   int levels, height, gap;
+   unsigned char *pxl;
+   const char *str = "PYRAMID-0123456789";
+   DmtxImage *img;
+   DmtxDecode *dec;
+
+   for(levels = 1; levels <= 2; levels++) {
+      for(height = 241; height <= 249; height += 4) {
+         for(gap = 1; gap <= 9; gap += 4) {
+            pxl = testImageCreate(str, 5, 320, height, 150, height - 120 - gap);
+            img = dmtxImageCreate(pxl, 320, height, DmtxPack24bppRGB);
+            dec = dmtxDecodeCreate(img, 1);
+            if(img == NULL || dec == NULL)
+               FatalError(1, "pyramidOddHeightTest\n");
+
+            if(dmtxDecodeSetProp(dec, DmtxPropPyramidLevels, levels) == DmtxFail)
+               FatalError(2, "pyramidOddHeightTest\n");
+
+            if(testDecodeNext(dec, str) == DmtxFalse)
+               FatalError(3, "pyramidOddHeightTest\n");
+
+            dmtxDecodeDestroy(&dec);
+            dmtxImageDestroy(&img);
+            free(pxl);
+         }
+      }
+   }
+}
+
+/**
+ * Levels that leave fewer than 16 pixels on a side are refused without
+ * touching the level in effect. A 320x241 image allows up to 3 levels.
+ */
+static void
+pyramidLevelsLimitTest(void)
+{
+   unsigned char *pxl;
+   const char *str = "PYRAMID-LIMIT";
+   DmtxImage *img;
+   DmtxDecode *dec;
+
+   pxl = testImageCreate(str, 5, 320, 241, 100, 60);
+   img = dmtxImageCreate(pxl, 320, 241, DmtxPack24bppRGB);
+   dec = dmtxDecodeCreate(img, 1);
+   if(img == NULL || dec == NULL)
+      FatalError(1, "pyramidLevelsLimitTest\n");
+
+   if(dmtxDecodeSetProp(dec, DmtxPropPyramidLevels, 3) == DmtxFail ||
+         dmtxDecodeSetProp(dec, DmtxPropPyramidLevels, 2) == DmtxFail)
+      FatalError(2, "pyramidLevelsLimitTest\n");
+
+   if(dmtxDecodeSetProp(dec, DmtxPropPyramidLevels, 4) != DmtxFail ||
+         dmtxDecodeSetProp(dec, DmtxPropPyramidLevels, 40) != DmtxFail ||
+         dmtxDecodeSetProp(dec, DmtxPropPyramidLevels, -1) != DmtxFail)
+      FatalError(3, "pyramidLevelsLimitTest\n");
+
+   if(dmtxDecodeGetProp(dec, DmtxPropPyramidLevels) != 2)
+      FatalError(4, "pyramidLevelsLimitTest\n");
+
+   /* The next frame rebuilds the level still in effect */
+   if(dmtxDecodeSetImage(dec, img) == DmtxFail || testDecodeNext(dec, str) == DmtxFalse)
+      FatalError(5, "pyramidLevelsLimitTest\n");
+
+   dmtxDecodeDestroy(&dec);
+   dmtxImageDestroy(&img);
+   free(pxl);
+}
+
+/**
+ * Executor of a pool without a thread to spare: with userData set each task
+ * runs as soon as it is submitted, otherwise tasks are queued until wait().
+ */
+static void
+testExecutorSubmit(void (*task)(void *arg), void *arg, void *userData)
+{
+   testTaskSubmitted++;
+
+   if(userData != NULL) {
+      task(arg);
+      return;
+   }
+
+   if(testTaskCount == TestTaskMax)
+      FatalError(1, "testExecutorSubmit\n");
+
+   testTask[testTaskCount].task = task;
+   testTask[testTaskCount].arg = arg;
+   testTaskCount++;
+}
+
+static void
+testExecutorWait(void *userData)
+{
+   int i;
+
+   (void)userData;
+
+   for(i = 0; i < testTaskCount; i++)
+      testTask[i].task(testTask[i].arg);
+
+   testTaskCount = 0;
+}
+
+/**
+ * Decode the same images one by one with dmtxRegionFindNext() and all at
+ * once with dmtxDecodeBatch(), on library threads and on both kinds of test
+ * executor. Image widths alternate so workers must also replace decoders.
+ */
+static void
+batchDecodeTest(void)
+{
+   int i, k, width;
+   char str[BatchImageCount][32];
+   unsigned char *pxl[BatchImageCount];
+   DmtxImage *img[BatchImageCount];
+   DmtxDecode *dec;
+   DmtxDecodeResult *batch;
+   DmtxMessage *msg;
+   DmtxExecutor executor;
+   int threadCount[] = { 1, 3, 4 };
+
+   for(i = 0; i < BatchImageCount; i++) {
+      sprintf(str[i], "BATCH-%d-%d", i, i * 7919);
+      width = (i % 2 == 0) ? 200 : 240;
+      pxl[i] = testImageCreate(str[i], 4, width, 160, 10 + i * 5, 20);
+      img[i] = dmtxImageCreate(pxl[i], width, 160, DmtxPack24bppRGB);
+      dec = dmtxDecodeCreate(img[i], 1);
+      if(img[i] == NULL || dec == NULL)
+         FatalError(1, "batchDecodeTest\n");
+
+      if(testDecodeNext(dec, str[i]) == DmtxFalse)
+         FatalError(2, "batchDecodeTest\n");
+      if(dmtxRegionFindNext(dec, NULL) != NULL)
+         FatalError(3, "batchDecodeTest\n");
+
+      dmtxDecodeDestroy(&dec);
+   }
+
+   executor.submit = testExecutorSubmit;
+   executor.wait = testExecutorWait;
+
+   /* Library threads first, then queued and immediate executor tasks */
+   for(k = 0; k < 5; k++) {
+      executor.userData = (k == 4) ? (void *)&executor : NULL;
+
+      batch = dmtxDecodeBatch(img, BatchImageCount, 1, NULL, NULL,
+            (k < 3) ? threadCount[k] : 4, (k < 3) ? NULL : &executor);
+      if(batch == NULL)
+         FatalError(4, "batchDecodeTest\n");
+
+      for(i = 0; i < BatchImageCount; i++) {
+         if(batch[i].status != DmtxPass || batch[i].count != 1)
+            FatalError(5, "batchDecodeTest\n");
+
+         msg = batch[i].message[0];
+         if(msg->outputIdx != strlen(str[i]) || memcmp(msg->output, str[i], msg->outputIdx) != 0)
+            FatalError(6, "batchDecodeTest\n");
+      }
+
+      dmtxDecodeBatchDestroy(&batch, BatchImageCount);
+   }
+
+   for(i = 0; i < BatchImageCount; i++) {
+      dmtxImageDestroy(&img[i]);
+      free(pxl[i]);
+   }
+}
+
+/**
+ * Count the messages of result that match one of str, failing on any other
+ * message or on a string matched twice.
+ */
+static int
+testResultMatch(DmtxDecodeResult *result, const char **str, int strCount)
+{
+   int i, j, seen[8] = { 0 };
+   DmtxMessage *msg;
+
+   for(i = 0; i < result->count; i++) {
+      msg = result->message[i];
+      for(j = 0; j < strCount; j++) {
+         if(msg->outputIdx == strlen(str[j]) && memcmp(msg->output, str[j], msg->outputIdx) == 0)
+            break;
+      }
+      if(j == strCount || seen[j]++ != 0)
+         FatalError(1, "testResultMatch\n");
+   }
+
+   return result->count;
+}
+
+/**
+ * Decode an image of three symbols with dmtxDecodeFindAll(): in full, up to
+ * an expected count and resumed for the rest, and under a timeout and an
+ * iteration budget that end the scan early. A scan ended by a limit must
+ * report DmtxFail, one that stops at the expected count DmtxPass.
+ */
+static void
+findAllLimitTest(void)
+{
+   int full;
+   unsigned char *pxl;
+   const char *str[] = { "FINDALL-ONE", "FINDALL-TWO", "FINDALL-THREE" };
+   DmtxImage *img;
+   DmtxDecode *dec;
+   DmtxDecodeResult *result;
+   DmtxScanConstraint budget;
+   DmtxTime timeout;
+
+   pxl = testImageCreate(str[0], 4, 400, 160, 10, 40);
+   testImagePaste(pxl, 400, 160, str[1], 4, 140, 40);
+   testImagePaste(pxl, 400, 160, str[2], 4, 270, 40);
+   img = dmtxImageCreate(pxl, 400, 160, DmtxPack24bppRGB);
+   dec = dmtxDecodeCreate(img, 1);
+   if(img == NULL || dec == NULL)
+      FatalError(1, "findAllLimitTest\n");
+
+   /* Whole image */
+   memset(&budget, 0x00, sizeof(DmtxScanConstraint));
+   result = dmtxDecodeFindAll(dec, &budget, 0);
+   if(result == NULL || result->status != DmtxPass || budget.stopCause != DmtxScanNotFound ||
+         testResultMatch(result, str, 3) != 3)
+      FatalError(2, "findAllLimitTest\n");
+   full = budget.iterations;
+   dmtxDecodeResultDestroy(&result);
+
+   /* Stop after two symbols, then resume for the third */
+   dmtxDecodeSetImage(dec, img);
+   memset(&budget, 0x00, sizeof(DmtxScanConstraint));
+   result = dmtxDecodeFindAll(dec, &budget, 2);
+   if(result == NULL || result->status != DmtxPass || budget.stopCause != DmtxScanSuccess ||
+         budget.iterations >= full || testResultMatch(result, str, 3) != 2)
+      FatalError(3, "findAllLimitTest\n");
+   dmtxDecodeResultDestroy(&result);
+
+   result = dmtxDecodeFindAll(dec, NULL, 0);
+   if(result == NULL || result->status != DmtxPass || testResultMatch(result, str, 3) != 1)
+      FatalError(4, "findAllLimitTest\n");
+   dmtxDecodeResultDestroy(&result);
+
+   /* A timeout already past ends the scan before the first seed */
+   dmtxDecodeSetImage(dec, img);
+   memset(&budget, 0x00, sizeof(DmtxScanConstraint));
+   timeout = dmtxTimeNow();
+   timeout.sec -= 1;
+   budget.maxTimeout = &timeout;
+   result = dmtxDecodeFindAll(dec, &budget, 3);
+   if(result == NULL || result->status != DmtxFail || budget.stopCause != DmtxScanTimeLimit ||
+         result->count != 0)
+      FatalError(5, "findAllLimitTest\n");
+   dmtxDecodeResultDestroy(&result);
+
+   /* An iteration budget short of the whole image */
+   dmtxDecodeSetImage(dec, img);
+   memset(&budget, 0x00, sizeof(DmtxScanConstraint));
+   budget.maxIterations = full / 2;
+   result = dmtxDecodeFindAll(dec, &budget, 0);
+   if(result == NULL || result->status != DmtxFail || budget.stopCause != DmtxScanIterLimit ||
+         budget.iterations != full / 2)
+      FatalError(6, "findAllLimitTest\n");
+   testResultMatch(result, str, 3);
+   dmtxDecodeResultDestroy(&result);
+
+   dmtxDecodeDestroy(&dec);
+   dmtxImageDestroy(&img);
+   free(pxl);
+}
+
 /**
  *
  *
@@ -121,3 +553,1003 @@ TestRGB(void)
    dmtxImageCreate(ptr, 320, 240, DmtxPack24bppRGB);
 }
 */
+
+/**
+ * Compare the geometry that locates and samples two regions.
+ */
+static DmtxBoolean
+testRegionEqual(DmtxRegion *reg0, DmtxRegion *reg1)
+{
+   if(reg0->sizeIdx != reg1->sizeIdx ||
+         memcmp(reg0->fit2raw, reg1->fit2raw, sizeof(DmtxMatrix3)) != 0 ||
+         memcmp(&(reg0->leftLoc), &(reg1->leftLoc), sizeof(DmtxPixelLoc)) != 0 ||
+         memcmp(&(reg0->bottomLoc), &(reg1->bottomLoc), sizeof(DmtxPixelLoc)) != 0 ||
+         memcmp(&(reg0->boundMin), &(reg1->boundMin), sizeof(DmtxPixelLoc)) != 0 ||
+         memcmp(&(reg0->boundMax), &(reg1->boundMax), sizeof(DmtxPixelLoc)) != 0)
+      return DmtxFalse;
+
+   return DmtxTrue;
+}
+
+/**
+ * Find four symbols lying across the seams of 48 pixel tiles with
+ * dmtxRegionFindAll(). Every thread count must return each symbol exactly
+ * once, and the same regions in the same order as a single thread.
+ */
+static void
+findAllSeamTest(void)
+{
+   int i, t, count, expectCount;
+   unsigned char *pxl;
+   const char *str[] = { "SEAM-A", "SEAM-B", "SEAM-C", "SEAM-D" };
+   int seen[4];
+   int threadCount[] = { 1, 2, 4 };
+   DmtxImage *img;
+   DmtxDecode *dec;
+   DmtxRegion **expect, **regions;
+   DmtxMessage *msg;
+
+   /* Each symbol covers a corner where four tiles meet */
+   pxl = testImageCreate(str[0], 3, 320, 240, 20, 20);
+   testImagePaste(pxl, 320, 240, str[1], 3, 115, 20);
+   testImagePaste(pxl, 320, 240, str[2], 3, 20, 115);
+   testImagePaste(pxl, 320, 240, str[3], 3, 210, 160);
+   img = dmtxImageCreate(pxl, 320, 240, DmtxPack24bppRGB);
+   dec = dmtxDecodeCreate(img, 1);
+   if(img == NULL || dec == NULL)
+      FatalError(1, "findAllSeamTest\n");
+
+   if(dmtxDecodeSetProp(dec, DmtxPropTileSize, 48) == DmtxFail)
+      FatalError(2, "findAllSeamTest\n");
+
+   expect = dmtxRegionFindAll(dec, threadCount[0], &expectCount);
+   if(expect == NULL || expectCount != 4)
+      FatalError(3, "findAllSeamTest\n");
+
+   memset(seen, 0x00, sizeof(seen));
+   for(i = 0; i < expectCount; i++) {
+      msg = dmtxDecodeMatrixRegion(dec, expect[i], DmtxUndefined);
+      if(msg == NULL)
+         FatalError(4, "findAllSeamTest\n");
+
+      for(t = 0; t < 4; t++) {
+         if(msg->outputIdx == strlen(str[t]) && memcmp(msg->output, str[t], msg->outputIdx) == 0)
+            break;
+      }
+      if(t == 4 || seen[t]++ != 0)
+         FatalError(5, "findAllSeamTest\n");
+
+      dmtxMessageDestroy(&msg);
+   }
+
+   for(t = 1; t < 3; t++) {
+      regions = dmtxRegionFindAll(dec, threadCount[t], &count);
+      if(regions == NULL || count != expectCount)
+         FatalError(6, "findAllSeamTest\n");
+
+      for(i = 0; i < count; i++) {
+         if(testRegionEqual(regions[i], expect[i]) == DmtxFalse)
+            FatalError(7, "findAllSeamTest\n");
+      }
+
+      dmtxRegionListDestroy(&regions);
+   }
+
+   dmtxRegionListDestroy(&expect);
+   dmtxDecodeDestroy(&dec);
+   dmtxImageDestroy(&img);
+   free(pxl);
+}
+
+/**
+ * Follow a symbol from one frame to the next with dmtxRegionTrack(). Moves
+ * of 1 to 3 pixels stay within the search window of a 4 pixel module and
+ * are tracked without scanning, which reports zero iterations. A jump of
+ * 60 pixels falls back to dmtxRegionFindNextDeterministic(), which scans.
+ */
+static void
+regionTrackTest(void)
+{
+   int i;
+   unsigned char *pxl0, *pxl1;
+   const char *str = "TRACK-0123";
+   int shift[][2] = { { 1, 0 }, { 0, 2 }, { -3, 1 }, { 2, -3 }, { 60, 40 } };
+   DmtxImage *img0, *img1;
+   DmtxDecode *dec;
+   DmtxRegion *prev, *reg;
+   DmtxScanConstraint constraint;
+
+   pxl0 = testImageCreate(str, 4, 240, 200, 70, 50);
+   img0 = dmtxImageCreate(pxl0, 240, 200, DmtxPack24bppRGB);
+   dec = dmtxDecodeCreate(img0, 1);
+   if(img0 == NULL || dec == NULL)
+      FatalError(1, "regionTrackTest\n");
+
+   for(i = 0; i < 5; i++) {
+      if(dmtxDecodeSetImage(dec, img0) == DmtxFail)
+         FatalError(2, "regionTrackTest\n");
+
+      prev = dmtxRegionFindNext(dec, NULL);
+      if(prev == NULL)
+         FatalError(3, "regionTrackTest\n");
+
+      pxl1 = testImageCreate(str, 4, 240, 200, 70 + shift[i][0], 50 + shift[i][1]);
+      img1 = dmtxImageCreate(pxl1, 240, 200, DmtxPack24bppRGB);
+      if(img1 == NULL || dmtxDecodeSetImage(dec, img1) == DmtxFail)
+         FatalError(4, "regionTrackTest\n");
+
+      memset(&constraint, 0x00, sizeof(DmtxScanConstraint));
+      reg = dmtxRegionTrack(dec, prev, &constraint);
+      if(reg == NULL || constraint.stopCause != DmtxScanSuccess)
+         FatalError(5, "regionTrackTest\n");
+
+      /* Only the jump needs a grid scan */
+      if((i < 4 && constraint.iterations != 0) || (i == 4 && constraint.iterations == 0))
+         FatalError(6, "regionTrackTest\n");
+
+      if(testDecodeRegion(dec, reg, str) == DmtxFalse)
+         FatalError(7, "regionTrackTest\n");
+
+      dmtxRegionDestroy(&reg);
+      dmtxRegionDestroy(&prev);
+      dmtxImageDestroy(&img1);
+      free(pxl1);
+   }
+
+   dmtxDecodeDestroy(&dec);
+   dmtxImageDestroy(&img0);
+   free(pxl0);
+}
+
+/**
+ * Scan an image of three symbols in steps of at most 5000 iterations with
+ * dmtxRegionFindNextDeterministic(), serially and through both kinds of
+ * test executor. Each call must stop for the same reason after the same
+ * number of iterations and return the same region, which must decode the
+ * same way. dmtxRegionFindAll() then hands 3 of its 4 workers to each
+ * executor, and wait() must leave no task behind. Seeds are only sought
+ * ahead of the scan with more than one online processor.
+ */
+static void
+executorScanTest(void)
+{
+   int i, k, calls, count, expectCount;
+   int iterations[ExecutorCallMax];
+   DmtxScanStatus stopCause[ExecutorCallMax];
+   unsigned char *pxl;
+   const char *str[] = { "EXEC-ONE", "EXEC-TWO", "EXEC-THREE" };
+   DmtxImage *img;
+   DmtxDecode *dec;
+   DmtxRegion *expect[ExecutorCallMax], *reg, **expectAll, **regions;
+   DmtxScanConstraint constraint;
+   DmtxExecutor executor;
+
+   pxl = testImageCreate(str[0], 4, 400, 160, 10, 40);
+   testImagePaste(pxl, 400, 160, str[1], 4, 140, 40);
+   testImagePaste(pxl, 400, 160, str[2], 4, 270, 40);
+   img = dmtxImageCreate(pxl, 400, 160, DmtxPack24bppRGB);
+   if(img == NULL)
+      FatalError(1, "executorScanTest\n");
+
+   executor.submit = testExecutorSubmit;
+   executor.wait = testExecutorWait;
+
+   /* Serial scan first, then queued and immediate executor tasks */
+   calls = 0;
+   for(k = 0; k < 3; k++) {
+      executor.userData = (k == 2) ? (void *)&executor : NULL;
+
+      dec = dmtxDecodeCreate(img, 1);
+      if(dec == NULL || (k > 0 && dmtxDecodeSetExecutor(dec, &executor) == DmtxFail))
+         FatalError(2, "executorScanTest\n");
+
+      for(i = 0;; i++) {
+         memset(&constraint, 0x00, sizeof(DmtxScanConstraint));
+         constraint.maxIterations = 5000;
+         reg = dmtxRegionFindNextDeterministic(dec, &constraint);
+         if(testTaskCount != 0 || i == ExecutorCallMax)
+            FatalError(3, "executorScanTest\n");
+
+         if(k == 0) {
+            iterations[i] = constraint.iterations;
+            stopCause[i] = constraint.stopCause;
+            expect[i] = reg;
+            calls++;
+         }
+         else if(i == calls || constraint.iterations != iterations[i] ||
+               constraint.stopCause != stopCause[i] || (reg == NULL) != (expect[i] == NULL) ||
+               (reg != NULL && testRegionEqual(reg, expect[i]) == DmtxFalse)) {
+            FatalError(4, "executorScanTest\n");
+         }
+
+         if(reg != NULL) {
+            if(testDecodeRegion(dec, reg, str[0]) == DmtxFalse &&
+                  testDecodeRegion(dec, reg, str[1]) == DmtxFalse &&
+                  testDecodeRegion(dec, reg, str[2]) == DmtxFalse)
+               FatalError(5, "executorScanTest\n");
+            if(k > 0)
+               dmtxRegionDestroy(&reg);
+         }
+
+         if(constraint.stopCause == DmtxScanNotFound)
+            break;
+      }
+      if(i + 1 != calls)
+         FatalError(6, "executorScanTest\n");
+
+      dmtxDecodeDestroy(&dec);
+   }
+
+   for(i = 0; i < calls; i++) {
+      if(expect[i] != NULL)
+         dmtxRegionDestroy(&(expect[i]));
+   }
+
+   dec = dmtxDecodeCreate(img, 1);
+   if(dec == NULL || dmtxDecodeSetProp(dec, DmtxPropTileSize, 64) == DmtxFail)
+      FatalError(7, "executorScanTest\n");
+
+   expectAll = dmtxRegionFindAll(dec, 1, &expectCount);
+   if(expectAll == NULL || expectCount != 3)
+      FatalError(8, "executorScanTest\n");
+
+   for(k = 0; k < 2; k++) {
+      executor.userData = (k == 1) ? (void *)&executor : NULL;
+      if(dmtxDecodeSetExecutor(dec, &executor) == DmtxFail)
+         FatalError(9, "executorScanTest\n");
+
+      testTaskSubmitted = 0;
+      regions = dmtxRegionFindAll(dec, 4, &count);
+      if(regions == NULL || count != expectCount || testTaskSubmitted != 3 || testTaskCount != 0)
+         FatalError(10, "executorScanTest\n");
+
+      for(i = 0; i < count; i++) {
+         if(testRegionEqual(regions[i], expectAll[i]) == DmtxFalse)
+            FatalError(11, "executorScanTest\n");
+      }
+
+      dmtxRegionListDestroy(&regions);
+   }
+
+   dmtxRegionListDestroy(&expectAll);
+   dmtxDecodeDestroy(&dec);
+   dmtxImageDestroy(&img);
+   free(pxl);
+}
+
+/**
+ * Allocation hook that counts blocks and tags them so testFree() can tell
+ * whether a block it is handed came from here.
+ */
+static void *
+testAlloc(size_t size, void *userData)
+{
+   unsigned char *block;
+   TestAllocCount *count = (TestAllocCount *)userData;
+
+   block = (unsigned char *)malloc(size + TestAllocHeader);
+   if(block == NULL)
+      return NULL;
+
+   *(int *)block = TestAllocMagic;
+   count->allocs++;
+   count->live++;
+
+   return block + TestAllocHeader;
+}
+
+static void
+testFree(void *ptr, void *userData)
+{
+   unsigned char *block;
+   TestAllocCount *count = (TestAllocCount *)userData;
+
+   block = (unsigned char *)ptr - TestAllocHeader;
+   if(*(int *)block != TestAllocMagic)
+      FatalError(1, "testFree\n");
+
+   count->frees++;
+   count->live--;
+
+   free(block);
+}
+
+/**
+ * Decode three frames through an arena-backed decoder with counting hooks
+ * installed. Destroying arena results must not reach the free hook, the
+ * arena size cannot change while results are live, and the next frame
+ * reuses the same arena memory, so earlier results are gone. Every block
+ * the library allocated must have been handed back to the hooks at the end.
+ */
+static void
+allocatorArenaTest(void)
+{
+   int f, frees, arenaBytes;
+   unsigned char *pxl[3];
+   const char *str = "ARENA-0123";
+   DmtxImage *img[3];
+   DmtxDecode *dec;
+   DmtxRegion *reg, *firstReg;
+   DmtxMessage *msg, *firstMsg;
+   DmtxAllocator hooks;
+   TestAllocCount count;
+
+   memset(&count, 0x00, sizeof(TestAllocCount));
+   hooks.alloc = testAlloc;
+   hooks.release = NULL;
+   hooks.userData = &count;
+   if(dmtxSetAllocator(&hooks) != DmtxFail)
+      FatalError(1, "allocatorArenaTest\n");
+
+   hooks.release = testFree;
+   if(dmtxSetAllocator(&hooks) == DmtxFail)
+      FatalError(2, "allocatorArenaTest\n");
+
+   for(f = 0; f < 3; f++) {
+      pxl[f] = testImageCreate(str, 4, 240, 200, 20 + f * 50, 30 + f * 40);
+      img[f] = dmtxImageCreate(pxl[f], 240, 200, DmtxPack24bppRGB);
+      if(img[f] == NULL)
+         FatalError(3, "allocatorArenaTest\n");
+   }
+
+   dec = dmtxDecodeCreate(img[0], 1);
+   if(dec == NULL || count.allocs == 0 ||
+         dmtxDecodeSetProp(dec, DmtxPropArenaSize, 4096) == DmtxFail)
+      FatalError(4, "allocatorArenaTest\n");
+
+   firstReg = NULL;
+   firstMsg = NULL;
+   arenaBytes = 0;
+   for(f = 0; f < 3; f++) {
+      if(dmtxDecodeSetImage(dec, img[f]) == DmtxFail)
+         FatalError(5, "allocatorArenaTest\n");
+
+      reg = dmtxRegionFindNext(dec, NULL);
+      msg = (reg == NULL) ? NULL : dmtxDecodeMatrixRegion(dec, reg, DmtxUndefined);
+      if(msg == NULL || msg->outputIdx != strlen(str) || memcmp(msg->output, str, msg->outputIdx) != 0)
+         FatalError(6, "allocatorArenaTest\n");
+
+      /* Results of this frame are live */
+      if(dmtxDecodeSetProp(dec, DmtxPropArenaSize, 8192) != DmtxFail ||
+            dmtxDecodeGetProp(dec, DmtxPropArenaSize) != 4096)
+         FatalError(7, "allocatorArenaTest\n");
+
+      /* Each frame starts over at the front of the same memory */
+      if(f == 0) {
+         firstReg = reg;
+         firstMsg = msg;
+         arenaBytes = dmtxDecodeGetProp(dec, DmtxPropArenaBytes);
+      }
+      else if(reg != firstReg || msg != firstMsg ||
+            dmtxDecodeGetProp(dec, DmtxPropArenaBytes) != arenaBytes) {
+         FatalError(8, "allocatorArenaTest\n");
+      }
+
+      frees = count.frees;
+      dmtxMessageDestroy(&msg);
+      dmtxRegionDestroy(&reg);
+      if(count.frees != frees || msg != NULL || reg != NULL)
+         FatalError(9, "allocatorArenaTest\n");
+   }
+
+   /* Nothing is live once the next image is attached */
+   if(dmtxDecodeSetImage(dec, img[0]) == DmtxFail ||
+         dmtxDecodeSetProp(dec, DmtxPropArenaSize, 0) == DmtxFail ||
+         dmtxDecodeGetProp(dec, DmtxPropArenaBytes) != 0)
+      FatalError(10, "allocatorArenaTest\n");
+
+   dmtxDecodeDestroy(&dec);
+   for(f = 0; f < 3; f++) {
+      dmtxImageDestroy(&img[f]);
+      free(pxl[f]);
+   }
+
+   if(count.live != 0 || count.frees != count.allocs)
+      FatalError(11, "allocatorArenaTest\n");
+
+   dmtxSetAllocator(NULL);
+}
+
+/**
+ * Scan a 512x192 image under a DmtxPropScanCacheLimit of three 64x64 tiles
+ * and check after every dmtxRegionFindNext() that the scan state held stays
+ * within it. Then fill a second decoder up to a one tile limit, so that
+ * dmtxDecodeGetCache() yields NULL for an untouched pixel, and decode a
+ * region there anyway: its marks must go past the limit.
+ */
+static void
+scanCacheLimitTest(void)
+{
+   int limit;
+   unsigned char *pxl, *cache;
+   const char *str = "CACHE-LIMIT";
+   DmtxImage *img;
+   DmtxDecode *dec;
+   DmtxRegion *reg;
+   DmtxMessage *msg;
+   DmtxVector2 center;
+
+   pxl = testImageCreate(str, 4, 512, 192, 380, 40);
+   img = dmtxImageCreate(pxl, 512, 192, DmtxPack24bppRGB);
+   dec = dmtxDecodeCreate(img, 1);
+   if(img == NULL || dec == NULL)
+      FatalError(1, "scanCacheLimitTest\n");
+
+   if(dmtxDecodeSetProp(dec, DmtxPropScanCacheLimit, -1) != DmtxFail)
+      FatalError(2, "scanCacheLimitTest\n");
+
+   limit = 3 * 64 * 64;
+   if(dmtxDecodeSetProp(dec, DmtxPropScanCacheLimit, limit) == DmtxFail ||
+         dmtxDecodeGetProp(dec, DmtxPropScanCacheLimit) != limit)
+      FatalError(3, "scanCacheLimitTest\n");
+
+   do {
+      reg = dmtxRegionFindNext(dec, NULL);
+      if(dmtxDecodeGetProp(dec, DmtxPropScanCacheBytes) > limit)
+         FatalError(4, "scanCacheLimitTest\n");
+   } while(reg != NULL && dmtxRegionDestroy(&reg) == DmtxPass);
+
+   if(dmtxDecodeGetProp(dec, DmtxPropScanCacheBytes) != limit)
+      FatalError(5, "scanCacheLimitTest\n");
+
+   /* The region to mark comes from a decoder without a limit */
+   dmtxDecodeDestroy(&dec);
+   dec = dmtxDecodeCreate(img, 1);
+   reg = (dec == NULL) ? NULL : dmtxRegionFindNext(dec, NULL);
+   if(reg == NULL)
+      FatalError(6, "scanCacheLimitTest\n");
+   dmtxDecodeDestroy(&dec);
+
+   dec = dmtxDecodeCreate(img, 1);
+   limit = 64 * 64;
+   if(dec == NULL || dmtxDecodeSetProp(dec, DmtxPropScanCacheLimit, limit) == DmtxFail)
+      FatalError(7, "scanCacheLimitTest\n");
+
+   /* Fill the only tile allowed, far from the symbol */
+   if(dmtxDecodeGetCache(dec, 10, 10) == NULL || dmtxDecodeGetCache(dec, 200, 10) != NULL ||
+         dmtxDecodeGetProp(dec, DmtxPropScanCacheBytes) != limit)
+      FatalError(8, "scanCacheLimitTest\n");
+
+   msg = dmtxDecodeMatrixRegion(dec, reg, DmtxUndefined);
+   if(msg == NULL || msg->outputIdx != strlen(str) || memcmp(msg->output, str, msg->outputIdx) != 0)
+      FatalError(9, "scanCacheLimitTest\n");
+
+   center.X = center.Y = 0.5;
+   dmtxMatrix3VMultiplyBy(&center, reg->fit2raw);
+   cache = dmtxDecodeGetCache(dec, (int)center.X, (int)center.Y);
+   if(dmtxDecodeGetProp(dec, DmtxPropScanCacheBytes) <= limit || cache == NULL ||
+         (*cache & 0x80) == 0x00)
+      FatalError(10, "scanCacheLimitTest\n");
+
+   dmtxMessageDestroy(&msg);
+   dmtxRegionDestroy(&reg);
+   dmtxDecodeDestroy(&dec);
+   dmtxImageDestroy(&img);
+   free(pxl);
+}
+
+/**
+ * Encode str in ASCII at a given symbol size with 4 pixel modules and return
+ * a malloc()ed 24bpp image of the symbol and its margin.
+ */
+static unsigned char *
+testSymbolCreate(const char *str, int sizeIdx, int *width, int *height)
+{
+   unsigned char *pxl;
+   DmtxEncode *enc;
+
+   enc = dmtxEncodeCreate();
+   if(enc == NULL)
+      FatalError(1, "testSymbolCreate\n");
+
+   dmtxEncodeSetProp(enc, DmtxPropScheme, DmtxSchemeAscii);
+   dmtxEncodeSetProp(enc, DmtxPropSizeRequest, sizeIdx);
+   dmtxEncodeSetProp(enc, DmtxPropModuleSize, 4);
+   dmtxEncodeSetProp(enc, DmtxPropMarginSize, 8);
+#ifdef HAVE_READER_PROGRAMMING
+   dmtxEncodeDataMatrix(enc, strlen(str), (unsigned char *)str, DmtxFalse);
+#else
+   dmtxEncodeDataMatrix(enc, strlen(str), (unsigned char *)str);
+#endif
+   if(enc->image == NULL)
+      FatalError(2, "testSymbolCreate\n");
+
+   *width = dmtxImageGetProp(enc->image, DmtxPropWidth);
+   *height = dmtxImageGetProp(enc->image, DmtxPropHeight);
+   pxl = (unsigned char *)malloc(*width * *height * 3);
+   if(pxl == NULL)
+      FatalError(3, "testSymbolCreate\n");
+   memcpy(pxl, enc->image->pxl, *width * *height * 3);
+
+   dmtxEncodeDestroy(&enc);
+
+   return pxl;
+}
+
+/**
+ * Find the symbol of a 24bpp image and decode it into msg.
+ */
+static DmtxBoolean
+testDecodeInto(unsigned char *pxl, int width, int height, DmtxMessage *msg)
+{
+   DmtxPassFail passFail;
+   DmtxImage *img;
+   DmtxDecode *dec;
+   DmtxRegion *reg;
+
+   img = dmtxImageCreate(pxl, width, height, DmtxPack24bppRGB);
+   dec = (img == NULL) ? NULL : dmtxDecodeCreate(img, 1);
+   reg = (dec == NULL) ? NULL : dmtxRegionFindNext(dec, NULL);
+   if(reg == NULL)
+      FatalError(1, "testDecodeInto\n");
+
+   passFail = dmtxDecodeMatrixRegionInto(dec, reg, DmtxUndefined, msg);
+
+   dmtxRegionDestroy(&reg);
+   dmtxDecodeDestroy(&dec);
+   dmtxImageDestroy(&img);
+
+   return (passFail == DmtxPass) ? DmtxTrue : DmtxFalse;
+}
+
+/**
+ * Decode a symbol holding a macro 05 or 06 codeword followed by digit pairs
+ * only, the longest output a macro symbol can produce, into a message sized
+ * for it. The encoder does not write macro codewords, but Reed-Solomon
+ * parity is linear and modules are bits, so XORing the images of three
+ * ASCII symbols whose first codewords XOR to the macro codeword, and that
+ * agree everywhere else, gives the image of the macro symbol.
+ */
+static void
+testMacroSymbol(int macro, int sizeIdx)
+{
+   int i, k, width, height, dataWords;
+   char str[3][256], expect[512];
+   unsigned char *pxl[3];
+   DmtxMessage *msg;
+
+   dataWords = dmtxGetSymbolAttribute(DmtxSymAttribSymbolDataWords, sizeIdx);
+
+   /* ASCII codewords are the character plus one; 0x88 = 0x08 ^ 0x80 */
+   str[0][0] = (char)((macro ^ 0x88) - 1);
+   str[1][0] = 0x07;
+   str[2][0] = 0x7f;
+   for(k = 0; k < 3; k++) {
+      for(i = 1; i < 2 * dataWords - 1; i++)
+         str[k][i] = '9';
+      str[k][i] = '\0';
+      pxl[k] = testSymbolCreate(str[k], sizeIdx, &width, &height);
+   }
+
+   for(i = 0; i < width * height * 3; i++)
+      pxl[0][i] ^= pxl[1][i] ^ pxl[2][i];
+
+   sprintf(expect, "[)>\x1e%s\x1d%s\x1e\x04", (macro == 236) ? "05" : "06", str[0] + 1);
+
+   msg = dmtxMessageCreate(sizeIdx, DmtxFormatMatrix);
+   if(msg == NULL || testDecodeInto(pxl[0], width, height, msg) == DmtxFalse)
+      FatalError(1, "testMacroSymbol\n");
+
+   if(msg->outputIdx != strlen(expect) || memcmp(msg->output, expect, msg->outputIdx) != 0 ||
+         msg->outputIdx >= (int)msg->outputSize || msg->outputSize > msg->outputCapacity)
+      FatalError(2, "testMacroSymbol\n");
+
+   dmtxMessageDestroy(&msg);
+   for(k = 0; k < 3; k++)
+      free(pxl[k]);
+}
+
+/**
+ * Decode a 40x40 symbol of digits only, the longest output of any symbol of
+ * that size, and then a small symbol into the same message. The message
+ * starts at the smallest size, so it grows to exactly what DecodeOutputBound
+ * allows for 40x40. The small symbol must reuse the buffers, restart the
+ * output and leave no trace of the large one. Macro symbols are checked
+ * against the bound as well.
+ */
+static void
+messageReuseTest(void)
+{
+   int i, width, height, dataWords;
+   size_t arrayCapacity, codeCapacity, outputCapacity;
+   char digits[256];
+   const char *str = "SMALL";
+   unsigned char *pxl;
+   DmtxMessage *msg;
+
+   dataWords = dmtxGetSymbolAttribute(DmtxSymAttribSymbolDataWords, DmtxSymbol40x40);
+   for(i = 0; i < 2 * dataWords; i++)
+      digits[i] = (char)('0' + (i * 7) % 10);
+   digits[i] = '\0';
+
+   msg = dmtxMessageCreate(DmtxSymbol10x10, DmtxFormatMatrix);
+   if(msg == NULL)
+      FatalError(1, "messageReuseTest\n");
+
+   pxl = testSymbolCreate(digits, DmtxSymbol40x40, &width, &height);
+   if(testDecodeInto(pxl, width, height, msg) == DmtxFalse)
+      FatalError(2, "messageReuseTest\n");
+   free(pxl);
+
+   if(msg->outputIdx != strlen(digits) || memcmp(msg->output, digits, msg->outputIdx) != 0 ||
+         msg->outputIdx >= (int)msg->outputSize || msg->outputSize > msg->outputCapacity)
+      FatalError(3, "messageReuseTest\n");
+
+   arrayCapacity = msg->arrayCapacity;
+   codeCapacity = msg->codeCapacity;
+   outputCapacity = msg->outputCapacity;
+
+   pxl = testSymbolCreate(str, DmtxSymbolSquareAuto, &width, &height);
+   if(testDecodeInto(pxl, width, height, msg) == DmtxFalse)
+      FatalError(4, "messageReuseTest\n");
+   free(pxl);
+
+   if(msg->outputIdx != strlen(str) || memcmp(msg->output, str, msg->outputIdx) != 0)
+      FatalError(5, "messageReuseTest\n");
+
+   for(i = msg->outputIdx; i < (int)msg->outputSize; i++) {
+      if(msg->output[i] != 0x00)
+         FatalError(6, "messageReuseTest\n");
+   }
+
+   if(msg->arrayCapacity != arrayCapacity || msg->codeCapacity != codeCapacity ||
+         msg->outputCapacity != outputCapacity)
+      FatalError(7, "messageReuseTest\n");
+
+   dmtxMessageDestroy(&msg);
+
+   testMacroSymbol(236, DmtxSymbol20x20);
+   testMacroSymbol(237, DmtxSymbol32x32);
+}
+
+/**
+ * Scan and decode a frame of two symbols, then attach a frame whose only
+ * symbol sits across where the first one was. Every scan state byte must be
+ * clear again, and a full scan must match that of a freshly created decoder
+ * call by call: same regions, iteration counts and stop causes.
+ */
+static void
+setImageResetTest(void)
+{
+   int x, y, call;
+   unsigned char *pxl0, *pxl1, *cache;
+   const char *str[] = { "FRAME-ONE", "FRAME-TWO", "FRAME-NEXT" };
+   DmtxImage *img0, *img1;
+   DmtxDecode *dec, *fresh;
+   DmtxRegion *reg, *freshReg;
+   DmtxScanConstraint constraint, freshConstraint;
+
+   pxl0 = testImageCreate(str[0], 4, 320, 200, 30, 40);
+   testImagePaste(pxl0, 320, 200, str[1], 4, 190, 90);
+   pxl1 = testImageCreate(str[2], 4, 320, 200, 60, 70);
+   img0 = dmtxImageCreate(pxl0, 320, 200, DmtxPack24bppRGB);
+   img1 = dmtxImageCreate(pxl1, 320, 200, DmtxPack24bppRGB);
+   dec = dmtxDecodeCreate(img0, 1);
+   if(img0 == NULL || img1 == NULL || dec == NULL)
+      FatalError(1, "setImageResetTest\n");
+
+   if(testDecodeNext(dec, str[0]) == DmtxFalse || testDecodeNext(dec, str[1]) == DmtxFalse ||
+         dmtxRegionFindNext(dec, NULL) != NULL)
+      FatalError(2, "setImageResetTest\n");
+
+   if(dmtxDecodeSetImage(dec, img1) == DmtxFail)
+      FatalError(3, "setImageResetTest\n");
+
+   for(y = 0; y < 200; y++) {
+      for(x = 0; x < 320; x++) {
+         cache = dmtxDecodeGetCache(dec, x, y);
+         if(cache == NULL || *cache != 0x00)
+            FatalError(4, "setImageResetTest\n");
+      }
+   }
+
+   fresh = dmtxDecodeCreate(img1, 1);
+   if(fresh == NULL)
+      FatalError(5, "setImageResetTest\n");
+
+   for(call = 0;; call++) {
+      memset(&constraint, 0x00, sizeof(DmtxScanConstraint));
+      memset(&freshConstraint, 0x00, sizeof(DmtxScanConstraint));
+      reg = dmtxRegionFindNextDeterministic(dec, &constraint);
+      freshReg = dmtxRegionFindNextDeterministic(fresh, &freshConstraint);
+
+      if(constraint.iterations != freshConstraint.iterations ||
+            constraint.stopCause != freshConstraint.stopCause || (reg == NULL) != (freshReg == NULL) ||
+            (reg != NULL && testRegionEqual(reg, freshReg) == DmtxFalse))
+         FatalError(6, "setImageResetTest\n");
+
+      if(reg == NULL)
+         break;
+
+      if(testDecodeRegion(dec, reg, str[2]) == DmtxFalse ||
+            testDecodeRegion(fresh, freshReg, str[2]) == DmtxFalse)
+         FatalError(7, "setImageResetTest\n");
+
+      dmtxRegionDestroy(&reg);
+      dmtxRegionDestroy(&freshReg);
+   }
+
+   if(call != 1)
+      FatalError(8, "setImageResetTest\n");
+
+   dmtxDecodeDestroy(&fresh);
+   dmtxDecodeDestroy(&dec);
+   dmtxImageDestroy(&img1);
+   dmtxImageDestroy(&img0);
+   free(pxl1);
+   free(pxl0);
+}
+
+/**
+ * A faint symbol near the center of a noisy grey image is found first by
+ * the center-out grid scan, while a black on white symbol sits in a corner.
+ * Its module steps of 22 levels pass the region edge threshold but stay
+ * under the saliency edge threshold, so with DmtxPropSaliencyCell set the
+ * corner symbol must come first. Setting the property back to 0 must give
+ * the same scan as a decoder that never had it.
+ */
+static void
+saliencyOrderTest(void)
+{
+   int i;
+   unsigned int seed;
+   unsigned char *pxl;
+   const char *str[] = { "FAINT-CENTER", "SHARP-CORNER" };
+   DmtxImage *img;
+   DmtxDecode *dec, *fresh;
+   DmtxRegion *reg, *freshReg;
+   DmtxScanConstraint constraint, freshConstraint;
+
+   pxl = testImageCreate(str[0], 4, 320, 240, 110, 70);
+   seed = 1;
+   for(i = 0; i < 320 * 240 * 3; i++) {
+      seed = seed * 1103515245u + 12345u;
+      pxl[i] = (unsigned char)(120 + pxl[i] * 22 / 255 + (int)((seed >> 16) % 5) - 2);
+   }
+   testImagePaste(pxl, 320, 240, str[1], 4, 230, 150);
+
+   img = dmtxImageCreate(pxl, 320, 240, DmtxPack24bppRGB);
+   dec = dmtxDecodeCreate(img, 1);
+   if(img == NULL || dec == NULL)
+      FatalError(1, "saliencyOrderTest\n");
+
+   if(testDecodeNext(dec, str[0]) == DmtxFalse)
+      FatalError(2, "saliencyOrderTest\n");
+
+   if(dmtxDecodeSetImage(dec, img) == DmtxFail ||
+         dmtxDecodeSetProp(dec, DmtxPropSaliencyCell, 16) == DmtxFail ||
+         testDecodeNext(dec, str[1]) == DmtxFalse)
+      FatalError(3, "saliencyOrderTest\n");
+
+   if(dmtxDecodeSetImage(dec, img) == DmtxFail ||
+         dmtxDecodeSetProp(dec, DmtxPropSaliencyCell, 0) == DmtxFail)
+      FatalError(4, "saliencyOrderTest\n");
+
+   fresh = dmtxDecodeCreate(img, 1);
+   if(fresh == NULL)
+      FatalError(5, "saliencyOrderTest\n");
+
+   for(i = 0;; i++) {
+      memset(&constraint, 0x00, sizeof(DmtxScanConstraint));
+      memset(&freshConstraint, 0x00, sizeof(DmtxScanConstraint));
+      reg = dmtxRegionFindNextDeterministic(dec, &constraint);
+      freshReg = dmtxRegionFindNextDeterministic(fresh, &freshConstraint);
+
+      if(constraint.iterations != freshConstraint.iterations || (reg == NULL) != (freshReg == NULL) ||
+            (reg != NULL && testRegionEqual(reg, freshReg) == DmtxFalse))
+         FatalError(6, "saliencyOrderTest\n");
+
+      if(reg == NULL)
+         break;
+
+      if(i == 2 || testDecodeRegion(dec, reg, str[i]) == DmtxFalse ||
+            testDecodeRegion(fresh, freshReg, str[i]) == DmtxFalse)
+         FatalError(7, "saliencyOrderTest\n");
+
+      dmtxRegionDestroy(&reg);
+      dmtxRegionDestroy(&freshReg);
+   }
+
+   if(i != 2)
+      FatalError(8, "saliencyOrderTest\n");
+
+   dmtxDecodeDestroy(&fresh);
+   dmtxDecodeDestroy(&dec);
+   dmtxImageDestroy(&img);
+   free(pxl);
+}
+
+/**
+ * Scan an image of three symbols with and without DmtxPropFlowCache. Every
+ * call must return the same region after the same number of iterations,
+ * and the cached scan must have reused flows.
+ */
+static void
+flowCacheTest(void)
+{
+   int i;
+   unsigned char *pxl;
+   const char *str[] = { "FLOW-ONE", "FLOW-TWO", "FLOW-THREE" };
+   DmtxImage *img;
+   DmtxDecode *dec, *cached;
+   DmtxRegion *reg, *cachedReg;
+   DmtxScanConstraint constraint, cachedConstraint;
+
+   pxl = testImageCreate(str[0], 4, 400, 160, 10, 40);
+   testImagePaste(pxl, 400, 160, str[1], 4, 140, 40);
+   testImagePaste(pxl, 400, 160, str[2], 4, 270, 40);
+   img = dmtxImageCreate(pxl, 400, 160, DmtxPack24bppRGB);
+   dec = dmtxDecodeCreate(img, 1);
+   cached = dmtxDecodeCreate(img, 1);
+   if(img == NULL || dec == NULL || cached == NULL)
+      FatalError(1, "flowCacheTest\n");
+
+   if(dmtxDecodeSetProp(cached, DmtxPropFlowCache, 1) == DmtxFail ||
+         dmtxDecodeGetProp(cached, DmtxPropFlowCache) != DmtxTrue ||
+         dmtxDecodeGetProp(dec, DmtxPropFlowCache) != DmtxFalse)
+      FatalError(2, "flowCacheTest\n");
+
+   for(i = 0;; i++) {
+      memset(&constraint, 0x00, sizeof(DmtxScanConstraint));
+      memset(&cachedConstraint, 0x00, sizeof(DmtxScanConstraint));
+      reg = dmtxRegionFindNextDeterministic(dec, &constraint);
+      cachedReg = dmtxRegionFindNextDeterministic(cached, &cachedConstraint);
+
+      if(constraint.iterations != cachedConstraint.iterations ||
+            constraint.stopCause != cachedConstraint.stopCause || (reg == NULL) != (cachedReg == NULL) ||
+            (reg != NULL && testRegionEqual(reg, cachedReg) == DmtxFalse))
+         FatalError(3, "flowCacheTest\n");
+
+      if(reg == NULL)
+         break;
+
+      if(i == 3 || testDecodeRegion(dec, reg, str[i]) == DmtxFalse ||
+            testDecodeRegion(cached, cachedReg, str[i]) == DmtxFalse)
+         FatalError(4, "flowCacheTest\n");
+
+      dmtxRegionDestroy(&reg);
+      dmtxRegionDestroy(&cachedReg);
+   }
+
+   if(i != 3 || dmtxDecodeGetProp(cached, DmtxPropFlowCacheHits) <= 0 ||
+         dmtxDecodeGetProp(dec, DmtxPropFlowCacheHits) != 0)
+      FatalError(5, "flowCacheTest\n");
+
+   dmtxDecodeDestroy(&cached);
+   dmtxDecodeDestroy(&dec);
+   dmtxImageDestroy(&img);
+   free(pxl);
+}
+
+/**
+ * Allocation hooks that refuse every request while still releasing blocks
+ * from the default allocator.
+ */
+static void *
+testAllocRefuse(size_t size, void *userData)
+{
+   (void)size;
+   (void)userData;
+
+   return NULL;
+}
+
+static void
+testRelease(void *ptr, void *userData)
+{
+   (void)userData;
+
+   free(ptr);
+}
+
+/**
+ * Decode a blue on yellow symbol packed as RGB, BGR and RGBX through each
+ * channel, a luma plane and the widest channel; every path must give the
+ * same message. A luma plane cannot be built from 16bpp pixels, so asking
+ * for one must fail and keep the channels in use. A change that fails for
+ * lack of memory must leave the previous luma plane in use, read just like
+ * the plane of a fresh decoder.
+ */
+static void
+scanPlaneTest(void)
+{
+   int i, p, k, x, y, value, freshValue;
+   unsigned char *rgb, *pxl, *pxl16;
+   const char *str = "PLANE-0123";
+   const unsigned char dark[] = { 40, 60, 160 }, light[] = { 250, 220, 60 };
+   int pack[] = { DmtxPack24bppRGB, DmtxPack24bppBGR, DmtxPack32bppRGBX };
+   int plane[] = { DmtxScanPlaneChannels, DmtxScanPlaneLuma, DmtxScanPlaneBestChannel };
+   DmtxImage *img;
+   DmtxDecode *dec, *fresh;
+   DmtxAllocator hooks;
+
+   rgb = testImageCreate(str, 4, 200, 160, 40, 20);
+   for(i = 0; i < 200 * 160; i++) {
+      for(k = 0; k < 3; k++)
+         rgb[i * 3 + k] = (rgb[i * 3] < 128) ? dark[k] : light[k];
+   }
+
+   pxl = (unsigned char *)malloc(200 * 160 * 4);
+   if(pxl == NULL)
+      FatalError(1, "scanPlaneTest\n");
+
+   for(p = 0; p < 3; p++) {
+      for(i = 0; i < 200 * 160; i++) {
+         for(k = 0; k < 3; k++) {
+            if(pack[p] == DmtxPack24bppRGB)
+               pxl[i * 3 + k] = rgb[i * 3 + k];
+            else if(pack[p] == DmtxPack24bppBGR)
+               pxl[i * 3 + k] = rgb[i * 3 + 2 - k];
+            else
+               pxl[i * 4 + k] = rgb[i * 3 + k];
+         }
+         if(pack[p] == DmtxPack32bppRGBX)
+            pxl[i * 4 + 3] = 0xff;
+      }
+
+      img = dmtxImageCreate(pxl, 200, 160, pack[p]);
+      if(img == NULL)
+         FatalError(2, "scanPlaneTest\n");
+
+      for(k = 0; k < 3; k++) {
+         dec = dmtxDecodeCreate(img, 1);
+         if(dec == NULL || dmtxDecodeSetProp(dec, DmtxPropScanPlane, plane[k]) == DmtxFail ||
+               testDecodeNext(dec, str) == DmtxFalse)
+            FatalError(3, "scanPlaneTest\n");
+         dmtxDecodeDestroy(&dec);
+      }
+
+      dmtxImageDestroy(&img);
+   }
+
+   /* 5 bit channels cannot feed a plane */
+   pxl16 = (unsigned char *)calloc(200 * 160, 2);
+   img = (pxl16 == NULL) ? NULL : dmtxImageCreate(pxl16, 200, 160, DmtxPack16bppRGB);
+   dec = (img == NULL) ? NULL : dmtxDecodeCreate(img, 1);
+   if(dec == NULL || dmtxDecodeSetProp(dec, DmtxPropScanPlane, DmtxScanPlaneLuma) != DmtxFail ||
+         dmtxDecodeSetProp(dec, DmtxPropScanPlane, 99) != DmtxFail ||
+         dmtxDecodeGetProp(dec, DmtxPropScanPlane) != DmtxScanPlaneChannels)
+      FatalError(4, "scanPlaneTest\n");
+   dmtxDecodeDestroy(&dec);
+   dmtxImageDestroy(&img);
+   free(pxl16);
+
+   /* A luma plane survives a switch that cannot allocate its flow cache */
+   img = dmtxImageCreate(rgb, 200, 160, DmtxPack24bppRGB);
+   dec = (img == NULL) ? NULL : dmtxDecodeCreate(img, 1);
+   fresh = (img == NULL) ? NULL : dmtxDecodeCreate(img, 1);
+   if(dec == NULL || fresh == NULL ||
+         dmtxDecodeSetProp(dec, DmtxPropScanPlane, DmtxScanPlaneLuma) == DmtxFail ||
+         dmtxDecodeSetProp(dec, DmtxPropFlowCache, 1) == DmtxFail ||
+         dmtxDecodeSetProp(fresh, DmtxPropScanPlane, DmtxScanPlaneLuma) == DmtxFail)
+      FatalError(5, "scanPlaneTest\n");
+
+   hooks.alloc = testAllocRefuse;
+   hooks.release = testRelease;
+   hooks.userData = NULL;
+   dmtxSetAllocator(&hooks);
+   if(dmtxDecodeSetProp(dec, DmtxPropScanPlane, DmtxScanPlaneBestChannel) != DmtxFail)
+      FatalError(6, "scanPlaneTest\n");
+   dmtxSetAllocator(NULL);
+
+   if(dmtxDecodeGetProp(dec, DmtxPropScanPlane) != DmtxScanPlaneLuma)
+      FatalError(7, "scanPlaneTest\n");
+
+   for(y = 0; y < 160; y++) {
+      for(x = 0; x < 200; x++) {
+         if(dmtxDecodeGetPixelValue(dec, x, y, 0, &value) == DmtxFail ||
+               dmtxDecodeGetPixelValue(fresh, x, y, 0, &freshValue) == DmtxFail ||
+               value != freshValue)
+            FatalError(8, "scanPlaneTest\n");
+      }
+   }
+
+   if(testDecodeNext(dec, str) == DmtxFalse)
+      FatalError(9, "scanPlaneTest\n");
+
+   dmtxDecodeDestroy(&fresh);
+   dmtxDecodeDestroy(&dec);
+   dmtxImageDestroy(&img);
+   free(pxl);
+   free(rgb);
+}